@@ -0,0 +1,491 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*------------------------------------------------------------------------------
+
+                Name: mdsbench
+
+                Type:   C main program
+
+                Purpose: Throughput benchmarks of the MDSplus hot paths
+
+------------------------------------------------------------------------------
+
+        Description:
+
+   mdsbench builds a synthetic tree with a configurable number of signal
+   nodes and measures segment and row writes, record reads, resampled reads
+   through XTreeGetTimedRecord, TdiCompile/TdiExecute, serialization,
+   compression and mdsip round trips. Every benchmark writes one result
+   line, either as a JSON object (default) or as CSV, so runs can be
+   compared by scripts. `make bench` in the top build directory runs it
+   with the default parameters against local:// and a tcp server started
+   for the occasion.
+
+   Usage: mdsbench [-n nodes] [-s segment_rows] [-S segments] [-r rows]
+                   [-i iterations] [-a array_size] [-d tree_dir]
+                   [-c connection]... [-o file] [-f json|csv] [-b bench]...
+
++-----------------------------------------------------------------------------*/
+#include <mdsplus/mdsconfig.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ipdesc.h>
+#include <mds_stdarg.h>
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+#include <status.h>
+#include <treeshr.h>
+#include <usagedef.h>
+#include <xtreeshr.h>
+
+extern int TdiCompile();
+extern int TdiExecute();
+
+#define TREE "mdsbench"
+#define SHOT 1
+#define NODEFMTSTR "S%05d"
+#define MAX_CONNECTIONS 8
+#define MAX_SELECTED 16
+
+static int num_nodes = 64;
+static int seg_rows = 10000;
+static int num_segs = 10;
+static int num_rows = 10000;
+static int iterations = 1000;
+static int array_size = 1000000;
+static char *tree_dir = NULL;
+static char *connections[MAX_CONNECTIONS];
+static int num_connections = 0;
+static char *selected[MAX_SELECTED];
+static int num_selected = 0;
+static FILE *out = NULL;
+static int csv = 0;
+static int failed = 0;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int enabled(const char *name)
+{
+  int i;
+  if (num_selected == 0)
+    return 1;
+  for (i = 0; i < num_selected; i++)
+    if (!strcmp(selected[i], name))
+      return 1;
+  return 0;
+}
+
+static void report(const char *name, const char *target, int64_t ops,
+                   int64_t bytes, double seconds)
+{
+  double ops_s = seconds > 0 ? ops / seconds : 0;
+  double mb_s = seconds > 0 ? bytes / seconds / 1e6 : 0;
+  if (csv)
+    fprintf(out, "%s,%s,%d,%d,%d,%" PRId64 ",%" PRId64 ",%.6f,%.1f,%.3f\n",
+            name, target, num_nodes, seg_rows, num_segs, ops, bytes, seconds,
+            ops_s, mb_s);
+  else
+    fprintf(out,
+            "{\"bench\": \"%s\", \"target\": \"%s\", \"nodes\": %d, "
+            "\"segment_rows\": %d, \"segments\": %d, \"ops\": %" PRId64
+            ", \"bytes\": %" PRId64 ", \"seconds\": %.6f, "
+            "\"ops_per_sec\": %.1f, \"mb_per_sec\": %.3f}\n",
+            name, target, num_nodes, seg_rows, num_segs, ops, bytes, seconds,
+            ops_s, mb_s);
+  fflush(out);
+}
+
+#define CHECK(call)                                                 \
+  do                                                                \
+  {                                                                 \
+    int _status = (call);                                           \
+    if (IS_NOT_OK(_status))                                         \
+    {                                                               \
+      fprintf(stderr, "%s:%d %s: %s\n", __FILE__, __LINE__, #call,  \
+              MdsGetMsg(_status));                                  \
+      failed = 1;                                                   \
+      goto end;                                                     \
+    }                                                               \
+  } while (0)
+
+/* release a context left open by a failed CHECK */
+static void close_dbid(void **dbid)
+{
+  if (*dbid)
+  {
+    _TreeClose(dbid, NULL, 0);
+    TreeFreeDbid(*dbid);
+    *dbid = NULL;
+  }
+}
+
+static void bench_build_tree()
+{
+  void *dbid = NULL;
+  int i, nid;
+  char name[16];
+  double start = now();
+  CHECK(_TreeOpenNew(&dbid, TREE, SHOT));
+  for (i = 0; i < num_nodes; i++)
+  {
+    sprintf(name, NODEFMTSTR, i);
+    CHECK(_TreeAddNode(dbid, name, &nid, TreeUSAGE_SIGNAL));
+  }
+  CHECK(_TreeWriteTree(&dbid, NULL, 0));
+  CHECK(_TreeClose(&dbid, NULL, 0));
+  report("build_tree", "local", num_nodes, 0, now() - start);
+end:;
+  close_dbid(&dbid);
+}
+
+static void bench_put_segment()
+{
+  void *dbid = NULL;
+  int i, j, k, nid;
+  char name[16];
+  int64_t start_t, end_t;
+  int64_t *dim = malloc(seg_rows * sizeof(*dim));
+  float *data = malloc(seg_rows * sizeof(*data));
+  mdsdsc_t dstart = {8, DTYPE_Q, CLASS_S, (char *)&start_t};
+  mdsdsc_t dend = {8, DTYPE_Q, CLASS_S, (char *)&end_t};
+  DESCRIPTOR_A(ddim, sizeof(*dim), DTYPE_Q, (char *)dim,
+               seg_rows * sizeof(*dim));
+  DESCRIPTOR_A(ddata, sizeof(*data), DTYPE_FS, (char *)data,
+               seg_rows * sizeof(*data));
+  for (j = 0; j < seg_rows; j++)
+    data[j] = (float)j;
+  double start = now();
+  int status = _TreeOpen(&dbid, TREE, SHOT, 0);
+  for (i = 0; STATUS_OK && i < num_nodes; i++)
+  {
+    sprintf(name, NODEFMTSTR, i);
+    status = _TreeFindNode(dbid, name, &nid);
+    for (k = 0; STATUS_OK && k < num_segs; k++)
+    {
+      for (j = 0; j < seg_rows; j++)
+        dim[j] = (int64_t)k * seg_rows + j;
+      start_t = dim[0];
+      end_t = dim[seg_rows - 1];
+      status = _TreeMakeSegment(dbid, nid, &dstart, &dend, (mdsdsc_t *)&ddim,
+                                (mdsdsc_a_t *)&ddata, -1, seg_rows);
+    }
+  }
+  CHECK(status);
+  CHECK(_TreeClose(&dbid, NULL, 0));
+  report("put_segment", "local", (int64_t)num_nodes * num_segs,
+         (int64_t)num_nodes * num_segs * seg_rows * (8 + sizeof(float)),
+         now() - start);
+end:;
+  free(dim);
+  free(data);
+  close_dbid(&dbid);
+}
+
+static void bench_put_row()
+{
+  void *dbid = NULL;
+  int i, nid;
+  char name[16];
+  float value = 0;
+  int64_t timestamp;
+  DESCRIPTOR_A(drow, sizeof(value), DTYPE_FS, (char *)&value, sizeof(value));
+  double start = now();
+  CHECK(_TreeOpen(&dbid, TREE, SHOT, 0));
+  sprintf(name, NODEFMTSTR, 0);
+  CHECK(_TreeFindNode(dbid, name, &nid));
+  /* append after the segments written by put_segment */
+  for (i = 0; i < num_rows; i++)
+  {
+    timestamp = (int64_t)num_segs * seg_rows + i;
+    value = (float)i;
+    CHECK(_TreePutRow(dbid, nid, seg_rows, &timestamp, (mdsdsc_a_t *)&drow));
+  }
+  CHECK(_TreeClose(&dbid, NULL, 0));
+  report("put_row", "local", num_rows, (int64_t)num_rows * (8 + sizeof(value)),
+         now() - start);
+end:;
+  close_dbid(&dbid);
+}
+
+static void bench_get_record()
+{
+  void *dbid = NULL;
+  int i, nid;
+  char name[16];
+  int64_t bytes = 0;
+  EMPTYXD(xd);
+  double start = now();
+  CHECK(_TreeOpen(&dbid, TREE, SHOT, 1));
+  for (i = 0; i < num_nodes; i++)
+  {
+    sprintf(name, NODEFMTSTR, i);
+    CHECK(_TreeFindNode(dbid, name, &nid));
+    CHECK(_TreeGetRecord(dbid, nid, &xd));
+    bytes += xd.l_length;
+  }
+  CHECK(_TreeClose(&dbid, NULL, 0));
+  report("get_record", "local", num_nodes, bytes, now() - start);
+end:;
+  MdsFree1Dx(&xd, NULL);
+  close_dbid(&dbid);
+}
+
+static void bench_get_timed_record()
+{
+  int i, nid;
+  char name[16];
+  int64_t bytes = 0;
+  int opened = 0;
+  int64_t t0 = seg_rows / 2, t1 = (int64_t)num_segs * seg_rows - seg_rows / 2,
+          delta = 100;
+  mdsdsc_t dstart = {8, DTYPE_Q, CLASS_S, (char *)&t0};
+  mdsdsc_t dend = {8, DTYPE_Q, CLASS_S, (char *)&t1};
+  mdsdsc_t ddelta = {8, DTYPE_Q, CLASS_S, (char *)&delta};
+  EMPTYXD(xd);
+  double start = now();
+  CHECK(TreeOpen(TREE, SHOT, 1));
+  opened = 1;
+  for (i = 0; i < num_nodes; i++)
+  {
+    sprintf(name, NODEFMTSTR, i);
+    CHECK(TreeFindNode(name, &nid));
+    CHECK(XTreeGetTimedRecord(nid, &dstart, &dend, &ddelta, &xd));
+    bytes += xd.l_length;
+  }
+  opened = 0;
+  CHECK(TreeClose(TREE, SHOT));
+  report("get_timed_record", "local", num_nodes, bytes, now() - start);
+end:;
+  MdsFree1Dx(&xd, NULL);
+  if (opened)
+    TreeClose(TREE, SHOT);
+}
+
+static const char expression[] =
+    "_x = build_range(0., 999., 1.); sum(sin(_x) * _x + 2. * cos(_x))";
+
+static void bench_tdi()
+{
+  int i;
+  struct descriptor expr_d = {sizeof(expression) - 1, DTYPE_T, CLASS_S,
+                              (char *)expression};
+  EMPTYXD(xd);
+  double start = now();
+  for (i = 0; i < iterations; i++)
+    CHECK(TdiCompile(&expr_d, &xd MDS_END_ARG));
+  report("tdi_compile", "local", iterations, 0, now() - start);
+  start = now();
+  for (i = 0; i < iterations; i++)
+    CHECK(TdiExecute(&expr_d, &xd MDS_END_ARG));
+  report("tdi_execute", "local", iterations, 0, now() - start);
+end:;
+  MdsFree1Dx(&xd, NULL);
+}
+
+static void bench_serialize()
+{
+  int i;
+  int *data = malloc(array_size * sizeof(*data));
+  for (i = 0; i < array_size; i++)
+    data[i] = i % 1000;
+  DESCRIPTOR_A(ddata, sizeof(*data), DTYPE_L, (char *)data,
+               array_size * sizeof(*data));
+  EMPTYXD(ser);
+  EMPTYXD(xd);
+  EMPTYXD(dxd);
+  int n = iterations / 10 > 0 ? iterations / 10 : 1;
+  double start = now();
+  for (i = 0; i < n; i++)
+    CHECK(MdsSerializeDscOut((mdsdsc_t *)&ddata, &ser));
+  report("serialize_out", "local", n, (int64_t)n * ddata.arsize, now() - start);
+  start = now();
+  for (i = 0; i < n; i++)
+    CHECK(MdsSerializeDscIn(ser.pointer->pointer, &xd));
+  report("serialize_in", "local", n, (int64_t)n * ddata.arsize, now() - start);
+  start = now();
+  for (i = 0; i < n; i++)
+    CHECK(MdsCompress(NULL, NULL, (mdsdsc_t *)&ddata, &xd));
+  report("compress", "local", n, (int64_t)n * ddata.arsize, now() - start);
+  if (xd.pointer)
+  {
+    start = now();
+    for (i = 0; i < n; i++)
+      CHECK(MdsDecompress((mdsdsc_r_t *)xd.pointer, &dxd));
+    report("decompress", "local", n, (int64_t)n * ddata.arsize, now() - start);
+  }
+end:;
+  MdsFree1Dx(&dxd, NULL);
+  MdsFree1Dx(&xd, NULL);
+  MdsFree1Dx(&ser, NULL);
+  free(data);
+}
+
+static void bench_mdsip(char *connection)
+{
+  int i;
+  struct descrip ans;
+  int conid = ConnectToMds(connection);
+  if (conid == -1)
+  {
+    fprintf(stderr, "Cannot connect to %s\n", connection);
+    failed = 1;
+    return;
+  }
+  double start = now();
+  for (i = 0; i < iterations; i++)
+  {
+    memset(&ans, 0, sizeof(ans));
+    CHECK(MdsValue(conid, "1", &ans, NULL));
+    free(ans.ptr);
+  }
+  report("mdsip_roundtrip", connection, iterations, 0, now() - start);
+  int64_t bytes = 0;
+  int n = iterations / 10 > 0 ? iterations / 10 : 1;
+  char expr[64];
+  sprintf(expr, "zero(%d, 0.)", array_size);
+  start = now();
+  for (i = 0; i < n; i++)
+  {
+    memset(&ans, 0, sizeof(ans));
+    CHECK(MdsValue(conid, expr, &ans, NULL));
+    bytes += (int64_t)array_size * ans.length;
+    free(ans.ptr);
+  }
+  report("mdsip_array", connection, n, bytes, now() - start);
+end:;
+  DisconnectFromMds(conid);
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+          "Usage: %s [-n nodes] [-s segment_rows] [-S segments] [-r rows]\n"
+          "          [-i iterations] [-a array_size] [-d tree_dir]\n"
+          "          [-c connection]... [-o file] [-f json|csv] [-b bench]...\n"
+          "benchmarks: build_tree put_segment put_row get_record\n"
+          "            get_timed_record tdi serialize mdsip\n",
+          prog);
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  int opt, i;
+  char *outfile = NULL;
+  while ((opt = getopt(argc, argv, "n:s:S:r:i:a:d:c:o:f:b:h")) != -1)
+  {
+    switch (opt)
+    {
+    case 'n':
+      num_nodes = atoi(optarg);
+      break;
+    case 's':
+      seg_rows = atoi(optarg);
+      break;
+    case 'S':
+      num_segs = atoi(optarg);
+      break;
+    case 'r':
+      num_rows = atoi(optarg);
+      break;
+    case 'i':
+      iterations = atoi(optarg);
+      break;
+    case 'a':
+      array_size = atoi(optarg);
+      break;
+    case 'd':
+      tree_dir = optarg;
+      break;
+    case 'c':
+      if (num_connections < MAX_CONNECTIONS)
+        connections[num_connections++] = optarg;
+      break;
+    case 'o':
+      outfile = optarg;
+      break;
+    case 'f':
+      csv = !strcmp(optarg, "csv");
+      break;
+    case 'b':
+      if (num_selected < MAX_SELECTED)
+        selected[num_selected++] = optarg;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (num_nodes <= 0 || seg_rows <= 0 || num_segs <= 0 || num_rows <= 0 ||
+      iterations <= 0 || array_size <= 0)
+    usage(argv[0]);
+  out = outfile ? fopen(outfile, "w") : stdout;
+  if (!out)
+  {
+    perror(outfile);
+    return 1;
+  }
+  if (csv)
+    fprintf(out, "bench,target,nodes,segment_rows,segments,ops,bytes,"
+                 "seconds,ops_per_sec,mb_per_sec\n");
+  char *path = malloc(strlen(TREE) + strlen(tree_dir ? tree_dir : ".") + 8);
+  sprintf(path, "%s_path=%s", TREE, tree_dir ? tree_dir : ".");
+  MdsPutEnv(path);
+  free(path);
+  /* the tree benchmarks depend on each other and always run together */
+  if (enabled("build_tree") || enabled("put_segment") || enabled("put_row") ||
+      enabled("get_record") || enabled("get_timed_record"))
+  {
+    bench_build_tree();
+    if (!failed)
+      bench_put_segment();
+    if (!failed)
+      bench_put_row();
+    if (!failed)
+      bench_get_record();
+    if (!failed)
+      bench_get_timed_record();
+  }
+  if (enabled("tdi"))
+    bench_tdi();
+  if (enabled("serialize"))
+    bench_serialize();
+  if (enabled("mdsip"))
+    for (i = 0; i < num_connections; i++)
+      bench_mdsip(connections[i]);
+  if (out != stdout)
+    fclose(out);
+  return failed;
+}
@@ -1029,6 +1029,7 @@ int BASLER_ACA::startFramesAcquisition()
 
 	void *saveList;
 	void *streamingList;
+	void *frameRing;
 
         void *frameBuffer;
 	unsigned char *metaData;
@@ -1061,18 +1062,12 @@ int BASLER_ACA::startFramesAcquisition()
           }
         }
 
-        if(this->Bpp==1)
-        {
-          frameBuffer = (char *) calloc(1, width * height * sizeof(char));
-        }
-        if(this->Bpp==2)
-        {
-          frameBuffer = (short *) calloc(1, width * height * sizeof(short));
-        }
 	frame8bit = (unsigned char *) calloc(1, width * height * sizeof(char));
 
         metaSize = sizeof(BASLERMETADATA);
-	metaData = (unsigned char *)calloc(1, metaSize);
+
+        //frames are acquired directly in the ring buffers and handed to the save and streaming threads without copy
+        camFrameRingCreate(0, width * height * this->Bpp, metaSize, &frameRing);
    
         camStartSave(&saveList); //  # Initialize save frame Linked list reference
    	camStartStreaming(&streamingList); //  # Initialize streaming frame Linked list reference
@@ -1087,6 +1082,7 @@ int BASLER_ACA::startFramesAcquisition()
         while ( acqFlag )
 	{
 
+        frameBuffer = camFrameRingClaim(frameRing, (void **)&metaData);
         getFrame( &frameStatus, frameBuffer, metaData);   //get the frame  
 
         if(storeEnabled)
@@ -1197,7 +1193,7 @@ int BASLER_ACA::startFramesAcquisition()
 //          camSaveFrame((void *)frameBuffer, width, height, frameTime, 14, (void *)treePtr, framesNid, timebaseNid, frameTimeBaseIdx, (void *)metaData, metaSize, framesMetadNid, saveList); 
           //printf("%s: SAVE FRAME: %d of %d frame time %f\n", this->ipAddress, frameTriggerCounter+1, burstNframe, frameTime+timeOffset);                              
 
-          camSaveFrame((void *)frameBuffer, width, height, frameTime+timeOffset, 8*this->Bpp, (void *)treePtr, framesNid, timebaseNid, frameTimeBaseIdx, (void *)metaData, metaSize, framesMetadNid, saveList); 
+          camSaveFrameRing((void *)frameBuffer, width, height, frameTime+timeOffset, 8*this->Bpp, (void *)treePtr, framesNid, timebaseNid, frameTimeBaseIdx, (void *)metaData, metaSize, framesMetadNid, saveList, frameRing); 
 	  enqueueFrameNumber++;
 
 	} 
@@ -1221,9 +1217,10 @@ int BASLER_ACA::startFramesAcquisition()
 	    //if ( (streamingSkipFrameNumber - 1 <= 0) || (frameCounter % ( streamingSkipFrameNumber - 1)) == 0 )  //20170327 - ORIGINAL
             else if((this->frameRate<10) || (frameCounter % int(this->frameRate/10.0))==0)  //send frame @ 10Hz. Reduce CPU usage.
 	    {
- 	        camStreamingFrame( tcpStreamHandle, frameBuffer, width, height, pixelFormat, 0, autoAdjustLimit, &lowLim, &highLim, minLim, maxLim, adjRoiX, adjRoiY, adjRoiW, adjRoiH, this->deviceName, streamingList);
+ 	        camStreamingFrameRing( tcpStreamHandle, frameBuffer, width, height, pixelFormat, 0, autoAdjustLimit, &lowLim, &highLim, minLim, maxLim, adjRoiX, adjRoiY, adjRoiW, adjRoiH, this->deviceName, streamingList, frameRing);
 	    }             
 	} // if( streamingEnabled )
+        camFrameRingCommit(frameRing);
         frameCounter++;           //never resetted, used for frame timestamp     
         if ( startStoreTrg == 1 ) //increment saved frame index only if acquisition has been triggered
         {
@@ -1239,6 +1236,10 @@ int BASLER_ACA::startFramesAcquisition()
     camStopSave(saveList); // Stop asynhronous store stream
     camStopStreaming(streamingList); // Stop asynhronous frame streaming
 
+    if( camFrameRingOverflows(frameRing) > 0 )
+      printf("%s: %d frames did not fit in the frame ring\n", this->ipAddress, camFrameRingOverflows(frameRing));
+    camFrameRingDestroy(frameRing);
+
     if( tcpStreamHandle != -1 )
       camCloseTcpConnection(&tcpStreamHandle);  
 
@@ -1246,9 +1247,7 @@ int BASLER_ACA::startFramesAcquisition()
     if (rstatus < 0)
 	sprintf(error,"%s: Cannot stop camera acquisition\n", this->ipAddress);
    
-    free(frameBuffer);
     free(frame8bit);
-    free(metaData);
 
     //printf("%s: Acquisition Statistics : Total frames read %d, \n\t\t\t\t\tTotal frames stored %d (expected %d), \n\t\t\t\t\tNumber of trigger %d (expected %d), \n\t\t\t\t\tIncomplete frame %d\n", this->ipAddress, frameCounter, enqueueFrameNumber, numTrigger * ( (int)( burstDuration * (frameRate - acqSkipFrameNumber)) + 1), NtriggerCount + startStoreTrg, numTrigger, incompleteFrame );
 
@@ -0,0 +1,130 @@
+#ifndef CAMFRAMERING_H
+#define CAMFRAMERING_H
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+//Fixed pool of frame buffers shared by the acquisition thread and the save and streaming consumers.
+//The acquisition thread claims the next buffer, lets the camera driver fill it, hands the same pointer
+//to the consumers that want the frame and commits it. Every consumer holding the frame releases it once done
+//and the buffer is reused when the last reference goes away, so no frame is ever copied.
+//Reference counts are atomic: claim/commit are called only by the acquisition thread and release by any consumer,
+//without locks. When the consumers lag and every slot is still referenced, claim() hands out a heap buffer
+//instead, so acquisition never blocks.
+class CamFrameRing
+{
+    static const size_t ALIGN = 64;
+
+    struct Ref
+    {
+        std::atomic<int> refs;
+    };
+
+    char *frames;
+    char *metas;
+    Ref *slots;
+    int nSlots;
+    size_t frameBytes;
+    size_t metaBytes;
+    int head;                      //next slot to claim (acquisition thread only)
+    char *current;                 //frame returned by the last claim()
+    std::atomic<int> overflows;
+
+    static size_t roundUp(size_t size)
+    {
+        return (size + ALIGN - 1) & ~(ALIGN - 1);
+    }
+
+    bool inRing(void *frame)
+    {
+        return (char *)frame >= frames && (char *)frame < frames + nSlots * frameBytes;
+    }
+
+    std::atomic<int> &refsOf(void *frame)
+    {
+        if(inRing(frame))
+            return slots[((char *)frame - frames) / frameBytes].refs;
+        return ((Ref *)((char *)frame - ALIGN))->refs;
+    }
+
+ public:
+    CamFrameRing(int nSlots, size_t frameBytes, size_t metaBytes)
+    {
+        this->nSlots = nSlots;
+        this->frameBytes = roundUp(frameBytes);
+        this->metaBytes = roundUp(metaBytes);
+        frames = (char *)calloc(nSlots, this->frameBytes);
+        metas = (char *)calloc(nSlots, this->metaBytes);
+        slots = new Ref[nSlots];
+        for(int i = 0; i < nSlots; i++)
+            slots[i].refs.store(0);
+        head = 0;
+        current = 0;
+        overflows.store(0);
+    }
+
+    //to be deleted only once the consumers have been stopped
+    ~CamFrameRing()
+    {
+        free(frames);
+        free(metas);
+        delete [] slots;
+    }
+
+    //return the buffer for the next frame and its metadata (acquisition thread).
+    //Slots still held by a slow consumer are skipped.
+    void *claim(void **meta)
+    {
+        for(int i = 0; i < nSlots; i++)
+        {
+            int idx = (head + i) % nSlots;
+            if(slots[idx].refs.load(std::memory_order_acquire) == 0)
+            {
+                slots[idx].refs.store(1, std::memory_order_relaxed);
+                current = frames + idx * frameBytes;
+                if(meta)
+                    *meta = metas + idx * metaBytes;
+                head = (idx + 1) % nSlots;
+                return current;
+            }
+        }
+        char *buf = (char *)malloc(ALIGN + frameBytes + metaBytes);
+        new (buf) Ref();
+        ((Ref *)buf)->refs.store(1, std::memory_order_relaxed);
+        current = buf + ALIGN;
+        if(meta)
+            *meta = current + frameBytes;
+        overflows.fetch_add(1, std::memory_order_relaxed);
+        return current;
+    }
+
+    //take a reference on a frame for a consumer. Must be called before commit()
+    void hold(void *frame)
+    {
+        refsOf(frame).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //drop the reference of the acquisition thread on the last claimed frame
+    void commit()
+    {
+        if(current)
+            release(current);
+        current = 0;
+    }
+
+    //drop a consumer reference
+    void release(void *frame)
+    {
+        if(refsOf(frame).fetch_sub(1, std::memory_order_acq_rel) == 1 && !inRing(frame))
+            free((char *)frame - ALIGN);
+    }
+
+    //number of frames that did not fit in the ring
+    int getOverflows()
+    {
+        return overflows.load(std::memory_order_relaxed);
+    }
+};
+
+#endif
@@ -27,6 +27,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <mdsobjects.h>
 using namespace MDSplus;
 #include "cammdsutils.h"
+#include "camframering.h"
 
 using namespace std;
 
@@ -59,8 +60,22 @@ class SaveFrame {
     int  numPixel; 
     int  discardBlackFrame = 0;
 
+    CamFrameRing *ring;     //frame buffer owner, 0 when the frame is a private copy
+
     SaveFrame *nxt;
 
+    void freeFrame()
+    {
+        if(ring)
+            ring->release(frame);
+        else if(pixelSize<=8)
+            delete (char *) frame;
+        else if(pixelSize<=16)
+            delete (short *)frame;
+        else if(pixelSize<=32)
+            delete (int *) frame;
+    }
+
  public:
     SaveFrame(void *frame, int width, int height, float frameTime, int pixelSize, void *treePtr, int dataNid, int timebaseNid, int frameIdx, void *frameMetadata, int metaSize, int metaNid,
               int pixelLevel, int numPixel)
@@ -81,6 +96,7 @@ class SaveFrame {
 		this->metaNid = metaNid;
 
 		this->treePtr = treePtr;
+		ring = 0;
 
         if( pixelLevel > 0 && numPixel > 0 )
         {
@@ -113,9 +129,15 @@ class SaveFrame {
         discardBlackFrame = 0;
 
 		this->treePtr = treePtr;
+		ring = 0;
 		nxt = 0;
     }
 
+    void setRing(CamFrameRing *ring)
+    {
+		this->ring = ring;
+    }
+
     void setNext(SaveFrame *itm)
     {
 		nxt = itm;
@@ -166,12 +188,7 @@ class SaveFrame {
 
 printf("Is Black Frame.\n");
 
-			if(pixelSize<=8)
-				delete (char *)  frame;
-			else if(pixelSize<=16)
-				delete (short *) frame;
-			else if(pixelSize<=32)
-				delete (int *)   frame;
+			freeFrame();
             return 0;
         }
 /*Fine chack*/
@@ -243,12 +260,7 @@ printf("Is Black Frame.\n");
 		    delete timebaseNode;
 		    if(hasMetadata) delete metaNode;
 
-		    if(pixelSize<=8)
-			    delete (char *) frame;
-		    else if(pixelSize<=16)
-			    delete (short *)frame;
-		    else if(pixelSize<=32)
-			    delete (int *) frame;
+		    freeFrame();
 
 	    }
 	    else  //timebase NOT defined (int. trigger)
@@ -289,12 +301,7 @@ printf("Is Black Frame.\n");
 			delete dataNode;
 			if(hasMetadata) delete metaNode;
 
-			if(pixelSize<=8)
-				delete (char *) frame;
-			else if(pixelSize<=16)
-				delete (short *)frame;
-			else if(pixelSize<=32)
-				delete (int *) frame;
+			freeFrame();
 		}
 		catch(MdsException *exc)
 		{
@@ -402,6 +409,15 @@ class SaveFrameList
 	    addFrame(newItem);
     }
 
+    void addFrame(void *frame, int width, int height, float frameTime, int pixelSize, void *treePtr, int dataNid, int timebaseNid,
+	int frameIdx, void *frameMetadata, int metaSize, int metaNid, CamFrameRing *ring)
+    {
+		SaveFrame *newItem = new SaveFrame(frame,  width,  height,  frameTime,  pixelSize,  treePtr,  dataNid,  timebaseNid,  frameIdx,
+	    frameMetadata,  metaSize,  metaNid, pixelLevel, numPixel);
+		newItem->setRing(ring);
+	    addFrame(newItem);
+    }
+
     void addFrame(void *frame, int width, int height, float frameTime, int pixelSize, void *treePtr, int dataNid, int timebaseNid,
 	int frameIdx)
     {
@@ -655,4 +671,16 @@ void camSaveFrameDirect(void *frame, int width, int height, float frameTime, int
     saveList->addFrame(bufFrame,  width,  height,  frameTime,  pixelSize,  treePtr,  dataNid,  timebaseNid,  frameIdx);
 }
 
+/*
+Save 1 frame in mdsplus without copying it: frame and frameMetadata must be buffers claimed
+from the frame ring ringPtr (camFrameRingClaim). The frame is held until it has been written.
+*/
+void camSaveFrameRing(void *frame, int width, int height, float frameTime, int pixelSize, void *treePtr, int dataNid, int timebaseNid, int frameIdx,
+	 void *frameMetadata, int metaSize, int metaNid, void *saveListPtr, void *ringPtr)
+{
+    CamFrameRing *ring = (CamFrameRing *)ringPtr;
+    ring->hold(frame);
 
+    SaveFrameList *saveList = (SaveFrameList *)saveListPtr;
+    saveList->addFrame(frame,  width,  height,  frameTime,  pixelSize,  treePtr,  dataNid,  timebaseNid,  frameIdx,  frameMetadata,  metaSize,  metaNid, ring);
+}
@@ -8,6 +8,7 @@ int camCloseTree(void *treePtr);
 void camSaveFrame(void *frame, int width, int height, float frameTime, int pixelSize, void *treePtr, int dataNid, int timebaseNid, int frameIdx, void *frameMetadata, int metaSize, int metaNid, void *saveListPtr);
 void camSaveFrameDirect(void *frame, int width, int height, float frameTime, int pixelSize, void *treePtr, int dataNid, int timebaseNid,
 	int frameIdx, void *saveListPtr);
+void camSaveFrameRing(void *frame, int width, int height, float frameTime, int pixelSize, void *treePtr, int dataNid, int timebaseNid, int frameIdx, void *frameMetadata, int metaSize, int metaNid, void *saveListPtr, void *ringPtr);
 
 static void *handleSave(void *listPtr);
 void camStartSaveDeferred(void **retList);
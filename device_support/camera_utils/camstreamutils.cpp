@@ -37,12 +37,18 @@ using namespace std;
 #include <unistd.h>
 #include <cerrno>        //tcp error enumeration
 
+//SIMD MIN/MAX
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 //FFMPEG TEXT OVERLAY
 #include <time.h>
 #include <fcntl.h>
 #include <sys/time.h>   //temp 4 debug
 
 #include "camstreamutils.h"
+#include "camframering.h"
 
 //debug mode if defined
 //#define debug
@@ -85,6 +91,8 @@ class StreamingFrame {
     int tcpStreamHandle;
     const char *deviceName;
 
+    CamFrameRing *ring;     //frame buffer owner, 0 when the frame is a private copy
+
     StreamingFrame *nxt;
 
  public:
@@ -108,9 +116,15 @@ class StreamingFrame {
 		this->adjRoiH = adjRoiH;
                 this->deviceName = deviceName;
 
+		ring = 0;
 		nxt = 0;
     }
 
+    void setRing(CamFrameRing *ring)
+    {
+		this->ring = ring;
+    }
+
     void setNext(StreamingFrame *itm)
     {
 		nxt = itm;
@@ -145,7 +159,9 @@ class StreamingFrame {
     	camSendFrameOnTcp(&tcpStreamHandle, width, height, frame8bit);
 	free(frame8bit);
 
-	if(pixelSize<=8)
+	if(ring)
+	    ring->release(frame);
+	else if(pixelSize<=8)
 	    delete (char *) frame;
 	else if(pixelSize<=16)
 	    delete (short *)frame;
@@ -174,10 +190,11 @@ class StreamingFrameList
 		threadCreated = false;
     }
 
-    void addStreamingFrame(int tcpStreamHandle, void *frame, int width, int height, int pixelFormat, int irFrameFormat, bool adjLimit, unsigned int *lowLim, unsigned int *highLim, unsigned int minLim, unsigned int maxLim, int adjRoiX, int adjRoiY, int adjRoiW, int adjRoiH, const char *deviceName)
+    void addStreamingFrame(int tcpStreamHandle, void *frame, int width, int height, int pixelFormat, int irFrameFormat, bool adjLimit, unsigned int *lowLim, unsigned int *highLim, unsigned int minLim, unsigned int maxLim, int adjRoiX, int adjRoiY, int adjRoiW, int adjRoiH, const char *deviceName, CamFrameRing *ring = 0)
     {
                 //printf("add streaming frame\n");
 		StreamingFrame *newItem = new StreamingFrame(tcpStreamHandle, frame, width, height, pixelFormat, irFrameFormat, adjLimit, lowLim, highLim, minLim,  maxLim, adjRoiX, adjRoiY, adjRoiW, adjRoiH, deviceName);
+		newItem->setRing(ring);
 		pthread_mutex_lock(&mutex);
 		if(streamingHead == NULL)
 		{
@@ -306,6 +323,59 @@ void camStreamingFrame(int tcpStreamHandle, void *frame, int width, int height,
     streamingList->addStreamingFrame(tcpStreamHandle, bufFrame, width, height, pixelFormat, irFrameFormat,  adjLimit, lowLim, highLim, minLim, maxLim, adjRoiX, adjRoiY, adjRoiW, adjRoiH, deviceName);    
 }
 
+//enqueue a frame claimed from the frame ring ringPtr for streaming without copying it.
+//The frame is held until it has been converted and sent, and must not be modified meanwhile.
+void camStreamingFrameRing(int tcpStreamHandle, void *frame, int width, int height, int pixelFormat, int irFrameFormat, bool adjLimit, unsigned int *lowLim, unsigned int *highLim, unsigned int minLim, unsigned int maxLim, int adjRoiX, int adjRoiY, int adjRoiW, int adjRoiH, const char *deviceName, void *streamingListPtr, void *ringPtr)
+{
+    CamFrameRing *ring = (CamFrameRing *)ringPtr;
+    ring->hold(frame);
+
+    StreamingFrameList *streamingList = (StreamingFrameList *)streamingListPtr;
+    streamingList->addStreamingFrame(tcpStreamHandle, frame, width, height, pixelFormat, irFrameFormat,  adjLimit, lowLim, highLim, minLim, maxLim, adjRoiX, adjRoiY, adjRoiW, adjRoiH, deviceName, ring);
+}
+
+
+//***********************************************
+//Frame ring: the acquisition thread claims a buffer, lets the driver fill it, hands it to
+//camSaveFrameRing/camStreamingFrameRing and commits it. nSlots<=0 takes the number of
+//slots from CAM_FRAME_RING_SLOTS (default 64).
+
+#define DEFAULT_RING_SLOTS 64
+
+void camFrameRingCreate(int nSlots, int frameSize, int metaSize, void **retRing)
+{
+    if(nSlots <= 0)
+    {
+        char *val = getenv("CAM_FRAME_RING_SLOTS");
+        nSlots = (val && strlen(val) > 0) ? atoi(val) : DEFAULT_RING_SLOTS;
+        if(nSlots <= 0)
+            nSlots = DEFAULT_RING_SLOTS;
+    }
+    *retRing = (void *)new CamFrameRing(nSlots, frameSize, metaSize);
+}
+
+void *camFrameRingClaim(void *ringPtr, void **metaData)
+{
+    return ((CamFrameRing *)ringPtr)->claim(metaData);
+}
+
+void camFrameRingCommit(void *ringPtr)
+{
+    ((CamFrameRing *)ringPtr)->commit();
+}
+
+int camFrameRingOverflows(void *ringPtr)
+{
+    return ((CamFrameRing *)ringPtr)->getOverflows();
+}
+
+//call only after camStopSave and camStopStreaming have drained the consumers
+void camFrameRingDestroy(void *ringPtr)
+{
+    if(ringPtr)
+        delete (CamFrameRing *)ringPtr;
+}
+
 
 //***********************************************
 
@@ -483,13 +553,163 @@ int camSendFrameOnTcp(int *kSockHandle, int width, int height, void *frame8bit)
 }
 
 
+//min/max search kernels: lowest pixel above minLim and highest pixel below maxLim in n pixels,
+//folded into *minpix and *maxpix. The 8 and 16 bit versions compare 16/8 pixels per SSE2 instruction
+//(unsigned values are biased to use the signed compares).
+static void minMax8(const unsigned char *pix, int n, unsigned int minLim, unsigned int maxLim, unsigned int *minpix, unsigned int *maxpix)
+{
+    unsigned int mn = *minpix, mx = *maxpix;
+    int i = 0;
+#ifdef __SSE2__
+    if(minLim < UCHAR_MAX && maxLim > 0)
+    {
+        const __m128i bias = _mm_set1_epi8((char)0x80);
+        const __m128i lo = _mm_set1_epi8((char)(minLim ^ 0x80));
+        const __m128i hi = maxLim > UCHAR_MAX ? _mm_set1_epi8((char)0xFF) : _mm_set1_epi8((char)(maxLim ^ 0x80));
+        const __m128i all = _mm_set1_epi8((char)0xFF);
+        __m128i vmin = all, vmax = _mm_setzero_si128();
+        for(; i + 16 <= n; i += 16)
+        {
+            __m128i p = _mm_loadu_si128((const __m128i *)(pix + i));
+            __m128i ps = _mm_xor_si128(p, bias);
+            __m128i gt = _mm_cmpgt_epi8(ps, lo);
+            __m128i lt = maxLim > UCHAR_MAX ? all : _mm_cmplt_epi8(ps, hi);
+            vmin = _mm_min_epu8(vmin, _mm_or_si128(_mm_and_si128(gt, p), _mm_andnot_si128(gt, all)));
+            vmax = _mm_max_epu8(vmax, _mm_and_si128(lt, p));
+        }
+        unsigned char lmin[16], lmax[16];
+        _mm_storeu_si128((__m128i *)lmin, vmin);
+        _mm_storeu_si128((__m128i *)lmax, vmax);
+        for(int k = 0; k < 16; k++)
+        {
+            if(lmin[k] > minLim && lmin[k] < mn)
+                mn = lmin[k];
+            if(lmax[k] < maxLim && lmax[k] > mx)
+                mx = lmax[k];
+        }
+    }
+#endif
+    for(; i < n; i++)
+    {
+        if(pix[i] > minLim && pix[i] < mn)
+            mn = pix[i];
+        if(pix[i] < maxLim && pix[i] > mx)
+            mx = pix[i];
+    }
+    *minpix = mn;
+    *maxpix = mx;
+}
+
+static void minMax16(const unsigned short *pix, int n, unsigned int minLim, unsigned int maxLim, unsigned int *minpix, unsigned int *maxpix)
+{
+    unsigned int mn = *minpix, mx = *maxpix;
+    int i = 0;
+#ifdef __SSE2__
+    if(minLim < USHRT_MAX && maxLim > 0)
+    {
+        const __m128i bias = _mm_set1_epi16((short)0x8000);
+        const __m128i lo = _mm_set1_epi16((short)(minLim ^ 0x8000));
+        const __m128i hi = _mm_set1_epi16((short)((maxLim > USHRT_MAX ? USHRT_MAX : maxLim) ^ 0x8000));
+        const __m128i all = _mm_set1_epi16((short)0xFFFF);
+        const __m128i top = _mm_set1_epi16(SHRT_MAX);
+        const __m128i bottom = _mm_set1_epi16(SHRT_MIN);
+        __m128i vmin = top, vmax = bottom;
+        for(; i + 8 <= n; i += 8)
+        {
+            __m128i ps = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(pix + i)), bias);
+            __m128i gt = _mm_cmpgt_epi16(ps, lo);
+            __m128i lt = maxLim > USHRT_MAX ? all : _mm_cmplt_epi16(ps, hi);
+            vmin = _mm_min_epi16(vmin, _mm_or_si128(_mm_and_si128(gt, ps), _mm_andnot_si128(gt, top)));
+            vmax = _mm_max_epi16(vmax, _mm_or_si128(_mm_and_si128(lt, ps), _mm_andnot_si128(lt, bottom)));
+        }
+        unsigned short lmin[8], lmax[8];
+        _mm_storeu_si128((__m128i *)lmin, _mm_xor_si128(vmin, bias));
+        _mm_storeu_si128((__m128i *)lmax, _mm_xor_si128(vmax, bias));
+        for(int k = 0; k < 8; k++)
+        {
+            if(lmin[k] > minLim && lmin[k] < mn)
+                mn = lmin[k];
+            if(lmax[k] < maxLim && lmax[k] > mx)
+                mx = lmax[k];
+        }
+    }
+#endif
+    for(; i < n; i++)
+    {
+        if(pix[i] > minLim && pix[i] < mn)
+            mn = pix[i];
+        if(pix[i] < maxLim && pix[i] > mx)
+            mx = pix[i];
+    }
+    *minpix = mn;
+    *maxpix = mx;
+}
+
+static void minMax32(const unsigned int *pix, int n, unsigned int minLim, unsigned int maxLim, unsigned int *minpix, unsigned int *maxpix)
+{
+    unsigned int mn = *minpix, mx = *maxpix;
+    for(int i = 0; i < n; i++)
+    {
+        if(pix[i] > minLim && pix[i] < mn)
+            mn = pix[i];
+        if(pix[i] < maxLim && pix[i] > mx)
+            mx = pix[i];
+    }
+    *minpix = mn;
+    *maxpix = mx;
+}
+
+
+//8 bit conversion table of the 8 and 16 bit formats, rebuilt only when the limits change.
+//One per thread since every streaming thread converts its own frames.
+struct FrameLut
+{
+    unsigned int size;
+    unsigned int minpix;
+    unsigned int maxpix;
+    unsigned char value[USHRT_MAX + 1];
+};
+static thread_local FrameLut frameLut = {0, 0, 0, {0}};
+
+static unsigned char normalize(unsigned int sample, unsigned int minpix, unsigned int maxpix, float span)
+{
+    if (sample < minpix)
+        return 0;
+    if (sample > maxpix)
+        return 255;
+    return (unsigned char) (((sample - minpix) / span) * 0xFF);
+}
+
+static const unsigned char *getLut(unsigned int size, unsigned int minpix, unsigned int maxpix)
+{
+    FrameLut *lut = &frameLut;
+    if(lut->size != size || lut->minpix != minpix || lut->maxpix != maxpix)
+    {
+        float span = (float)(maxpix - minpix + 1);
+        unsigned int lo = minpix < size ? minpix : size;
+        unsigned int hi = maxpix < size ? maxpix + 1 : size;
+        if(hi < lo)
+            hi = lo;
+        memset(lut->value, 0, lo);
+        for(unsigned int s = lo; s < hi; s++)
+            lut->value[s] = normalize(s, minpix, maxpix, span);
+        memset(lut->value + hi, 255, size - hi);
+        lut->size = size;
+        lut->minpix = minpix;
+        lut->maxpix = maxpix;
+    }
+    return lut->value;
+}
+
+
 int camFrameTo8bit(void *frame, int width, int height, int pixelFormat, unsigned char *frame8bit, bool adjLimits, unsigned int *lowLim, unsigned int *highLim, unsigned int minLim, unsigned int maxLim, int adjRoiX, int adjRoiY, int adjRoiW, int adjRoiH)
 {
      //when adjLimits==0, lowLim and highLim are used to adjust the frame. minLim and maxLim are NOT used.
      //minLim & maxLim depend on specific camera and are used only if adjLimits==1. In this case lowLim and highLim are calculated in the frame but cannot exceed the minLim and maxLim.
      //frame8bit is the 8 bit resized version of frame using the passed or calculated min and max limits
-   
+
      int pixelSize = getPixelSize(pixelFormat);
+     int npix = width * height;
 
        unsigned int minpix, maxpix;
 
@@ -501,52 +721,19 @@ int camFrameTo8bit(void *frame, int width, int height, int pixelFormat, unsigned
 		   minpix = UCHAR_MAX;
 	        else if(pixelSize<=16)
 		   minpix = USHRT_MAX;
-	        else if(pixelSize<=32)
+	        else
 		   minpix = UINT_MAX;
-		
+
                 for(int row=adjRoiY; row<adjRoiY+adjRoiH; row++)    //calculate min & max pixel only in ROI
                 {
-                 for(int col=adjRoiX; col<adjRoiX+adjRoiW; col++)
-                 {
-                     int i=(row*width)+col;
+                     int i=(row*width)+adjRoiX;
                      if(pixelSize<=8)
-                     {
-                        char *framePtr = (char *)frame;
-			if ((framePtr[i] > minLim) && (framePtr[i] < minpix))
-			{
-				minpix = framePtr[i];
-			}
-			if ((framePtr[i] < maxLim) && (framePtr[i] > maxpix))
-			{
-				maxpix = framePtr[i];
-			}
-                     }
+                        minMax8((unsigned char *)frame + i, adjRoiW, minLim, maxLim, &minpix, &maxpix);
                      else if(pixelSize<=16)
-                     {
-                        short *framePtr = (short *)frame;
-			if ((framePtr[i] > minLim) && (framePtr[i] < minpix))
-			{
-				minpix = framePtr[i];
-			}
-			if ((framePtr[i] < maxLim) && (framePtr[i] > maxpix))
-			{
-				maxpix = framePtr[i];
-			}
-                     }
-                     else if(pixelSize<=32)
-                     {
-                        int *framePtr = (int *)frame;
-			if ((framePtr[i] > minLim) && (framePtr[i] < minpix))
-			{
-				minpix = framePtr[i];
-			}
-			if ((framePtr[i] < maxLim) && (framePtr[i] > maxpix))
-			{
-				maxpix = framePtr[i];
-			}
-                     }
-                 }//for columns                 
-                }//for rows                  
+                        minMax16((unsigned short *)frame + i, adjRoiW, minLim, maxLim, &minpix, &maxpix);
+                     else
+                        minMax32((unsigned int *)frame + i, adjRoiW, minLim, maxLim, &minpix, &maxpix);
+                }//for rows
 		*lowLim = minpix;
 		*highLim = maxpix;
 	}
@@ -556,81 +743,28 @@ int camFrameTo8bit(void *frame, int width, int height, int pixelFormat, unsigned
 		maxpix = *highLim;
 	}
 
-	unsigned char nsample = 0; // Normalized sample value (between 0 and 255)
-	float span = (float)(maxpix - minpix + 1);
-
-	//for(int i=0; i<width*height; i++) 
-        for(int row=0; row<height; row++)
-        { 
-          for(int col=0; col<width; col++) 
-  	  {
-             int i=row*width+col;  
-                     if(pixelSize<=8)                       //no need to normalize. already 8 bits!!!
-                     {
-                        unsigned char *framePtr = (unsigned char *)frame;
-                        unsigned char sample = framePtr[i];
-			if (sample < minpix)
-			{
-				nsample = 0;
-			}
-			else if (sample > maxpix)
-			{
-				nsample = 255; 
-			}
-			else 
-			{
-			    nsample = (unsigned char) (((sample - minpix) / span) * 0xFF);
-			}
-                        frame8bit[i] = nsample;
-                     }
-                     else if(pixelSize<=16)
-                     {
-                        short *framePtr = (short *)frame;
-                        unsigned short sample = framePtr[i];
-			if (sample < minpix)
-			{
-				nsample = 0;
-			}
-			else if (sample > maxpix)
-			{
-				nsample = 255; 
-			}
-			else 
-			{
-			    nsample = (unsigned char) (((sample - minpix) / span) * 0xFF);
-			}
-			frame8bit[i] = nsample;
-                     }
-                     else if(pixelSize<=32)
-                     {
-                        int *framePtr = (int *)frame;
-                        unsigned int sample = framePtr[i];
-			if (sample < minpix)
-			{
-				nsample = 0;
-			}
-			else if (sample > maxpix)
-			{
-				nsample = 255; 
-			}
-			else 
-			{
-			    nsample = (unsigned char) (((sample - minpix) / span) * 0xFF);
-			}
-			frame8bit[i] = nsample;
-                     }            
-/*
-	       if(adjLimits && (row==adjRoiY || row==adjRoiY+adjRoiH))        //mark the region of auto adjust (ROI)
-	       {
-	  	  frame8bit[i] = 0xFF;
-               }
-	       if(adjLimits && (col==adjRoiX || col==adjRoiX+adjRoiW))
-	       {
-	  	  frame8bit[i] = 0xFF;
-               }
-*/
-         }//for col
-	}//for row
+	if(pixelSize<=8)
+	{
+		const unsigned char *lut = getLut(UCHAR_MAX + 1, minpix, maxpix);
+		const unsigned char *framePtr = (unsigned char *)frame;
+		for(int i=0; i<npix; i++)
+			frame8bit[i] = lut[framePtr[i]];
+	}
+	else if(pixelSize<=16)
+	{
+		const unsigned char *lut = getLut(USHRT_MAX + 1, minpix, maxpix);
+		const unsigned short *framePtr = (unsigned short *)frame;
+		for(int i=0; i<npix; i++)
+			frame8bit[i] = lut[framePtr[i]];
+	}
+	else
+	{
+		float span = (float)(maxpix - minpix + 1);
+		const unsigned int *framePtr = (unsigned int *)frame;
+		for(int i=0; i<npix; i++)
+			frame8bit[i] = normalize(framePtr[i], minpix, maxpix, span);
+	}
+	return 0;
 }
 
 
@@ -19,6 +19,14 @@ int camFrameTo8bit(void *frame, int width, int height, int pixelFormat, unsigned
 int camFFMPEGoverlay(const char *filename, const char *textString);
 
 void camStreamingFrame(int tcpStreamHandle, void *frame, int width, int height, int pixelFormat, int irFrameFormat, bool adjLimit, unsigned int *lowLim, unsigned int *highLim, unsigned int minLim, unsigned int maxLim, int adjRoiX, int adjRoiY, int adjRoiW, int adjRoiH, const char *deviceName, void *streamingListPtr);
+void camStreamingFrameRing(int tcpStreamHandle, void *frame, int width, int height, int pixelFormat, int irFrameFormat, bool adjLimit, unsigned int *lowLim, unsigned int *highLim, unsigned int minLim, unsigned int maxLim, int adjRoiX, int adjRoiY, int adjRoiW, int adjRoiH, const char *deviceName, void *streamingListPtr, void *ringPtr);
+
+//zero copy frame hand-off, see camframering.h
+void camFrameRingCreate(int nSlots, int frameSize, int metaSize, void **retRing);
+void *camFrameRingClaim(void *ringPtr, void **metaData);
+void camFrameRingCommit(void *ringPtr);
+int camFrameRingOverflows(void *ringPtr);
+void camFrameRingDestroy(void *ringPtr);
 
 static void *handleStreaming(void *listPtr);
 void camStartStreaming(void **retList);
@@ -58,6 +58,7 @@ $ dwcope [-default setup]
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
+#include <sys/time.h>
 #include <X11/cursorfont.h>
 #include <X11/Xatom.h>
 #include <X11/Intrinsic.h>
@@ -141,6 +142,10 @@ extern Boolean EvaluateData(Boolean brief, int row, int col, int index,
 extern Boolean EvaluateText(String text, String error_prefix, String *text_ret,
                             String *error);
 extern void CloseDataSources();
+extern int SetupEvaluateWorkers(XtAppContext app_context,
+                                void (*done)(XtPointer));
+extern Boolean EvaluateInBackground(void (*work)(XtPointer), XtPointer arg);
+extern void CancelBackgroundEvaluations(void (*discard)(XtPointer));
 
 static String GlobalShot();
 static void RaiseWindows();
@@ -248,6 +253,10 @@ static void ManageWaveforms();
 static void RemoveZeros(String string, int *length);
 static void Unbusy();
 static void ClearWaveform(WaveInfo *info);
+static void QueueWaveform(WaveInfo *info, Boolean event);
+static void WaveformEvaluated(XtPointer arg);
+static void CancelWaveforms();
+static void SetGrid(WaveInfo *info);
 static void RestoreDatabase(String dbname, Widget w);
 static void WriteDatabase(String dbname, Boolean zoom);
 static void GetNewLimits(WaveInfo *info, float **xmin, float **xmax,
@@ -321,6 +330,15 @@ static float DeltaX;
 static float DeltaY;
 static XtAppContext AppContext;
 static XtWorkProcId UpdateWaveformsWorkProcID;
+static int EvalWorkers = 0;
+static unsigned EvalSerial[MaxCols][MaxRows];
+static int EvalPending = 0;
+static int EvalFetched = 0;
+static Boolean EvalOverride = FALSE;
+static struct timeval EvalStart;
+static double EvalSlowest;
+static int EvalSlowestCol;
+static int EvalSlowestRow;
 
 int main(int argc, String *argv)
 {
@@ -448,6 +466,7 @@ int main(int argc, String *argv)
         XtNameToWidget(TopWidget, "*disable_icon_updates"), False, False);
   }
   SetupEventInput(AppContext, TopWidget);
+  EvalWorkers = SetupEvaluateWorkers(AppContext, WaveformEvaluated);
   SetDirMask(XtNameToWidget(TopWidget, "*file_dialog"), &defaultfile, 0);
 
   XtVaSetValues(Pane[0], XmNleftAttachment, XmATTACH_FORM, NULL);
@@ -1503,7 +1522,7 @@ void /*XtInputCallbackProc */ EventUpdate(XtPointer client_data
       for (r = 0; r < MaxRows; r++)
         if (Wave[c][r].received)
         {
-          UpdateWaveform(0, &Wave[c][r], 1, -1, -1);
+          QueueWaveform(&Wave[c][r], 1);
           Wave[c][r].received = 0;
         }
     if (ScopePrintEventReceived)
@@ -1558,13 +1577,17 @@ static void /*XtCallbackProc */ ApplyOverride(Widget w __attribute__((unused)),
                                               __attribute__((unused)))
 {
   static struct _UpdateWaveformsInfo info;
-  if (UpdateWaveformsWorkProcID != 0)
+  if (UpdateWaveformsWorkProcID != 0 || EvalOverride)
   {
     XmString label = XmStringCreateSimple("Apply");
-    XtRemoveWorkProc(UpdateWaveformsWorkProcID);
+    if (UpdateWaveformsWorkProcID != 0)
+      XtRemoveWorkProc(UpdateWaveformsWorkProcID);
+    if (EvalOverride)
+      CancelWaveforms();
     XtVaSetValues(XtNameToWidget(MainWidget, "*override_shot_apply"),
                   XmNlabelString, label, XmNmarginWidth, 5, NULL);
     UpdateWaveformsWorkProcID = 0;
+    EvalOverride = FALSE;
     XmStringFree(label);
   }
   else
@@ -1572,11 +1595,29 @@ static void /*XtCallbackProc */ ApplyOverride(Widget w __attribute__((unused)),
     XmString label = XmStringCreateSimple("Cancel");
     XtVaSetValues(XtNameToWidget(MainWidget, "*override_shot_apply"),
                   XmNlabelString, label, XmNmarginWidth, 2, NULL);
-    info.r = 0;
-    info.c = 0;
-    UpdateWaveformsWorkProcID =
-        XtAppAddWorkProc(AppContext, UpdateWaveformsWorkproc, (XtPointer)&info);
     XmStringFree(label);
+    if (EvalWorkers)
+    {
+      int c;
+      int r;
+      CancelWaveforms();
+      EvalOverride = TRUE;
+      for (c = 0; c < Columns; c++)
+        for (r = 0; r < Rows[c]; r++)
+          QueueWaveform(&Wave[c][r], 0);
+      if (!EvalPending)
+      {
+        EvalFetched = 0;
+        WaveformEvaluated(0);
+      }
+    }
+    else
+    {
+      info.r = 0;
+      info.c = 0;
+      UpdateWaveformsWorkProcID = XtAppAddWorkProc(
+          AppContext, UpdateWaveformsWorkproc, (XtPointer)&info);
+    }
   }
 }
 
@@ -2122,6 +2163,187 @@ static String GlobalShot()
   return strlen(override_shot) ? override_shot : GlobalWave.shot;
 }
 
+/*------------------------------------------------------------------------------
+        A panel is evaluated in three steps: NewWaveEval collects what is
+        needed from the widgets, EvaluateWave does the data access and can
+        run on a background worker, and ShowWave puts the results in the
+        panel. Each evaluation carries a serial number for its panel so
+        that a result which has been overtaken by a newer request, a
+        cancel or a clear is dropped instead of drawn.
+------------------------------------------------------------------------------*/
+
+typedef struct _WaveEval
+{
+  WaveInfo *info;
+  unsigned serial;
+  char complain;
+  Boolean brief;
+  Boolean event;
+  Boolean update;
+  Boolean status;
+  Boolean title_status;
+  Boolean print_title_status;
+  int row;
+  int col;
+  int idx;
+  String database;
+  String shot;
+  String default_node;
+  String x;
+  String y;
+  String title;
+  String print_title;
+  XmdsWaveformValStruct x_wave;
+  XmdsWaveformValStruct y_wave;
+  String error;
+  String title_evaluated;
+  String title_error;
+  String print_title_evaluated;
+  String print_title_error;
+  double seconds;
+} WaveEval;
+
+static WaveEval *NewWaveEval(char complain, WaveInfo *info, Boolean event)
+{
+  WaveEval *we = (WaveEval *)XtCalloc(1, sizeof(WaveEval));
+  int r = 0;
+  int c;
+  int idx = 0;
+  we->info = info;
+  we->complain = complain;
+  we->event = event;
+  we->update = 1;
+  we->brief = !(complain || !XmToggleButtonGadgetGetState(XtNameToWidget(
+                                TopWidget, "*brief_errors")));
+  we->shot = XtNewString(info->_global.global.shot ? GlobalShot() : info->shot);
+  we->database = XtNewString(info->_global.global.database
+                                 ? GlobalWave.database
+                                 : info->database);
+  we->default_node = XtNewString(info->_global.global.default_node
+                                     ? GlobalWave.default_node
+                                     : info->default_node);
+  we->x = XtNewString(info->_global.global.x ? GlobalWave.x : info->x);
+  we->y = XtNewString(info->_global.global.y ? GlobalWave.y : info->y);
+  we->title = XtNewString(info->_global.global.title ? GlobalWave.title
+                                                     : info->title);
+  we->print_title = XtNewString(info->_global.global.print_title
+                                    ? GlobalWave.print_title
+                                    : info->print_title);
+  for (c = 0; c < Columns; c++)
+    for (r = 0; r < Rows[c]; r++, idx++)
+      if (Wave[c][r].w == info->w)
+        goto found;
+found:
+  we->row = r;
+  we->col = c;
+  we->idx = idx;
+  if (c < MaxCols && r < MaxRows)
+    we->serial = ++EvalSerial[c][r];
+  return we;
+}
+
+static void /*EvaluateInBackground work */ EvaluateWave(XtPointer arg)
+{
+  WaveEval *we = (WaveEval *)arg;
+  struct timeval start;
+  struct timeval end;
+  gettimeofday(&start, 0);
+  we->status = EvaluateData(we->brief, we->row, we->col, we->idx,
+                            we->event ? &we->update : (Boolean *)0,
+                            we->database, we->shot, we->default_node, we->x,
+                            we->y, &we->x_wave, &we->y_wave, &we->error);
+  if (we->status ? we->update : !we->complain)
+    we->title_status =
+        EvaluateText(we->title, "Error evaluating title", &we->title_evaluated,
+                     &we->title_error);
+  if (we->status && we->update)
+    we->print_title_status =
+        EvaluateText(we->print_title, "Error evaluating print title",
+                     &we->print_title_evaluated, &we->print_title_error);
+  gettimeofday(&end, 0);
+  we->seconds =
+      (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 1E-6;
+}
+
+static int ShowWave(WaveEval *we, Boolean new_grid)
+{
+  WaveInfo *info = we->info;
+  float *xmin;
+  float *xmax;
+  float *ymin;
+  float *ymax;
+  if (!we->status)
+  {
+    String error = we->error;
+    if (!we->complain && we->title_status && we->title_evaluated)
+    {
+      int len = strlen(we->title_evaluated) + 2 + strlen(we->error);
+      error = XtMalloc(len + 1);
+      strcpy(error, we->title_evaluated);
+      strcat(error, "\n");
+      strcat(error, we->error);
+      error[len] = 0;
+    }
+    Complain(info, we->complain, error);
+    if (error != we->error)
+      XtFree(error);
+    return 0;
+  }
+  if (!we->update)
+    return -1;
+  if (!we->title_status && we->complain && we->title_error)
+    PopupComplaint(DataSetupWidget, we->title_error);
+  if (info->print_title_evaluated)
+    XtFree(info->print_title_evaluated);
+  info->print_title_evaluated = we->print_title_evaluated;
+  we->print_title_evaluated = 0;
+  if (!we->print_title_status && we->complain && we->print_title_error)
+    PopupComplaint(DataSetupWidget, we->print_title_error);
+  GetNewLimits(info, &xmin, &xmax, &ymin, &ymax);
+  if (new_grid)
+    XtVaSetValues(info->w, XmdsNdisabled, True, NULL);
+  XmdsWaveformUpdate(info->w, &we->x_wave, &we->y_wave, we->title_evaluated,
+                     xmin, xmax, ymin, ymax, new_grid);
+  we->status = 0; /* the waveform owns the data now */
+  return 1;
+}
+
+static void FreeWaveEval(XtPointer arg)
+{
+  WaveEval *we = (WaveEval *)arg;
+  if (we->status && we->update)
+  {
+    if (we->x_wave.destroy)
+      (*we->x_wave.destroy)(we->info->w, we->x_wave.destroy_arg);
+    if (we->y_wave.destroy)
+      (*we->y_wave.destroy)(we->info->w, we->y_wave.destroy_arg);
+  }
+  XtFree(we->database);
+  XtFree(we->shot);
+  XtFree(we->default_node);
+  XtFree(we->x);
+  XtFree(we->y);
+  XtFree(we->title);
+  XtFree(we->print_title);
+  XtFree(we->error);
+  XtFree(we->title_evaluated);
+  XtFree(we->title_error);
+  XtFree(we->print_title_evaluated);
+  XtFree(we->print_title_error);
+  XtFree((String)we);
+}
+
+static void FetchStatus(String text)
+{
+  Widget w = XtNameToWidget(MainWidget, "*fetch_status");
+  if (w)
+  {
+    XmString label = XmStringCreateSimple(text);
+    XtVaSetValues(w, XmNlabelString, label, NULL);
+    XmStringFree(label);
+  }
+}
+
 static int UpdateWaveform(Boolean complain, WaveInfo *info, Boolean event,
                           int global_change_mask, int change_mask)
 {
@@ -2137,97 +2359,23 @@ static int UpdateWaveform(Boolean complain, WaveInfo *info, Boolean event,
   if (changed(shot) || changed(database) || changed(default_node) ||
       changed(x) || changed(y) || changed(title) || changed(print_title))
   {
-    XmdsWaveformValStruct x_wave;
-    XmdsWaveformValStruct y_wave;
-    String title_evaluated = 0;
-    String error = 0;
-    String shot = info->_global.global.shot ? GlobalShot() : info->shot;
-    String database =
-        info->_global.global.database ? GlobalWave.database : info->database;
-    String default_node = info->_global.global.default_node
-                              ? GlobalWave.default_node
-                              : info->default_node;
-    String x = info->_global.global.x ? GlobalWave.x : info->x;
-    String y = info->_global.global.y ? GlobalWave.y : info->y;
-    String title = info->_global.global.title ? GlobalWave.title : info->title;
-    String print_title = info->_global.global.print_title
-                             ? GlobalWave.print_title
-                             : info->print_title;
-    float *xmin;
-    float *xmax;
-    float *ymin;
-    float *ymax;
-    Boolean update = 1;
-    int r = 0;
-    int c;
-    int idx = 0;
-    Boolean brief = !(complain || !XmToggleButtonGadgetGetState(XtNameToWidget(
-                                      TopWidget, "*brief_errors")));
-    for (c = 0; c < Columns; c++)
-      for (r = 0; r < Rows[c]; r++, idx++)
-        if (Wave[c][r].w == info->w)
-          goto found;
-  found:
-    if (!EvaluateData(brief, r, c, idx, event ? &update : (Boolean *)0,
-                      database, shot, default_node, x, y, &x_wave, &y_wave,
-                      &error))
+    WaveEval *we = NewWaveEval(complain, info, event);
+    int shown;
+    char text[80];
+    EvaluateWave((XtPointer)we);
+    shown = ShowWave(we, new_grid);
+    if (shown > 0)
     {
-      String terror = 0;
-      if (!complain &&
-          EvaluateText(title, "Error evaluating title", &title_evaluated,
-                       &terror) &&
-          title_evaluated)
-      {
-        String save = error;
-        int len = strlen(title_evaluated) + 2 + strlen(save);
-        error = XtMalloc(len + 1);
-        strcpy(error, title_evaluated);
-        strcat(error, "\n");
-        strcat(error, save);
-        error[len] = 0;
-      }
-      else if (terror)
-        XtFree(terror);
-      if (title_evaluated)
-        XtFree(title_evaluated);
-      Complain(info, complain, error);
-      if (error)
-        XtFree(error);
-      Unbusy();
-      return 0;
+      sprintf(text, "Column %d row %d: %.2f s", we->col + 1, we->row + 1,
+              we->seconds);
+      FetchStatus(text);
     }
-    if (event & !update)
+    FreeWaveEval((XtPointer)we);
+    if (shown <= 0)
     {
       Unbusy();
-      return 1;
-    }
-    if (!EvaluateText(title, "Error evaluating title", &title_evaluated,
-                      &error))
-    {
-      if (complain)
-        PopupComplaint(DataSetupWidget, error);
-      if (error)
-        XtFree(error);
+      return shown < 0;
     }
-    if (info->print_title_evaluated)
-    {
-      XtFree(info->print_title_evaluated);
-      info->print_title_evaluated = 0;
-    }
-    if (!EvaluateText(print_title, "Error evaluating print title",
-                      &info->print_title_evaluated, &error))
-    {
-      if (complain)
-        PopupComplaint(DataSetupWidget, error);
-      if (error)
-        XtFree(error);
-    }
-    GetNewLimits(info, &xmin, &xmax, &ymin, &ymax);
-    if (new_grid)
-      XtVaSetValues(info->w, XmdsNdisabled, True, NULL);
-    XmdsWaveformUpdate(info->w, &x_wave, &y_wave, title_evaluated, xmin, xmax,
-                       ymin, ymax, new_grid);
-    XtFree(title_evaluated);
   }
   else if (changed(xmin) || changed(ymin) || changed(xmax) || changed(ymax))
   {
@@ -2240,32 +2388,123 @@ static int UpdateWaveform(Boolean complain, WaveInfo *info, Boolean event,
                   XmdsNyMax, ymax, NULL);
   }
   if (new_grid)
-  {
-    int x_grid_lines = info->_global.global.x_grid_lines
-                           ? GlobalWave.x_grid_lines
-                           : info->x_grid_lines;
-    int y_grid_lines = info->_global.global.y_grid_lines
-                           ? GlobalWave.y_grid_lines
-                           : info->y_grid_lines;
-    Boolean x_grid_labels = info->_global.global.x_grid_labels
-                                ? GlobalWave.x_grid_labels
-                                : info->x_grid_labels;
-    Boolean y_grid_labels = info->_global.global.y_grid_labels
-                                ? GlobalWave.y_grid_labels
-                                : info->y_grid_labels;
-    char show_mode =
-        info->_global.global.show_mode ? GlobalWave.show_mode : info->show_mode;
-    Boolean step_plot =
-        info->_global.global.step_plot ? GlobalWave.step_plot : info->step_plot;
-    XtVaSetValues(info->w, XmdsNxGridLines, x_grid_lines, XmdsNyGridLines,
-                  y_grid_lines, XmdsNxLabels, x_grid_labels, XmdsNyLabels,
-                  y_grid_labels, XmdsNshowMode, show_mode, XmdsNstepPlot,
-                  step_plot, XmdsNdisabled, False, NULL);
-  }
+    SetGrid(info);
   Unbusy();
   return 1;
 }
 
+static void SetGrid(WaveInfo *info)
+{
+  int x_grid_lines = info->_global.global.x_grid_lines ? GlobalWave.x_grid_lines
+                                                       : info->x_grid_lines;
+  int y_grid_lines = info->_global.global.y_grid_lines ? GlobalWave.y_grid_lines
+                                                       : info->y_grid_lines;
+  Boolean x_grid_labels = info->_global.global.x_grid_labels
+                              ? GlobalWave.x_grid_labels
+                              : info->x_grid_labels;
+  Boolean y_grid_labels = info->_global.global.y_grid_labels
+                              ? GlobalWave.y_grid_labels
+                              : info->y_grid_labels;
+  char show_mode =
+      info->_global.global.show_mode ? GlobalWave.show_mode : info->show_mode;
+  Boolean step_plot =
+      info->_global.global.step_plot ? GlobalWave.step_plot : info->step_plot;
+  XtVaSetValues(info->w, XmdsNxGridLines, x_grid_lines, XmdsNyGridLines,
+                y_grid_lines, XmdsNxLabels, x_grid_labels, XmdsNyLabels,
+                y_grid_labels, XmdsNshowMode, show_mode, XmdsNstepPlot,
+                step_plot, XmdsNdisabled, False, NULL);
+}
+
+/*------------------------------------------------------------------------------
+        Background updates: QueueWaveform hands a panel to the evaluation
+        workers (or updates it in place when there are none) and
+        WaveformEvaluated draws it when it comes back, so panels appear as
+        their data arrives. The status line shows the time spent on each
+        panel and, once all are in, the total and the slowest one.
+------------------------------------------------------------------------------*/
+
+static void QueueWaveform(WaveInfo *info, Boolean event)
+{
+  WaveEval *we = NewWaveEval(0, info, event);
+  info->received = 0;
+  if (!EvaluateInBackground(EvaluateWave, (XtPointer)we))
+  {
+    FreeWaveEval((XtPointer)we);
+    UpdateWaveform(0, info, event, -1, -1);
+    return;
+  }
+  if (!EvalPending++)
+  {
+    EvalFetched = 0;
+    EvalSlowest = 0;
+    gettimeofday(&EvalStart, 0);
+  }
+}
+
+static void /*EvaluateInBackground discard */ DiscardWaveform(XtPointer arg)
+{
+  FreeWaveEval(arg);
+  EvalPending--;
+}
+
+static void CancelWaveforms()
+{
+  int c;
+  int r;
+  CancelBackgroundEvaluations(DiscardWaveform);
+  for (c = 0; c < MaxCols; c++)
+    for (r = 0; r < MaxRows; r++)
+      EvalSerial[c][r]++;
+}
+
+static void /*SetupEvaluateWorkers done */ WaveformEvaluated(XtPointer arg)
+{
+  WaveEval *we = (WaveEval *)arg;
+  char text[120];
+  if (we)
+  {
+    if (we->col < MaxCols && we->row < MaxRows &&
+        we->serial == EvalSerial[we->col][we->row])
+    {
+      if (ShowWave(we, TRUE) > 0)
+        SetGrid(we->info);
+      EvalFetched++;
+      if (we->seconds >= EvalSlowest)
+      {
+        EvalSlowest = we->seconds;
+        EvalSlowestCol = we->col;
+        EvalSlowestRow = we->row;
+      }
+      sprintf(text, "Column %d row %d: %.2f s (%d pending)", we->col + 1,
+              we->row + 1, we->seconds, EvalPending - 1);
+      FetchStatus(text);
+    }
+    FreeWaveEval(arg);
+    if (--EvalPending)
+      return;
+  }
+  if (EvalFetched)
+  {
+    struct timeval now;
+    gettimeofday(&now, 0);
+    sprintf(text, "%d panels in %.2f s, slowest column %d row %d: %.2f s",
+            EvalFetched,
+            (now.tv_sec - EvalStart.tv_sec) +
+                (now.tv_usec - EvalStart.tv_usec) * 1E-6,
+            EvalSlowestCol + 1, EvalSlowestRow + 1, EvalSlowest);
+    FetchStatus(text);
+  }
+  if (EvalOverride)
+  {
+    XmString label = XmStringCreateSimple("Apply");
+    XtVaSetValues(XtNameToWidget(MainWidget, "*override_shot_apply"),
+                  XmNlabelString, label, XmNmarginWidth, 5, NULL);
+    XmStringFree(label);
+    EvalOverride = FALSE;
+    SetWindowTitles();
+  }
+}
+
 static void Complain(WaveInfo *info, char mode, String error)
 {
   switch (mode)
@@ -2291,6 +2530,12 @@ static void Complain(WaveInfo *info, char mode, String error)
 
 static void ClearWaveform(WaveInfo *info)
 {
+  int c;
+  int r;
+  for (c = 0; c < MaxCols; c++)
+    for (r = 0; r < MaxRows; r++)
+      if (&Wave[c][r] == info)
+        EvalSerial[c][r]++;
   ResetWave(info);
   SetupEvent("", &info->received, &info->eventid);
   if (info->w)
@@ -89,6 +89,10 @@ String y, XmdsWaveformValStruct *x_ret, XmdsWaveformValStruct *y_ret, String
 Boolean EvaluateText(String text, String error_prefix, String *text_ret, String
 *error); void CloseDataSources();
 
+int SetupEvaluateWorkers(XtAppContext app_context, void (*done)(XtPointer));
+Boolean EvaluateInBackground(void (*work)(XtPointer), XtPointer arg);
+void CancelBackgroundEvaluations(void (*discard)(XtPointer));
+
 ------------------------------------------------------------------------------
    Copyright (c) 1990
    Property of Massachusetts Institute of Technology, Cambridge MA 02139.
@@ -133,12 +137,15 @@ extern int TdiCompile();
 extern int TdiDimOf();
 extern int TdiDebug();
 
+static pthread_mutex_t eval_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned close_generation = 0;
+
 static void ResetErrors()
 {
   static int const four = 4;
   static struct descriptor const clear_messages = {4, DTYPE_L, CLASS_S,
                                                    (char *)&four};
-  static struct descriptor_d messages = {0, DTYPE_T, CLASS_D, 0};
+  struct descriptor_d messages = {0, DTYPE_T, CLASS_D, 0};
   TdiDebug(&clear_messages, &messages MDS_END_ARG);
   StrFree1Dx(&messages);
 }
@@ -150,7 +157,7 @@ static Boolean Error(Boolean brief, String topic, String *error,
     *error = XtNewString(topic);
   else
   {
-    static struct descriptor_d messages = {0, DTYPE_T, CLASS_D, 0};
+    struct descriptor_d messages = {0, DTYPE_T, CLASS_D, 0};
     static int const one = 1;
     static struct descriptor const get_messages = {4, DTYPE_L, CLASS_S,
                                                    (char *)&one};
@@ -191,8 +198,8 @@ Boolean EvaluateData(Boolean brief, int row, int col, int idx, Boolean *event,
   static DESCRIPTOR(rowv, "_ROW=$");
   static DESCRIPTOR(colv, "_COLUMN=$");
   static DESCRIPTOR(idxv, "_INDEX=$");
-  static int ival;
-  static DESCRIPTOR_LONG(ival_d, &ival);
+  int ival;
+  DESCRIPTOR_LONG(ival_d, &ival);
   ival = row;
   TdiExecute(&rowv, &ival_d, &ival_d MDS_END_ARG);
   ival = col;
@@ -201,12 +208,11 @@ Boolean EvaluateData(Boolean brief, int row, int col, int idx, Boolean *event,
   TdiExecute(&idxv, &ival_d, &ival_d MDS_END_ARG);
   if (strlen(database))
   {
-    static int shotnum;
-    shotnum = 0;
+    int shotnum = 0;
     if (strlen(shot))
     {
       struct descriptor shot_dsc = {0, DTYPE_T, CLASS_S, 0};
-      static DESCRIPTOR_LONG(shotnum_dsc, &shotnum);
+      DESCRIPTOR_LONG(shotnum_dsc, &shotnum);
       shot_dsc.length = strlen(shot);
       shot_dsc.pointer = shot;
       ResetErrors();
@@ -241,7 +247,7 @@ Boolean EvaluateData(Boolean brief, int row, int col, int idx, Boolean *event,
   if (strlen(y))
   {
     struct descriptor y_dsc = {0, DTYPE_T, CLASS_S, 0};
-    static EMPTYXD(sig);
+    EMPTYXD(sig);
     static float zero = 0.0;
     static struct descriptor float_dsc = {sizeof(float), DTYPE_FLOAT, CLASS_S,
                                           (char *)&zero};
@@ -306,10 +312,16 @@ Boolean EvaluateData(Boolean brief, int row, int col, int idx, Boolean *event,
           return Error(brief, "Error evaluating X-axis", error, &y_xd, &x_xd);
       }
       else
+      {
+        MdsFree1Dx(&sig, 0);
         return Error(1, "Y-axis contains no points", error, &y_xd, 0);
+      }
     }
     else
+    {
+      MdsFree1Dx(&sig, 0);
       return Error(brief, "Error evaluating Y-axis", error, &y_xd, 0);
+    }
   }
   else
     return Error(1, "", error, 0, 0);
@@ -323,8 +335,8 @@ Boolean EvaluateText(String text, String error_prefix, String *text_ret,
   if (strlen(text))
   {
     struct descriptor text_dsc = {0, DTYPE_T, CLASS_S, 0};
-    static EMPTYXD(string_xd);
-    static struct descriptor_d string_d = {0, DTYPE_T, CLASS_D, 0};
+    EMPTYXD(string_xd);
+    struct descriptor_d string_d = {0, DTYPE_T, CLASS_D, 0};
     text_dsc.length = strlen(text);
     text_dsc.pointer = text;
     ResetErrors();
@@ -355,6 +367,138 @@ void CloseDataSources()
 {
   while (TreeClose(NULL, 0) & 1)
     ;
+  pthread_mutex_lock(&eval_mutex);
+  close_generation++;
+  pthread_mutex_unlock(&eval_mutex);
+}
+
+/*------------------------------------------------------------------------------
+        Background evaluation: a pool of worker threads, each with its own
+        tree context, runs the work queued by EvaluateInBackground and hands
+        it back to the Xt main loop through a pipe as soon as it is done.
+        DWSCOPE_THREADS sets the number of workers, 0 evaluates everything
+        in the main loop as before. Workers close their trees before their
+        next job after CloseDataSources.
+------------------------------------------------------------------------------*/
+
+typedef struct _EvalJob
+{
+  struct _EvalJob *next;
+  void (*work)(XtPointer);
+  XtPointer arg;
+} EvalJob;
+
+static pthread_cond_t eval_cond = PTHREAD_COND_INITIALIZER;
+static EvalJob *eval_head = NULL;
+static EvalJob *eval_tail = NULL;
+static int eval_pipe[2];
+static int eval_workers = 0;
+static void (*eval_done)(XtPointer) = NULL;
+
+static void *EvalWorker(void *arg __attribute__((unused)))
+{
+  unsigned closed;
+  pthread_mutex_lock(&eval_mutex);
+  closed = close_generation;
+  pthread_mutex_unlock(&eval_mutex);
+  TreeUsePrivateCtx(1);
+  for (;;)
+  {
+    EvalJob *job;
+    unsigned generation;
+    pthread_mutex_lock(&eval_mutex);
+    while (!eval_head)
+      pthread_cond_wait(&eval_cond, &eval_mutex);
+    job = eval_head;
+    eval_head = job->next;
+    if (!eval_head)
+      eval_tail = NULL;
+    generation = close_generation;
+    pthread_mutex_unlock(&eval_mutex);
+    if (generation != closed)
+    {
+      while (TreeClose(NULL, 0) & 1)
+        ;
+      closed = generation;
+    }
+    job->work(job->arg);
+    if (write(eval_pipe[1], &job->arg, sizeof(job->arg)) != sizeof(job->arg))
+      perror("Error writing to evaluation pipe");
+    free(job);
+  }
+  return NULL;
+}
+
+static void EvalDone(XtPointer client_data __attribute__((unused)),
+                     int *source __attribute__((unused)),
+                     XtInputId *id __attribute__((unused)))
+{
+  XtPointer arg;
+  if (read(eval_pipe[0], &arg, sizeof(arg)) == sizeof(arg))
+    eval_done(arg);
+  else
+    perror("Error reading from evaluation pipe");
+}
+
+int SetupEvaluateWorkers(XtAppContext app_context, void (*done)(XtPointer))
+{
+  char *threads = getenv("DWSCOPE_THREADS");
+  int num = threads ? atoi(threads) : 4;
+  int i;
+  if (num <= 0)
+    return 0;
+  if (pipe(eval_pipe) == -1)
+  {
+    perror("Error creating evaluation pipes");
+    return 0;
+  }
+  eval_done = done;
+  XtAppAddInput(app_context, eval_pipe[0], (XtPointer)XtInputReadMask,
+                EvalDone, 0);
+  for (i = 0; i < num; i++)
+  {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, EvalWorker, NULL))
+      break;
+    pthread_detach(thread);
+  }
+  eval_workers = i;
+  return eval_workers;
+}
+
+Boolean EvaluateInBackground(void (*work)(XtPointer), XtPointer arg)
+{
+  EvalJob *job;
+  if (!eval_workers || !(job = malloc(sizeof(EvalJob))))
+    return 0;
+  job->next = NULL;
+  job->work = work;
+  job->arg = arg;
+  pthread_mutex_lock(&eval_mutex);
+  if (eval_tail)
+    eval_tail->next = job;
+  else
+    eval_head = job;
+  eval_tail = job;
+  pthread_cond_signal(&eval_cond);
+  pthread_mutex_unlock(&eval_mutex);
+  return 1;
+}
+
+void CancelBackgroundEvaluations(void (*discard)(XtPointer))
+{
+  EvalJob *job;
+  pthread_mutex_lock(&eval_mutex);
+  job = eval_head;
+  eval_head = eval_tail = NULL;
+  pthread_mutex_unlock(&eval_mutex);
+  while (job)
+  {
+    EvalJob *next = job->next;
+    discard(job->arg);
+    free(job);
+    job = next;
+  }
 }
 
 #ifdef OLD_WAY
@@ -986,3 +1130,22 @@ void SetupEventInput(XtAppContext app_context,
 }
 
 #endif
+
+#if !defined(_LOCAL_ACCESS)
+int SetupEvaluateWorkers(XtAppContext app_context __attribute__((unused)),
+                         void (*done)(XtPointer) __attribute__((unused)))
+{
+  return 0;
+}
+
+Boolean EvaluateInBackground(void (*work)(XtPointer) __attribute__((unused)),
+                             XtPointer arg __attribute__((unused)))
+{
+  return 0;
+}
+
+void CancelBackgroundEvaluations(void (*discard)(XtPointer)
+                                 __attribute__((unused)))
+{
+}
+#endif
@@ -32,17 +32,40 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
         TechX Corporation.
 
-        usage:  MDSplus2HDF5 treename shot-number
+        usage:  MDSplus2HDF5 treename shot-number [-n nodes] [-z level]
+                             [-j readers]
 
         This program will open the tree specified on the command line
+
+        -n nodes    only export the nodes matching this wildcard node
+                    specification (for example "\\TOP.DIAG***"), with
+                    the groups of their ancestors
+        -z level    deflate level of chunked array datasets (default 1,
+                    0 writes contiguous datasets)
+        -j readers  threads reading the segments of a segmented node
+                    (default 2)
+
+        Segmented nodes are copied one segment at a time into chunked
+        datasets that grow as the segments are appended.  The readers
+        fetch the next segments while the current one is being written,
+        so at most a few segments of a signal are held in memory.
+
+        A segmented node is written as a group named after the node,
+        like a signal, holding a "data" dataset with the rows of all
+        segments and a "dim0" dataset with their dimension, instead of
+        the dataset older versions wrote from the evaluated record.
+        Readers of such files must look for the group.  hdf5ToMds reads
+        the group back as a structure with DATA and DIM0 nodes.
 */
 #include "hdf5.h"
 #include "mds_stdarg.h"
 #include "mdsdescrip.h"
 #include "mdsshr.h"
+#include "ncidef.h"
 #include "tdishr.h"
 #include "treeshr.h"
 #include <mdsplus/mdsplus.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -53,9 +76,21 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MAX_TREENAME 12
 #define MAX_DIMS 8
 #define MAX_DESCRS 8
+#define MAX_READERS 16
+#define CHUNK_BYTES (1 << 20)
+#define MIN_CHUNKED_BYTES (64 << 10)
 
 static char *tree;
 static int shot;
+static char *nodes = NULL;
+static int deflate_level = 1;
+static int readers = 2;
+
+/* with -n, the sorted nids of the matching nodes and of their ancestors */
+static int *wanted = NULL;
+static int num_wanted = 0;
+static int *needed = NULL;
+static int num_needed = 0;
 
 // extern int TdiExecute();
 
@@ -248,11 +283,13 @@ void ExitOnMDSError(int status, const char *msg)
 
 static void usage(const char *cmd)
 {
-  fprintf(stderr, "Usage %s tree shot\n", cmd);
+  fprintf(stderr, "Usage %s tree shot [-n nodes] [-z level] [-j readers]\n",
+          cmd);
 }
 
 static void parse_cmdline(int argc, const char *argv[])
 {
+  int i;
   if (argc < 3)
   {
     usage(argv[0]);
@@ -260,6 +297,102 @@ static void parse_cmdline(int argc, const char *argv[])
   }
   tree = (char *)argv[1];
   shot = strtol(argv[2], NULL, 0);
+  for (i = 3; i < argc; i++)
+  {
+    if (argv[i][0] != '-' || i + 1 == argc)
+    {
+      usage(argv[0]);
+      exit(0);
+    }
+    switch (argv[i++][1])
+    {
+    case 'n':
+      nodes = (char *)argv[i];
+      break;
+    case 'z':
+      deflate_level = strtol(argv[i], NULL, 0);
+      break;
+    case 'j':
+      readers = strtol(argv[i], NULL, 0);
+      if (readers < 1)
+        readers = 1;
+      else if (readers > MAX_READERS)
+        readers = MAX_READERS;
+      break;
+    default:
+      usage(argv[0]);
+      exit(0);
+    }
+  }
+}
+
+static int compare_nids(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+static int in_list(int nid, int *list, int num)
+{
+  return bsearch(&nid, list, num, sizeof(int), compare_nids) != NULL;
+}
+
+static int sort_list(int *list, int num)
+{
+  int i, j;
+  qsort(list, num, sizeof(int), compare_nids);
+  for (i = j = 0; i < num; i++)
+    if (j == 0 || list[j - 1] != list[i])
+      list[j++] = list[i];
+  return j;
+}
+
+static void OutOfMemory(const char *what)
+{
+  fprintf(stderr, "out of memory selecting %s\n", what);
+  exit(1);
+}
+
+/*
+  Routine SelectNodes - find the nodes matching the -n option and their
+                ancestors, which are exported as the groups leading to them.
+*/
+static void SelectNodes(char *spec)
+{
+  void *ctx = NULL;
+  int nid, size = 0;
+  while (TreeFindNodeWild(spec, &nid, &ctx, -1) & 1)
+  {
+    int parent = nid;
+    int parent_len;
+    NCI_ITM itmlst[] = {{sizeof(int), NciPARENT, &parent, &parent_len},
+                        {0, NciEND_OF_LIST, 0, 0}};
+    if (num_wanted == size)
+    {
+      size = size ? size * 2 : 1024;
+      wanted = realloc(wanted, size * sizeof(int));
+      if (!wanted)
+        OutOfMemory(spec);
+    }
+    wanted[num_wanted++] = nid;
+    do
+    {
+      if (num_needed % 1024 == 0)
+      {
+        needed = realloc(needed, (num_needed + 1024) * sizeof(int));
+        if (!needed)
+          OutOfMemory(spec);
+      }
+      needed[num_needed++] = parent;
+    } while (parent && (TreeGetNci(parent, itmlst) & 1) && parent_len);
+  }
+  TreeFindNodeEnd(&ctx);
+  if (num_wanted == 0)
+  {
+    fprintf(stderr, "No nodes match %s\n", spec);
+    exit(0);
+  }
+  num_wanted = sort_list(wanted, num_wanted);
+  num_needed = sort_list(needed, num_needed);
 }
 
 static hid_t CreateHDF5(char *tree, int shot)
@@ -286,9 +419,13 @@ hid_t MdsType2HDF5Type(unsigned char type)
   case DTYPE_FT:
     return (H5T_NATIVE_DOUBLE);
   case DTYPE_L:
-    return (H5T_NATIVE_LONG);
+    return (H5T_NATIVE_INT);
   case DTYPE_LU:
-    return (H5T_NATIVE_ULONG);
+    return (H5T_NATIVE_UINT);
+  case DTYPE_Q:
+    return (H5T_NATIVE_LLONG);
+  case DTYPE_QU:
+    return (H5T_NATIVE_ULLONG);
   case DTYPE_W:
     return (H5T_NATIVE_SHORT);
   case DTYPE_WU:
@@ -333,33 +470,79 @@ static void PutNumeric(hid_t parent, char *name, struct descriptor *dsc)
 
 typedef ARRAY_COEFF(char, MAX_DIMS) ARRAY_AC;
 
-static void PutArray(hid_t parent, char *name, struct descriptor *dsc)
+/*
+  Routine ChunkedPlist - dataset creation properties for an array of
+                rank dimensions with elements of length bytes.  Chunks
+                hold whole rows (the first HDF5 dimension, the last MDSplus
+                one) up to about CHUNK_BYTES and are compressed with
+                deflate_level unless it is 0.
+*/
+static hid_t ChunkedPlist(int rank, hsize_t *dim, int length)
+{
+  int j;
+  hsize_t chunk[MAX_DIMS];
+  hsize_t row = length;
+  hid_t plist;
+  for (j = 1; j < rank; j++)
+  {
+    chunk[j] = dim[j];
+    row *= dim[j];
+  }
+  chunk[0] = CHUNK_BYTES / (row ? row : 1);
+  if (chunk[0] > dim[0])
+    chunk[0] = dim[0];
+  if (chunk[0] < 1)
+    chunk[0] = 1;
+  plist = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(plist, rank, chunk);
+  if (deflate_level > 0)
+  {
+    H5Pset_shuffle(plist);
+    H5Pset_deflate(plist, deflate_level);
+  }
+  return plist;
+}
+
+/*
+  Array dimensions of an MDSplus array in HDF5 order, slowest varying first
+*/
+static int ArrayDims(struct descriptor_a *adsc, hsize_t *dim)
 {
   int j;
+  int rank = adsc->dimct;
+  if (adsc->aflags.coeff)
+  {
+    ARRAY_AC *ac_dsc = (ARRAY_AC *)adsc;
+    for (j = 0; j < rank; j++)
+      dim[j] = ac_dsc->m[adsc->dimct - j - 1];
+  }
+  else
+  {
+    rank = 1;
+    dim[0] = adsc->arsize / adsc->length;
+  }
+  return rank;
+}
+
+static void PutArray(hid_t parent, char *name, struct descriptor *dsc)
+{
   //  herr_t status;
   struct descriptor_a *adsc = (struct descriptor_a *)dsc;
-  ARRAY_AC *ac_dsc = (ARRAY_AC *)dsc;
   hid_t space_id;
   hid_t ds_id;
-  int rank = adsc->dimct;
+  int rank;
   hsize_t dim[MAX_DIMS];
   hid_t dtype = MdsType2HDF5Type(dsc->dtype);
   if (dtype > 0)
   {
-    if (adsc->aflags.coeff)
-    {
-      for (j = 0; j < rank; j++)
-      {
-        dim[j] = ac_dsc->m[adsc->dimct - j - 1];
-      }
-    }
-    else
-    {
-      rank = 1;
-      dim[0] = adsc->arsize / adsc->length;
-    }
+    rank = ArrayDims(adsc, dim);
     space_id = H5Screate_simple(rank, dim, NULL);
-    ds_id = H5Dcreate(parent, name, dtype, space_id, H5P_DEFAULT);
+    hid_t plist = (deflate_level > 0 && adsc->arsize >= MIN_CHUNKED_BYTES)
+                      ? ChunkedPlist(rank, dim, adsc->length)
+                      : H5P_DEFAULT;
+    ds_id = H5Dcreate(parent, name, dtype, space_id, plist);
+    if (plist != H5P_DEFAULT)
+      H5Pclose(plist);
     if (ds_id < 0)
     {
       char *new_name = MemberMangle(name);
@@ -535,6 +718,228 @@ static void WriteData(hid_t parent, char *name, struct descriptor *dsc)
   }
 }
 
+/*
+  Segmented records are streamed through a small ring of slots.  Reader
+  threads fetch segment next_read into slot next_read % depth while the
+  main thread appends the segments to the HDF5 file in order, so HDF5,
+  which is not thread safe, is only called from the main thread.  A reader
+  waits while depth segments are pending, which bounds the memory used to
+  depth segments whatever the length of the record.
+*/
+typedef struct
+{
+  int ready;
+  int status;
+  struct descriptor_xd data;
+  struct descriptor_xd dim;
+} segment_slot_t;
+
+typedef struct
+{
+  int nid;
+  int nseg;
+  int next_read;
+  int next_write;
+  int depth;
+  segment_slot_t *slot;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+} segment_pipe_t;
+
+static void ReadSegment(segment_pipe_t *segs, int idx, segment_slot_t *slot)
+{
+  static const struct descriptor_xd empty_xd = {0, DTYPE_DSC, CLASS_XD, 0, 0};
+  int status;
+  slot->data = empty_xd;
+  slot->dim = empty_xd;
+  status = TreeGetSegment(segs->nid, idx, &slot->data, &slot->dim);
+  if (STATUS_OK && slot->dim.pointer && slot->dim.pointer->class != CLASS_A)
+    status = TdiData((struct descriptor *)&slot->dim, &slot->dim MDS_END_ARG);
+  slot->status = status;
+}
+
+static void *SegmentReader(void *arg)
+{
+  segment_pipe_t *segs = (segment_pipe_t *)arg;
+  pthread_mutex_lock(&segs->lock);
+  for (;;)
+  {
+    int idx;
+    segment_slot_t *slot;
+    while (segs->next_read < segs->nseg &&
+           segs->next_read - segs->next_write >= segs->depth)
+      pthread_cond_wait(&segs->cond, &segs->lock);
+    if (segs->next_read >= segs->nseg)
+      break;
+    idx = segs->next_read++;
+    slot = &segs->slot[idx % segs->depth];
+    pthread_mutex_unlock(&segs->lock);
+    ReadSegment(segs, idx, slot);
+    pthread_mutex_lock(&segs->lock);
+    slot->ready = 1;
+    pthread_cond_broadcast(&segs->cond);
+  }
+  pthread_mutex_unlock(&segs->lock);
+  return NULL;
+}
+
+/*
+  Routine AppendRows - append the rows of an array to an extendible
+                dataset, creating the dataset from the first array.
+
+  Arguments:
+                ds_id - (hid_t *) the dataset, or a negative id if it still
+                        has to be created.
+                parent - (hid_t) the group to create the dataset in.
+                name - (char *) the name of the dataset.
+                dsc - (struct descriptor *) the array to append.
+                rows - (hsize_t *) the number of rows written so far.
+*/
+static void AppendRows(hid_t *ds_id, hid_t parent, char *name,
+                       struct descriptor *dsc, hsize_t *rows)
+{
+  struct descriptor_a *adsc = (struct descriptor_a *)dsc;
+  hsize_t dim[MAX_DIMS];
+  hsize_t size[MAX_DIMS];
+  hsize_t start[MAX_DIMS];
+  hid_t dtype;
+  hid_t space_id;
+  hid_t mem_id;
+  int rank;
+  int j;
+  if (dsc == NULL || dsc->class != CLASS_A)
+    return;
+  dtype = MdsType2HDF5Type(dsc->dtype);
+  if (dtype <= 0)
+    return;
+  rank = ArrayDims(adsc, dim);
+  if (*ds_id < 0)
+  {
+    hsize_t maxdims[MAX_DIMS];
+    hid_t plist = ChunkedPlist(rank, dim, adsc->length);
+    memcpy(size, dim, sizeof(hsize_t) * rank);
+    memcpy(maxdims, dim, sizeof(hsize_t) * rank);
+    size[0] = 0;
+    maxdims[0] = H5S_UNLIMITED;
+    space_id = H5Screate_simple(rank, size, maxdims);
+    *ds_id = H5Dcreate(parent, name, dtype, space_id, plist);
+    H5Pclose(plist);
+    H5Sclose(space_id);
+    if (*ds_id < 0)
+    {
+      fprintf(stderr, "could not create dataset to store segments in %s\n",
+              name);
+      return;
+    }
+  }
+  space_id = H5Dget_space(*ds_id);
+  if (H5Sget_simple_extent_ndims(space_id) != rank)
+  {
+    H5Sclose(space_id);
+    fprintf(stderr, "segment of %s has a different shape, skipped\n", name);
+    return;
+  }
+  H5Sget_simple_extent_dims(space_id, size, NULL);
+  H5Sclose(space_id);
+  for (j = 1; j < rank; j++)
+    if (size[j] != dim[j])
+    {
+      fprintf(stderr, "segment of %s has a different shape, skipped\n", name);
+      return;
+    }
+  size[0] = *rows + dim[0];
+  H5Dset_extent(*ds_id, size);
+  space_id = H5Dget_space(*ds_id);
+  memset(start, 0, sizeof(start));
+  start[0] = *rows;
+  H5Sselect_hyperslab(space_id, H5S_SELECT_SET, start, NULL, dim, NULL);
+  mem_id = H5Screate_simple(rank, dim, NULL);
+  H5Dwrite(*ds_id, dtype, mem_id, space_id, H5P_DEFAULT, adsc->pointer);
+  H5Sclose(mem_id);
+  H5Sclose(space_id);
+  *rows += dim[0];
+}
+
+/*
+  Routine WriteSegmented - write a segmented record as a group with an
+                extendible "data" and "dim0" dataset, appending one segment
+                at a time as the reader threads deliver them.
+*/
+static void WriteSegmented(hid_t parent, char *name, int nid, int nseg)
+{
+  pthread_t threads[MAX_READERS];
+  segment_pipe_t segs;
+  hid_t data_id = -1;
+  hid_t dim_id = -1;
+  hsize_t data_rows = 0;
+  hsize_t dim_rows = 0;
+  int nthreads = readers < nseg ? readers : nseg;
+  int i;
+  hid_t g_id = H5Gcreate(parent, name, 0);
+  if (g_id < 0)
+  {
+    char *new_name = ChildMangle(name);
+    g_id = H5Gcreate(parent, new_name, 0);
+  }
+  if (g_id < 0)
+  {
+    fprintf(stderr, "could not create group for segments of %s \n", name);
+    return;
+  }
+  segs.nid = nid;
+  segs.nseg = nseg;
+  segs.next_read = 0;
+  segs.next_write = 0;
+  segs.depth = 2 * nthreads;
+  segs.slot = calloc(segs.depth, sizeof(segment_slot_t));
+  if (!segs.slot)
+  {
+    fprintf(stderr, "out of memory copying segments of %s\n", name);
+    H5Gclose(g_id);
+    return;
+  }
+  pthread_mutex_init(&segs.lock, NULL);
+  pthread_cond_init(&segs.cond, NULL);
+  for (i = 0; i < nthreads; i++)
+    if (pthread_create(&threads[i], NULL, SegmentReader, &segs))
+      break;
+  nthreads = i;
+  for (i = 0; i < nseg; i++)
+  {
+    segment_slot_t *slot = &segs.slot[i % segs.depth];
+    if (nthreads == 0)
+      ReadSegment(&segs, i, slot);
+    pthread_mutex_lock(&segs.lock);
+    while (nthreads && !slot->ready)
+      pthread_cond_wait(&segs.cond, &segs.lock);
+    pthread_mutex_unlock(&segs.lock);
+    if (slot->status & 1)
+    {
+      AppendRows(&data_id, g_id, "data", slot->data.pointer, &data_rows);
+      AppendRows(&dim_id, g_id, "dim0", slot->dim.pointer, &dim_rows);
+    }
+    else
+      fprintf(stderr, "could not read segment %d of %s\n", i, name);
+    MdsFree1Dx(&slot->data, NULL);
+    MdsFree1Dx(&slot->dim, NULL);
+    pthread_mutex_lock(&segs.lock);
+    slot->ready = 0;
+    segs.next_write++;
+    pthread_cond_broadcast(&segs.cond);
+    pthread_mutex_unlock(&segs.lock);
+  }
+  for (i = 0; i < nthreads; i++)
+    pthread_join(threads[i], NULL);
+  pthread_cond_destroy(&segs.cond);
+  pthread_mutex_destroy(&segs.lock);
+  free(segs.slot);
+  if (data_id >= 0)
+    H5Dclose(data_id);
+  if (dim_id >= 0)
+    H5Dclose(dim_id);
+  H5Gclose(g_id);
+}
+
 /*
   Routine WriteDataNID - Routine to get the data from a nid and call WriteData
                 to add an attribute to the HDF5 file for it.
@@ -555,6 +960,12 @@ static void WriteDataNID(hid_t parent, char *name, int nid)
   static EMPTYXD(xd);
   DESCRIPTOR_NID(nid_dsc, &nid);
   int status;
+  int nseg = 0;
+  if ((TreeGetNumSegments(nid, &nseg) & 1) && nseg > 0)
+  {
+    WriteSegmented(parent, name, nid, nseg);
+    return;
+  }
   status = TdiEvaluate(&nid_dsc, &xd MDS_END_ARG);
   if (STATUS_OK)
   {
@@ -587,6 +998,8 @@ static void AddBranch(int nid, hid_t parent_id)
   char name[MAX_TREENAME + 1];
   int _is_child;
   int _has_descendants;
+  if (nodes && !in_list(nid, needed, num_needed))
+    return;
   bzero(name, sizeof(name));
   if (nid == 0)
     strcpy(name, "\\TOP");
@@ -626,7 +1039,7 @@ static void AddBranch(int nid, hid_t parent_id)
     }
   }
 
-  if (!_is_child)
+  if (!_is_child && (!nodes || in_list(nid, wanted, num_wanted)))
   {
     if (_has_descendants)
     {
@@ -645,6 +1058,8 @@ int main(int argc, const char *argv[])
   hid_t file_id;
   parse_cmdline(argc, argv);
   ExitOnMDSError(TreeOpen(tree, shot, 0), "Error opening tree");
+  if (nodes)
+    SelectNodes(nodes);
   file_id = CreateHDF5(tree, shot);
   /*
    * add \top and all of its members and children
@@ -22,16 +22,39 @@ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
+/*
+        Program hdf5ToMds
+
+        usage:  hdf5ToMds file tree shot
+
+        Creates a new pulse of tree with a node for every group, dataset
+        and attribute of the HDF5 file.  Groups become structure nodes.
+        Chunked numeric datasets become segmented records with a segment
+        per slab of about SEGMENT_BYTES, and the dimension of the
+        segments is the row index.  This applies to any chunked dataset,
+        not only the ones written by MDSplus2HDF5 for segmented nodes, so
+        extendible or compressed datasets that older versions read into
+        one array are now read as segments.  Other datasets become
+        arrays.  A segmented node exported by MDSplus2HDF5 comes back as
+        a structure with a segmented DATA and DIM0 node.
+*/
 #include <ctype.h>
 #include <hdf5.h>
 #include <mdsdescrip.h>
 #include <ncidef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <treeshr.h>
 #include <usagedef.h>
 
+/* target size of the segments written for chunked datasets */
+#define SEGMENT_BYTES (1 << 20)
+
+/* most dimensions an MDSplus array descriptor can hold */
+#define MAX_DIMS 8
+
 static int d_status = EXIT_SUCCESS;
 
 static const char *tree = 0;
@@ -74,12 +97,17 @@ static int AddNode(const char *h5name, int usage)
 
   int status;
   int memlen = ((strlen(h5name) < 12) ? 12 : strlen(h5name)) + 2;
-  char *name =
-      strcpy(malloc(memlen), (usage != TreeUSAGE_STRUCTURE) ? ":" : ".");
+  char *name = malloc(memlen);
   size_t i;
   size_t len;
   int idx = 1;
   int nid;
+  if (!name)
+  {
+    printf("Out of memory adding node for %s\n", h5name);
+    exit(EXIT_FAILURE);
+  }
+  strcpy(name, (usage != TreeUSAGE_STRUCTURE) ? ":" : ".");
   for (i = 0; i < strlen(h5name) && ((h5name[i] < 'A' || h5name[i] > 'Z') &&
                                      (h5name[i] < 'a' || h5name[i] > 'z'));
        i++)
@@ -204,7 +232,94 @@ static void PutScalar(int nid, char dtype, int size, void *ptr)
   TreePutRecord(nid, &dsc, 0);
 }
 
-static void PutData(hid_t obj, int nid, char dtype, int htype, int size,
+static int IsChunked(hid_t obj)
+{
+  hid_t plist = H5Dget_create_plist(obj);
+  int chunked = (H5Pget_layout(plist) == H5D_CHUNKED);
+  H5Pclose(plist);
+  return chunked;
+}
+
+static void PutSegments(hid_t obj, int nid, char dtype, hid_t htype, int size,
+                        int n_dims, hsize_t *dims)
+{
+  /***************************************************
+  Stream a chunked dataset into a segmented record.
+  The dataset is read a slab of whole rows (its first
+  dimension) at a time, each slab holding a multiple
+  of the chunk rows of about SEGMENT_BYTES, and every
+  slab is stored as one segment whose last MDSplus
+  dimension is the rows. The segment start, end and
+  dimension are the row indices, so only one slab is
+  in memory whatever the size of the dataset.
+  ***************************************************/
+  hsize_t chunk[64];
+  hsize_t offset[64];
+  hsize_t count[64];
+  hsize_t row_bytes = size;
+  hsize_t seg_rows;
+  hsize_t row;
+  hid_t plist = H5Dget_create_plist(obj);
+  char *mem;
+  int i;
+  H5Pget_chunk(plist, n_dims, chunk);
+  H5Pclose(plist);
+  for (i = 1; i < n_dims; i++)
+    row_bytes *= dims[i];
+  if (dims[0] == 0 || row_bytes == 0)
+    return;
+  seg_rows = chunk[0] ? chunk[0] : 1;
+  if (seg_rows * row_bytes < SEGMENT_BYTES)
+    seg_rows *= SEGMENT_BYTES / (seg_rows * row_bytes);
+  if (seg_rows > dims[0])
+    seg_rows = dims[0];
+  mem = malloc(seg_rows * row_bytes);
+  if (!mem)
+  {
+    printf("Out of memory reading %llu rows of %llu bytes, skipping\n",
+           (unsigned long long)seg_rows, (unsigned long long)row_bytes);
+    d_status = EXIT_FAILURE;
+    return;
+  }
+  memcpy(count, dims, n_dims * sizeof(hsize_t));
+  memset(offset, 0, n_dims * sizeof(hsize_t));
+  for (row = 0; row < dims[0]; row += count[0])
+  {
+    int64_t first = (int64_t)row;
+    int64_t last;
+    int64_t delta = 1;
+    DESCRIPTOR_A_COEFF(dsc, 0, 0, 0, 8, 0);
+    mdsdsc_t start_d = {sizeof(int64_t), DTYPE_Q, CLASS_S, (char *)&first};
+    mdsdsc_t end_d = {sizeof(int64_t), DTYPE_Q, CLASS_S, (char *)&last};
+    mdsdsc_t delta_d = {sizeof(int64_t), DTYPE_Q, CLASS_S, (char *)&delta};
+    DESCRIPTOR_RANGE(dim_d, &start_d, &end_d, &delta_d);
+    hid_t file_space = H5Dget_space(obj);
+    hid_t mem_space;
+    count[0] = dims[0] - row < seg_rows ? dims[0] - row : seg_rows;
+    last = first + (int64_t)count[0] - 1;
+    offset[0] = row;
+    H5Sselect_hyperslab(file_space, H5S_SELECT_SET, offset, NULL, count, NULL);
+    mem_space = H5Screate_simple(n_dims, count, NULL);
+    H5Dread(obj, htype, mem_space, file_space, H5P_DEFAULT, (void *)mem);
+    H5Sclose(mem_space);
+    H5Sclose(file_space);
+    dsc.length = size;
+    dsc.dtype = dtype;
+    dsc.pointer = mem;
+    dsc.a0 = mem;
+    dsc.dimct = n_dims;
+    dsc.arsize = (int)(count[0] * row_bytes);
+    for (i = 0; i < n_dims; i++)
+      dsc.m[i] = (int)count[n_dims - 1 - i];
+    if (n_dims == 1)
+      dsc.aflags.coeff = 0;
+    TreeMakeSegment(nid, &start_d, &end_d, (mdsdsc_t *)&dim_d,
+                    (mdsdsc_a_t *)&dsc, -1, (int)count[0]);
+  }
+  free(mem);
+}
+
+static void PutData(hid_t obj, int nid, char dtype, hid_t htype, int size,
                     int n_dims, hsize_t *dims, int is_attr)
 {
   /*********************************************
@@ -212,7 +327,15 @@ static void PutData(hid_t obj, int nid, char dtype, int htype, int size,
   attributes and H5Dread for datasets. Load the
   data into MDSplus nodes.
   *********************************************/
-  if (dtype)
+  if (n_dims > MAX_DIMS)
+  {
+    printf("Skipping data with %d dimensions, at most %d are supported\n",
+           n_dims, MAX_DIMS);
+    return;
+  }
+  if (dtype && !is_attr && n_dims > 0 && dtype != DTYPE_T && IsChunked(obj))
+    PutSegments(obj, nid, dtype, htype, size, n_dims, dims);
+  else if (dtype)
   {
     char *mem;
     int array_size = 1;
@@ -220,6 +343,12 @@ static void PutData(hid_t obj, int nid, char dtype, int htype, int size,
     for (i = 0; i < n_dims; i++)
       array_size *= dims[i];
     mem = malloc(size * array_size);
+    if (!mem)
+    {
+      printf("Out of memory reading %d bytes, skipping\n", size * array_size);
+      d_status = EXIT_FAILURE;
+      return;
+    }
     if (is_attr)
       H5Aread(obj, htype, (void *)mem);
     else
@@ -244,7 +373,7 @@ static int mds_find_attr(hid_t attr_id, const char *name,
   {
     int size;
     char dtype;
-    int htype;
+    hid_t htype;
     int is_signed;
     hsize_t ds_dims[64];
     hid_t space = H5Aget_space(obj);
@@ -415,7 +544,7 @@ static int mds_find_objs(hid_t group, const char *name, void *op_data)
     {
       int size;
       char dtype;
-      int htype;
+      hid_t htype;
       int is_signed;
       hsize_t ds_dims[64];
       hid_t space = H5Dget_space(obj);
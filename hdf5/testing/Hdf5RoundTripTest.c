@@ -0,0 +1,208 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <hdf5.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// MDSplus //
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+#include <treeshr.h>
+#include <usagedef.h>
+
+// testing //
+#include "testing.h"
+
+/* Export a tree with a segmented and a plain array node with MDSplus2HDF5
+ * and import the file with hdf5ToMds into another pulse. The segmented node
+ * becomes a group with chunked "data" and "dim0" datasets, which come back
+ * as segmented DATA and DIM0 nodes. The plain array comes back as an array.
+ */
+#define TREE "hdf5_test"
+#define SEGMENTS 3
+#define SEG_ROWS 500
+#define ROWS (SEGMENTS * SEG_ROWS)
+#define ARR_LEN 10
+
+static float data[ROWS];
+static int64_t times[ROWS];
+static float arr[ARR_LEN];
+
+static void make_tree()
+{
+  int sig, arr_nid, seg, status;
+  DESCRIPTOR_A(arr_d, sizeof(float), DTYPE_FS, arr, sizeof(arr));
+  status = TreeOpenNew(TREE, 1);
+  TEST1(STATUS_OK);
+  status = TreeAddNode("SIG", &sig, TreeUSAGE_SIGNAL);
+  TEST1(STATUS_OK);
+  status = TreeAddNode("ARR", &arr_nid, TreeUSAGE_NUMERIC);
+  TEST1(STATUS_OK);
+  status = TreeWriteTree(0, 0);
+  TEST1(STATUS_OK);
+  for (seg = 0; seg < SEGMENTS; seg++)
+  {
+    float *rows = &data[seg * SEG_ROWS];
+    int64_t *t = &times[seg * SEG_ROWS];
+    DESCRIPTOR_A(data_d, sizeof(float), DTYPE_FS, rows,
+                 SEG_ROWS * sizeof(float));
+    DESCRIPTOR_A(dim_d, sizeof(int64_t), DTYPE_Q, t,
+                 SEG_ROWS * sizeof(int64_t));
+    mdsdsc_t start_d = {sizeof(int64_t), DTYPE_Q, CLASS_S, (char *)&t[0]};
+    mdsdsc_t end_d = {sizeof(int64_t), DTYPE_Q, CLASS_S,
+                      (char *)&t[SEG_ROWS - 1]};
+    status = TreeMakeSegment(sig, &start_d, &end_d, (mdsdsc_t *)&dim_d,
+                             (mdsdsc_a_t *)&data_d, -1, SEG_ROWS);
+    TEST1(STATUS_OK);
+  }
+  status = TreePutRecord(arr_nid, (mdsdsc_t *)&arr_d, 0);
+  TEST1(STATUS_OK);
+  status = TreeClose(0, 0);
+  TEST1(STATUS_OK);
+}
+
+/// read a whole one dimensional dataset, returns its length
+static hsize_t read_dataset(hid_t file, const char *name, hid_t type,
+                            void *buf, hsize_t max, int *chunked)
+{
+  hsize_t len = 0;
+  hid_t ds = H5Dopen(file, name);
+  if (ds < 0)
+    return 0;
+  hid_t space = H5Dget_space(ds);
+  hid_t plist = H5Dget_create_plist(ds);
+  if (H5Sget_simple_extent_ndims(space) == 1)
+    H5Sget_simple_extent_dims(space, &len, NULL);
+  *chunked = H5Pget_layout(plist) == H5D_CHUNKED;
+  if (len > 0 && len <= max)
+    H5Dread(ds, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf);
+  H5Pclose(plist);
+  H5Sclose(space);
+  H5Dclose(ds);
+  return len;
+}
+
+static void check_file()
+{
+  static float file_data[ROWS];
+  static int64_t file_times[ROWS];
+  float file_arr[ARR_LEN];
+  int chunked;
+  hid_t file = H5Fopen(TREE "_1.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+  TEST1(file >= 0);
+  TEST1(read_dataset(file, "/\\TOP/SIG/data", H5T_NATIVE_FLOAT, file_data,
+                     ROWS, &chunked) == ROWS);
+  TEST1(chunked);
+  TEST0(memcmp(file_data, data, sizeof(data)));
+  TEST1(read_dataset(file, "/\\TOP/SIG/dim0", H5T_NATIVE_LLONG, file_times,
+                     ROWS, &chunked) == ROWS);
+  TEST0(memcmp(file_times, times, sizeof(times)));
+  TEST1(read_dataset(file, "/\\TOP/ARR", H5T_NATIVE_FLOAT, file_arr, ARR_LEN,
+                     &chunked) == ARR_LEN);
+  TEST0(chunked);
+  TEST0(memcmp(file_arr, arr, sizeof(arr)));
+  H5Fclose(file);
+}
+
+/// concatenate the segments of a node, returns the number of rows
+static int read_segments(const char *path, char *buf, int length, int max)
+{
+  int nid, nseg = 0, idx, rows = 0;
+  int status = TreeFindNode(path, &nid);
+  if (STATUS_OK)
+    status = TreeGetNumSegments(nid, &nseg);
+  for (idx = 0; STATUS_OK && idx < nseg; idx++)
+  {
+    EMPTYXD(seg);
+    EMPTYXD(dim);
+    status = TreeGetSegment(nid, idx, &seg, &dim);
+    if (STATUS_OK && seg.pointer && seg.pointer->class == CLASS_A &&
+        seg.pointer->length == length)
+    {
+      mdsdsc_a_t *a = (mdsdsc_a_t *)seg.pointer;
+      int n = a->arsize / length;
+      if (rows + n <= max)
+        memcpy(buf + rows * length, a->pointer, a->arsize);
+      rows += n;
+    }
+    else
+      status = 0;
+    MdsFree1Dx(&seg, NULL);
+    MdsFree1Dx(&dim, NULL);
+  }
+  return STATUS_OK && nseg > 0 ? rows : -1;
+}
+
+static void check_import()
+{
+  static float tree_data[ROWS];
+  static int64_t tree_times[ROWS];
+  EMPTYXD(xd);
+  int nid, nseg = -1;
+  int status = TreeOpen(TREE, 2, 1);
+  TEST1(STATUS_OK);
+  TEST1(read_segments(".TOP.SIG:DATA", (char *)tree_data, sizeof(float),
+                      ROWS) == ROWS);
+  TEST0(memcmp(tree_data, data, sizeof(data)));
+  TEST1(read_segments(".TOP.SIG:DIM0", (char *)tree_times, sizeof(int64_t),
+                      ROWS) == ROWS);
+  TEST0(memcmp(tree_times, times, sizeof(times)));
+  status = TreeFindNode(".TOP:ARR", &nid);
+  TEST1(STATUS_OK);
+  status = TreeGetNumSegments(nid, &nseg);
+  TEST1(STATUS_OK && nseg == 0);
+  status = TreeGetRecord(nid, &xd);
+  TEST1(STATUS_OK);
+  TEST1(xd.pointer && xd.pointer->class == CLASS_A &&
+        xd.pointer->dtype == DTYPE_FS &&
+        ((mdsdsc_a_t *)xd.pointer)->arsize == sizeof(arr));
+  if (xd.pointer)
+    TEST0(memcmp(xd.pointer->pointer, arr, sizeof(arr)));
+  MdsFree1Dx(&xd, NULL);
+  TreeClose(0, 0);
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(HDF5 round trip);
+  int i;
+  for (i = 0; i < ROWS; i++)
+  {
+    data[i] = (float)i * 0.5f - 100;
+    times[i] = 1000 + 10 * (int64_t)i;
+  }
+  for (i = 0; i < ARR_LEN; i++)
+    arr[i] = (float)i * i;
+  MdsPutEnv(TREE "_path=.");
+  make_tree();
+  TEST0(system("MDSplus2HDF5 " TREE " 1"));
+  check_file();
+  TEST0(system("hdf5ToMds " TREE "_1.h5 " TREE " 2"));
+  check_import();
+  END_TESTING;
+}
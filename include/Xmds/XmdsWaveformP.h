@@ -148,6 +148,23 @@ typedef struct _XmdsWaveformAxis
   int offset;
   double pointer_resolution;
 } XmdsWaveformAxis;
+/* Pixel column envelope of the trace and the scaling it was built for */
+
+typedef struct _XmdsWaveformEnvelope
+{
+  int count;
+  int *x;
+  int *y;
+  Boolean *pen_down;
+  float xmin;
+  float xmax;
+  float ymin;
+  float ymax;
+  Dimension width;
+  Dimension height;
+  int xoffset;
+  int yoffset;
+} XmdsWaveformEnvelope;
 /* Fields global to widget */
 
 typedef struct _WaveformPart
@@ -193,6 +210,7 @@ typedef struct _WaveformPart
   Boolean disabled;
   Boolean redraw;
   Boolean closed;
+  XmdsWaveformEnvelope envelope;
 } XmdsWaveformPart;
 /****************************************************************
  *
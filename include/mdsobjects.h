@@ -2938,6 +2938,7 @@ namespace MDSplus
   class Tree;
   class TreeNode;
   class TreeNodeArray;
+  class TreeAsyncWriter;
 
   ///
   /// \brief The TreeNode class object description of DTYPE_NID
@@ -3297,6 +3298,19 @@ namespace MDSplus
     /// Writre a single row of timestamped data
     virtual void putRow(Data *data, int64_t *time, int size = 1024);
 
+    /// Queue a single row of timestamped data on an asynchronous writer.
+    /// Rows queued for the same node are merged and stored in the background,
+    /// see \ref TreeAsyncWriter.
+    virtual void putRowAsync(TreeAsyncWriter *writer, Data *data,
+                             int64_t *time, int size = 1024);
+
+    /// Queue (part of) data segment on an asynchronous writer
+    virtual void putSegmentAsync(TreeAsyncWriter *writer, Array *data, int ofs);
+
+    /// Queue a complete segment on an asynchronous writer
+    virtual void makeSegmentAsync(TreeAsyncWriter *writer, Data *start,
+                                  Data *end, Data *time, Array *initialData);
+
     /// Get info for the node identified by sefIdx, or the last node if -1 is
     /// passed as segIdx argument. The function returns dtype of the contained
     /// data and the row dimensions. The function provides: In dimct the number
@@ -4248,6 +4262,55 @@ namespace MDSplus
     int64_t getDatafileSize();
   };
 
+  ///
+  /// \brief The TreeAsyncWriter class queues segment writes of a tree and
+  /// stores them from a background thread (see treeshr TreeAsyncWriterOpen).
+  ///
+  /// Data passed to \ref TreeNode::putRowAsync, \ref
+  /// TreeNode::putSegmentAsync and \ref TreeNode::makeSegmentAsync is copied
+  /// and the call returns at once; it blocks only while more than maxBytes
+  /// are waiting to be written. Consecutive rows of a node are stored with a
+  /// single write. The writer is flushed when the tree is closed and when it
+  /// is deleted. Errors of the background thread are thrown by the next call.
+  ///
+  ///     TreeAsyncWriter writer(tree);
+  ///     for (int i = 0; i < numSamples; i++)
+  ///       node->putRowAsync(&writer, samples[i], &times[i], 10000);
+  ///     writer.flush();
+  ///
+  class EXPORT TreeAsyncWriter
+  {
+    void *writer;
+
+  public:
+    TreeAsyncWriter(Tree *tree, int64_t maxBytes = 0);
+    ~TreeAsyncWriter();
+
+    /// Return the treeshr writer handle
+    void *getWriter() { return writer; }
+
+    /// Wait until everything queued so far has been written
+    void flush();
+
+    /// Number of queued items not yet written
+    int64_t getQueueDepth();
+
+    /// Largest number of queued items seen
+    int64_t getMaxQueueDepth();
+
+    /// Bytes waiting to be written
+    int64_t getQueuedBytes();
+
+    /// Rows stored so far
+    int64_t getRowsWritten();
+
+    /// Average time in ns from queueing to storage of the last batch
+    int64_t getLastLatency();
+
+    /// Longest time in ns from queueing to storage
+    int64_t getMaxLatency();
+  };
+
   ////////////////////////////////////////////////////////////////////////////////
   //  Event  /////////////////////////////////////////////////////////////////////
   ////////////////////////////////////////////////////////////////////////////////
@@ -4432,12 +4495,16 @@ namespace MDSplus
   {
     Connection *conn;
     Dictionary *evalRes;
+    int nThreads;
+    int timeoutMs;
 
   public:
     GetMany(Connection *conn)
     {
       this->conn = conn;
       evalRes = 0;
+      nThreads = 0;
+      timeoutMs = 0;
     }
     ~GetMany()
     {
@@ -4448,6 +4515,14 @@ namespace MDSplus
     void insert(int idx, char *name, char *expr, Data **args, int nArgs);
     void insert(char *beforeName, char *name, char *expr, Data **args, int nArgs);
     void remove(char *name);
+    /// Evaluate the entries on the server with nThreads worker threads.
+    /// With timeoutMs > 0 entries not completed within timeoutMs are
+    /// reported as errors. nThreads <= 1 restores serial evaluation.
+    void setParallel(int nThreads, int timeoutMs = 0)
+    {
+      this->nThreads = nThreads;
+      this->timeoutMs = timeoutMs;
+    }
     void execute();
     Data *get(char *name);
   };
@@ -4569,8 +4644,26 @@ namespace MDSplus
     std::vector<std::string> names;
     std::string name;
     void handleJSONPayload(char *);
+    void handleBinaryPayload(const char *, size_t);
 
   public:
+    /// Payload format of the messages sent for a stream. JSON is understood
+    /// by every listener, BINARY and BINARY_INT16 carry a versioned header
+    /// followed by the raw little-endian times and samples (as float32 or
+    /// as int16 scaled to the chunk range) and are decoded by C++
+    /// EventStream listeners, which accept any of the three.
+    enum Format
+    {
+      JSON = 0,
+      BINARY = 1,
+      BINARY_INT16 = 2
+    };
+    /// Select the format used by send() for the named stream. The default
+    /// is taken from environment variable MDSEVENT_STREAM_FORMAT
+    /// (json, binary or int16) and is JSON if not defined.
+    static void setFormat(const char *name, Format format);
+    static Format getFormat(const char *name);
+
     virtual void run();
     EventStream() : Event("STREAMING")
     {
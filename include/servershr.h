@@ -50,6 +50,7 @@ EXPORT extern int ServerDispatchPhase(int *id, void *vtable, char *phasenam,
                                       void (*output_rtn)(),
                                       const char *monitor);
 EXPORT extern int ServerFailedEssential(void *vtable, int reset);
+EXPORT extern char *ServerGetCriticalPath(void *vtable, double *seconds);
 EXPORT extern char *ServerFindServers(void **ctx, char *wild_match);
 EXPORT extern int ServerMonitorCheckin(char *server, void (*ast)(),
                                        void *astparam);
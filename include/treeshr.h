@@ -83,6 +83,7 @@ extern "C"
   extern EXPORT int TreeDoMethod_HANDLER(int *sig_args, int *mech_args);
   extern EXPORT int TreeEditing();
   extern EXPORT int _TreeEditing(void *dbid);
+  extern EXPORT int _TreeFilesChanged(void *dbid);
   extern EXPORT int TreeEndConglomerate();
   extern EXPORT int _TreeEndConglomerate(void *dbid);
 
@@ -308,6 +309,9 @@ extern "C"
                                        mdsdsc_xd_t *delta);
   extern EXPORT int _TreeGetTimeContext(void *dbid, mdsdsc_xd_t *start,
                                         mdsdsc_xd_t *end, mdsdsc_xd_t *delta);
+  extern EXPORT int TreeBeginTimeContext(mdsdsc_t *start, mdsdsc_t *end,
+                                         mdsdsc_t *delta);
+  extern EXPORT int TreeEndTimeContext();
   extern EXPORT int TreeGetNumSegments(int nid, int *num);
   extern EXPORT int _TreeGetNumSegments(void *dbid, int nid, int *num);
   extern EXPORT int TreeGetSegmentLimits(int nid, int segidx, mdsdsc_xd_t *start,
@@ -333,6 +337,23 @@ extern "C"
   extern EXPORT int TreeGetSegmentTimes(int nid, int *numsegs, int64_t **times);
   extern EXPORT int _TreeGetSegmentTimes(void *dbid, int nid, int *numsegs,
                                          int64_t **times);
+  extern EXPORT int TreeGetSegmentRows(int nid, int *numsegs, int **rows);
+  extern EXPORT int _TreeGetSegmentRows(void *dbid, int nid, int *numsegs,
+                                        int **rows);
+  extern EXPORT int TreeGetSegmentedRecordWindow(int nid, mdsdsc_t *start,
+                                                 mdsdsc_t *end,
+                                                 mdsdsc_xd_t *data);
+  extern EXPORT int _TreeGetSegmentedRecordWindow(void *dbid, int nid,
+                                                  mdsdsc_t *start,
+                                                  mdsdsc_t *end,
+                                                  mdsdsc_xd_t *data);
+  extern EXPORT int TreeGetSegmentedRecordRows(int nid, int64_t first,
+                                               int64_t last, int64_t *offset,
+                                               mdsdsc_xd_t *data);
+  extern EXPORT int _TreeGetSegmentedRecordRows(void *dbid, int nid,
+                                                int64_t first, int64_t last,
+                                                int64_t *offset,
+                                                mdsdsc_xd_t *data);
   extern EXPORT int TreeGetSegmentTimesXd(int nid, int *numsegs,
                                           mdsdsc_xd_t *start_list,
                                           mdsdsc_xd_t *end_list);
@@ -364,6 +385,83 @@ extern "C"
   extern EXPORT int _TreeSetSegmentScale(void *dbid, int nid, mdsdsc_t *value);
   extern EXPORT int TreeSetSegmentScale(int nid, mdsdsc_t *value);
 
+  // Asynchronous segment writer
+  typedef struct
+  {
+    int64_t queue_depth;
+    int64_t max_queue_depth;
+    int64_t queued_bytes;
+    int64_t blocked;
+    int64_t items_written;
+    int64_t rows_written;
+    int64_t rows_merged;
+    int64_t segments_begun;
+    int64_t write_calls;
+    int64_t batches;
+    int64_t bytes_written;
+    int64_t last_latency_ns;
+    int64_t max_latency_ns;
+    int64_t total_latency_ns;
+  } TREE_ASYNC_WRITER_STATS;
+  extern EXPORT int TreeAsyncWriterOpen(int64_t max_bytes, void **writer);
+  extern EXPORT int _TreeAsyncWriterOpen(void *dbid, int64_t max_bytes,
+                                         void **writer);
+  extern EXPORT int TreeAsyncPutRow(void *writer, int nid, int bufsize,
+                                    int64_t *timestamp, mdsdsc_a_t *rowdata);
+  extern EXPORT int TreeAsyncPutSegment(void *writer, int nid, int rowidx,
+                                        mdsdsc_a_t *data);
+  extern EXPORT int TreeAsyncMakeSegment(void *writer, int nid,
+                                         mdsdsc_t *start, mdsdsc_t *end,
+                                         mdsdsc_t *dim, mdsdsc_a_t *data,
+                                         int idx, int filled);
+  extern EXPORT int TreeAsyncWriterFlush(void *writer);
+  extern EXPORT int TreeAsyncWriterClose(void *writer);
+  extern EXPORT int TreeAsyncWriterGetStats(void *writer,
+                                            TREE_ASYNC_WRITER_STATS *stats);
+
+  // Decoded record cache
+  typedef struct
+  {
+    int64_t hits;
+    int64_t misses;
+    int64_t evictions;
+    int64_t invalidations;
+    int64_t bytes;
+    int64_t entries;
+    int64_t limit;
+  } TREE_RECORD_CACHE_STATS;
+  extern EXPORT int64_t TreeSetRecordCacheSize(int64_t size);
+  extern EXPORT void TreeFlushRecordCache();
+  extern EXPORT int TreeGetRecordCacheStats(TREE_RECORD_CACHE_STATS *stats);
+  extern EXPORT void TreeResetRecordCacheStats();
+
+#define TREE_PERF_OPEN 0
+#define TREE_PERF_GET_RECORD 1
+#define TREE_PERF_PUT_RECORD 2
+#define TREE_PERF_SEGMENT_READ 3
+#define TREE_PERF_SEGMENT_WRITE 4
+#define TREE_PERF_NCI_READ 5
+#define TREE_PERF_LOCK_WAIT 6
+#define TREE_PERF_NUM_OPS 7
+#define TREE_PERF_BUCKETS 40
+  typedef struct _tree_perf_stats
+  {
+    int64_t count;
+    int64_t total_ns;
+    int64_t max_ns;
+    /* slowest call: nid (node index within max_tree for NCI reads and
+       lock waits), -1 if not node related, and its tree and shot */
+    int max_nid;
+    int max_shot;
+    char max_tree[13];
+    int64_t histogram[TREE_PERF_BUCKETS]; /* [i]: latency in [2^i,2^(i+1)) ns */
+  } TREE_PERF_STATS;
+  extern EXPORT int TreeGetPerfStats(int op, TREE_PERF_STATS *stats);
+  extern EXPORT void TreeResetPerfStats();
+  extern EXPORT const char *TreePerfOpName(int op);
+  extern EXPORT char *TreePerfReport();
+  extern EXPORT int TreeGetPerfReport(mdsdsc_xd_t *out);
+
   extern EXPORT int _TreeExecute(void *dbid, ...);
   extern EXPORT int _TreeEvaluate(void *dbid, ...);
   extern EXPORT int _TreeDecompile(void *dbid, ...);
@@ -13,7 +13,36 @@ typedef enum
   GetData,
   GetNci,
   PutData,
-  PutNci
+  PutNci,
+  PutDataFull,
+  MakeSegment,
+  MakeSegmentFull,
+  MakeTimestampedSegment,
+  MakeTimestampedSegmentFull,
+  UpdateSegment,
+  PutSegment,
+  PutSegmentFull,
+  PutTimestampedSegment,
+  PutTimestampedSegmentFull
 } TreeshrHookType;
 
+struct descriptor;
+
+/* Native tree hook consumer. nid is 0 for tree level hooks and data is only
+ * set for the *Full hooks. Callbacks run in the thread of the tree operation.
+ */
+typedef void (*TreeHookCallback)(TreeshrHookType type, char const *tree,
+                                 int shot, int nid, struct descriptor *data);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+  extern int TreeRegisterHook(TreeshrHookType type, TreeHookCallback callback);
+  extern int TreeUnregisterHook(TreeshrHookType type,
+                                TreeHookCallback callback);
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -8,6 +8,11 @@ EXPORT int XTreeGetTimedRecord(int nid, struct descriptor *startD,
                                struct descriptor *endD,
                                struct descriptor *minDeltaD,
                                struct descriptor_xd *outSignal);
+EXPORT int XTreeGetTimedSegments(int nid, struct descriptor *startD,
+                                 struct descriptor *endD,
+                                 struct descriptor_xd *outSignal);
+EXPORT int XTreeGetSegmentRange(int nid, int startIdx, int endIdx,
+                                struct descriptor_xd *outSignal);
 EXPORT int XTreeDefaultResample(struct descriptor_signal *currSignal,
                                 struct descriptor *startD,
                                 struct descriptor *endD,
@@ -94,6 +94,26 @@ static void checkSignal(float *inData, float *inDim, int size, float **outData,
 
 
 
+// Estimate the group delay of the filter from the slope of its phase
+
+static float filterDelay(Filter *filter, float fc)
+{
+  float mod[1000];
+  float phs[1000];
+  float phs_steep;
+  int i;
+
+  TestFilter(filter, fc, 1000, mod, phs);
+
+  for (i = 1; i < 1000 - 1 && !isnan(phs[i]) && !isnan(phs[i + 1]) && phs[i] > phs[i + 1]; i++) ;
+
+  if (i > 1) {
+    phs_steep = (phs[1] - phs[i]) / ((i / 1000.) * fc / 2.);
+    return phs_steep / (2 * PI);
+  }
+  return 0;
+}
+
 EXPORT struct descriptor_xd *MdsFilter(float *inData, float *inDim, int *inSize, float *cut_off,
 				int *num_in_poles)
 {
@@ -117,10 +137,9 @@ EXPORT struct descriptor_xd *MdsFilter(float *inData, float *inDim, int *inSize,
   sizeof(int), DTYPE_L, CLASS_S, 0}, time_at_0_d = {
   sizeof(float), DTYPE_FLOAT, CLASS_S, 0};
 
-  int num_samples, num_poles, start_idx, end_idx, i;
+  int num_samples, num_poles, start_idx, end_idx;
   float fc, dummy, *filtered_data, start, end, time_at_0;
   double delta = 0;
-  float phs_steep;
   float delay = 0.0f;
   static Filter *filter;
 
@@ -155,16 +174,7 @@ EXPORT struct descriptor_xd *MdsFilter(float *inData, float *inDim, int *inSize,
   filter = ButtwInvar(cut_off, &dummy, &dummy, &dummy, &fc, &num_poles);
 
   filtered_data = (float *)malloc(num_samples * sizeof(float));
-  float mod[1000];
-  float phs[1000];
-  TestFilter(filter, fc, 1000, mod, phs);
-
-  for (i = 1; i < 1000 - 1 && !isnan(phs[i]) && !isnan(phs[i + 1]) && phs[i] > phs[i + 1]; i++) ;
-
-  if (i > 1) {
-    phs_steep = (phs[1] - phs[i]) / ((i / 1000.) * fc / 2.);
-    delay = phs_steep / (2 * PI);
-  }
+  delay = filterDelay(filter, fc);
 
   DoFilter(filter, in_data, filtered_data, &num_samples);
   FreeFilter(filter);
@@ -185,6 +195,55 @@ EXPORT struct descriptor_xd *MdsFilter(float *inData, float *inDim, int *inSize,
   return &out_xd;
 }
 
+// Filter and decimate a signal: only one sample every *decimation is computed and returned.
+// If *fir is nonzero an *order taps Hamming FIR is used, otherwise an *order poles Butterworth.
+// The time base of the result is compensated for the filter delay.
+
+EXPORT struct descriptor_xd *MdsFilterDecimate(float *inData, float *inDim, int *inSize, float *cut_off,
+				int *order, int *decimation, int *fir)
+{
+  static struct descriptor_xd out_xd = { 0, DTYPE_DSC, CLASS_XD, 0, 0 };
+
+  DESCRIPTOR_A(data_d, sizeof(float), DTYPE_FLOAT, 0, 0);
+  DESCRIPTOR_A(dim_d, sizeof(float), DTYPE_FLOAT, 0, 0);
+  DESCRIPTOR_SIGNAL_1(signal_d, &data_d, 0, &dim_d);
+
+  Filter *filter;
+  float fc, dummy = 0, delay, *out_data, *out_dim;
+  int num_samples = *inSize, num_out, n, start_idx = 0, delta, i;
+
+  MdsFree1Dx(&out_xd, 0);
+  if (num_samples < 2)
+    return &out_xd;
+  delta = (*decimation > 0) ? *decimation : 1;
+  n = (*order > 0) ? *order : (*fir ? 64 : 10);
+  fc = 1 / (inDim[1] - inDim[0]);
+  if (*fir) {
+    filter = FirHamming(cut_off, &fc, &n);
+    delay = (n - 1) / (2 * fc);
+  } else {
+    filter = ButtwInvar(cut_off, &dummy, &dummy, &dummy, &fc, &n);
+    delay = filterDelay(filter, fc);
+  }
+
+  num_out = (num_samples - 1) / delta + 1;
+  out_data = (float *)malloc(num_out * sizeof(float));
+  out_dim = (float *)malloc(num_out * sizeof(float));
+  DoFilterResample(filter, inData, out_data, &num_samples, &start_idx, &delta, &num_out);
+  FreeFilter(filter);
+  for (i = 0; i < num_out; i++)
+    out_dim[i] = inDim[i * delta] - delay;
+
+  data_d.pointer = (char *)out_data;
+  data_d.arsize = num_out * sizeof(float);
+  dim_d.pointer = (char *)out_dim;
+  dim_d.arsize = num_out * sizeof(float);
+  MdsCopyDxXd((struct descriptor *)&signal_d, &out_xd);
+  free(out_data);
+  free(out_dim);
+  return &out_xd;
+}
+
 EXPORT void PrintFilter(Filter * filter)
 {
   int i, j;
@@ -930,9 +930,10 @@ EXPORT int GetXYSignalXd(mdsdsc_t *const inY, mdsdsc_t *const inX,
   }
   else
     deltaP = NULL;
-  // Set limits if any
+  // Set limits if any, for this thread only
 
-  int status = TreeSetTimeContext(xMinP, xMaxP, deltaP);
+  int status = TreeBeginTimeContext(xMinP, xMaxP, deltaP);
+  const int timecontext = STATUS_OK;
 
   if (STATUS_OK)
     status = TdiEvaluate(inY, &yXd MDS_END_ARG);
@@ -992,7 +993,8 @@ return_err:;
   MdsFree1Dx(&yLabel, NULL);
   MdsFree1Dx(&xXd, NULL);
   MdsFree1Dx(&yXd, NULL);
-  TreeSetTimeContext(NULL, NULL, NULL); // reset timecontext
+  if (timecontext)
+    TreeEndTimeContext(); // reset timecontext
   return status;
 }
 EXPORT int _GetXYSignalXd(void **const ctx, mdsdsc_t *const y,
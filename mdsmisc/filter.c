@@ -86,6 +86,7 @@ out must be already allocated.
 int *start_idx, int *delta_idx, int *max_out_samples) perform digital filtering
 as specified in structure filter. but only samples corresponding to start_idx +
 N*delta_idx (N >=0) are stored in out. In and out must be already allocated.
+Only the retained samples are computed, see filterstate.c.
 
         DoFilterResampleVME(Filter *filter, short *in, float *out, int
 *n_samples, int *start_idx, int *delta_idx, int *max_out_samples, int step_raw)
@@ -101,6 +102,7 @@ structure filter. module and phase must be already allocated
 #include "filter.h"
 #include <math.h>
 #include <mdsplus/mdsconfig.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -120,86 +122,33 @@ EXPORT void DoFilterResample(Filter *filter, float *in, float *out, int *n_s,
                              int *start_idx, int *delta_idx,
                              int *max_out_samples)
 {
-  int i, j, curr_sample, k_num, k_den, n_samples, start, delta, *curr_idx,
-      out_idx, idx;
-  float **history, *curr_out;
-
-  out_idx = 0;
-  n_samples = *n_s;
-  start = *start_idx;
-  delta = *delta_idx;
+  int n_samples = *n_s, start = *start_idx, delta = *delta_idx;
+  int64_t last;
+  FilterState *state;
 
   /* normalize if not already done */
   NormalizeFilter(filter);
 
-  history = (float **)malloc(filter->num_parallels * sizeof(float *));
-  curr_idx = (int *)malloc(filter->num_parallels * sizeof(int));
-  curr_out = (float *)malloc(filter->num_parallels * sizeof(float));
-
-  for (i = 0; i < filter->num_parallels; i++)
+  /* samples following the last stored one need not be filtered */
+  if (start >= 0 && delta > 0 && *max_out_samples > 0)
   {
-    if (filter->units[i].den_degree > 1)
-    {
-      history[i] =
-          (float *)calloc(filter->units[i].den_degree * sizeof(float), 1);
-      curr_idx[i] = filter->units[i].den_degree - 1;
-    }
+    last = start + (int64_t)(*max_out_samples - 1) * delta;
+    if (last < n_samples)
+      n_samples = (int)last + 1;
   }
 
-  for (curr_sample = 0; curr_sample < n_samples && out_idx < *max_out_samples;
-       curr_sample++)
+  state = FilterStateNew(filter);
+  if (!state)
   {
-    for (i = 0; i < filter->num_parallels; i++)
-    {
-      curr_out[i] = 0;
-      if (curr_sample + 1 >= filter->units[i].num_degree)
-        k_num = filter->units[i].num_degree;
-      else
-        k_num = curr_sample + 1;
-      if (curr_sample + 1 >= filter->units[i].den_degree)
-        k_den = filter->units[i].den_degree;
-      else
-        k_den = curr_sample + 1;
-      for (j = 0; j < k_num; j++)
-        curr_out[i] += filter->units[i].num[j] * in[curr_sample - j];
-      for (j = 1; j < k_den; j++)
-      {
-        idx = (curr_idx[i] - 1 + j) % filter->units[i].den_degree;
-        curr_out[i] -= filter->units[i].den[j] * history[i][idx];
-      }
-
-      /* Update history */
-      /* move marker in circolar buffer */
-      if (filter->units[i].den_degree > 1)
-      {
-        curr_idx[i]--;
-        if (curr_idx[i] < 0)
-          curr_idx[i] = filter->units[i].den_degree - 1;
-        history[i][curr_idx[i]] = curr_out[i];
-      }
-    }
-
-    /* store sample in out if needed */
-    if (curr_sample >= start && !((curr_sample - start) % delta))
-    {
-      for (i = 0, out[out_idx] = 0; i < filter->num_parallels; i++)
-        out[out_idx] += curr_out[i];
-      out_idx++;
-    }
+    *max_out_samples = 0;
+    return;
   }
-
-  *max_out_samples = out_idx;
-
-  /* Free storage */
-  for (i = 0; i < filter->num_parallels; i++)
-    if (filter->units[i].den_degree > 0)
-      free(history[i]);
-  free(history);
-  free(curr_out);
-  free(curr_idx);
+  DoFilterResampleState(state, in, out, &n_samples, start_idx, delta_idx,
+                        max_out_samples);
+  FilterStateFree(state);
 
   /* First sample equal for input and output */
-  if (start == 0)
+  if (start == 0 && *max_out_samples > 0)
     out[0] = in[start];
 }
 
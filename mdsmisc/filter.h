@@ -44,6 +44,9 @@ typedef struct
   int idx;
 } RunTimeFilter;
 
+/* Reusable run time state of a filter, see filterstate.c */
+typedef struct _FilterState FilterState;
+
 /* Public Function prototypes */
 Filter *ButtwInvar(float *fp, float *fs, float *ap, float *as, float *fc,
                    int *out_n);
@@ -72,6 +75,13 @@ void TestFilter(Filter *filter, float fc, int n_points, float *module,
                 float *phase);
 void FreeFilter(Filter *filter);
 
+FilterState *FilterStateNew(Filter *filter);
+void FilterStateReset(FilterState *state);
+void FilterStateFree(FilterState *state);
+void DoFilterResampleState(FilterState *state, float *in, float *out,
+                           int *n_samples, int *start_idx, int *delta_idx,
+                           int *max_out_idx);
+
 /* Public Function prototypes internally used */
 Filter *Invariant(double fp, double fs, double ap, double as, double fc,
                   int *out_n, Complex *(*FindPoles)());
@@ -0,0 +1,474 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*------------------------------------------------------------------------------
+
+        Name:	FILTERSTATE
+
+        Type:   C function
+
+        Date:   18-OCT-2026
+
+        Purpose: Reusable filter state and decimating filter engine.
+--------------------------------------------------------------------------------
+
+ Description: public routines are:
+
+        FilterState *FilterStateNew(Filter *filter)
+            build the run time state for filter. The coefficients are copied
+and normalized, so filter may be freed afterwards.
+
+        void FilterStateReset(FilterState *state)
+            clear the filter history.
+
+        void FilterStateFree(FilterState *state)
+            release the state.
+
+        DoFilterResampleState(FilterState *state, float *in, float *out,
+int *n_samples, int *start_idx, int *delta_idx, int *max_out_samples)
+            same as DoFilterResample, but the history is taken from and left
+in state, so that a long signal can be filtered in consecutive blocks.
+start_idx is relative to the current block.
+
+ The parallel units of the filter are split into three groups:
+
+ - non recursive units are summed into a single FIR, which is evaluated only
+   at the retained samples (start_idx + N*delta_idx). When that is more
+   expensive than a full convolution, as for long FIRs with a small delta,
+   overlap-save FFT convolution is used instead, two real segments per
+   complex transform;
+ - recursive units of order up to two are run as a bank of biquads in
+   transposed direct form II. Coefficients and states are stored as arrays
+   padded to BIQUAD_LANES so that the loop over the sections vectorizes;
+ - any other recursive unit is run in transposed direct form II.
+
+ The recursive part must see every input sample, but its outputs are summed
+ only at the retained samples. Input is processed in blocks of at most
+ FILTER_BLOCK samples so that the work buffers stay small.
+------------------------------------------------------------------------------*/
+#include "filter.h"
+#include <math.h>
+#include <mdsplus/mdsconfig.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BIQUAD_LANES 4
+#define FFT_MIN_TAPS 64
+#define FILTER_BLOCK 65536
+
+typedef struct
+{
+  int order;
+  double *b, *a, *s;
+} IirUnit;
+
+struct _FilterState
+{
+  /* non recursive part, taps stored in reverse order */
+  int num_taps;
+  double *taps;
+  double *work; /* num_taps - 1 history samples followed by the block */
+  int block;
+  /* overlap-save convolution of the non recursive part */
+  int fft_len, fft_log2;
+  Complex *fft_taps, *fft_buf, *twiddle;
+  /* recursive units of order <= 2 */
+  int num_biquads;
+  double *b0, *b1, *b2, *a1, *a2, *s1, *s2, *y;
+  /* other recursive units */
+  int num_iir;
+  IirUnit *iir;
+};
+
+static void fft(Complex *x, int n, Complex const *w, int inverse)
+{
+  int i, j, k, bit, len, half, step;
+  Complex t, u, v, wk;
+
+  for (i = 1, j = 0; i < n; i++)
+  {
+    for (bit = n >> 1; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j)
+    {
+      t = x[i];
+      x[i] = x[j];
+      x[j] = t;
+    }
+  }
+  for (len = 2; len <= n; len <<= 1)
+  {
+    half = len >> 1;
+    step = n / len;
+    for (i = 0; i < n; i += len)
+      for (k = 0; k < half; k++)
+      {
+        wk = w[k * step];
+        if (inverse)
+          wk.im = -wk.im;
+        u = x[i + k];
+        v = x[i + k + half];
+        t.re = v.re * wk.re - v.im * wk.im;
+        t.im = v.re * wk.im + v.im * wk.re;
+        x[i + k].re = u.re + t.re;
+        x[i + k].im = u.im + t.im;
+        x[i + k + half].re = u.re - t.re;
+        x[i + k + half].im = u.im - t.im;
+      }
+  }
+}
+
+static int setup_fft(FilterState *state)
+{
+  int i, n;
+
+  if (state->num_taps < FFT_MIN_TAPS)
+    return 1;
+  for (n = 1, state->fft_log2 = 0; n < 4 * state->num_taps; n <<= 1)
+    state->fft_log2++;
+  state->fft_len = n;
+  state->twiddle = (Complex *)malloc(n / 2 * sizeof(Complex));
+  state->fft_taps = (Complex *)calloc(n, sizeof(Complex));
+  state->fft_buf = (Complex *)malloc(n * sizeof(Complex));
+  if (!state->twiddle || !state->fft_taps || !state->fft_buf)
+    return 0;
+  for (i = 0; i < n / 2; i++)
+  {
+    state->twiddle[i].re = cos(2 * PI * i / n);
+    state->twiddle[i].im = -sin(2 * PI * i / n);
+  }
+  for (i = 0; i < state->num_taps; i++)
+    state->fft_taps[i].re = state->taps[state->num_taps - 1 - i];
+  fft(state->fft_taps, n, state->twiddle, 0);
+  return 1;
+}
+
+static int add_iir(FilterState *state, FilterUnit *unit)
+{
+  int j, order = (unit->num_degree > unit->den_degree ? unit->num_degree
+                                                       : unit->den_degree) -
+                 1;
+  double a0 = unit->den[0];
+
+  if (order <= 2)
+  {
+    int u = state->num_biquads++;
+    state->b0[u] = unit->num[0] / a0;
+    state->b1[u] = unit->num_degree > 1 ? unit->num[1] / a0 : 0;
+    state->b2[u] = unit->num_degree > 2 ? unit->num[2] / a0 : 0;
+    state->a1[u] = unit->den[1] / a0;
+    state->a2[u] = unit->den_degree > 2 ? unit->den[2] / a0 : 0;
+  }
+  else
+  {
+    IirUnit *iir = &state->iir[state->num_iir++];
+    iir->order = order;
+    iir->b = (double *)calloc(order + 1, sizeof(double));
+    iir->a = (double *)calloc(order + 1, sizeof(double));
+    iir->s = (double *)calloc(order, sizeof(double));
+    if (!iir->b || !iir->a || !iir->s)
+      return 0;
+    for (j = 0; j < unit->num_degree; j++)
+      iir->b[j] = unit->num[j] / a0;
+    for (j = 1; j < unit->den_degree; j++)
+      iir->a[j] = unit->den[j] / a0;
+  }
+  return 1;
+}
+
+EXPORT FilterState *FilterStateNew(Filter *filter)
+{
+  int i, j, lanes = 0, hist;
+  double scale;
+  FilterState *state = (FilterState *)calloc(1, sizeof(FilterState));
+
+  if (!state)
+    return NULL;
+  for (i = 0; i < filter->num_parallels; i++)
+  {
+    FilterUnit *unit = &filter->units[i];
+    if (unit->den_degree > 1)
+      lanes++;
+    else if (unit->num_degree > state->num_taps)
+      state->num_taps = unit->num_degree;
+  }
+  lanes = (lanes + BIQUAD_LANES - 1) / BIQUAD_LANES * BIQUAD_LANES;
+  if (lanes)
+  {
+    state->b0 = (double *)calloc(8 * lanes, sizeof(double));
+    if (!state->b0)
+      goto error;
+    state->b1 = state->b0 + lanes;
+    state->b2 = state->b1 + lanes;
+    state->a1 = state->b2 + lanes;
+    state->a2 = state->a1 + lanes;
+    state->s1 = state->a2 + lanes;
+    state->s2 = state->s1 + lanes;
+    state->y = state->s2 + lanes;
+    state->iir = (IirUnit *)calloc(lanes, sizeof(IirUnit));
+    if (!state->iir)
+      goto error;
+  }
+  if (state->num_taps)
+  {
+    state->taps = (double *)calloc(state->num_taps, sizeof(double));
+    if (!state->taps)
+      goto error;
+  }
+  for (i = 0; i < filter->num_parallels; i++)
+  {
+    FilterUnit *unit = &filter->units[i];
+    if (unit->den_degree > 1)
+    {
+      if (!add_iir(state, unit))
+        goto error;
+      continue;
+    }
+    scale = unit->den_degree > 0 ? 1 / unit->den[0] : 1;
+    for (j = 0; j < unit->num_degree; j++)
+      state->taps[state->num_taps - 1 - j] += unit->num[j] * scale;
+  }
+  /* biquads were packed first, pad the bank up to the lane count */
+  state->num_biquads = (state->num_biquads + BIQUAD_LANES - 1) /
+                       BIQUAD_LANES * BIQUAD_LANES;
+  if (!setup_fft(state))
+    goto error;
+  state->block = FILTER_BLOCK;
+  if (state->block < 2 * state->fft_len)
+    state->block = 2 * state->fft_len;
+  hist = state->num_taps > 0 ? state->num_taps - 1 : 0;
+  if (state->num_taps)
+  {
+    state->work = (double *)calloc(hist + state->block, sizeof(double));
+    if (!state->work)
+      goto error;
+  }
+  return state;
+
+error:
+  FilterStateFree(state);
+  return NULL;
+}
+
+EXPORT void FilterStateReset(FilterState *state)
+{
+  int i;
+
+  if (state->num_taps)
+    memset(state->work, 0, (state->num_taps - 1) * sizeof(double));
+  if (state->num_biquads)
+  {
+    memset(state->s1, 0, state->num_biquads * sizeof(double));
+    memset(state->s2, 0, state->num_biquads * sizeof(double));
+  }
+  for (i = 0; i < state->num_iir; i++)
+    memset(state->iir[i].s, 0, state->iir[i].order * sizeof(double));
+}
+
+EXPORT void FilterStateFree(FilterState *state)
+{
+  int i;
+
+  if (!state)
+    return;
+  for (i = 0; i < state->num_iir; i++)
+  {
+    free(state->iir[i].b);
+    free(state->iir[i].a);
+    free(state->iir[i].s);
+  }
+  free(state->iir);
+  free(state->b0);
+  free(state->taps);
+  free(state->work);
+  free(state->twiddle);
+  free(state->fft_taps);
+  free(state->fft_buf);
+  free(state);
+}
+
+/* FIR outputs at work[first + k * delta], k < n_out, evaluated directly */
+static void fir_direct(FilterState *state, float *out, int first, int delta,
+                       int n_out)
+{
+  int j, k, num_taps = state->num_taps;
+  double const *taps = state->taps;
+
+  for (k = 0; k < n_out; k++)
+  {
+    double const *x = state->work + first + k * delta;
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (j = 0; j + 3 < num_taps; j += 4)
+    {
+      s0 += taps[j] * x[j];
+      s1 += taps[j + 1] * x[j + 1];
+      s2 += taps[j + 2] * x[j + 2];
+      s3 += taps[j + 3] * x[j + 3];
+    }
+    for (; j < num_taps; j++)
+      s0 += taps[j] * x[j];
+    out[k] = (s0 + s1) + (s2 + s3);
+  }
+}
+
+/* Same as fir_direct, by overlap-save. Each transform carries two segments
+   of fft_len - num_taps + 1 outputs, one in the real and one in the
+   imaginary part. */
+static void fir_fft(FilterState *state, float *out, int n, int first,
+                    int delta, int n_out)
+{
+  int i, k, seg, len = state->fft_len, hist = state->num_taps - 1;
+  int step = len - hist, avail = hist + n, last = first + (n_out - 1) * delta;
+  double scale = 1. / len;
+  Complex *buf = state->fft_buf, c;
+
+  for (seg = first; seg <= last; seg += 2 * step)
+  {
+    for (i = 0; i < len; i++)
+    {
+      buf[i].re = seg + i < avail ? state->work[seg + i] : 0;
+      buf[i].im = seg + step + i < avail ? state->work[seg + step + i] : 0;
+    }
+    fft(buf, len, state->twiddle, 0);
+    for (i = 0; i < len; i++)
+    {
+      c.re = buf[i].re * state->fft_taps[i].re -
+             buf[i].im * state->fft_taps[i].im;
+      c.im = buf[i].re * state->fft_taps[i].im +
+             buf[i].im * state->fft_taps[i].re;
+      buf[i] = c;
+    }
+    fft(buf, len, state->twiddle, 1);
+    /* first retained output at or after seg */
+    k = (seg - first + delta - 1) / delta;
+    for (i = first + k * delta; k < n_out && i < seg + 2 * step;
+         k++, i += delta)
+      out[k] = (i < seg + step ? buf[hist + i - seg].re
+                               : buf[hist + i - seg - step].im) *
+               scale;
+  }
+}
+
+static void run_block(FilterState *state, float const *in, int n,
+                      float *out, int first, int delta, int n_out)
+{
+  int i, j, k, u, hist = state->num_taps - 1, nb = state->num_biquads;
+  double x, yu;
+
+  if (state->num_taps)
+  {
+    double *work = state->work;
+    for (i = 0; i < n; i++)
+      work[hist + i] = in[i];
+    if (n_out > 0)
+    {
+      int nseg = ((n_out - 1) * delta) / (state->fft_len - hist) + 1;
+      if (state->fft_len &&
+          2.5 * state->fft_len * state->fft_log2 * nseg <
+              (double)n_out * state->num_taps)
+        fir_fft(state, out, n, first, delta, n_out);
+      else
+        fir_direct(state, out, first, delta, n_out);
+    }
+    memmove(work, work + n, hist * sizeof(double));
+  }
+  else
+    memset(out, 0, n_out * sizeof(float));
+
+  if (nb)
+  {
+    double *restrict b0 = state->b0, *restrict b1 = state->b1,
+                     *restrict b2 = state->b2, *restrict a1 = state->a1,
+                     *restrict a2 = state->a2, *restrict s1 = state->s1,
+                     *restrict s2 = state->s2, *restrict y = state->y;
+    for (i = 0, k = 0; i < n; i++)
+    {
+      x = in[i];
+      for (u = 0; u < nb; u += BIQUAD_LANES)
+        for (j = u; j < u + BIQUAD_LANES; j++)
+        {
+          yu = b0[j] * x + s1[j];
+          s1[j] = b1[j] * x - a1[j] * yu + s2[j];
+          s2[j] = b2[j] * x - a2[j] * yu;
+          y[j] = yu;
+        }
+      if (k < n_out && i == first + k * delta)
+      {
+        for (u = 0, yu = 0; u < nb; u++)
+          yu += y[u];
+        out[k++] += yu;
+      }
+    }
+  }
+
+  for (u = 0; u < state->num_iir; u++)
+  {
+    IirUnit *iir = &state->iir[u];
+    int order = iir->order;
+    double *b = iir->b, *a = iir->a, *s = iir->s;
+    for (i = 0, k = 0; i < n; i++)
+    {
+      x = in[i];
+      yu = b[0] * x + s[0];
+      for (j = 0; j < order - 1; j++)
+        s[j] = b[j + 1] * x - a[j + 1] * yu + s[j + 1];
+      s[order - 1] = b[order] * x - a[order] * yu;
+      if (k < n_out && i == first + k * delta)
+        out[k++] += yu;
+    }
+  }
+}
+
+EXPORT void DoFilterResampleState(FilterState *state, float *in, float *out,
+                                  int *n_s, int *start_idx, int *delta_idx,
+                                  int *max_out_samples)
+{
+  int n, cnt, first, done = 0, out_idx = 0, n_samples = *n_s,
+                     next = *start_idx, delta = *delta_idx;
+
+  if (delta < 1)
+    delta = 1;
+  if (next < 0)
+    next += (-next + delta - 1) / delta * delta;
+  while (done < n_samples)
+  {
+    n = n_samples - done;
+    if (n > state->block)
+      n = state->block;
+    first = next - done;
+    cnt = 0;
+    if (out_idx < *max_out_samples && first < n)
+    {
+      cnt = (n - 1 - first) / delta + 1;
+      if (cnt > *max_out_samples - out_idx)
+        cnt = *max_out_samples - out_idx;
+    }
+    run_block(state, in + done, n, out + out_idx, first, delta, cnt);
+    out_idx += cnt;
+    next += cnt * delta;
+    done += n;
+  }
+  *max_out_samples = out_idx;
+}
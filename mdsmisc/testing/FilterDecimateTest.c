@@ -0,0 +1,240 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// MDSplus //
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+
+#include "../filter.h"
+
+// testing //
+#include "testing.h"
+
+extern struct descriptor_xd *MdsFilterDecimate(float *inData, float *inDim,
+                                               int *inSize, float *cut_off,
+                                               int *order, int *decimation,
+                                               int *fir);
+
+#define NUM_SAMPLES 200003
+#define TOLERANCE 1e-4
+
+/* one unit for each of the engine paths: a long FIR, two units of order up
+   to two (the second one not normalized) and a third order recursive unit */
+static double b1[] = {0.02, 0.04, 0.02}, a1[] = {1, -1.56, 0.64};
+static double b2[] = {0.2}, a2[] = {2, -1.8};
+static double b3[] = {0.01, 0.02, 0.01}, a3[] = {1, -1.5, 0.74, -0.12};
+
+static Filter *make_filter()
+{
+  float fc = 0.05f, s_f = 1.f;
+  int n = 101;
+  Filter *fir = FirHamming(&fc, &s_f, &n);
+  Filter *filter = (Filter *)malloc(sizeof(Filter));
+  filter->num_parallels = 4;
+  filter->units = (FilterUnit *)calloc(4, sizeof(FilterUnit));
+  filter->units[0] = fir->units[0];
+  filter->units[1] = (FilterUnit){3, 3, b1, a1};
+  filter->units[2] = (FilterUnit){1, 2, b2, a2};
+  filter->units[3] = (FilterUnit){3, 4, b3, a3};
+  free(fir->units);
+  free(fir);
+  return filter;
+}
+
+/* straightforward direct form evaluation of every unit */
+static double *reference(Filter *filter, float *in, int n)
+{
+  double *out = (double *)calloc(n, sizeof(double));
+  double *y = (double *)malloc(n * sizeof(double));
+  int i, j, k;
+  for (k = 0; k < filter->num_parallels; k++)
+  {
+    FilterUnit *unit = &filter->units[k];
+    double a0 = unit->den_degree > 0 ? unit->den[0] : 1;
+    for (i = 0; i < n; i++)
+    {
+      double acc = 0;
+      for (j = 0; j < unit->num_degree && j <= i; j++)
+        acc += unit->num[j] * in[i - j];
+      for (j = 1; j < unit->den_degree && j <= i; j++)
+        acc -= unit->den[j] * y[i - j];
+      y[i] = acc / a0;
+      out[i] += y[i];
+    }
+  }
+  free(y);
+  return out;
+}
+
+static int check(double const *ref, float const *out, int start, int delta,
+                 int count)
+{
+  int i;
+  for (i = 0; i < count; i++)
+  {
+    double r = ref[start + i * delta];
+    if (fabs(out[i] - r) > TOLERANCE * (1 + fabs(r)))
+    {
+      fprintf(stderr, "sample %d: got %g, expected %g\n", start + i * delta,
+              out[i], r);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int resample(Filter *filter, float *in, float *out, double const *ref,
+                    int start, int delta)
+{
+  int n = NUM_SAMPLES, expected = (NUM_SAMPLES - 1 - start) / delta + 1,
+      count = expected;
+  DoFilterResample(filter, in, out, &n, &start, &delta, &count);
+  return count == expected && check(ref, out, start, delta, count);
+}
+
+/* feed the signal to a single state in blocks of the given sizes */
+static int stream(FilterState *state, float *in, float *out, double const *ref,
+                  int start, int delta, int const *blocks)
+{
+  int done = 0, next = start, total = 0, i;
+  for (i = 0; done < NUM_SAMPLES; i++)
+  {
+    int n = blocks[i] ? blocks[i] : NUM_SAMPLES - done;
+    int first = next - done, count = NUM_SAMPLES;
+    if (n > NUM_SAMPLES - done)
+      n = NUM_SAMPLES - done;
+    DoFilterResampleState(state, in + done, out + total, &n, &first, &delta,
+                          &count);
+    total += count;
+    next += count * delta;
+    done += n;
+  }
+  return total == (NUM_SAMPLES - 1 - start) / delta + 1 &&
+         check(ref, out, start, delta, total);
+}
+
+static void test_engine()
+{
+  static int const blocks[] = {1, 1000, 77777, 3, 65536, 0};
+  float *in = (float *)malloc(NUM_SAMPLES * sizeof(float));
+  float *out = (float *)malloc(NUM_SAMPLES * sizeof(float));
+  Filter *filter = make_filter();
+  FilterState *state;
+  double *ref;
+  int i, n = NUM_SAMPLES;
+
+  srand(1);
+  for (i = 0; i < NUM_SAMPLES; i++)
+    in[i] = (float)(sin(0.01 * i) + 0.5 * sin(0.3 * i) +
+                    (double)rand() / RAND_MAX - 0.5);
+  ref = reference(filter, in, NUM_SAMPLES);
+
+  // full rate, the first sample is passed through by DoFilter
+  DoFilter(filter, in, out, &n);
+  TEST1(out[0] == in[0]);
+  TEST1(check(ref + 1, out + 1, 0, 1, NUM_SAMPLES - 1));
+
+  // decimated, FFT convolution for small steps and direct taps for large ones
+  TEST1(resample(filter, in, out, ref, 7, 3));
+  TEST1(resample(filter, in, out, ref, 5, 100));
+  TEST1(resample(filter, in, out, ref, 1, 1));
+
+  // same answers when the signal is given in consecutive blocks
+  state = FilterStateNew(filter);
+  TEST1(state != NULL);
+  TEST1(stream(state, in, out, ref, 7, 3, blocks));
+  FilterStateReset(state);
+  TEST1(stream(state, in, out, ref, 5, 100, blocks));
+  FilterStateFree(state);
+
+  free(ref);
+  free(filter->units[0].num);
+  free(filter->units);
+  free(filter);
+  free(in);
+  free(out);
+}
+
+static void test_mds_filter_decimate()
+{
+  float in[1001], dim[1001], cut_off = 50.f, delay;
+  int size = 1001, order = 0, decimation = 10, fir = 1, i;
+  struct descriptor_xd *xd;
+  struct descriptor_signal *signal;
+  struct descriptor_a *data, *axis;
+
+  for (i = 0; i < size; i++)
+  {
+    in[i] = 1.f;
+    dim[i] = i * 1e-3f;
+  }
+
+  // default 64 taps FIR: delay of 31.5 samples, unit gain at DC
+  xd = MdsFilterDecimate(in, dim, &size, &cut_off, &order, &decimation, &fir);
+  TEST1(xd->pointer && xd->pointer->class == CLASS_R &&
+        xd->pointer->dtype == DTYPE_SIGNAL);
+  signal = (struct descriptor_signal *)xd->pointer;
+  data = (struct descriptor_a *)signal->data;
+  axis = (struct descriptor_a *)signal->dimensions[0];
+  TEST1(data->arsize / sizeof(float) == 101);
+  TEST1(axis->arsize / sizeof(float) == 101);
+  delay = 63 / (2 * 1000.f);
+  for (i = 0; i < 101; i++)
+    if (((float *)axis->pointer)[i] != dim[i * decimation] - delay)
+      break;
+  TEST1(i == 101);
+  for (i = 7; i < 101; i++)
+    if (fabsf(((float *)data->pointer)[i] - 1.f) > 0.02f)
+      break;
+  TEST1(i == 101);
+
+  // Butterworth, output length only depends on the decimation
+  fir = 0;
+  decimation = 3;
+  xd = MdsFilterDecimate(in, dim, &size, &cut_off, &order, &decimation, &fir);
+  signal = (struct descriptor_signal *)xd->pointer;
+  TEST1(signal && ((struct descriptor_a *)signal->data)->arsize /
+                          sizeof(float) ==
+                      (1001 - 1) / 3 + 1);
+
+  // too short to have a sampling frequency
+  size = 1;
+  xd = MdsFilterDecimate(in, dim, &size, &cut_off, &order, &decimation, &fir);
+  TEST0(xd->pointer);
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Filter Decimate);
+  test_engine();
+  test_mds_filter_decimate();
+  END_TESTING;
+  return 0;
+}
@@ -67,6 +67,8 @@ extern void *deserializeData(char const *serialized);
 extern void convertTimeToAscii(int64_t *timePtr, char *dateBuf, int bufLen,
                                int *retLen);
 extern void *getManyObj(char *serializedIn);
+extern void *getManyObjParallel(char *serializedIn, int nThreads,
+                                int timeoutMs);
 extern void *putManyObj(char *serializedIn);
 
 void *convertToScalarDsc(int clazz, int dtype, int length, char *ptr)
@@ -925,6 +927,23 @@ struct descriptor_xd EXPORT *GetManyExecute(char *serializedIn)
   return &xd;
 }
 
+struct descriptor_xd EXPORT *GetManyExecuteParallel(char *serializedIn,
+                                                    int nThreads,
+                                                    int timeoutMs)
+{
+  static EMPTYXD(xd);
+  struct descriptor_xd *serResult;
+
+  serResult = (struct descriptor_xd *)getManyObjParallel(serializedIn,
+                                                         nThreads, timeoutMs);
+  if (serResult->class == CLASS_XD)
+    MdsSerializeDscOut(serResult->pointer, &xd);
+  else
+    MdsSerializeDscOut((struct descriptor *)serResult, &xd);
+  freeDsc(serResult);
+  return &xd;
+}
+
 struct descriptor_xd EXPORT *PutManyExecute(char *serializedIn)
 {
   static EMPTYXD(xd);
@@ -30,6 +30,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rapidjson/document.h"     // rapidjson's DOM-style API
 #include "rapidjson/prettywriter.h" // for stringify JSON
 #include <iostream>
+#include <map>
+#include <math.h>
+#include <stdlib.h>
 #include <vector>
 using namespace rapidjson;
 
@@ -55,6 +58,14 @@ inline int nanosleep(const struct timespec *req,
 // times: long for absolute times, float for relative times)
 // samples: (float, 1D array) the dimension of the values array is related to the number oftimes and
 //     the declared dimension
+//
+// Alternatively (see EventStream::setFormat()) the same content is sent as a binary message, all
+// fields little-endian:
+// magic (4 bytes: 0x7f 'E' 'S' 'B'), version (uint8), flags (uint8: 1 absolute time, 2 int16 samples),
+// nDims (uint16), shot (int32), nTimes (uint32), nSamples (uint32), seq_number (uint64),
+// timestamp (uint64), scale (float32), offset (float32), name length (uint16), name,
+// dims (nDims x uint32), times (nTimes x uint64 if absolute, float32 otherwise),
+// samples (nSamples x float32, or int16 where sample = raw * scale + offset)
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 using namespace MDSplus;
 
@@ -81,6 +92,156 @@ static uint64_t getAndIncrementTimestamp(const char *stream)
   return 0;
 }
 
+#define BINARY_STREAM_VERSION 1
+#define BINARY_STREAM_ABSTIME 1
+#define BINARY_STREAM_INT16 2
+#define BINARY_STREAM_HEADER_SIZE 46
+static const char binaryStreamMagic[4] = {'\x7f', 'E', 'S', 'B'};
+
+static std::map<std::string, EventStream::Format> chanFormats;
+
+static EventStream::Format getDefaultFormat()
+{
+  static int defaultFormat = -1;
+  if (defaultFormat < 0)
+  {
+    const char *env = getenv("MDSEVENT_STREAM_FORMAT");
+    if (env && !strcasecmp(env, "binary"))
+      defaultFormat = EventStream::BINARY;
+    else if (env && !strcasecmp(env, "int16"))
+      defaultFormat = EventStream::BINARY_INT16;
+    else
+      defaultFormat = EventStream::JSON;
+  }
+  return (EventStream::Format)defaultFormat;
+}
+
+EXPORT void EventStream::setFormat(const char *name, Format format)
+{
+  pthread_mutex_lock(&mutex);
+  chanFormats[std::string(name)] = format;
+  pthread_mutex_unlock(&mutex);
+}
+
+EXPORT EventStream::Format EventStream::getFormat(const char *name)
+{
+  pthread_mutex_lock(&mutex);
+  std::map<std::string, Format>::iterator it = chanFormats.find(name);
+  Format format = (it == chanFormats.end()) ? getDefaultFormat() : it->second;
+  pthread_mutex_unlock(&mutex);
+  return format;
+}
+
+static inline bool isLittleEndian()
+{
+  const uint16_t one = 1;
+  return *(const uint8_t *)&one == 1;
+}
+
+// Copy n items of itemSize bytes between host and little-endian order
+static void copyLE(char *dst, const void *src, size_t itemSize, size_t n)
+{
+  if (isLittleEndian() || itemSize == 1)
+  {
+    memcpy(dst, src, itemSize * n);
+    return;
+  }
+  const char *s = (const char *)src;
+  for (size_t i = 0; i < n; i++, dst += itemSize, s += itemSize)
+    for (size_t b = 0; b < itemSize; b++)
+      dst[b] = s[itemSize - 1 - b];
+}
+
+static void putLE(std::vector<char> &buf, const void *src, size_t itemSize,
+                  size_t n = 1)
+{
+  size_t pos = buf.size();
+  buf.resize(pos + itemSize * n);
+  if (n > 0)
+    copyLE(&buf[pos], src, itemSize, n);
+}
+
+// Read n items from a received message, false if past its end
+static bool getLE(void *dst, const char *buf, size_t size, size_t &pos,
+                  size_t itemSize, size_t n = 1)
+{
+  if (n > (size - pos) / itemSize)
+    return false;
+  copyLE((char *)dst, buf + pos, itemSize, n);
+  pos += itemSize * n;
+  return true;
+}
+
+static void sendBinary(int shot, const char *name, bool isAbsTime, int nTimes,
+                       void *times, int nDims, int *dims, float *samples,
+                       bool asInt16)
+{
+  uint32_t nSamples = 1;
+  for (int i = 0; i < nDims; i++)
+    nSamples *= dims[i];
+  float scale = 1, offset = 0;
+  if (asInt16 && nSamples > 0)
+  {
+    float minVal = samples[0], maxVal = samples[0];
+    for (uint32_t i = 1; i < nSamples; i++)
+    {
+      if (samples[i] < minVal)
+        minVal = samples[i];
+      else if (samples[i] > maxVal)
+        maxVal = samples[i];
+    }
+    offset = (maxVal + minVal) / 2;
+    if (maxVal > minVal)
+      scale = (maxVal - minVal) / 65534;
+  }
+  std::vector<char> buf;
+  size_t nameLen = strlen(name);
+  buf.reserve(BINARY_STREAM_HEADER_SIZE + nameLen + 4 * nDims +
+              (isAbsTime ? 8 : 4) * nTimes + (asInt16 ? 2 : 4) * nSamples);
+  buf.insert(buf.end(), binaryStreamMagic, binaryStreamMagic + 4);
+  uint8_t version = BINARY_STREAM_VERSION;
+  uint8_t flags = (isAbsTime ? BINARY_STREAM_ABSTIME : 0) |
+                  (asInt16 ? BINARY_STREAM_INT16 : 0);
+  uint16_t nDims16 = nDims;
+  uint32_t nTimes32 = nTimes;
+  uint64_t seqNumber = getAndIncrementTimestamp(name);
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  uint64_t ms = tp.tv_sec * 1000 + tp.tv_usec / 1000;
+  uint16_t nameLen16 = nameLen;
+  putLE(buf, &version, 1);
+  putLE(buf, &flags, 1);
+  putLE(buf, &nDims16, 2);
+  putLE(buf, &shot, 4);
+  putLE(buf, &nTimes32, 4);
+  putLE(buf, &nSamples, 4);
+  putLE(buf, &seqNumber, 8);
+  putLE(buf, &ms, 8);
+  putLE(buf, &scale, 4);
+  putLE(buf, &offset, 4);
+  putLE(buf, &nameLen16, 2);
+  buf.insert(buf.end(), name, name + nameLen16);
+  for (int i = 0; i < nDims; i++)
+  {
+    uint32_t dim = dims[i];
+    putLE(buf, &dim, 4);
+  }
+  putLE(buf, times, isAbsTime ? 8 : 4, nTimes);
+  if (asInt16)
+  {
+    std::vector<int16_t> raw(nSamples);
+    for (uint32_t i = 0; i < nSamples; i++)
+    {
+      float val = rintf((samples[i] - offset) / scale);
+      raw[i] = (val > 32767) ? 32767 : (val < -32767) ? -32767 : (int16_t)val;
+    }
+    putLE(buf, raw.data(), 2, nSamples);
+  }
+  else
+    putLE(buf, samples, 4, nSamples);
+  Event::setEventRaw(name, buf.size(), &buf[0]);
+}
+
 static void makeSampleArray(Value &samplesVal, float *samples, int nDims, int *dims, Document::AllocatorType &allocator)
 {
   if (nDims > 1)
@@ -105,6 +266,13 @@ static void makeSampleArray(Value &samplesVal, float *samples, int nDims, int *d
 EXPORT void EventStream::send(int shot, const char *name, bool isAbsTime, int nTimes, void *times,
                               int nDim, int *dims, float *samples)
 {
+  Format format = getFormat(name);
+  if (format != JSON)
+  {
+    sendBinary(shot, name, isAbsTime, nTimes, times, nDim, dims, samples,
+               format == BINARY_INT16);
+    return;
+  }
   Document d;
   d.SetObject();
   Document::AllocatorType &allocator = d.GetAllocator();
@@ -274,6 +442,11 @@ EXPORT void EventStream::run()
     delete[] newPayload;
     return;
   }
+  if (bufSize >= 4 && !memcmp(buf, binaryStreamMagic, 4)) //Binary payload
+  {
+    handleBinaryPayload(buf, bufSize);
+    return;
+  }
   char *str = new char[bufSize + 1]; // Make it a string
   memcpy(str, buf, bufSize);
   str[bufSize] = 0;
@@ -496,6 +669,93 @@ EXPORT void EventStream::handleJSONPayload(char *payload)
   deleteData(timesD);
 }
 
+EXPORT void EventStream::handleBinaryPayload(const char *buf, size_t size)
+{
+  size_t pos = 4;
+  uint8_t version, flags;
+  uint16_t nDims, nameLen;
+  int shot;
+  uint32_t nTimes, nSamples;
+  uint64_t seqNumber, timestamp;
+  float scale, offset;
+  if (!getLE(&version, buf, size, pos, 1) || version > BINARY_STREAM_VERSION ||
+      !getLE(&flags, buf, size, pos, 1) || !getLE(&nDims, buf, size, pos, 2) ||
+      !getLE(&shot, buf, size, pos, 4) || !getLE(&nTimes, buf, size, pos, 4) ||
+      !getLE(&nSamples, buf, size, pos, 4) ||
+      !getLE(&seqNumber, buf, size, pos, 8) ||
+      !getLE(&timestamp, buf, size, pos, 8) ||
+      !getLE(&scale, buf, size, pos, 4) || !getLE(&offset, buf, size, pos, 4) ||
+      !getLE(&nameLen, buf, size, pos, 2) || nameLen > size - pos ||
+      nDims > 64)
+  {
+    std::cout << "Invalid binary stream payload" << std::endl;
+    return;
+  }
+  std::string nameStr(buf + pos, nameLen);
+  pos += nameLen;
+  bool isAbsTime = (flags & BINARY_STREAM_ABSTIME) != 0;
+  bool isInt16 = (flags & BINARY_STREAM_INT16) != 0;
+  int dims[64];
+  uint32_t expected = 1;
+  for (int i = 0; i < nDims; i++)
+  {
+    uint32_t dim;
+    if (!getLE(&dim, buf, size, pos, 4))
+      return;
+    dims[i] = dim;
+    expected *= dim;
+  }
+  size_t remaining = size - pos;
+  if (expected != nSamples ||
+      remaining != (size_t)nTimes * (isAbsTime ? 8 : 4) +
+                       (size_t)nSamples * (isInt16 ? 2 : 4))
+  {
+    std::cout << "Invalid binary stream payload for " << nameStr << std::endl;
+    return;
+  }
+  Data *timesD;
+  if (isAbsTime)
+  {
+    std::vector<uint64_t> times(nTimes);
+    getLE(times.data(), buf, size, pos, 8, nTimes);
+    if (nTimes == 1)
+      timesD = new Uint64(times[0]);
+    else
+      timesD = new Uint64Array(times.data(), nTimes);
+  }
+  else
+  {
+    std::vector<float> times(nTimes);
+    getLE(times.data(), buf, size, pos, 4, nTimes);
+    if (nTimes == 1)
+      timesD = new Float32(times[0]);
+    else
+      timesD = new Float32Array(times.data(), nTimes);
+  }
+  std::vector<float> samples(nSamples);
+  if (isInt16)
+  {
+    std::vector<int16_t> raw(nSamples);
+    getLE(raw.data(), buf, size, pos, 2, nSamples);
+    for (uint32_t i = 0; i < nSamples; i++)
+      samples[i] = raw[i] * scale + offset;
+  }
+  else
+    getLE(samples.data(), buf, size, pos, 4, nSamples);
+  Data *samplesD;
+  if (nSamples == 1)
+    samplesD = new Float32(samples[0]);
+  else
+    samplesD = new Float32Array(samples.data(), nDims, dims);
+  for (size_t i = 0; i < listeners.size(); i++)
+  {
+    if (names[i] == nameStr)
+      listeners[i]->dataReceived(samplesD, timesD, shot);
+  }
+  deleteData(samplesD);
+  deleteData(timesD);
+}
+
 EXPORT void EventStream::registerListener(DataStreamListener *listener,
                                           const char *inName)
 {
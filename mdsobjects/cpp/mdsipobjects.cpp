@@ -25,7 +25,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <mdsobjects.h>
 #include <mdsplus/mdsplus.h>
 #include <mdsplus/AutoPointer.hpp>
+#include <mdsshr.h>
+#include <treeshr.h>
 #include <string.h>
+#include <time.h>
 #include <cstddef>
 #include <iostream>
 #include <string>
@@ -56,6 +59,8 @@ using namespace MDSplus;
 using namespace std;
 
 extern "C" void *getManyObj(char *serializedIn);
+extern "C" void *getManyObjParallel(char *serializedIn, int nThreads,
+                                    int timeoutMs);
 extern "C" void *putManyObj(char *serializedIn);
 extern "C" void *compileFromExprWithArgs(char *expr, int nArgs, void *args,
                                          void *tree, void *ctx, int *retStatus);
@@ -119,6 +124,419 @@ static int convertType(int mdsType)
   }
 }
 
+#ifndef _MSC_VER
+///////////////////////////////////////////////////////////////////////////////
+// Parallel GetMany
+//
+// The entries of a GetMany list are independent, so a client may ask for them
+// to be evaluated by a pool of worker threads. A worker has its own TDI
+// context (TDI state is per thread) and its own read-only context on the tree
+// that is active in the calling thread, so only lists that cannot tell the
+// difference are run in parallel:
+//   - every expression is pure (see IsPureExpression in ResultCache.c): it
+//     calls no user functions and uses no variables, so the private TDI
+//     variables of the caller cannot change its answer;
+//   - the active tree is not open for edit.
+// The default node and the time context of the caller are copied into the
+// worker before it evaluates the batch. Anything else is evaluated serially
+// by getManyObj in the calling thread. The answers are stored in the result
+// dictionary in request order.
+//
+// The workers are started on demand and then kept, with the tree they last
+// opened, for the following requests. They are shared by all connections and
+// their number is capped by MDSIP_GETMANY_THREADS (default 16). A cached tree
+// is reopened when another tree or shot is requested or when its files
+// changed on disk.
+//
+// With a timeout, entries that have not completed within timeoutMs of the
+// start of the batch are reported with an error. Evaluations that are already
+// running cannot be interrupted: the workers finish them in the background
+// and free answers that come in after the caller reported the entry. The
+// answer and error of a task are only touched under the batch mutex, and
+// only read by the caller once done is set. The batch state is released by
+// whichever thread drops the last reference to it.
+///////////////////////////////////////////////////////////////////////////////
+
+extern "C" int IsPureExpression(const char *exp, int len);
+
+struct GetManyTask
+{
+  std::string expr;
+  std::vector<void *> args; // argument descriptors owned by the task
+  Data *answer;
+  std::string error;
+  bool done;
+  bool reported; // the caller has moved past this task
+};
+
+struct GetManyBatch
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  std::vector<GetManyTask> tasks;
+  size_t next;      // first task not yet claimed by a worker
+  bool abandoned;   // caller timed out, do not start further tasks
+  int refs;         // caller plus queued and running workers
+  std::string treeName;
+  int shot;
+  int defaultNid;
+  mdsdsc_xd_t timeStart; // time context of the caller
+  mdsdsc_xd_t timeEnd;
+  mdsdsc_xd_t timeDelta;
+};
+
+static void releaseGetManyBatch(GetManyBatch *batch)
+{
+  pthread_mutex_lock(&batch->mutex);
+  bool last = --batch->refs == 0;
+  pthread_mutex_unlock(&batch->mutex);
+  if (!last)
+    return;
+  for (size_t i = 0; i < batch->tasks.size(); i++)
+  {
+    GetManyTask &task = batch->tasks[i];
+    for (size_t j = 0; j < task.args.size(); j++)
+      freeDsc(task.args[j]);
+    if (task.answer)
+      deleteData(task.answer);
+  }
+  MdsFree1Dx(&batch->timeStart, NULL);
+  MdsFree1Dx(&batch->timeEnd, NULL);
+  MdsFree1Dx(&batch->timeDelta, NULL);
+  pthread_cond_destroy(&batch->cond);
+  pthread_mutex_destroy(&batch->mutex);
+  delete batch;
+}
+
+static Data *evaluateGetManyTask(GetManyTask &task, Tree *tree)
+{
+  int status;
+  Data *compData = (Data *)compileFromExprWithArgs(
+      (char *)task.expr.c_str(), task.args.size(), task.args.data(), tree,
+      tree ? tree->getCtx() : NULL, &status);
+  if (STATUS_NOT_OK)
+    throw MdsException(status);
+  if (!compData)
+    throw MdsException("Cannot compile expression");
+  Data *answer = compData->data(tree);
+  deleteData(compData);
+  return answer;
+}
+
+// store the outcome of a task; called with the batch mutex held
+static void completeGetManyTask(GetManyBatch *batch, GetManyTask &task,
+                                Data *answer, std::string const &error)
+{
+  if (task.reported)
+  { // the caller timed out on this task, nobody will read the answer
+    if (answer)
+      deleteData(answer);
+  }
+  else
+  {
+    task.answer = answer;
+    task.error = error;
+  }
+  task.done = true;
+  pthread_cond_broadcast(&batch->cond);
+}
+
+// the tree of the batch in the context of the caller, reusing the one the
+// worker opened for a previous batch when it is still current
+static Tree *getManyWorkerTree(GetManyBatch *batch, Tree *&cached)
+{
+  if (batch->treeName.empty())
+    return NULL;
+  if (cached && (batch->treeName != cached->getName() ||
+                 batch->shot != cached->getShot() ||
+                 IS_OK(_TreeFilesChanged(cached->getCtx()))))
+  {
+    delete cached;
+    cached = NULL;
+  }
+  if (!cached)
+    cached = new Tree(batch->treeName.c_str(), batch->shot, "READONLY");
+  int status = _TreeSetDefaultNid(cached->getCtx(), batch->defaultNid);
+  if (STATUS_OK)
+    status = _TreeSetTimeContext(cached->getCtx(), batch->timeStart.pointer,
+                                 batch->timeEnd.pointer,
+                                 batch->timeDelta.pointer);
+  if (STATUS_NOT_OK)
+    throw MdsException(status);
+  return cached;
+}
+
+// evaluate tasks of the batch until none are left
+static void runGetManyBatch(GetManyBatch *batch, Tree *&cached)
+{
+  pthread_mutex_lock(&batch->mutex);
+  const bool finished = batch->abandoned || batch->next >= batch->tasks.size();
+  pthread_mutex_unlock(&batch->mutex);
+  if (finished) // other workers took all tasks
+    return;
+  Tree *tree = NULL;
+  std::string treeError;
+  try
+  {
+    tree = getManyWorkerTree(batch, cached);
+  }
+  catch (MdsException const &e)
+  {
+    treeError = e.what();
+  }
+  pthread_mutex_lock(&batch->mutex);
+  while (!batch->abandoned && batch->next < batch->tasks.size())
+  {
+    GetManyTask &task = batch->tasks[batch->next++];
+    pthread_mutex_unlock(&batch->mutex);
+    Data *answer = NULL;
+    std::string error = treeError;
+    if (error.empty())
+    {
+      try
+      {
+        answer = evaluateGetManyTask(task, tree);
+      }
+      catch (MdsException const &e)
+      {
+        error = e.what();
+      }
+    }
+    pthread_mutex_lock(&batch->mutex);
+    completeGetManyTask(batch, task, answer, error);
+  }
+  pthread_mutex_unlock(&batch->mutex);
+}
+
+static pthread_mutex_t getManyPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t getManyPoolCond = PTHREAD_COND_INITIALIZER;
+// one entry per worker a batch asked for, each holding a batch reference
+static std::vector<GetManyBatch *> getManyPoolQueue;
+static size_t getManyPoolHead = 0;
+static int getManyPoolThreads = 0;
+
+static int getManyPoolMax()
+{
+  char *threadsStr = getenv("MDSIP_GETMANY_THREADS");
+  int max = threadsStr ? atoi(threadsStr) : 16;
+  return max > 0 ? max : 1;
+}
+
+static void *getManyPoolWorker(void *)
+{
+  Tree *cached = NULL;
+  for (;;)
+  {
+    pthread_mutex_lock(&getManyPoolMutex);
+    while (getManyPoolHead == getManyPoolQueue.size())
+      pthread_cond_wait(&getManyPoolCond, &getManyPoolMutex);
+    GetManyBatch *batch = getManyPoolQueue[getManyPoolHead++];
+    if (getManyPoolHead == getManyPoolQueue.size())
+    {
+      getManyPoolQueue.clear();
+      getManyPoolHead = 0;
+    }
+    pthread_mutex_unlock(&getManyPoolMutex);
+    runGetManyBatch(batch, cached);
+    releaseGetManyBatch(batch);
+  }
+  return NULL;
+}
+
+// queue the batch for up to nWorkers pool threads, starting threads as
+// needed; returns the number of workers queued, 0 if there is no pool
+static int submitGetManyBatch(GetManyBatch *batch, int nWorkers)
+{
+  pthread_mutex_lock(&getManyPoolMutex);
+  const int max = getManyPoolMax();
+  while (getManyPoolThreads < nWorkers && getManyPoolThreads < max)
+  {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, getManyPoolWorker, NULL))
+      break;
+    pthread_detach(thread);
+    getManyPoolThreads++;
+  }
+  if (nWorkers > getManyPoolThreads)
+    nWorkers = getManyPoolThreads;
+  pthread_mutex_lock(&batch->mutex);
+  batch->refs += nWorkers;
+  pthread_mutex_unlock(&batch->mutex);
+  for (int i = 0; i < nWorkers; i++)
+    getManyPoolQueue.push_back(batch);
+  pthread_cond_broadcast(&getManyPoolCond);
+  pthread_mutex_unlock(&getManyPoolMutex);
+  return nWorkers;
+}
+
+void *getManyObjParallel(char *serializedIn, int nThreads, int timeoutMs)
+{
+  AutoData<List> inArgs((List *)deserialize((const char *)serializedIn));
+  if (inArgs->clazz != CLASS_APD) // || inArgs->dtype != DTYPE_LIST)
+    throw MdsException(
+        "INTERNAL ERROR: Get Multi did not receive a LIST argument");
+
+  int nArgs = inArgs->len();
+
+  String nameKey("name");
+  String exprKey("exp");
+  String argsKey("args");
+  std::vector<String *> names;
+  GetManyBatch *batch = new GetManyBatch();
+  pthread_mutex_init(&batch->mutex, NULL);
+  pthread_cond_init(&batch->cond, NULL);
+  batch->tasks.resize(nArgs);
+  batch->next = 0;
+  batch->abandoned = false;
+  batch->refs = 1;
+  batch->shot = 0;
+  batch->defaultNid = 0;
+  static const EMPTYXD(emptyXd);
+  batch->timeStart = batch->timeEnd = batch->timeDelta = emptyXd;
+  bool parallel = nThreads > 1 && nArgs > 1;
+  try
+  {
+    for (int idx = 0; parallel && idx < nArgs; idx++)
+    {
+      AutoData<Dictionary> currArg((Dictionary *)inArgs->getElementAt(idx));
+      if (currArg->clazz != CLASS_APD) // || currArg->dtype != DTYPE_DICTIONARY)
+        throw MdsException(
+            "INTERNAL ERROR: Get Multi Argument is not a DICTIONARY argument");
+      names.push_back((String *)currArg->getItem(&nameKey));
+      AutoData<String> exprData((String *)currArg->getItem(&exprKey));
+      AutoArray<char> expr(exprData->getString());
+      AutoData<List> argsData((List *)currArg->getItem(&argsKey));
+      GetManyTask &task = batch->tasks[idx];
+      task.expr = expr.get();
+      task.answer = NULL;
+      task.done = false;
+      task.reported = false;
+      parallel = IsPureExpression(task.expr.c_str(), task.expr.size());
+      if (parallel && argsData.get())
+      {
+        Data **dataList = argsData->getDscs();
+        for (size_t i = 0; i < argsData->len(); ++i)
+          task.args.push_back(dataList[i]->convertToDsc());
+      }
+    }
+    if (parallel)
+    {
+      Tree *active = NULL;
+      try
+      {
+        active = getActiveTree();
+      }
+      catch (MdsException const &)
+      {
+        // no tree open, expressions are evaluated without one
+      }
+      AutoPointer<Tree> tree(active);
+      if (active)
+      {
+        void *ctx = active->getCtx();
+        batch->treeName = active->getName();
+        batch->shot = active->getShot();
+        parallel = IS_NOT_OK(_TreeEditing(ctx)) &&
+                   IS_OK(_TreeGetDefaultNid(ctx, &batch->defaultNid)) &&
+                   IS_OK(_TreeGetTimeContext(ctx, &batch->timeStart,
+                                             &batch->timeEnd,
+                                             &batch->timeDelta));
+      }
+    }
+  }
+  catch (MdsException const &)
+  {
+    for (size_t i = 0; i < names.size(); i++)
+      deleteData(names[i]);
+    releaseGetManyBatch(batch);
+    throw;
+  }
+  if (!parallel)
+  {
+    for (size_t i = 0; i < names.size(); i++)
+      deleteData(names[i]);
+    releaseGetManyBatch(batch);
+    return getManyObj(serializedIn);
+  }
+
+  if (nThreads > nArgs)
+    nThreads = nArgs;
+  const int nWorkers = submitGetManyBatch(batch, nThreads);
+
+  timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeoutMs / 1000;
+  deadline.tv_nsec += (timeoutMs % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L)
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  AutoData<Dictionary> result(new Dictionary());
+  pthread_mutex_lock(&batch->mutex);
+  for (int idx = 0; idx < nArgs; idx++)
+  {
+    GetManyTask &task = batch->tasks[idx];
+    // if no worker could be started evaluate the remaining entries here
+    if (!nWorkers && batch->next <= (size_t)idx)
+    {
+      batch->next = idx + 1;
+      pthread_mutex_unlock(&batch->mutex);
+      Data *answer = NULL;
+      std::string error;
+      try
+      {
+        AutoPointer<Tree> tree(batch->treeName.empty() ? NULL : getActiveTree());
+        answer = evaluateGetManyTask(task, tree.get());
+      }
+      catch (MdsException const &e)
+      {
+        error = e.what();
+      }
+      pthread_mutex_lock(&batch->mutex);
+      completeGetManyTask(batch, task, answer, error);
+    }
+    while (!task.done && !batch->abandoned)
+    {
+      if (timeoutMs <= 0)
+        pthread_cond_wait(&batch->cond, &batch->mutex);
+      else if (pthread_cond_timedwait(&batch->cond, &batch->mutex,
+                                      &deadline) == ETIMEDOUT)
+        batch->abandoned = true;
+    }
+    // a task that is not done yet may still be written by its worker
+    const bool done = task.done;
+    Data *answer = done ? task.answer : NULL;
+    std::string error = done ? task.error : std::string("Timeout");
+    task.answer = NULL;
+    task.reported = true;
+    pthread_mutex_unlock(&batch->mutex);
+
+    AutoData<Dictionary> answDict(new Dictionary());
+    if (done && error.empty())
+    {
+      AutoData<String> valueKey(new String("value"));
+      answDict->setItem(valueKey.get(), answer);
+    }
+    else
+    {
+      AutoData<String> errorKey(new String("error"));
+      AutoData<String> errorData(new String(error.c_str()));
+      answDict->setItem(errorKey.get(), errorData.get());
+    }
+    AutoData<String> nameData(names[idx]);
+    result->setItem(nameData.get(), answDict.get());
+    pthread_mutex_lock(&batch->mutex);
+  }
+  batch->abandoned = true;
+  pthread_mutex_unlock(&batch->mutex);
+  releaseGetManyBatch(batch);
+
+  return result->convertToDsc();
+}
+#endif
+
 void *getManyObj(char *serializedIn)
 {
   AutoData<List> inArgs((List *)deserialize((const char *)serializedIn));
@@ -870,6 +1288,15 @@ void GetMany::execute()
   AutoData<Uint8Array> serData(
       new Uint8Array((unsigned char *)ser.get(), serSize));
   Data *serPtr = (Data *)serData.get();
+  if (nThreads > 1)
+  {
+    AutoData<Int32> threadsData(new Int32(nThreads));
+    AutoData<Int32> timeoutData(new Int32(timeoutMs));
+    Data *args[3] = {serPtr, threadsData.get(), timeoutData.get()};
+    AutoData<Data> serEvalRes(conn->get("GetManyExecute($,$,$)", args, 3));
+    evalRes = (Dictionary *)deserialize(serEvalRes.get());
+    return;
+  }
   AutoData<Data> serEvalRes(conn->get("GetManyExecute($)", &serPtr, 1));
   evalRes = (Dictionary *)deserialize(serEvalRes.get());
 }
@@ -81,6 +81,11 @@ int makeTreeTimestampedSegment(void *dbid, int nid, void *dataDsc,
 int putTreeTimestampedSegment(void *dbid, int nid, void *dataDsc,
                               int64_t *times);
 int putTreeRow(void *dbid, int nid, void *dataDsc, int64_t *time, int size);
+int asyncPutTreeRow(void *writer, int nid, void *dataDsc, int64_t *time,
+                    int size);
+int asyncPutTreeSegment(void *writer, int nid, void *dataDsc, int ofs);
+int asyncMakeTreeSegment(void *writer, int nid, void *dataDsc, void *startDsc,
+                         void *endDsc, void *dimDsc, int rowsFilled);
 int setTreeXNci(void *dbid, int nid, const char *name, void *dataDsc);
 
 int getTreeData(void *dbid, int nid, void **data, void *tree)
@@ -279,6 +284,50 @@ int putTreeRow(void *dbid, int nid, void *dataDsc, int64_t *time, int size)
   return status;
 }
 
+int asyncPutTreeRow(void *writer, int nid, void *dataDsc, int64_t *time,
+                    int size)
+{
+  struct descriptor_xd *dataXd = (struct descriptor_xd *)dataDsc;
+  int status;
+
+  status = TreeAsyncPutRow(writer, nid, size, time,
+                           (struct descriptor_a *)dataXd->pointer);
+  freeDsc(dataXd);
+  return status;
+}
+
+int asyncPutTreeSegment(void *writer, int nid, void *dataDsc, int ofs)
+{
+  struct descriptor_xd *dataXd = (struct descriptor_xd *)dataDsc;
+  int status;
+
+  status = TreeAsyncPutSegment(writer, nid, ofs,
+                               (struct descriptor_a *)dataXd->pointer);
+  freeDsc(dataXd);
+  return status;
+}
+
+int asyncMakeTreeSegment(void *writer, int nid, void *dataDsc, void *startDsc,
+                         void *endDsc, void *dimDsc, int rowsFilled)
+{
+  struct descriptor_xd *dataXd = (struct descriptor_xd *)dataDsc;
+  struct descriptor_xd *startXd = (struct descriptor_xd *)startDsc;
+  struct descriptor_xd *endXd = (struct descriptor_xd *)endDsc;
+  struct descriptor_xd *dimXd = (struct descriptor_xd *)dimDsc;
+  int status;
+
+  status = TreeAsyncMakeSegment(
+      writer, nid, startXd->pointer, endXd->pointer, dimXd->pointer,
+      (struct descriptor_a *)dataXd->pointer, -1, rowsFilled);
+
+  freeDsc(dataXd);
+  freeDsc(startXd);
+  freeDsc(endXd);
+  freeDsc(dimXd);
+
+  return status;
+}
+
 int putTreeSegment(void *dbid, int nid, void *dataDsc, int ofs)
 {
   struct descriptor_xd *dataXd = (struct descriptor_xd *)dataDsc;
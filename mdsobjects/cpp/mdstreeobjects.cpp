@@ -132,6 +132,12 @@ extern "C"
   int setTreeXNci(void *dbid, int nid, const char *name, void *dataDsc);
   int getTreeXNci(void *dbid, int nid, const char *name, void **data, void *tree);
   int putTreeRow(void *dbid, int nid, void *dataDsc, int64_t *time, int size);
+  int asyncPutTreeRow(void *writer, int nid, void *dataDsc, int64_t *time,
+                      int size);
+  int asyncPutTreeSegment(void *writer, int nid, void *dataDsc, int ofs);
+  int asyncMakeTreeSegment(void *writer, int nid, void *dataDsc,
+                           void *startDsc, void *endDsc, void *dimDsc,
+                           int rowsFilled);
   int getTreeSegmentInfo(void *dbid, int nid, int segIdx, char *dtype,
                          char *dimct, int *dims, int *nextRow);
   // From TreeFindTagWild.c
@@ -690,6 +696,65 @@ int64_t Tree::getDatafileSize()
   return size;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//  TreeAsyncWriter  ///////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+TreeAsyncWriter::TreeAsyncWriter(Tree *tree, int64_t maxBytes)
+{
+  int status = _TreeAsyncWriterOpen(tree->getCtx(), maxBytes, &writer);
+  if (STATUS_NOT_OK)
+    throw MdsException(status);
+}
+
+TreeAsyncWriter::~TreeAsyncWriter() { TreeAsyncWriterClose(writer); }
+
+void TreeAsyncWriter::flush()
+{
+  int status = TreeAsyncWriterFlush(writer);
+  if (STATUS_NOT_OK)
+    throw MdsException(status);
+}
+
+static TREE_ASYNC_WRITER_STATS getAsyncStats(void *writer)
+{
+  TREE_ASYNC_WRITER_STATS stats;
+  int status = TreeAsyncWriterGetStats(writer, &stats);
+  if (STATUS_NOT_OK)
+    throw MdsException(status);
+  return stats;
+}
+
+int64_t TreeAsyncWriter::getQueueDepth()
+{
+  return getAsyncStats(writer).queue_depth;
+}
+
+int64_t TreeAsyncWriter::getMaxQueueDepth()
+{
+  return getAsyncStats(writer).max_queue_depth;
+}
+
+int64_t TreeAsyncWriter::getQueuedBytes()
+{
+  return getAsyncStats(writer).queued_bytes;
+}
+
+int64_t TreeAsyncWriter::getRowsWritten()
+{
+  return getAsyncStats(writer).rows_written;
+}
+
+int64_t TreeAsyncWriter::getLastLatency()
+{
+  return getAsyncStats(writer).last_latency_ns;
+}
+
+int64_t TreeAsyncWriter::getMaxLatency()
+{
+  return getAsyncStats(writer).max_latency_ns;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //  TreeNode  //////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -1948,6 +2013,40 @@ void TreeNode::putRow(Data *data, int64_t *time, int size)
     throw MdsException(status);
 }
 
+void TreeNode::putRowAsync(TreeAsyncWriter *writer, Data *data, int64_t *time,
+                           int size)
+{
+  resolveNid();
+  int status = asyncPutTreeRow(writer->getWriter(), getNid(),
+                               data->convertToDsc(), time, size);
+  if (STATUS_NOT_OK)
+    throw MdsException(status);
+}
+
+void TreeNode::putSegmentAsync(TreeAsyncWriter *writer, Array *data, int ofs)
+{
+  resolveNid();
+  int status = asyncPutTreeSegment(writer->getWriter(), getNid(),
+                                   data->convertToDsc(), ofs);
+  if (STATUS_NOT_OK)
+    throw MdsException(status);
+}
+
+void TreeNode::makeSegmentAsync(TreeAsyncWriter *writer, Data *start,
+                                Data *end, Data *time, Array *initialData)
+{
+  resolveNid();
+  int numDims;
+  int *shape = initialData->getShape(&numDims);
+  int status = asyncMakeTreeSegment(
+      writer->getWriter(), getNid(), initialData->convertToDsc(),
+      start->convertToDsc(), end->convertToDsc(), time->convertToDsc(),
+      shape[0]);
+  deleteNativeArray(shape);
+  if (STATUS_NOT_OK)
+    throw MdsException(status);
+}
+
 TreeNode *TreeNode::getNode(char const *relPath)
 {
   int newNid;
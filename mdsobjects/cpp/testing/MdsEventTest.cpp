@@ -88,6 +88,19 @@ static void *sendStreamAbsArr(void *streamName)
   return NULL;
 }
 
+static void *sendStreamBinaryArr(void *streamName)
+{
+  sleep(1);
+  float times[] = {1., 2};
+  float samples[] = {10, 11};
+  EventStream::setFormat((char *)streamName, EventStream::BINARY);
+  int numSamples = 2;
+  EventStream::send(1, (char *)streamName, false, 2, times, 1, &numSamples,
+                    samples);
+  pthread_exit(0);
+  return NULL;
+}
+
 static void *setevent(void *evname)
 {
   sleep(1);
@@ -317,18 +330,22 @@ int main(int argc __attribute__((unused)),
     MDSplus::EventStream evStreamScalarAbsolute("EVENT_TEST:[]SCALAR_ABSOLUTE");
     MDSplus::EventStream evStreamArrayRelative("EVENT_TEST:[]ARRAY_RELATIVE");
     MDSplus::EventStream evStreamArrayAbsolute("EVENT_TEST:[]ARRAY_ABSOLUTE");
+    MDSplus::EventStream evStreamArrayBinary("EVENT_TEST:[]ARRAY_BINARY");
     TestListenerScalarRelative testListenerScalarRelative;
     TestListenerScalarAbsolute testListenerScalarAbsolute;
     TestListenerArrayRelative testListenerArrayRelative;
     TestListenerArrayAbsolute testListenerArrayAbsolute;
+    TestListenerArrayRelative testListenerArrayBinary;
     evStreamScalarRelative.registerListener(&testListenerScalarRelative);
     evStreamScalarAbsolute.registerListener(&testListenerScalarAbsolute);
     evStreamArrayRelative.registerListener(&testListenerArrayRelative);
     evStreamArrayAbsolute.registerListener(&testListenerArrayAbsolute);
+    evStreamArrayBinary.registerListener(&testListenerArrayBinary);
     evStreamScalarRelative.start();
     evStreamScalarAbsolute.start();
     evStreamArrayRelative.start();
     evStreamArrayAbsolute.start();
+    evStreamArrayBinary.start();
     { // STREAM SCALAR RELATIVE TIME
       pthread_t thread;
       if (pthread_create(&thread, attrp, sendStream, (void *)"EVENT_TEST:[]SCALAR_RELATIVE"))
@@ -403,6 +420,26 @@ int main(int argc __attribute__((unused)),
       delete[] retTimes;
       delete[] retSamples;
     }
+    { // STREAM ARRAY BINARY PAYLOAD
+      pthread_t thread;
+      if (pthread_create(&thread, attrp, sendStreamBinaryArr, (void *)"EVENT_TEST:[]ARRAY_BINARY"))
+        throw std::runtime_error(
+            "ERROR: Could not create thread for sendStream");
+
+      testListenerArrayBinary.waitStream();
+      pthread_join(thread, NULL);
+      int retTimesSize, retSamplesSize;
+      float *retTimes = testListenerArrayBinary.getTimes(&retTimesSize);
+      float *retSamples = testListenerArrayBinary.getSamples(&retSamplesSize);
+      int retShot = testListenerArrayBinary.getShot();
+      TEST1(retTimesSize == 2);
+      TEST1(retSamplesSize == 2);
+      TEST1(retTimes[0] == 1. && retTimes[1] == 2.)
+      TEST1(retSamples[0] == 10. && retSamples[1] == 11.)
+      TEST1(retShot == 1);
+      delete[] retTimes;
+      delete[] retSamples;
+    }
   }
   catch (...)
   {
@@ -0,0 +1,158 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+#include <mdsdescrip.h>
+#include <mdsobjects.h>
+
+#include "testing.h"
+#include "testutils/testutils.h"
+#include "testutils/unique_ptr.h"
+#include "mdsplus/AutoPointer.hpp"
+
+using namespace MDSplus;
+using namespace testing;
+
+// server side entry points called by the GetManyExecute TDI function
+extern "C" struct descriptor_xd *GetManyExecute(char *serializedIn);
+extern "C" struct descriptor_xd *GetManyExecuteParallel(char *serializedIn,
+                                                        int nThreads,
+                                                        int timeoutMs);
+
+// evaluate a GetMany list in this process as the server would
+static Dictionary *execute(GetMany *list, int nThreads, int timeoutMs)
+{
+  int size;
+  AutoArray<char> ser(list->serialize(&size));
+  struct descriptor_xd *xd =
+      nThreads > 1 ? GetManyExecuteParallel(ser.get(), nThreads, timeoutMs)
+                   : GetManyExecute(ser.get());
+  return (Dictionary *)deserialize((char const *)xd->pointer->pointer);
+}
+
+// the value of an entry or NULL if it reported an error
+static Data *value_of(Dictionary *result, const char *name, std::string *error)
+{
+  String nameStr(name);
+  unique_ptr<Dictionary> entry = (Dictionary *)result->getItem(&nameStr);
+  if (!entry.base())
+  {
+    *error = "missing";
+    return NULL;
+  }
+  String valueKey("value");
+  Data *value = entry->getItem(&valueKey);
+  if (value)
+    return value;
+  String errorKey("error");
+  unique_ptr<String> errorStr = (String *)entry->getItem(&errorKey);
+  AutoArray<char> errorBuf(errorStr.base() ? errorStr->getString() : NULL);
+  *error = errorBuf.get() ? errorBuf.get() : "unknown";
+  return NULL;
+}
+
+static void append(GetMany *list, const char *name, const char *expr,
+                   Data *arg = NULL)
+{
+  Data *args[1] = {arg};
+  list->append((char *)name, (char *)expr, arg ? args : NULL, arg ? 1 : 0);
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(GetMany);
+
+  { // parallel evaluation gives the serial answers in request order //
+    unique_ptr<GetMany> list = new GetMany(NULL);
+    unique_ptr<Int32> arg = new Int32(41);
+    char name[16], expr[32];
+    for (int i = 0; i < 32; i++)
+    {
+      sprintf(name, "e%d", i);
+      sprintf(expr, "%d * 3 + 1", i);
+      append(list, name, expr);
+    }
+    append(list, "arg", "$ + 1", arg);
+    append(list, "array", "[1, 2, 3] * 2");
+    append(list, "bad", "1 +");
+    unique_ptr<Dictionary> serial = execute(list, 1, 0);
+    unique_ptr<Dictionary> parallel = execute(list, 4, 0);
+    for (int i = 0; i < 32; i++)
+    {
+      std::string error;
+      sprintf(name, "e%d", i);
+      unique_ptr<Data> s = value_of(serial, name, &error);
+      unique_ptr<Data> p = value_of(parallel, name, &error);
+      TEST1(s.base() && p.base());
+      TEST1(s->getInt() == i * 3 + 1);
+      TEST1(p->getInt() == i * 3 + 1);
+    }
+    std::string error;
+    unique_ptr<Data> answer = value_of(parallel, "arg", &error);
+    TEST1(answer.base() && answer->getInt() == 42);
+    answer = value_of(parallel, "array", &error);
+    TEST1(answer.base() != NULL);
+    int n;
+    AutoArray<int> values(answer->getIntArray(&n));
+    TEST1(n == 3 && values.get()[0] == 2 && values.get()[2] == 6);
+    answer = value_of(parallel, "bad", &error);
+    TEST1(answer.base() == NULL);
+    TEST0(error.empty());
+  }
+
+  { // entries still running at the timeout are reported as such //
+    unique_ptr<GetMany> list = new GetMany(NULL);
+    append(list, "fast", "1");
+    append(list, "slow", "size(sort(sin(ramp(20000000))))");
+    append(list, "after", "3");
+    unique_ptr<Dictionary> result = execute(list, 2, 50);
+    std::string error;
+    unique_ptr<Data> answer = value_of(result, "fast", &error);
+    TEST1(answer.base() && answer->getInt() == 1);
+    answer = value_of(result, "slow", &error);
+    TEST1(answer.base() == NULL);
+    TEST1(error == "Timeout");
+    // the worker finishes the slow entry in the background and frees it
+    sleep(2);
+  }
+
+  { // lists that may depend on the caller's context are evaluated serially //
+    unique_ptr<Data> set = MDSplus::execute("_getmany_x = 5");
+    unique_ptr<GetMany> list = new GetMany(NULL);
+    append(list, "var", "_getmany_x + 1");
+    append(list, "const", "2");
+    unique_ptr<Dictionary> result = execute(list, 4, 0);
+    std::string error;
+    unique_ptr<Data> answer = value_of(result, "var", &error);
+    TEST1(answer.base() && answer->getInt() == 6);
+    answer = value_of(result, "const", &error);
+    TEST1(answer.base() && answer->getInt() == 2);
+  }
+
+  END_TESTING;
+}
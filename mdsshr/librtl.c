@@ -77,17 +77,51 @@ typedef struct
   DIR *dir_ptr;
 } FindFileCtx;
 
-typedef struct _VmList
-{
-  void *ptr;
-  struct _VmList *next;
-} VmList;
+/* VM zones are arenas: blocks up to ZONE_SMALL_MAX bytes are carved out of
+   ZONE_CHUNK_SIZE chunks and recycled through per size free lists, larger
+   blocks are malloc'ed and kept on a doubly linked list. Every block is
+   preceded by a VmHeader, so allocate and free are O(1) and a reset only
+   releases the large blocks, keeping the chunks for reuse until the zone is
+   deleted. The word right before the data
+   tags the block with its zone; LibFreeVm hands any other pointer to free(),
+   that word being within the malloc chunk header of a malloc'ed block. */
+#define ZONE_ALIGN 16
+#define ZONE_SMALL_MAX 512
+#define ZONE_CLASSES (ZONE_SMALL_MAX / ZONE_ALIGN)
+#define ZONE_CHUNK_SIZE 0x10000
+
+typedef struct _VmHeader
+{
+  struct _VmHeader *prev; /* large blocks only */
+  struct _VmHeader *next; /* large block list or free list of size class */
+  uint32_t size;          /* usable size, multiple of ZONE_ALIGN if small */
+} VmHeader;
+#define VM_HEADER_SIZE                                   \
+  ((sizeof(VmHeader) + sizeof(uintptr_t) + ZONE_ALIGN - 1) & \
+   ~(size_t)(ZONE_ALIGN - 1))
+#define VM_HEADER(ptr) ((VmHeader *)((char *)(ptr)-VM_HEADER_SIZE))
+#define VM_DATA(hdr) ((void *)((char *)(hdr) + VM_HEADER_SIZE))
+#define VM_TAG(ptr) (((uintptr_t *)(ptr))[-1])
+#define ZONE_TAG(zone) ((uintptr_t)(zone) ^ (uintptr_t)0x5a4f4e45)
+
+typedef struct _VmChunk
+{
+  struct _VmChunk *next;
+} VmChunk;
+#define VM_CHUNK_SIZE \
+  ((sizeof(VmChunk) + ZONE_ALIGN - 1) & ~(size_t)(ZONE_ALIGN - 1))
 
 typedef struct _ZoneList
 {
-  VmList *vm;
+  struct _ZoneList *prev;
   struct _ZoneList *next;
   pthread_mutex_t lock;
+  VmChunk *chunks;
+  VmChunk *spare; /* chunks released by a reset */
+  char *bump;
+  char *bump_end;
+  VmHeader *large;
+  VmHeader *free[ZONE_CLASSES];
 } ZoneList;
 
 typedef struct node
@@ -880,99 +914,98 @@ ZoneList *MdsZones = NULL;
 
 EXPORT int LibCreateVmZone(ZoneList **const zone)
 {
-  ZoneList *list;
-  *zone = malloc(sizeof(ZoneList));
-  (*zone)->vm = NULL;
-  (*zone)->next = NULL;
+  *zone = calloc(1, sizeof(ZoneList));
+  if (!*zone)
+    return LibINSVIRMEM;
   pthread_mutex_init(&(*zone)->lock, NULL);
   LOCK_ZONES;
-  if (MdsZones == NULL)
-    MdsZones = *zone;
-  else
-  {
-    for (list = MdsZones; list->next; list = list->next)
-      ;
-    list->next = *zone;
-  }
+  (*zone)->next = MdsZones;
+  if (MdsZones)
+    MdsZones->prev = *zone;
+  MdsZones = *zone;
   UNLOCK_ZONES;
-  return (*zone != NULL);
+  return MDSplusSUCCESS;
 }
 
 EXPORT int LibDeleteVmZone(ZoneList **const zone)
 {
-  int found;
-  ZoneList *list, *prev;
+  if (!zone || !*zone)
+    return 0;
   LibResetVmZone(zone);
-  LOCK_ZONES;
-  found = 0;
-  if (*zone == MdsZones)
+  VmChunk *chunk, *next_chunk;
+  for (chunk = (*zone)->spare; chunk; chunk = next_chunk)
   {
-    found = 1;
-    MdsZones = (*zone)->next;
+    next_chunk = chunk->next;
+    free(chunk);
   }
+  LOCK_ZONES;
+  if ((*zone)->prev)
+    (*zone)->prev->next = (*zone)->next;
   else
-  {
-    for (prev = 0, list = MdsZones; list && list != *zone;
-         prev = list, list = list->next)
-      ;
-    if (list && prev)
-    {
-      prev->next = list->next;
-      found = 1;
-    }
-  }
-  if (found)
-  {
-    free(*zone);
-    *zone = 0;
-  }
+    MdsZones = (*zone)->next;
+  if ((*zone)->next)
+    (*zone)->next->prev = (*zone)->prev;
   UNLOCK_ZONES;
-  return found;
+  pthread_mutex_destroy(&(*zone)->lock);
+  free(*zone);
+  *zone = NULL;
+  return MDSplusSUCCESS;
 }
 
 EXPORT int LibResetVmZone(ZoneList **const zone)
 {
   if (zone && *zone)
   {
-    VmList *vm, *_vm;
+    VmChunk *chunk, *next_chunk;
+    VmHeader *large, *next_large;
     LOCK_ZONE(*zone);
-    vm = (*zone)->vm;
-    (*zone)->vm = NULL;
+    for (chunk = (*zone)->chunks; chunk; chunk = next_chunk)
+    {
+      next_chunk = chunk->next;
+      chunk->next = (*zone)->spare;
+      (*zone)->spare = chunk;
+    }
+    large = (*zone)->large;
+    (*zone)->chunks = NULL;
+    (*zone)->large = NULL;
+    (*zone)->bump = (*zone)->bump_end = NULL;
+    memset((*zone)->free, 0, sizeof((*zone)->free));
     UNLOCK_ZONE(*zone);
-    while (vm)
+    for (; large; large = next_large)
     {
-      free(vm->ptr);
-      _vm = vm;
-      vm = _vm->next;
-      free(_vm);
+      next_large = large->next;
+      free(large);
     }
   }
   return MDSplusSUCCESS;
 }
 
-static VmList *ZoneList_remove_VmList(ZoneList **zone, void *vm)
+static VmHeader *zone_get_small(ZoneList *zone, uint32_t size)
 {
-  VmList *list;
-  LOCK_ZONE(*zone);
-  VmList **prev = &(*zone)->vm;
-  for (list = (*zone)->vm; list; prev = &list->next, list = list->next)
+  int idx = size / ZONE_ALIGN - 1;
+  VmHeader *hdr = zone->free[idx];
+  if (hdr)
   {
-    if (list->ptr == vm)
-    {
-      *prev = list->next;
-      break;
-    }
+    zone->free[idx] = hdr->next;
+    return hdr;
   }
-  UNLOCK_ZONE(*zone);
-  return list;
-}
-
-static void ZoneList_add_VmList(ZoneList **zone, VmList *list)
-{
-  LOCK_ZONE(*zone);
-  list->next = (*zone)->vm;
-  (*zone)->vm = list;
-  UNLOCK_ZONE(*zone);
+  size_t needed = VM_HEADER_SIZE + size;
+  if (zone->bump + needed > zone->bump_end || !zone->bump)
+  {
+    VmChunk *chunk = zone->spare;
+    if (chunk)
+      zone->spare = chunk->next;
+    else if (!(chunk = malloc(ZONE_CHUNK_SIZE)))
+      return NULL;
+    chunk->next = zone->chunks;
+    zone->chunks = chunk;
+    zone->bump = (char *)chunk + VM_CHUNK_SIZE;
+    zone->bump_end = (char *)chunk + ZONE_CHUNK_SIZE;
+  }
+  hdr = (VmHeader *)zone->bump;
+  zone->bump += needed;
+  hdr->size = size;
+  return hdr;
 }
 
 EXPORT int LibFreeVm(const uint32_t *len, void **vm, ZoneList **zone)
@@ -980,11 +1013,32 @@ EXPORT int LibFreeVm(const uint32_t *len, void **vm, ZoneList **zone)
   (void)len;
   if (vm && *vm)
   {
-    free(*vm);
-    if (zone)
+    if (zone && *zone && VM_TAG(*vm) == ZONE_TAG(*zone))
     {
-      free(ZoneList_remove_VmList(zone, *vm));
+      VmHeader *hdr = VM_HEADER(*vm);
+      VM_TAG(*vm) = 0;
+      LOCK_ZONE(*zone);
+      if (hdr->size <= ZONE_SMALL_MAX)
+      {
+        int idx = hdr->size / ZONE_ALIGN - 1;
+        hdr->next = (*zone)->free[idx];
+        (*zone)->free[idx] = hdr;
+        hdr = NULL;
+      }
+      else
+      {
+        if (hdr->prev)
+          hdr->prev->next = hdr->next;
+        else
+          (*zone)->large = hdr->next;
+        if (hdr->next)
+          hdr->next->prev = hdr->prev;
+      }
+      UNLOCK_ZONE(*zone);
+      free(hdr);
     }
+    else
+      free(*vm);
   }
   return MDSplusSUCCESS;
 }
@@ -999,18 +1053,44 @@ EXPORT int libfreevm(const uint32_t *len, void **vm, ZoneList **zone)
 
 EXPORT int LibGetVm(const uint32_t *len, void **vm, ZoneList **zone)
 {
-  *vm = malloc(*len);
+  if (zone && *zone)
+  {
+    VmHeader *hdr;
+    uint32_t size = *len;
+    if (size <= ZONE_SMALL_MAX)
+    {
+      size = size ? (size + ZONE_ALIGN - 1) & ~(uint32_t)(ZONE_ALIGN - 1)
+                  : ZONE_ALIGN;
+      LOCK_ZONE(*zone);
+      hdr = zone_get_small(*zone, size);
+      UNLOCK_ZONE(*zone);
+    }
+    else
+    {
+      hdr = malloc(VM_HEADER_SIZE + size);
+      if (hdr)
+      {
+        hdr->size = size;
+        hdr->prev = NULL;
+        LOCK_ZONE(*zone);
+        hdr->next = (*zone)->large;
+        if (hdr->next)
+          hdr->next->prev = hdr;
+        (*zone)->large = hdr;
+        UNLOCK_ZONE(*zone);
+      }
+    }
+    *vm = hdr ? VM_DATA(hdr) : NULL;
+    if (*vm)
+      VM_TAG(*vm) = ZONE_TAG(*zone);
+  }
+  else
+    *vm = malloc(*len);
   if (*vm == NULL)
   {
     printf("Insufficient virtual memory\n");
     return LibINSVIRMEM;
   }
-  if (zone)
-  {
-    VmList *list = malloc(sizeof(VmList));
-    list->ptr = *vm;
-    ZoneList_add_VmList(zone, list);
-  }
   return MDSplusSUCCESS;
 }
 EXPORT int libgetvm_(const uint32_t *len, void **vm, ZoneList **zone)
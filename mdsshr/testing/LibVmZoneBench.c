@@ -0,0 +1,178 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*
+ * Cost of LibGetVm/LibFreeVm on a zone against the list tracked blocks the
+ * zones used before and against untracked malloc/free, run with
+ * "make bench"; LibVmZoneTest checks the zones.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libroutines.h>
+#include <mdsshr.h>
+
+#define NBLOCKS 1000
+#define NLOOPS 1000
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t block_len(int i)
+{
+  // mostly descriptor sized blocks with an occasional large array
+  return (i % 97) ? (uint32_t)(8 + (i * 7) % 500) : (uint32_t)(4096 + i);
+}
+
+/* the zones before: a malloc'ed list node per block, found by a list walk */
+typedef struct _VmList
+{
+  void *ptr;
+  struct _VmList *next;
+} VmList;
+
+static void list_get(VmList **list, uint32_t len, void **vm)
+{
+  VmList *node = malloc(sizeof(VmList));
+  *vm = node->ptr = malloc(len);
+  node->next = *list;
+  *list = node;
+}
+
+static void list_free(VmList **list, void *vm)
+{
+  VmList **prev, *node;
+  for (prev = list; (node = *prev) && node->ptr != vm; prev = &node->next)
+    ;
+  if (node)
+  {
+    *prev = node->next;
+    free(node);
+  }
+  free(vm);
+}
+
+/* order 0 frees in reverse allocation order, 1 in allocation order */
+static double time_zone(int order)
+{
+  ZoneList *zone = NULL;
+  static void *vm[NBLOCKS];
+  uint32_t len;
+  int i, loop;
+  LibCreateVmZone(&zone);
+  double t0 = now();
+  for (loop = 0; loop < NLOOPS; loop++)
+  {
+    for (i = 0; i < NBLOCKS; i++)
+    {
+      len = block_len(i);
+      LibGetVm(&len, &vm[i], &zone);
+    }
+    for (i = 0; i < NBLOCKS; i++)
+    {
+      const int j = order ? i : NBLOCKS - 1 - i;
+      len = block_len(j);
+      LibFreeVm(&len, &vm[j], &zone);
+    }
+  }
+  t0 = now() - t0;
+  LibDeleteVmZone(&zone);
+  return t0;
+}
+
+static double time_list(int order)
+{
+  VmList *list = NULL;
+  static void *vm[NBLOCKS];
+  int i, loop;
+  double t0 = now();
+  for (loop = 0; loop < NLOOPS; loop++)
+  {
+    for (i = 0; i < NBLOCKS; i++)
+      list_get(&list, block_len(i), &vm[i]);
+    for (i = 0; i < NBLOCKS; i++)
+      list_free(&list, vm[order ? i : NBLOCKS - 1 - i]);
+  }
+  return now() - t0;
+}
+
+static double time_malloc(int order)
+{
+  static void *vm[NBLOCKS];
+  int i, loop;
+  double t0 = now();
+  for (loop = 0; loop < NLOOPS; loop++)
+  {
+    for (i = 0; i < NBLOCKS; i++)
+      vm[i] = malloc(block_len(i));
+    for (i = 0; i < NBLOCKS; i++)
+      free(vm[order ? i : NBLOCKS - 1 - i]);
+  }
+  return now() - t0;
+}
+
+/* a zone dropped whole, as TDI does with its temporary zones */
+static double time_reset()
+{
+  ZoneList *zone = NULL;
+  void *vm;
+  uint32_t len;
+  int i, loop;
+  LibCreateVmZone(&zone);
+  double t0 = now();
+  for (loop = 0; loop < NLOOPS; loop++)
+  {
+    for (i = 0; i < NBLOCKS; i++)
+    {
+      len = block_len(i);
+      LibGetVm(&len, &vm, &zone);
+    }
+    LibResetVmZone(&zone);
+  }
+  t0 = now() - t0;
+  LibDeleteVmZone(&zone);
+  return t0;
+}
+
+int main(int argc __attribute__((unused)),
+         char **argv __attribute__((unused)))
+{
+  static const char *orders[] = {"reverse", "allocation"};
+  const double ops = (double)NLOOPS * NBLOCKS;
+  int order;
+  for (order = 0; order < 2; order++)
+    printf("%d blocks freed in %s order: zone %.1f, list %.1f, "
+           "malloc %.1f ns per get and free\n",
+           NBLOCKS, orders[order], time_zone(order) * 1e9 / ops,
+           time_list(order) * 1e9 / ops, time_malloc(order) * 1e9 / ops);
+  printf("%d blocks dropped by a zone reset: %.1f ns per get\n", NBLOCKS,
+         time_reset() * 1e9 / ops);
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libroutines.h>
+#include <mdsshr.h>
+#include "testing.h"
+
+#define NBLOCKS 1000
+
+static uint32_t block_len(int i)
+{
+  // mostly descriptor sized blocks with an occasional large array
+  return (i % 97) ? (uint32_t)(8 + (i * 7) % 500) : (uint32_t)(4096 + i);
+}
+
+static void zone_correctness(void)
+{
+  BEGIN_TESTING(LibGetVm zone allocate free reuse);
+  ZoneList *zone = NULL;
+  void *vm[NBLOCKS];
+  uint32_t len;
+  int i, allocated = 1, aligned = 1, intact = 1;
+  TEST1(LibCreateVmZone(&zone) & 1);
+  TEST1(zone != NULL);
+  for (i = 0; i < NBLOCKS; i++)
+  {
+    len = block_len(i);
+    allocated &= LibGetVm(&len, &vm[i], &zone) & 1;
+    aligned &= ((uintptr_t)vm[i] & 15) == 0;
+    memset(vm[i], i & 0xff, len);
+  }
+  for (i = 0; i < NBLOCKS; i++)
+  {
+    unsigned char *p = vm[i];
+    len = block_len(i);
+    intact &= p[0] == (i & 0xff) && p[len - 1] == (i & 0xff);
+  }
+  TEST1(allocated);
+  TEST1(aligned);
+  TEST1(intact);
+  // a freed small block is handed out again for the same size class
+  len = block_len(1);
+  void *old = vm[1];
+  TEST1(LibFreeVm(&len, &vm[1], &zone) & 1);
+  TEST1(LibGetVm(&len, &vm[1], &zone) & 1);
+  TEST1(vm[1] == old);
+  for (i = 0; i < NBLOCKS; i += 2)
+  {
+    len = block_len(i);
+    LibFreeVm(&len, &vm[i], &zone);
+  }
+  // blocks that did not come from the zone are handed to free()
+  for (i = 0; i < 4; i++)
+  {
+    static const uint32_t lens[] = {24, 512, 4096, 1 << 20};
+    void *p = malloc(lens[i]);
+    memset(p, 0, lens[i]);
+    TEST1(LibFreeVm(&lens[i], &p, &zone) & 1);
+  }
+  TEST1(LibResetVmZone(&zone) & 1);
+  len = 24;
+  TEST1(LibGetVm(&len, &vm[0], &zone) & 1);
+  TEST1(LibDeleteVmZone(&zone) & 1);
+  TEST1(zone == NULL);
+  // a NULL zone falls back to plain malloc/free
+  TEST1(LibGetVm(&len, &vm[0], NULL) & 1);
+  TEST1(LibFreeVm(&len, &vm[0], NULL) & 1);
+  END_TESTING;
+}
+
+int main(int argc __attribute__((unused)),
+         char **argv __attribute__((unused)))
+{
+  zone_correctness();
+  return 0;
+}
@@ -0,0 +1,615 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*
+ * Shared memory transport for clients on the same host as the server.
+ *
+ * The server listens on an abstract unix socket named after the port
+ * (mdsip -P shm -p <name>, clients connect to shm://<name>). For every
+ * client it creates a memfd holding one byte ring per direction and the
+ * eventfds to sleep on, and passes them over the socket.
+ * From then on the socket only serves to notice that the peer went away.
+ *
+ * Each ring has a single producer and a single consumer that advance free
+ * running head and tail counters, so data moves with one memcpy per side and
+ * no system call as long as both sides keep up. A reader that finds its
+ * ring empty, or a writer that finds it full, spins for a while, then sets
+ * the matching waiting flag of the ring and sleeps on the matching eventfd;
+ * the peer only rings the eventfd when that flag is set. Keeping data and
+ * space wakeups apart lets one thread read while another one writes.
+ *
+ * MDSIP_SHM_SIZE   bytes per ring, rounded up to a power of two (4 MiB)
+ * MDSIP_SHM_SPIN   polls of the ring before a side goes to sleep (4000,
+ *                  0 on a single cpu)
+ */
+#define _GNU_SOURCE
+#include <mdsplus/mdsconfig.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <poll.h>
+#include <pwd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+#include "../mdsip_connections.h"
+#include <mdsshr.h>
+#include <pthread_port.h>
+#include <status.h>
+
+// #define DEBUG
+#include <mdsmsg.h>
+
+#define PROTOCOL "shm"
+
+#ifdef __linux__
+
+#define SHM_MAGIC 0x4d445348
+#define CLIENT 0
+#define SERVER 1
+#define DATA 0
+#define SPACE 1
+#define BELLS 4 // eventfd of (ring << 1 | DATA or SPACE)
+#define MAX_RING_SIZE ((uint64_t)1 << 40)
+
+typedef struct
+{
+  uint64_t head; // bytes written so far, advanced by the sender
+  char pad_head[56];
+  uint64_t tail; // bytes read so far, advanced by the receiver
+  char pad_tail[56];
+  uint32_t waiting[2]; // DATA: reader sleeps, SPACE: writer sleeps
+  char pad_waiting[56];
+} shm_ring_t;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t closed;
+  uint64_t size;       // bytes in each ring, a power of two
+  char pad[48];
+  shm_ring_t ring[2]; // indexed by the sending side
+} shm_header_t;
+
+// size and mask are kept here, the shared header can be written by the peer
+typedef struct
+{
+  shm_header_t *hdr;
+  uint64_t size;
+  uint64_t mask;
+  size_t map_len;
+  int side;
+  int sock;
+  int bell[BELLS];
+} io_shm_t;
+
+static io_shm_t *get_shm(Connection *c)
+{
+  size_t len;
+  char *info_name;
+  io_shm_t *s = (io_shm_t *)ConnectionGetInfo(c, &info_name, 0, &len);
+  return (info_name && !strcmp(PROTOCOL, info_name) && len == sizeof(io_shm_t))
+             ? s
+             : NULL;
+}
+
+static inline char *ring_data(io_shm_t *s, int side)
+{
+  return (char *)(s->hdr + 1) + side * s->size;
+}
+
+/// bytes to read (DATA) or room to write (SPACE) in ring, counters moved
+/// out of [0, size] by the peer are clamped so copies stay in the ring
+static inline size_t ring_ready(io_shm_t *s, int ring, int what)
+{
+  shm_ring_t *r = &s->hdr->ring[ring];
+  int64_t used = (int64_t)(__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) -
+                           __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE));
+  if (used < 0)
+    used = 0;
+  else if ((uint64_t)used > s->size)
+    used = s->size;
+  return what == DATA ? (size_t)used : (size_t)(s->size - used);
+}
+
+/// wake the peer if it sleeps waiting for what in ring
+static void ring_wake(io_shm_t *s, int ring, int what)
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&s->hdr->ring[ring].waiting[what], __ATOMIC_RELAXED))
+  {
+    uint64_t one = 1;
+    if (write(s->bell[ring << 1 | what], &one, sizeof(one)) < 0)
+      MDSDBG("eventfd write: %s", strerror(errno));
+  }
+}
+
+static int get_spin()
+{
+  static int spin = -1;
+  if (spin < 0)
+  {
+    const char *env = getenv("MDSIP_SHM_SPIN");
+    // spinning only pays off when the peer runs on another cpu
+    spin = env ? (int)strtol(env, NULL, 0)
+               : sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 4000 : 0;
+    if (spin < 0)
+      spin = 0;
+  }
+  return spin;
+}
+
+static inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+/// Wait until ring has data or space as selected by what, honouring the
+/// to_msec convention of recv_to: negative waits forever, otherwise it is a
+/// timeout.
+/// \return bytes ready, 0 on timeout, -1 when the peer has gone away
+static ssize_t ring_wait(io_shm_t *s, int ring, int what, int to_msec)
+{
+  size_t n;
+  int spin;
+  for (spin = get_spin(); spin > 0; spin--)
+  {
+    if ((n = ring_ready(s, ring, what)))
+      return n;
+    cpu_relax();
+  }
+  uint32_t *waiting = &s->hdr->ring[ring].waiting[what];
+  struct pollfd fds[2] = {{s->bell[ring << 1 | what], POLLIN, 0},
+                          {s->sock, POLLIN, 0}};
+  for (;;)
+  {
+    int err = 0;
+    __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+    n = ring_ready(s, ring, what);
+    if (!n && !__atomic_load_n(&s->hdr->closed, __ATOMIC_ACQUIRE))
+    {
+      err = poll(fds, 2, to_msec < 0 ? 1000 : to_msec);
+      if (err > 0 && fds[0].revents)
+      {
+        uint64_t count;
+        if (read(fds[0].fd, &count, sizeof(count)) < 0)
+          MDSDBG("eventfd read: %s", strerror(errno));
+      }
+      n = ring_ready(s, ring, what);
+    }
+    __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+    if (n)
+      return n;
+    if (__atomic_load_n(&s->hdr->closed, __ATOMIC_ACQUIRE) ||
+        (err > 0 && fds[1].revents))
+      return -1;
+    if (err < 0 && errno != EINTR)
+      return -1;
+    if (err == 0 && to_msec >= 0)
+    {
+      errno = ETIMEDOUT;
+      return 0;
+    }
+  }
+}
+
+// SEND //
+
+static ssize_t io_send(Connection *c, const void *buffer, size_t buflen,
+                       int nowait __attribute__((unused)))
+{
+  io_shm_t *s = get_shm(c);
+  if (!s)
+    return -1;
+  shm_ring_t *r = &s->hdr->ring[s->side];
+  char *data = ring_data(s, s->side);
+  const char *bptr = (const char *)buffer;
+  size_t sent = 0;
+  errno = 0;
+  while (sent < buflen)
+  {
+    ssize_t space = ring_wait(s, s->side, SPACE, -1);
+    if (space <= 0)
+    {
+      errno = EPIPE;
+      break;
+    }
+    size_t n = buflen - sent < (size_t)space ? buflen - sent : (size_t)space;
+    uint64_t head = r->head;
+    size_t off = head & s->mask;
+    size_t first = s->size - off < n ? s->size - off : n;
+    memcpy(data + off, bptr + sent, first);
+    memcpy(data, bptr + sent + first, n - first);
+    __atomic_store_n(&r->head, head + n, __ATOMIC_RELEASE);
+    ring_wake(s, s->side, DATA);
+    sent += n;
+  }
+  MDSDBG("conid=%d, sent=%" PRIu64 "/%" PRIu64, c->id, (uint64_t)sent,
+         (uint64_t)buflen);
+  return sent ? (ssize_t)sent : -1;
+}
+
+// RECEIVE //
+
+static ssize_t io_recv_to(Connection *c, void *buffer, size_t buflen,
+                          const int to_msec)
+{
+  io_shm_t *s = get_shm(c);
+  if (!s)
+    return -1;
+  errno = 0;
+  ssize_t avail = ring_wait(s, !s->side, DATA, to_msec);
+  if (avail <= 0)
+    return avail < 0 ? 0 : -1; // closed reads as end of file
+  shm_ring_t *r = &s->hdr->ring[!s->side];
+  char *data = ring_data(s, !s->side);
+  size_t n = buflen < (size_t)avail ? buflen : (size_t)avail;
+  uint64_t tail = r->tail;
+  size_t off = tail & s->mask;
+  size_t first = s->size - off < n ? s->size - off : n;
+  memcpy(buffer, data + off, first);
+  memcpy((char *)buffer + first, data, n - first);
+  __atomic_store_n(&r->tail, tail + n, __ATOMIC_RELEASE);
+  ring_wake(s, !s->side, SPACE);
+  MDSDBG("conid=%d, ans=%" PRIu64, c->id, (uint64_t)n);
+  return n;
+}
+
+static ssize_t io_recv(Connection *c, void *buffer, size_t buflen)
+{
+  return io_recv_to(c, buffer, buflen, -1);
+}
+
+// DISCONNECT //
+
+static void shm_close(io_shm_t *s)
+{
+  int i;
+  if (s->hdr)
+    munmap(s->hdr, s->map_len);
+  for (i = 0; i < BELLS; i++)
+    if (s->bell[i] >= 0)
+      close(s->bell[i]);
+  if (s->sock >= 0)
+    close(s->sock);
+}
+
+static int io_disconnect(Connection *c)
+{
+  io_shm_t *s = get_shm(c);
+  if (s)
+  {
+    __atomic_store_n(&s->hdr->closed, 1, __ATOMIC_RELEASE);
+    ring_wake(s, !s->side, SPACE);
+    ring_wake(s, s->side, DATA);
+    shm_close(s);
+    if (s->side == SERVER)
+    {
+      char now[32];
+      Now32(now);
+      fprintf(stdout, "%s (pid %d) Connection disconnected from %s@localhost\r\n",
+              now, getpid(), c->rm_user ? c->rm_user : "?");
+      fflush(stdout);
+    }
+  }
+  return C_OK;
+}
+
+// CONNECT //
+
+static socklen_t shm_address(struct sockaddr_un *addr, const char *name)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  // abstract namespace: leading NUL, nothing to clean up in the file system
+  int len = snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1,
+                     "mdsip-shm-%s", name);
+  if (len > (int)sizeof(addr->sun_path) - 1)
+    len = sizeof(addr->sun_path) - 1;
+  return offsetof(struct sockaddr_un, sun_path) + 1 + len;
+}
+
+static inline long get_timeout_sec()
+{
+  const char *timeout = getenv("MDSIP_CONNECT_TIMEOUT");
+  if (timeout)
+    return strtol(timeout, NULL, 0);
+  return 10;
+}
+
+static int io_connect(Connection *c, char *protocol __attribute__((unused)),
+                      char *host)
+{
+  io_shm_t s = {NULL, 0, 0, 0, CLIENT, -1, {-1, -1, -1, -1}};
+  struct sockaddr_un addr;
+  socklen_t addr_len = shm_address(&addr, host && *host ? host : "mdsip");
+  s.sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (s.sock < 0 || connect(s.sock, (struct sockaddr *)&addr, addr_len))
+  {
+    fprintf(stderr, "Connect failed to shm://%s: %s\n", host, strerror(errno));
+    shm_close(&s);
+    return C_ERROR;
+  }
+  // the server answers with the ring size, the memfd and the eventfds
+  struct pollfd pfd = {s.sock, POLLIN, 0};
+  if (poll(&pfd, 1, get_timeout_sec() * 1000) != 1)
+  {
+    fprintf(stderr, "Error in connect to shm://%s: timeout\n", host);
+    shm_close(&s);
+    return C_ERROR;
+  }
+  uint64_t size = 0;
+  int fds[1 + BELLS];
+  char cbuf[CMSG_SPACE(sizeof(fds))];
+  struct iovec iov = {&size, sizeof(size)};
+  struct msghdr msg = {0};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cbuf;
+  msg.msg_controllen = sizeof(cbuf);
+  struct cmsghdr *cmsg;
+  if (recvmsg(s.sock, &msg, MSG_CMSG_CLOEXEC) != sizeof(size) ||
+      !(cmsg = CMSG_FIRSTHDR(&msg)) || cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+  {
+    fprintf(stderr, "Error in connect to shm://%s: bad handshake\n", host);
+    shm_close(&s);
+    return C_ERROR;
+  }
+  memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+  memcpy(s.bell, fds + 1, sizeof(s.bell));
+  if (!size || (size & (size - 1)) || size > MAX_RING_SIZE)
+  {
+    fprintf(stderr, "Error in connect to shm://%s: bad ring size\n", host);
+    close(fds[0]);
+    shm_close(&s);
+    return C_ERROR;
+  }
+  s.size = size;
+  s.mask = size - 1;
+  s.map_len = sizeof(shm_header_t) + 2 * size;
+  struct stat st;
+  if (fstat(fds[0], &st) || (size_t)st.st_size != s.map_len ||
+      (s.hdr = mmap(NULL, s.map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fds[0], 0)) == MAP_FAILED)
+  {
+    perror("Error in connect mapping shared memory");
+    s.hdr = NULL;
+  }
+  close(fds[0]);
+  if (!s.hdr || s.hdr->magic != SHM_MAGIC || s.hdr->size != size)
+  {
+    shm_close(&s);
+    return C_ERROR;
+  }
+  ConnectionSetInfo(c, PROTOCOL, s.sock, &s, sizeof(s));
+  return C_OK;
+}
+
+// LISTEN //
+
+static uint64_t get_ring_size()
+{
+  uint64_t want = 4 << 20, size = 4096;
+  const char *env = getenv("MDSIP_SHM_SIZE");
+  if (env)
+  {
+    long long val = strtoll(env, NULL, 0);
+    if (val > 0)
+      want = val;
+  }
+  while (size < want && size < MAX_RING_SIZE)
+    size <<= 1;
+  return size;
+}
+
+/// Create the shared rings of a new client and hand them over on sock.
+static int shm_create(io_shm_t *s, int sock)
+{
+  const uint64_t size = get_ring_size();
+  int fds[1 + BELLS];
+  int i, ok;
+  s->hdr = NULL;
+  s->size = size;
+  s->mask = size - 1;
+  s->map_len = sizeof(shm_header_t) + 2 * size;
+  s->side = SERVER;
+  s->sock = sock;
+  fds[0] = memfd_create("mdsip-shm", MFD_CLOEXEC);
+  ok = fds[0] >= 0;
+  for (i = 0; i < BELLS; i++)
+    ok &= (s->bell[i] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) >= 0;
+  if (!ok || ftruncate(fds[0], s->map_len) ||
+      (s->hdr = mmap(NULL, s->map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fds[0], 0)) == MAP_FAILED)
+  {
+    perror("Error creating shared memory for client");
+    s->hdr = NULL;
+    goto error;
+  }
+  s->hdr->magic = SHM_MAGIC;
+  s->hdr->size = size;
+  memcpy(fds + 1, s->bell, sizeof(s->bell));
+  char cbuf[CMSG_SPACE(sizeof(fds))];
+  memset(cbuf, 0, sizeof(cbuf));
+  struct iovec iov = {(void *)&size, sizeof(size)};
+  struct msghdr msg = {0};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cbuf;
+  msg.msg_controllen = sizeof(cbuf);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  if (sendmsg(sock, &msg, MSG_NOSIGNAL) != sizeof(size))
+  {
+    perror("Error sending shared memory to client");
+    goto error;
+  }
+  close(fds[0]);
+  return C_OK;
+error:
+  if (fds[0] >= 0)
+    close(fds[0]);
+  shm_close(s);
+  return C_ERROR;
+}
+
+/// The peer is on this host, so the username it claims must be the one of
+/// the uid the kernel reports for its end of the socket.
+static int io_authorize(Connection *c, char *username)
+{
+  io_shm_t *s = get_shm(c);
+  struct ucred cred = {0, 0, 0};
+  socklen_t len = sizeof(cred);
+  struct passwd pwd, *ppwd = NULL;
+  char pwbuf[1024];
+  char now[32];
+  if (!s || getsockopt(s->sock, SOL_SOCKET, SO_PEERCRED, &cred, &len))
+    return ACCESS_DENIED;
+  Now32(now);
+  fprintf(stdout,
+          "%s (pid %d) Connection received from %s@localhost (pid %d, uid %d)\r\n",
+          now, getpid(), username, (int)cred.pid, (int)cred.uid);
+  fflush(stdout);
+  if (getpwuid_r(cred.uid, &pwd, pwbuf, sizeof(pwbuf), &ppwd) || !ppwd ||
+      strcmp(ppwd->pw_name, username))
+  {
+    fprintf(stderr, "shm peer uid %d is not user %s\n", (int)cred.uid,
+            username);
+    return ACCESS_DENIED;
+  }
+  char *matchString[2];
+  matchString[0] = strcat(strcpy(malloc(strlen(username) + 16), username),
+                          "@127.0.0.1");
+  matchString[1] = strcat(strcpy(malloc(strlen(username) + 16), username),
+                          "@localhost");
+  int ans = CheckClient(username, 2, matchString);
+  free(matchString[0]);
+  free(matchString[1]);
+  return ans;
+}
+
+static void *client_thread(void *arg)
+{
+  Connection *connection = (Connection *)arg;
+  pthread_cleanup_push((void *)destroyConnection, (void *)connection);
+  int status;
+  do
+    status = ConnectionDoMessage(connection);
+  while (STATUS_OK);
+  pthread_cleanup_pop(1);
+  return NULL;
+}
+
+static int io_listen(int argc, char **argv)
+{
+  Options options[] = {{"p", "port", 1, 0, 0}, {0, 0, 0, 0, 0}};
+  ParseCommand(argc, argv, options, 0, 0, 0);
+  if (options[0].present && options[0].value)
+    SetPortname(options[0].value);
+  else if (GetPortname() == 0)
+    SetPortname("mdsip");
+  struct sockaddr_un addr;
+  socklen_t addr_len = shm_address(&addr, GetPortname());
+  int ssock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (ssock < 0 || bind(ssock, (struct sockaddr *)&addr, addr_len) ||
+      listen(ssock, 128))
+  {
+    fprintf(stderr, "Error binding to shm://%s: %s\n", GetPortname(),
+            strerror(errno));
+    if (ssock >= 0)
+      close(ssock);
+    return C_ERROR;
+  }
+  for (;;)
+  {
+    int sock = accept4(ssock, NULL, NULL, SOCK_CLOEXEC);
+    if (sock < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      perror("Error accepting shm connection, shutting down");
+      break;
+    }
+    io_shm_t s;
+    if (shm_create(&s, sock) != C_OK)
+      continue;
+    int id;
+    if (IS_NOT_OK(AcceptConnection(PROTOCOL, PROTOCOL, sock, &s, sizeof(s),
+                                   &id, NULL)))
+      continue; // connection destroyed, io_disconnect released s
+    Connection *connection = PopConnection(id);
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 0x40000);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    const int err =
+        pthread_create(&thread, &attr, client_thread, (void *)connection);
+    pthread_attr_destroy(&attr);
+    if (err)
+    {
+      errno = err;
+      perror("dispatch_client");
+      destroyConnection(connection);
+    }
+  }
+  close(ssock);
+  return C_ERROR;
+}
+
+static IoRoutines shm_routines = {
+    io_connect, io_send, io_recv, NULL, io_listen,
+    io_authorize, NULL, io_disconnect, io_recv_to, NULL};
+
+#else /* __linux__ */
+
+static int io_connect(Connection *c __attribute__((unused)),
+                      char *protocol __attribute__((unused)),
+                      char *host __attribute__((unused)))
+{
+  fprintf(stderr, "The shm protocol is only available on Linux\n");
+  return C_ERROR;
+}
+
+static IoRoutines shm_routines = {io_connect, NULL, NULL, NULL, NULL,
+                                  NULL,       NULL, NULL, NULL, NULL};
+
+#endif /* __linux__ */
+
+EXPORT IoRoutines *Io() { return &shm_routines; }
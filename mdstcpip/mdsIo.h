@@ -43,7 +43,8 @@ typedef enum
 #define MDSIP_VERSION_DSC_ARGS 1
 #define MDSIP_VERSION_OPEN_ONE 2
 #define MDSIP_VERSION_DSC_ANS 3
-#define MDSIP_VERSION MDSIP_VERSION_DSC_ANS
+#define MDSIP_VERSION_CHUNKED 4
+#define MDSIP_VERSION MDSIP_VERSION_CHUNKED
 
 #define MAX_DIMS 8
 
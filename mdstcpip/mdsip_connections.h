@@ -83,6 +83,8 @@ typedef struct _connection
   mdsdsc_t *descrip[MDSIP_MAX_ARGS]; // list for message arguments
   MdsEventList *event;
   void *tdicontext[6];
+  void *dbid;  // private tree context when MDSIP_CONTEXT_POOL is set
+  int pooled;  // context leased from the pool
   int compression_level;
   SOCKET readfd;
   struct _io_routines *io;
@@ -194,6 +196,11 @@ typedef struct _io_routines
 #define CType(c) (c & 0x0f)
 #define IsCompressed(c) (c & COMPRESSED)
 
+// dtype of the header of a chunked answer (MDSIP_VERSION_CHUNKED): the real
+// dtype is held in descriptor_idx and the data follows as one or more
+// messages of ndims=1 holding dims[0] elements each
+#define DTYPE_CHUNKED 98
+
 // somewhat jScope only message->h.status
 #ifdef NOCOMPRESSION
 #define SUPPORTS_COMPRESSION 0
@@ -269,6 +276,21 @@ EXPORT char ClientType(void);
 EXPORT int CloseConnection(int conid);
 int destroyConnection(Connection *connection); // internal use
 
+// pool of tree and TDI contexts of closed connections, see ContextPool.c
+int ContextPoolSize();
+void ContextPoolLease(Connection *c);
+int ContextPoolReturn(Connection *c);
+
+// cache of answers to repeated expressions on closed pulses, see ResultCache.c
+typedef struct result_cache result_cache_t;
+result_cache_t *ResultCacheKey(Connection *c);
+result_cache_t *ResultCacheFind(result_cache_t *key);
+int ResultCacheBind(result_cache_t *key);
+int ResultCacheSend(Connection *c, result_cache_t *hit);
+void ResultCacheStore(result_cache_t *key, const Message *wire, int wire_len);
+void ResultCacheRelease(result_cache_t *e);
+EXPORT int IsPureExpression(const char *exp, int len);
+
 ////////////////////////////////////////////////////////////////////////////////
 ///
 /// \brief Remote mdsip server connection.
@@ -336,6 +358,9 @@ client_t GetConnectionClientType(int id);
 int MdsIpGetConnectionVersion(int id);
 
 extern void FlipData(Message *m);
+extern void FlipDataBytes(const MsgHdr *header, char *bytes);
+extern void ConvertBinary(int num, int sign_extend, short in_length,
+                          char *in_ptr, short out_length, char *out_ptr);
 extern void FlipHeader(MsgHdr *header);
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -398,6 +423,29 @@ EXPORT int GetAnswerInfoTO(int id, char *dtype, short *length, char *ndims,
                            int *dims, int *numbytes, void **dptr, void **m,
                            int timeout);
 
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Like GetAnswerInfoTO() but the answer data is received directly into a
+/// caller provided buffer. Chunked answers are written chunk by chunk as they
+/// arrive, so answers larger than 2GB can be received without an
+/// intermediate copy. If the buffer is too small the answer is discarded,
+/// numbytes is set to the required size and MDSplusERROR is returned.
+///
+/// \param id the id of the connection to use
+/// \param dtype pointer to store the descriptor dtype info
+/// \param length pointer to store the descriptor length
+/// \param ndims pointer to store the descriptor dimensions number
+/// \param dims pointer to store the descriptor dimensions
+/// \param buffer the memory to receive the descriptor data
+/// \param bufsize the size of buffer in bytes
+/// \param numbytes pointer to store the descriptor total number of bytes
+/// \param timeout timeout in milliseconds or -1 to wait forever
+/// \return the function returns the status held by the answered descriptor
+///
+EXPORT int GetAnswerInto(int id, char *dtype, short *length, char *ndims,
+                         int *dims, void *buffer, size_t bufsize,
+                         size_t *numbytes, int timeout);
+
 ////////////////////////////////////////////////////////////////////////////////
 ///
 /// Get current compression level
@@ -447,6 +495,8 @@ EXPORT Message *GetMdsMsg(int id, int *status);
 EXPORT Message *GetMdsMsgTO(int id, int *status, int timeout);
 EXPORT Message *GetMdsMsgOOB(int id, int *status);
 Message *GetMdsMsgTOC(Connection *c, int *status, int to_msec);
+int GetMdsChunksC(Connection *c, unsigned char message_id, char *buffer,
+                  uint64_t total, int to_msec);
 
 ////////////////////////////////////////////////////////////////////////////////
 ///
@@ -589,6 +639,22 @@ EXPORT int MdsSetDefault(int id, char *node);
 EXPORT int MdsValue(int id, char *exp, ...);
 EXPORT void MdsIpFree(void *ptr); // used to free ans.ptr returned by MdsValue
 
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Executes a TDI expression inside the server and receives the result
+/// directly into buffer, see GetAnswerInto(). On success ans_arg describes
+/// the result and ans_arg->ptr points to buffer.
+///
+/// \param id the id of the connection to use
+/// \param exp the TDI expression c string to be avaluated.
+/// \param buffer the memory to receive the result data
+/// \param bufsize the size of buffer in bytes
+/// \param ans_arg the descriptor filled with the result info
+/// \return the evaluation exit status of the expression.
+///
+EXPORT int MdsValueInto(int id, char *exp, void *buffer, size_t bufsize,
+                        struct descrip *ans_arg);
+
 EXPORT int NextConnection(void **ctx, char **info_name, void **info,
                           size_t *info_len);
 
@@ -657,6 +723,9 @@ EXPORT int SendDsc(int id, unsigned char idx, unsigned char nargs,
 ///
 EXPORT int SendMdsMsg(int id, Message *m, int msg_options);
 int SendMdsMsgC(Connection *c, Message *m, int msg_options);
+Message *EncodeMdsMsgC(Connection *c, Message *m, int *wire_len);
+int SendEncodedMdsMsgC(Connection *c, Message *wire, int wire_len,
+                       int msg_options);
 
 ////////////////////////////////////////////////////////////////////////////////
 ///
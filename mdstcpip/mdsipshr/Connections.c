@@ -297,6 +297,7 @@ int destroyConnection(Connection *connection)
         free(e->info);
       free(e);
     }
+    ContextPoolReturn(connection);
     TdiDeleteContext(connection->tdicontext);
     FreeDescriptors(connection);
   }
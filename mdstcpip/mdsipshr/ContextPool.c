@@ -0,0 +1,262 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*------------------------------------------------------------------------------
+
+                Name: ContextPool
+
+                Type:   C functions
+
+                Purpose: Reuse tree and TDI contexts of short-lived connections
+
+------------------------------------------------------------------------------
+
+        Description:
+
+   Clients that connect for a single request (web backends, scripts) pay
+   for opening the tree and compiling their functions on every connection.
+   With MDSIP_CONTEXT_POOL set to a positive number the server keeps up to
+   that many contexts of closed connections. A context is the private tree
+   database list (dbid) of the connection together with its private TDI
+   variables; on return the variables are released, except for compiled
+   FUN definitions, the default node and time context are reset and the
+   tree is left open.
+
+   A connection leases a context only if its first command is
+   TreeOpen(tree, shot) and the pool holds a context of the same user with
+   exactly that tree and shot open; shot 0 is resolved to the current shot
+   first. The TreeOpen of the client then finds the tree already open.
+   A context whose tree file was replaced or rewritten since the tree was
+   opened, e.g. by a new model or a re-created shot, is released instead.
+   Any other connection starts with a fresh context. The least recently
+   returned context is released when the pool is full. Contexts with more
+   than one tree open, or with a tree open for edit or modified, are never
+   pooled.
+
+------------------------------------------------------------------------------*/
+#include <mdsplus/mdsconfig.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dbidef.h>
+#include <mdsshr.h>
+#include <pthread_port.h>
+#include <status.h>
+#include <treeshr.h>
+#include "../mdsip_connections.h"
+
+//#define DEBUG
+#include <mdsmsg.h>
+
+extern int TdiCleanContext();
+extern int TdiDeleteContext();
+
+typedef struct pool_entry
+{
+  struct pool_entry *next;
+  char *user;
+  char tree[13];
+  int shot;
+  void *dbid;
+  void *tdicontext[6];
+} pool_entry_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pool_entry_t *pool = NULL; // most recently returned first
+static int pool_count = 0;
+static int pool_max = 0;
+
+static void pool_init()
+{
+  char *env = getenv("MDSIP_CONTEXT_POOL");
+  if (env)
+    pool_max = atoi(env);
+  if (pool_max < 0)
+    pool_max = 0;
+}
+
+int ContextPoolSize()
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, pool_init);
+  return pool_max;
+}
+
+static void entry_free(pool_entry_t *e)
+{
+  MDSDBG("releasing context of %s for %s/%d", e->user, e->tree, e->shot);
+  TreeFreeDbid(e->dbid);
+  TdiDeleteContext(e->tdicontext);
+  free(e->user);
+  free(e);
+}
+
+static int same_user(const pool_entry_t *e, const char *user)
+{
+  return user ? e->user && !strcmp(e->user, user) : !e->user;
+}
+
+/// Extract the tree and shot of a leading TreeOpen(tree, shot) command.
+static int first_tree(Connection *c, char *tree, int *shot)
+{
+  static const char cmd[] = "TREEOPEN(";
+  const mdsdsc_t *const exp = c->descrip[0];
+  if (c->nargs < 3 || !exp || exp->dtype != DTYPE_T ||
+      exp->length < sizeof(cmd) - 1)
+    return FALSE;
+  size_t i;
+  for (i = 0; i < sizeof(cmd) - 1; i++)
+    if (toupper(exp->pointer[i]) != cmd[i])
+      return FALSE;
+  const mdsdsc_t *const t = c->descrip[1], *const s = c->descrip[2];
+  if (!t || t->dtype != DTYPE_T || !t->length || t->length > 12 || !s ||
+      !s->pointer)
+    return FALSE;
+  switch (s->dtype)
+  {
+  case DTYPE_L:
+  case DTYPE_LU:
+    *shot = *(int *)s->pointer;
+    break;
+  case DTYPE_W:
+    *shot = *(int16_t *)s->pointer;
+    break;
+  case DTYPE_WU:
+    *shot = *(uint16_t *)s->pointer;
+    break;
+  default:
+    return FALSE;
+  }
+  for (i = 0; i < t->length; i++)
+    tree[i] = toupper(t->pointer[i]);
+  tree[i] = '\0';
+  return TRUE;
+}
+
+/// Attach a pooled context to a connection on its first command.
+void ContextPoolLease(Connection *c)
+{
+  char tree[13];
+  int shot = 0;
+  pool_entry_t *e, **pe, **found = NULL;
+  c->pooled = TRUE;
+  if (!first_tree(c, tree, &shot))
+    return;
+  if (shot == 0)
+    shot = TreeGetCurrentShotId(tree);
+  pthread_mutex_lock(&pool_lock);
+  for (pe = &pool; (e = *pe); pe = &e->next)
+  {
+    if (same_user(e, c->rm_user) && e->shot == shot && !strcmp(e->tree, tree))
+    {
+      found = pe;
+      break;
+    }
+  }
+  if (found)
+  {
+    e = *found;
+    *found = e->next;
+    pool_count--;
+  }
+  else
+    e = NULL;
+  pthread_mutex_unlock(&pool_lock);
+  if (!e)
+    return;
+  if (IS_OK(_TreeFilesChanged(e->dbid)))
+  { // a new model or a re-created shot, the open tree shows the old one
+    MDSDBG(CON_PRI " dropped stale context for %s/%d", CON_VAR(c), e->tree,
+           e->shot);
+    entry_free(e);
+    return;
+  }
+  MDSDBG(CON_PRI " leased context for %s/%d", CON_VAR(c), e->tree, e->shot);
+  c->dbid = e->dbid;
+  memcpy(c->tdicontext, e->tdicontext, 3 * sizeof(void *));
+  free(e->user);
+  free(e);
+}
+
+/// Park the context of a closing connection.
+/// Returns TRUE if the pool took the tree and TDI private contexts.
+int ContextPoolReturn(Connection *c)
+{
+  char tree[13] = {0};
+  int shot = 0, opened = 0;
+  char edit = 0, modified = 0;
+  DBI_ITM itmlst[] = {
+      {sizeof(tree) - 1, DbiNAME, tree, 0},
+      {sizeof(shot), DbiSHOTID, &shot, 0},
+      {sizeof(edit), DbiOPEN_FOR_EDIT, &edit, 0},
+      {sizeof(modified), DbiMODIFIED, &modified, 0},
+      {sizeof(opened), DbiNUMBER_OPENED, &opened, 0},
+      {0, 0, 0, 0},
+  };
+  if (!c->pooled)
+    return FALSE;
+  // the next client must not inherit what this one set up in its session
+  if (!c->dbid || IS_NOT_OK(_TreeGetDbi(c->dbid, itmlst)) || edit ||
+      modified || opened != 1 || !ContextPoolSize() ||
+      IS_NOT_OK(_TreeSetDefaultNid(c->dbid, 0)) ||
+      IS_NOT_OK(_TreeSetTimeContext(c->dbid, NULL, NULL, NULL)))
+  {
+    TreeFreeDbid(c->dbid);
+    c->dbid = NULL;
+    return FALSE;
+  }
+  char *cptr;
+  for (cptr = tree; *cptr && *cptr != ' '; cptr++)
+    ;
+  *cptr = '\0';
+  pool_entry_t *e = (pool_entry_t *)calloc(1, sizeof(pool_entry_t));
+  e->user = c->rm_user ? strdup(c->rm_user) : NULL;
+  strcpy(e->tree, tree);
+  e->shot = shot;
+  e->dbid = c->dbid;
+  memcpy(e->tdicontext, c->tdicontext, 3 * sizeof(void *));
+  TdiCleanContext(e->tdicontext);
+  c->dbid = NULL;
+  memset(c->tdicontext, 0, 3 * sizeof(void *));
+  pool_entry_t *evict = NULL;
+  pthread_mutex_lock(&pool_lock);
+  e->next = pool;
+  pool = e;
+  if (++pool_count > pool_max)
+  {
+    pool_entry_t **pe;
+    for (pe = &pool; (*pe)->next; pe = &(*pe)->next)
+      ;
+    evict = *pe;
+    *pe = NULL;
+    pool_count--;
+  }
+  pthread_mutex_unlock(&pool_lock);
+  MDSDBG(CON_PRI " returned context for %s/%d", CON_VAR(c), e->tree, e->shot);
+  if (evict)
+    entry_free(evict);
+  return TRUE;
+}
@@ -26,35 +26,134 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifdef DEBUG
 #include <stdio.h>
 #endif
+#include <stdint.h>
+#include <string.h>
 #include "../mdsip_connections.h"
 
-void FlipData(Message *m)
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+// Reverse the bytes of each 2, 4, 8 or 16 byte element of a vector.
+
+static inline __m128i swap16(__m128i v)
+{
+  return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i swap32(__m128i v)
+{
+  v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+  v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+  return swap16(v);
+}
+
+static inline __m128i swap64(__m128i v)
+{
+  v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+  v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+  return swap16(v);
+}
+
+static inline __m128i swap128(__m128i v)
+{
+  return swap64(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+#define FLIP_VECTORS(swap)                         \
+  for (; i + 16 <= nbytes; i += 16)                \
+  {                                                \
+    __m128i *const p = (__m128i *)(ptr + i);       \
+    _mm_storeu_si128(p, swap(_mm_loadu_si128(p))); \
+  }
+#endif
+
+/// Byte swap num elements of length bytes at ptr in place.
+static void flip_array(int length, char *ptr, int num)
+{
+  const size_t nbytes = (size_t)num * length;
+  size_t i = 0;
+#ifdef __SSE2__
+  switch (length)
+  {
+  case 2:
+    FLIP_VECTORS(swap16);
+    break;
+  case 4:
+    FLIP_VECTORS(swap32);
+    break;
+  case 8:
+    FLIP_VECTORS(swap64);
+    break;
+  case 16:
+    FLIP_VECTORS(swap128);
+    break;
+  }
+#endif
+  switch (length)
+  {
+#ifdef __GNUC__
+  case 2:
+    for (; i < nbytes; i += 2)
+    {
+      uint16_t v;
+      memcpy(&v, ptr + i, 2);
+      v = __builtin_bswap16(v);
+      memcpy(ptr + i, &v, 2);
+    }
+    break;
+  case 4:
+    for (; i < nbytes; i += 4)
+    {
+      uint32_t v;
+      memcpy(&v, ptr + i, 4);
+      v = __builtin_bswap32(v);
+      memcpy(ptr + i, &v, 4);
+    }
+    break;
+  case 8:
+    for (; i < nbytes; i += 8)
+    {
+      uint64_t v;
+      memcpy(&v, ptr + i, 8);
+      v = __builtin_bswap64(v);
+      memcpy(ptr + i, &v, 8);
+    }
+    break;
+#endif
+  default:
+    for (; i < nbytes; i += length)
+      FlipBytes(length, ptr + i);
+    break;
+  }
+}
+
+void FlipData(Message *m) { FlipDataBytes(&m->h, m->bytes); }
+
+void FlipDataBytes(const MsgHdr *header, char *bytes)
 {
   int num = 1;
   int i;
-  char *ptr;
   int dims[MAX_DIMS];
   for (i = 0; i < MAX_DIMS; i++)
   {
 #ifdef __CRAY
-    dims[i] = i % 2 ? m->h.dims[i / 2] & 0xffffffff : m->h.dims[i / 2] >> 32;
+    dims[i] = i % 2 ? header->dims[i / 2] & 0xffffffff : header->dims[i / 2] >> 32;
 #else
-    dims[i] = m->h.dims[i];
+    dims[i] = header->dims[i];
 #endif
   }
-  if (m->h.ndims)
-    for (i = 0; i < m->h.ndims; i++)
+  if (header->ndims)
+    for (i = 0; i < header->ndims; i++)
       num *= dims[i];
 #ifdef DEBUG
   printf("num to flip = %d\n", num);
 #endif
-  switch (m->h.dtype)
+  switch (header->dtype)
   {
 #ifndef __CRAY
   case DTYPE_COMPLEX:
   case DTYPE_COMPLEX_DOUBLE:
-    for (i = 0, ptr = m->bytes; i < (num * 2); i++, ptr += m->h.length / 2)
-      FlipBytes(m->h.length / 2, ptr);
+    flip_array(header->length / 2, bytes, num * 2);
     break;
   case DTYPE_FLOAT:
   case DTYPE_DOUBLE:
@@ -65,8 +164,87 @@ void FlipData(Message *m)
   case DTYPE_SHORT:
   case DTYPE_ULONG:
   case DTYPE_LONG:
-    for (i = 0, ptr = m->bytes; i < num; i++, ptr += m->h.length)
-      FlipBytes(m->h.length, ptr);
+    flip_array(header->length, bytes, num);
     break;
   }
 }
+
+/// Copy num integers of in_length bytes to out_length bytes, sign extending
+/// or zero filling when they widen and keeping the low bytes when they
+/// narrow. Both sides are in the byte order of this machine.
+void ConvertBinary(int num, int sign_extend, short in_length, char *in_ptr,
+                   short out_length, char *out_ptr)
+{
+  int i = 0;
+  int j;
+#if defined(__SSE2__) && !defined(WORDS_BIGENDIAN)
+  const __m128i zero = _mm_setzero_si128();
+  if (in_length == 2 && (out_length == 4 || out_length == 8))
+  {
+    for (; i + 8 <= num; i += 8)
+    {
+      const __m128i v = _mm_loadu_si128((const __m128i *)(in_ptr + i * 2));
+      const __m128i s = sign_extend ? _mm_srai_epi16(v, 15) : zero;
+      const __m128i w[2] = {_mm_unpacklo_epi16(v, s), _mm_unpackhi_epi16(v, s)};
+      __m128i *const o = (__m128i *)(out_ptr + (size_t)i * out_length);
+      if (out_length == 4)
+      {
+        _mm_storeu_si128(o, w[0]);
+        _mm_storeu_si128(o + 1, w[1]);
+      }
+      else
+        for (j = 0; j < 2; j++)
+        {
+          const __m128i t = sign_extend ? _mm_srai_epi32(w[j], 31) : zero;
+          _mm_storeu_si128(o + 2 * j, _mm_unpacklo_epi32(w[j], t));
+          _mm_storeu_si128(o + 2 * j + 1, _mm_unpackhi_epi32(w[j], t));
+        }
+    }
+  }
+  else if (in_length == 4 && out_length == 8)
+  {
+    for (; i + 4 <= num; i += 4)
+    {
+      const __m128i v = _mm_loadu_si128((const __m128i *)(in_ptr + i * 4));
+      const __m128i s = sign_extend ? _mm_srai_epi32(v, 31) : zero;
+      __m128i *const o = (__m128i *)(out_ptr + (size_t)i * 8);
+      _mm_storeu_si128(o, _mm_unpacklo_epi32(v, s));
+      _mm_storeu_si128(o + 1, _mm_unpackhi_epi32(v, s));
+    }
+  }
+  else if (in_length == 4 && out_length == 2)
+  {
+    for (; i + 8 <= num; i += 8)
+    { // sign extending the low halves keeps packs from saturating
+      const __m128i *const p = (const __m128i *)(in_ptr + i * 4);
+      const __m128i a =
+          _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128(p), 16), 16);
+      const __m128i b =
+          _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128(p + 1), 16), 16);
+      _mm_storeu_si128((__m128i *)(out_ptr + i * 2), _mm_packs_epi32(a, b));
+    }
+  }
+  else if (in_length == 8 && out_length == 4)
+  {
+    for (; i + 4 <= num; i += 4)
+    {
+      const __m128i *const p = (const __m128i *)(in_ptr + (size_t)i * 8);
+      const __m128i a =
+          _mm_shuffle_epi32(_mm_loadu_si128(p), _MM_SHUFFLE(3, 1, 2, 0));
+      const __m128i b =
+          _mm_shuffle_epi32(_mm_loadu_si128(p + 1), _MM_SHUFFLE(3, 1, 2, 0));
+      _mm_storeu_si128((__m128i *)(out_ptr + i * 4), _mm_unpacklo_epi64(a, b));
+    }
+  }
+#endif
+  signed char *in_p = (signed char *)in_ptr + (size_t)i * in_length;
+  signed char *out_p = (signed char *)out_ptr + (size_t)i * out_length;
+  short min_len = out_length < in_length ? out_length : in_length;
+  for (; i < num; i++, in_p += in_length, out_p += out_length)
+  {
+    for (j = 0; j < min_len; j++)
+      out_p[j] = in_p[j];
+    for (; j < out_length; j++)
+      out_p[j] = sign_extend ? (in_p[min_len - 1] < 0 ? -1 : 0) : 0;
+  }
+}
@@ -26,8 +26,50 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdio.h>
 #endif
 #include "../mdsip_connections.h"
+#include <limits.h>
 #include <status.h>
 #include <stdlib.h>
+#include <string.h>
+
+// total number of data bytes announced by a DTYPE_CHUNKED answer header
+static uint64_t chunked_size(const MsgHdr *h)
+{
+  uint64_t size = (uint16_t)h->length;
+  int i;
+  for (i = 0; i < h->ndims && i < MAX_DIMS; i++)
+    size *= (uint32_t)h->dims[i];
+  return size;
+}
+
+// Reassembles a chunked answer into a single message for the callers that
+// expect one. Answers that do not fit an int sized message are discarded.
+// Returns NULL if the stream broke and the connection must be closed.
+static Message *get_chunked_answer(Connection *c, Message *m, int *status,
+                                   int timeout_msec)
+{
+  const uint64_t total = chunked_size(&m->h);
+  Message *a = NULL;
+  if (total <= INT_MAX - sizeof(MsgHdr))
+    a = realloc(m, sizeof(MsgHdr) + total);
+  if (a)
+    m = a;
+  *status = GetMdsChunksC(c, m->h.message_id, a ? a->bytes : NULL, total,
+                          timeout_msec);
+  if (*status == SsINTERNAL)
+  {
+    free(m);
+    return NULL;
+  }
+  if (!a)
+  {
+    *status = MDSplusERROR;
+    return m;
+  }
+  a->h.msglen = (int)(sizeof(MsgHdr) + total);
+  a->h.dtype = a->h.descriptor_idx;
+  a->h.descriptor_idx = 0;
+  return a;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 //  GetAnswerInfo  /////////////////////////////////////////////////////////////
@@ -68,6 +110,8 @@ int GetAnswerInfoTO(int id, char *dtype, short *length, char *ndims, int *dims,
   int i;
   Message *m;
   m = GetMdsMsgTOC(c, &status, timeout_msec);
+  if (m && STATUS_OK && m->h.dtype == DTYPE_CHUNKED)
+    m = get_chunked_answer(c, m, &status, timeout_msec);
   UnlockConnection(c);
   if (!m && status == SsINTERNAL)
   {
@@ -146,3 +190,49 @@ int GetAnswerInfoTO(int id, char *dtype, short *length, char *ndims, int *dims,
   *mout = m;
   return m->h.status;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+//  GetAnswerInto  /////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+int GetAnswerInto(int id, char *dtype, short *length, char *ndims, int *dims,
+                  void *buffer, size_t bufsize, size_t *numbytes,
+                  int timeout_msec)
+{
+  Connection *c = FindConnectionSending(id);
+  if (!c)
+    return MDSplusERROR;
+  INIT_STATUS;
+  int answer = MDSplusERROR;
+  int i;
+  *numbytes = 0;
+  Message *m = GetMdsMsgTOC(c, &status, timeout_msec);
+  if (m && STATUS_OK)
+  {
+    const int chunked = m->h.dtype == DTYPE_CHUNKED;
+    const uint64_t size =
+        chunked ? chunked_size(&m->h) : m->h.msglen - sizeof(MsgHdr);
+    const int fits = size <= bufsize;
+    *dtype = chunked ? m->h.descriptor_idx : m->h.dtype;
+    *length = m->h.length;
+    *ndims = m->h.ndims;
+    for (i = 0; i < MAX_DIMS; i++)
+      dims[i] = i < m->h.ndims ? m->h.dims[i] : 0;
+    *numbytes = (size_t)size;
+    if (chunked)
+      status = GetMdsChunksC(c, m->h.message_id, fits ? buffer : NULL, size,
+                             timeout_msec);
+    else if (fits)
+      memcpy(buffer, m->bytes, size);
+    if (fits)
+      answer = m->h.status;
+  }
+  free(m);
+  UnlockConnection(c);
+  if (status == SsINTERNAL)
+  {
+    CloseConnection(id);
+    return MDSplusERROR;
+  }
+  return STATUS_OK ? answer : status;
+}
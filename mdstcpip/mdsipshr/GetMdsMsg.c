@@ -25,6 +25,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../mdsip_connections.h"
 #include "../zlib/zlib.h"
 #include <errno.h>
+#include <inttypes.h>
 #include <pthread_port.h>
 #include <status.h>
 #include <stdio.h>
@@ -160,6 +161,86 @@ Message *GetMdsMsgTO(int id, int *status, int to_msec)
 
 Message *GetMdsMsg(int id, int *status) { return GetMdsMsgTO(id, status, -1); }
 
+////////////////////////////////////////////////////////////////////////////////
+//  GetMdsChunks  //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Receives the data messages that follow a DTYPE_CHUNKED answer header,
+// writing total bytes into buffer. Uncompressed chunks are received in place.
+// Every chunk must carry the message_id of the header.
+// If buffer is NULL the data is read and discarded to keep the connection in
+// sync. A broken or stalled stream cannot be resynchronized, so any failure
+// returns SsINTERNAL.
+int GetMdsChunksC(Connection *c, unsigned char message_id, char *buffer,
+                  uint64_t total, int to_msec)
+{
+  char *scratch = NULL;
+  size_t scratch_size = 0;
+  uint64_t received = 0;
+  int status = MDSplusSUCCESS;
+  while (received < total)
+  {
+    MsgHdr header;
+    status = get_bytes_to(c, (void *)&header, sizeof(MsgHdr), to_msec);
+    if (status != MDSplusSUCCESS)
+      break;
+    const int swap = Endian(header.client_type) != Endian(ClientType());
+    if (swap)
+      FlipHeader(&header);
+    const uint32_t msglen = (uint32_t)header.msglen;
+    const uint64_t dlen = (uint64_t)header.length * (uint32_t)header.dims[0];
+    const size_t wlen = msglen - sizeof(MsgHdr);
+    if (msglen < sizeof(MsgHdr) || header.message_id != message_id ||
+        header.ndims != 1 || dlen == 0 ||
+        dlen > total - received ||
+        (!IsCompressed(header.client_type) && wlen != dlen))
+    {
+      fprintf(stderr,
+              "\nGetMdsChunks shutdown connection %d: bad chunk header, "
+              "message_id=%d, length=%d, dims[0]=%d\n",
+              c->id, header.message_id, header.length, header.dims[0]);
+      status = SsINTERNAL;
+      break;
+    }
+    char *dst = buffer ? buffer + received : NULL;
+    if (dst && !IsCompressed(header.client_type))
+      status = get_bytes_to(c, dst, wlen, 1000);
+    else
+    {
+      if (wlen > scratch_size)
+      {
+        free(scratch);
+        scratch = malloc(wlen);
+        scratch_size = scratch ? wlen : 0;
+        if (!scratch)
+        {
+          status = SsINTERNAL;
+          break;
+        }
+      }
+      status = get_bytes_to(c, scratch, wlen, 1000);
+      if (status == MDSplusSUCCESS && dst)
+      {
+        unsigned long ulen = (unsigned long)dlen;
+        if (wlen < 4 ||
+            uncompress((unsigned char *)dst, &ulen,
+                       (unsigned char *)scratch + 4, wlen - 4) != Z_OK ||
+            ulen != dlen)
+          status = SsINTERNAL;
+      }
+    }
+    if (status != MDSplusSUCCESS)
+      break;
+    if (dst && swap)
+      FlipDataBytes(&header, dst);
+    received += dlen;
+  }
+  free(scratch);
+  MDSDBG(CON_PRI " received %" PRIu64 "/%" PRIu64 " chunked bytes",
+         CON_VAR(c), received, total);
+  return status == MDSplusSUCCESS ? status : SsINTERNAL;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //  GetMdsMsgOOB  //////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
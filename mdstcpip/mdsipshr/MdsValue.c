@@ -166,6 +166,24 @@ EXPORT int MdsValue(int id, char *expression, ...)
   return _MdsValue(id, nargs, arglist, arglist[nargs]);
 }
 
+EXPORT int MdsValueInto(int id, char *expression, void *buffer, size_t bufsize,
+                        struct descrip *ans_arg)
+{
+  int dim = 0;
+  int status = SendArg(id, 0, DTYPE_CSTRING, 1, strlen(expression), 0, &dim,
+                       expression);
+  if (STATUS_OK)
+  {
+    short len;
+    size_t numbytes;
+    status = GetAnswerInto(id, &ans_arg->dtype, &len, &ans_arg->ndims,
+                           ans_arg->dims, buffer, bufsize, &numbytes, -1);
+    ans_arg->length = len;
+  }
+  ans_arg->ptr = STATUS_OK ? buffer : NULL;
+  return status;
+}
+
 EXPORT int MdsValueDsc(int id, const char *expression, ...)
 {
   /**** NOTE: MDS_END_ARG terminated argument list expected ****/
@@ -64,9 +64,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 extern int TdiRestoreContext(void **);
 extern int TdiSaveContext(void **);
+extern int TdiSwapPrivateContext(void **);
 
 extern int CvtConvertFloat(void *invalue, uint32_t indtype, void *outvalue,
                            uint32_t outdtype, uint32_t options);
+extern int CvtConvertFloatArray(void const *invalues, uint32_t indtype,
+                                void *outvalues, uint32_t outdtype, int count);
 #define VAX_F DTYPE_F   /* VAX F     Floating point data    */
 #define VAX_D DTYPE_D   /* VAX D     Floating point data    */
 #define VAX_G DTYPE_G   /* VAX G     Floating point data    */
@@ -78,29 +81,19 @@ extern int CvtConvertFloat(void *invalue, uint32_t indtype, void *outvalue,
 #define CRAY 8          /* Cray      Floating point data    */
 #define IEEE_X 9        /* IEEE X    Floating point data    */
 
-static void convert_binary(int num, int sign_extend, short in_length,
-                           char *in_ptr, short out_length, char *out_ptr)
-{
-  int i;
-  int j;
-  signed char *in_p = (signed char *)in_ptr;
-  signed char *out_p = (signed char *)out_ptr;
-  short min_len = out_length < in_length ? out_length : in_length;
-  for (i = 0; i < num; i++, in_p += in_length, out_p += out_length)
-  {
-    for (j = 0; j < min_len; j++)
-      out_p[j] = in_p[j];
-    for (; j < out_length; j++)
-      out_p[j] = sign_extend ? (in_p[min_len - 1] < 0 ? -1 : 0) : 0;
-  }
-}
-
 static void convert_float(int num, int in_type, char in_length, char *in_ptr,
                           int out_type, char out_length, char *out_ptr)
 {
   int i;
   char *in_p;
   char *out_p;
+  if (in_type != CRAY && out_type != CRAY &&
+      in_length == ((in_type == VAX_F || in_type == IEEE_S) ? 4 : 8) &&
+      out_length == ((out_type == VAX_F || out_type == IEEE_S) ? 4 : 8))
+  { // packed arrays of the common types are converted in one call
+    CvtConvertFloatArray(in_ptr, in_type, out_ptr, out_type, num);
+    return;
+  }
   for (i = 0, in_p = in_ptr, out_p = out_ptr; i < num;
        i++, in_p += in_length, out_p += out_length)
   {
@@ -134,7 +127,7 @@ static void convert_float(int num, int in_type, char in_length, char *in_ptr,
   }
 }
 
-static inline uint32_t get_nbytes(uint16_t *length, uint32_t *num, int client_type, mdsdsc_t *d)
+static inline uint64_t get_nbytes(uint16_t *length, uint64_t *num, int client_type, mdsdsc_t *d)
 {
   if (CType(client_type) == CRAY_CLIENT)
   {
@@ -196,7 +189,7 @@ static inline uint32_t get_nbytes(uint16_t *length, uint32_t *num, int client_ty
   return (*num) * (*length);
 }
 
-static inline void convert_ieee(Message *m, int num, const mdsdsc_t *d, uint32_t nbytes)
+static inline void convert_ieee(Message *m, int num, const mdsdsc_t *d, size_t nbytes)
 {
   switch (d->dtype)
   {
@@ -252,18 +245,18 @@ static inline void convert_ieee(Message *m, int num, const mdsdsc_t *d, uint32_t
   }
 }
 
-static inline void convert_cray(Message *m, int num, const mdsdsc_t *d, uint32_t nbytes)
+static inline void convert_cray(Message *m, int num, const mdsdsc_t *d, size_t nbytes)
 {
   switch (d->dtype)
   {
   case DTYPE_USHORT:
   case DTYPE_ULONG:
-    convert_binary(num, 0, d->length, d->pointer, m->h.length, m->bytes);
+    ConvertBinary(num, 0, d->length, d->pointer, m->h.length, m->bytes);
     break;
   case DTYPE_SHORT:
   case DTYPE_LONG:
-    convert_binary(num, 1, (char)d->length, d->pointer, (char)m->h.length,
-                   m->bytes);
+    ConvertBinary(num, 1, (char)d->length, d->pointer, (char)m->h.length,
+                  m->bytes);
     break;
   case DTYPE_F:
     convert_float(num, VAX_F, (char)d->length, d->pointer, CRAY,
@@ -299,18 +292,18 @@ static inline void convert_cray(Message *m, int num, const mdsdsc_t *d, uint32_t
   }
 }
 
-static inline void convert_cray_ieee(Message *m, int num, const mdsdsc_t *d, uint32_t nbytes)
+static inline void convert_cray_ieee(Message *m, int num, const mdsdsc_t *d, size_t nbytes)
 {
   switch (d->dtype)
   {
   case DTYPE_USHORT:
   case DTYPE_ULONG:
-    convert_binary(num, 0, d->length, d->pointer, m->h.length, m->bytes);
+    ConvertBinary(num, 0, d->length, d->pointer, m->h.length, m->bytes);
     break;
   case DTYPE_SHORT:
   case DTYPE_LONG:
-    convert_binary(num, 1, (char)d->length, d->pointer, (char)m->h.length,
-                   m->bytes);
+    ConvertBinary(num, 1, (char)d->length, d->pointer, (char)m->h.length,
+                  m->bytes);
     break;
   case DTYPE_F:
     convert_float(num, VAX_F, (char)d->length, d->pointer, IEEE_S,
@@ -364,7 +357,7 @@ static inline void convert_cray_ieee(Message *m, int num, const mdsdsc_t *d, uin
   }
 }
 
-static inline void convert_vmsg(Message *m, int num, const mdsdsc_t *d, uint32_t nbytes)
+static inline void convert_vmsg(Message *m, int num, const mdsdsc_t *d, size_t nbytes)
 {
   switch (d->dtype)
   {
@@ -420,7 +413,7 @@ static inline void convert_vmsg(Message *m, int num, const mdsdsc_t *d, uint32_t
   }
 }
 
-static inline void convert_default(Message *m, int num, const mdsdsc_t *d, uint32_t nbytes)
+static inline void convert_default(Message *m, int num, const mdsdsc_t *d, size_t nbytes)
 {
   switch (d->dtype)
   {
@@ -476,13 +469,280 @@ static inline void convert_default(Message *m, int num, const mdsdsc_t *d, uint3
   }
 }
 
-static inline int _send_response(Connection *connection, Message *message, Message **message_out, int status, mdsdsc_t *d)
+static inline void convert_data(Message *m, int num, const mdsdsc_t *d, size_t nbytes, int client_type)
+{
+  switch (CType(client_type))
+  {
+  case IEEE_CLIENT:
+  case JAVA_CLIENT:
+    convert_ieee(m, num, d, nbytes);
+    break;
+  case CRAY_CLIENT:
+    convert_cray(m, num, d, nbytes);
+    break;
+  case CRAY_IEEE_CLIENT:
+    convert_cray_ieee(m, num, d, nbytes);
+    break;
+  case VMSG_CLIENT:
+    convert_vmsg(m, num, d, nbytes);
+    break;
+  default:
+    convert_default(m, num, d, nbytes);
+    break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Chunked answers  ///////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Clients that negotiated MDSIP_VERSION_CHUNKED receive array answers larger
+// than MDSIP_CHUNK_SIZE bytes (default 4MB, 0 disables) as a DTYPE_CHUNKED
+// header followed by element aligned data messages. This lifts the 2GB limit
+// of the int msglen and avoids a full copy of the answer. A producer thread
+// converts and compresses the next chunks while the current one is sent.
+
+#define CHUNK_DEPTH 2
+#define DEFAULT_CHUNK_SIZE (4 << 20)
+#define MAX_CHUNK_SIZE (1 << 30)
+
+static size_t chunk_size = DEFAULT_CHUNK_SIZE;
+
+static void chunk_size_init()
+{
+  char *env = getenv("MDSIP_CHUNK_SIZE");
+  if (env)
+  {
+    long size = atol(env);
+    chunk_size = size > 0 ? (size_t)size : 0;
+    if (chunk_size > MAX_CHUNK_SIZE) // a chunk must fit the int msglen
+      chunk_size = MAX_CHUNK_SIZE;
+  }
+}
+
+static size_t get_chunk_size()
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, chunk_size_init);
+  return chunk_size;
+}
+
+typedef struct
+{
+  Connection *connection;
+  const mdsdsc_t *d;
+  int serial;
+  int status;
+  uint16_t length;     // element length sent to the client
+  uint64_t num;        // number of elements
+  uint32_t per_chunk;  // elements per chunk
+  uint32_t nchunks;
+  char dtype;          // dtype after conversion, set with the first chunk
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  uint32_t produced;   // chunks encoded
+  uint32_t consumed;   // chunks sent
+  int abort;
+  int threaded;
+  pthread_t thread;
+  Message *wire[CHUNK_DEPTH];
+  int wire_len[CHUNK_DEPTH];
+} chunk_pipe_t;
+
+static Message *make_chunk(chunk_pipe_t *p, uint32_t idx, int *wire_len)
+{
+  const uint64_t first = (uint64_t)idx * p->per_chunk;
+  const uint32_t count =
+      p->num - first < p->per_chunk ? (uint32_t)(p->num - first) : p->per_chunk;
+  const size_t nbytes = (size_t)count * p->length;
+  Message *m = malloc(sizeof(MsgHdr) + nbytes);
+  memset(&m->h, 0, sizeof(MsgHdr));
+  m->h.msglen = sizeof(MsgHdr) + nbytes;
+  m->h.client_type = p->connection->client_type;
+  m->h.message_id = p->connection->message_id;
+  m->h.status = p->status;
+  m->h.length = p->length;
+  m->h.ndims = 1;
+  m->h.dims[0] = count;
+  if (p->serial)
+  {
+    m->h.dtype = DTYPE_SERIAL;
+    memcpy(m->bytes, p->d->pointer + first, nbytes);
+  }
+  else
+  {
+    const mdsdsc_t slice = {p->d->length, p->d->dtype, CLASS_S,
+                            p->d->pointer + first * p->d->length};
+    m->h.dtype = p->d->dtype;
+    convert_data(m, count, &slice, nbytes, p->connection->client_type);
+  }
+  if (idx == 0)
+    p->dtype = m->h.dtype;
+  Message *wire = EncodeMdsMsgC(p->connection, m, wire_len);
+  if (wire != m)
+    free(m);
+  return wire;
+}
+
+static void *chunk_producer(void *arg)
+{
+  chunk_pipe_t *p = (chunk_pipe_t *)arg;
+  uint32_t idx;
+  for (idx = 0; idx < p->nchunks; idx++)
+  {
+    pthread_mutex_lock(&p->mutex);
+    while (!p->abort && idx - p->consumed >= CHUNK_DEPTH)
+      pthread_cond_wait(&p->cond, &p->mutex);
+    const int abort = p->abort;
+    pthread_mutex_unlock(&p->mutex);
+    if (abort)
+      break;
+    int wire_len;
+    Message *wire = make_chunk(p, idx, &wire_len);
+    pthread_mutex_lock(&p->mutex);
+    p->wire[idx % CHUNK_DEPTH] = wire;
+    p->wire_len[idx % CHUNK_DEPTH] = wire_len;
+    p->produced = idx + 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+  }
+  return NULL;
+}
+
+static void chunk_pipe_cleanup(void *arg)
+{
+  chunk_pipe_t *p = (chunk_pipe_t *)arg;
+  if (p->threaded)
+  {
+    pthread_mutex_lock(&p->mutex);
+    p->abort = TRUE;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+    pthread_join(p->thread, NULL);
+  }
+  for (; p->consumed < p->produced; p->consumed++)
+    free(p->wire[p->consumed % CHUNK_DEPTH]);
+  pthread_cond_destroy(&p->cond);
+  pthread_mutex_destroy(&p->mutex);
+}
+
+// Can return non-MDSplus error code of SsINTERNAL because of SendMdsMsgC()
+static int send_chunked(Connection *connection, int status, const mdsdsc_t *d,
+                        int serial, uint16_t length, uint64_t num,
+                        const MsgHdr *info)
+{
+  chunk_pipe_t p;
+  memset(&p, 0, sizeof(p));
+  p.connection = connection;
+  p.d = d;
+  p.serial = serial;
+  p.status = status;
+  p.length = length;
+  p.num = num;
+  p.per_chunk = get_chunk_size() / length;
+  if (p.per_chunk == 0)
+    p.per_chunk = 1;
+  p.nchunks = (uint32_t)((num + p.per_chunk - 1) / p.per_chunk);
+  pthread_mutex_init(&p.mutex, NULL);
+  pthread_cond_init(&p.cond, NULL);
+  p.threaded = p.nchunks > 1 &&
+               pthread_create(&p.thread, NULL, chunk_producer, &p) == 0;
+  int send_status = MDSplusSUCCESS;
+  uint32_t idx;
+  pthread_cleanup_push(chunk_pipe_cleanup, &p);
+  for (idx = 0; idx < p.nchunks && send_status == MDSplusSUCCESS; idx++)
+  {
+    const int slot = idx % CHUNK_DEPTH;
+    if (p.threaded)
+    {
+      // a cancel in the wait returns with the mutex held, release it before
+      // chunk_pipe_cleanup takes it again
+      pthread_mutex_lock(&p.mutex);
+      pthread_cleanup_push((void *)pthread_mutex_unlock, &p.mutex);
+      while (p.produced <= idx)
+        pthread_cond_wait(&p.cond, &p.mutex);
+      pthread_cleanup_pop(1);
+    }
+    else
+    {
+      p.wire[slot] = make_chunk(&p, idx, &p.wire_len[slot]);
+      p.produced = idx + 1;
+    }
+    if (idx == 0)
+    {
+      Message header;
+      header.h = *info;
+      header.h.msglen = sizeof(MsgHdr);
+      header.h.client_type = connection->client_type;
+      header.h.message_id = connection->message_id;
+      header.h.status = status;
+      header.h.dtype = DTYPE_CHUNKED;
+      header.h.descriptor_idx = (unsigned char)p.dtype;
+      header.h.length = length;
+      send_status = SendMdsMsgC(connection, &header, 0);
+    }
+    if (send_status == MDSplusSUCCESS)
+      send_status =
+          SendEncodedMdsMsgC(connection, p.wire[slot], p.wire_len[slot], 0);
+    pthread_mutex_lock(&p.mutex);
+    free(p.wire[slot]);
+    p.consumed = idx + 1;
+    pthread_cond_broadcast(&p.cond);
+    pthread_mutex_unlock(&p.mutex);
+  }
+  pthread_cleanup_pop(1);
+  MDSDBG(CON_PRI " sent %" PRIu64 " elements in %u chunks",
+         CON_VAR(connection), num, p.nchunks);
+  return send_status;
+}
+
+static inline int _send_response(Connection *connection, Message *message, Message **message_out, int status, mdsdsc_t *d, result_cache_t *cache)
 {
   const int client_type = connection->client_type;
   const unsigned char message_id = connection->message_id;
   Message *m = NULL;
   int serial = STATUS_NOT_OK || (connection->descrip[0] && connection->descrip[0]->dtype == DTYPE_SERIAL);
   (void)message;
+  if (d->class == CLASS_A && connection->version >= MDSIP_VERSION_CHUNKED && get_chunk_size())
+  {
+    MsgHdr info;
+    uint16_t length;
+    uint64_t num;
+    uint64_t nbytes;
+    memset(&info, 0, sizeof(info));
+    info.ndims = 1;
+    if (serial && STATUS_OK)
+    {
+      length = 1;
+      num = nbytes = ((mdsdsc_a_t *)d)->arsize;
+    }
+    else
+    {
+      array_coeff *a = (array_coeff *)d;
+      uint64_t count = 1;
+      int i;
+      nbytes = get_nbytes(&length, &num, client_type, d);
+      if (a->aflags.coeff && a->dimct <= MAX_DIMS)
+      {
+        info.ndims = a->dimct;
+        for (i = 0; i < info.ndims; i++)
+          count *= (info.dims[i] = a->m[i]);
+      }
+      if (count != num)
+      { // announce a flat array if the shape does not match the data
+        info.ndims = 1;
+        for (i = 1; i < MAX_DIMS; i++)
+          info.dims[i] = 0;
+      }
+    }
+    if (info.ndims == 1)
+      info.dims[0] = (int)num;
+    if (nbytes > get_chunk_size())
+    {
+      *message_out = NULL;
+      return send_chunked(connection, status, d, serial && STATUS_OK, length, num, &info);
+    }
+  }
   if (serial && STATUS_OK && d->class == CLASS_A)
   {
     mdsdsc_a_t *array = (mdsdsc_a_t *)d;
@@ -501,8 +761,8 @@ static inline int _send_response(Connection *connection, Message *message, Messa
   else
   {
     uint16_t length;
-    uint32_t num;
-    uint32_t nbytes = get_nbytes(&length, &num, client_type, d);
+    uint64_t num;
+    uint64_t nbytes = get_nbytes(&length, &num, client_type, d);
     *message_out = m = malloc(sizeof(MsgHdr) + nbytes);
     memset(&m->h, 0, sizeof(MsgHdr));
     m->h.msglen = sizeof(MsgHdr) + nbytes;
@@ -528,35 +788,29 @@ static inline int _send_response(Connection *connection, Message *message, Messa
       for (i = m->h.ndims; i < MAX_DIMS; i++)
         m->h.dims[i] = 0;
     }
-    switch (CType(client_type))
-    {
-    case IEEE_CLIENT:
-    case JAVA_CLIENT:
-      convert_ieee(m, num, d, nbytes);
-      break;
-    case CRAY_CLIENT:
-      convert_cray(m, num, d, nbytes);
-      break;
-    case CRAY_IEEE_CLIENT:
-      convert_cray_ieee(m, num, d, nbytes);
-      break;
-    case VMSG_CLIENT:
-      convert_vmsg(m, num, d, nbytes);
-      break;
-    default:
-      convert_default(m, num, d, nbytes);
-      break;
-    }
+    convert_data(m, num, d, nbytes, client_type);
   }
-  return SendMdsMsgC(connection, m, 0);
+  if (!cache)
+    return SendMdsMsgC(connection, m, 0);
+  // same as SendMdsMsgC but keep the encoded answer for the result cache
+  if (connection->io && connection->io->flush)
+    connection->io->flush(connection);
+  int wire_len;
+  Message *wire = EncodeMdsMsgC(connection, m, &wire_len);
+  const int send_status = SendEncodedMdsMsgC(connection, wire, wire_len, 0);
+  if (send_status == MDSplusSUCCESS)
+    ResultCacheStore(cache, wire, wire_len);
+  if (wire != m)
+    free(wire);
+  return send_status;
 }
 
 /// returns true if message cleanup is handled
-static int send_response(Connection *connection, Message *message, const int status_in, mdsdsc_t *const d)
+static int send_response_cache(Connection *connection, Message *message, const int status_in, mdsdsc_t *const d, result_cache_t *cache)
 {
   int status;
   INIT_AND_FREE_ON_EXIT(Message *, m);
-  status = _send_response(connection, message, &m, status_in, d);
+  status = _send_response(connection, message, &m, status_in, d, cache);
   FREE_NOW(m);
   if (STATUS_NOT_OK)
     return FALSE; // no good close connection
@@ -564,6 +818,12 @@ static int send_response(Connection *connection, Message *message, const int sta
   return TRUE;
 }
 
+/// returns true if message cleanup is handled
+static int send_response(Connection *connection, Message *message, const int status_in, mdsdsc_t *const d)
+{
+  return send_response_cache(connection, message, status_in, d, NULL);
+}
+
 /// returns true if message cleanup is handled
 static int return_status(Connection *connection, Message *message, int status)
 {
@@ -637,32 +897,64 @@ typedef struct
   Connection *connection;
   mdsdsc_xd_t *xdp;
   int cs;
+  int pool;
+  int private_ctx;
+  void *dbid;
 } cleanup_command_t;
 
 static void cleanup_command(void *args)
 {
   cleanup_command_t *p = (cleanup_command_t *)args;
   MdsFree1Dx(p->xdp, NULL);
+  if (p->pool)
+  {
+    p->connection->dbid = TreeSwitchDbid(p->dbid);
+    TreeUsePrivateCtx(p->private_ctx);
+  }
   if (p->cs)
   {
     TdiSaveContext(p->connection->tdicontext);
     TdiRestoreContext(p->tdicontext);
   }
+  else if (p->pool)
+    TdiSwapPrivateContext(p->connection->tdicontext);
 }
 
-static inline int execute_command(Connection *connection, mdsdsc_xd_t *ans_xd)
+/// Evaluates the command of connection into ans_xd. If the result cache holds
+/// the answer, it is returned in hit instead. Otherwise key is set if the
+/// answer may be stored in the result cache.
+static inline int execute_command(Connection *connection, mdsdsc_xd_t *ans_xd,
+                                  result_cache_t **key, result_cache_t **hit)
 {
   int status;
   cleanup_command_t p;
   p.cs = !!GetContextSwitching();
+  p.pool = ContextPoolSize() > 0;
+  if (p.pool)
+  {
+    // the connection runs in its own tree context that may be pooled
+    if (!connection->pooled)
+      ContextPoolLease(connection);
+    p.private_ctx = TreeUsePrivateCtx(1);
+    p.dbid = TreeSwitchDbid(connection->dbid);
+  }
   if (p.cs)
   {
     TdiSaveContext(p.tdicontext);
     TdiRestoreContext(connection->tdicontext);
   }
+  else if (p.pool) // the public variables stay shared
+    TdiSwapPrivateContext(connection->tdicontext);
   p.connection = connection;
   EMPTYXD(xd);
   p.xdp = &xd;
+  *key = ResultCacheKey(connection);
+  *hit = *key ? ResultCacheFind(*key) : NULL;
+  if (*hit)
+  {
+    cleanup_command(&p);
+    return MDSplusSUCCESS;
+  }
   const int serialize_out = connection->descrip[0]->dtype == DTYPE_SERIAL;
   if (serialize_out)
   {
@@ -683,6 +975,11 @@ static inline int execute_command(Connection *connection, mdsdsc_xd_t *ans_xd)
     else
       status = TdiData(xd.pointer, ans_xd MDS_END_ARG);
   }
+  if (*key && (STATUS_NOT_OK || !ResultCacheBind(*key)))
+  {
+    ResultCacheRelease(*key);
+    *key = NULL;
+  }
   pthread_cleanup_pop(1);
   return status;
 }
@@ -807,11 +1104,23 @@ static int execute_message(Connection *connection, Message *message)
   else // NORMAL TDI COMMAND //
   {
     INIT_AND_FREEXD_ON_EXIT(ans_xd);
-    status = execute_command(connection, &ans_xd);
-    if (STATUS_NOT_OK)
-      GetErrorText(status, &ans_xd);
+    result_cache_t *key, *hit;
+    status = execute_command(connection, &ans_xd, &key, &hit);
     connection->compression_level = GetCompressionLevel();
-    freed_message = send_response(connection, message, status, ans_xd.pointer);
+    if (hit)
+    {
+      freed_message = ResultCacheSend(connection, hit) == MDSplusSUCCESS;
+      if (freed_message)
+        free(message);
+    }
+    else
+    {
+      if (STATUS_NOT_OK)
+        GetErrorText(status, &ans_xd);
+      freed_message =
+          send_response_cache(connection, message, status, ans_xd.pointer, key);
+    }
+    ResultCacheRelease(key);
     FREEXD_NOW(ans_xd);
   }
   FreeDescriptors(connection);
@@ -915,13 +1224,13 @@ static int standard_command(Connection *connection, Message *message)
         {
         case DTYPE_USHORT:
         case DTYPE_ULONG:
-          convert_binary(num, 0, message->h.length, message->bytes, d->length,
-                         d->pointer);
+          ConvertBinary(num, 0, message->h.length, message->bytes, d->length,
+                        d->pointer);
           break;
         case DTYPE_SHORT:
         case DTYPE_LONG:
-          convert_binary(num, 1, message->h.length, message->bytes, d->length,
-                         d->pointer);
+          ConvertBinary(num, 1, message->h.length, message->bytes, d->length,
+                        d->pointer);
           break;
         default:
           memcpy(d->pointer, message->bytes, dbytes);
@@ -933,13 +1242,13 @@ static int standard_command(Connection *connection, Message *message)
         {
         case DTYPE_USHORT:
         case DTYPE_ULONG:
-          convert_binary(num, 0, message->h.length, message->bytes, d->length,
-                         d->pointer);
+          ConvertBinary(num, 0, message->h.length, message->bytes, d->length,
+                        d->pointer);
           break;
         case DTYPE_SHORT:
         case DTYPE_LONG:
-          convert_binary(num, 1, message->h.length, message->bytes, d->length,
-                         d->pointer);
+          ConvertBinary(num, 1, message->h.length, message->bytes, d->length,
+                        d->pointer);
           break;
         case DTYPE_FLOAT:
           convert_float(num, CRAY, (char)message->h.length, message->bytes,
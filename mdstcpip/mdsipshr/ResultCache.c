@@ -0,0 +1,579 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*------------------------------------------------------------------------------
+
+                Name: ResultCache
+
+                Type:   C functions
+
+                Purpose: Reuse the answers of repeated expressions on closed shots
+
+------------------------------------------------------------------------------
+
+        Description:
+
+   Right after a shot many clients ask the server for the same signals of
+   the same pulse. With MDSIP_RESULT_CACHE set to a size (bytes, or with a
+   k, M or G suffix) the server keeps the encoded answers of such requests
+   and sends the stored bytes when the request comes again instead of
+   evaluating it. MDSIP_RESULT_CACHE_ENTRY limits the size of a single
+   answer (default an eighth of the cache); the least recently used
+   answers are dropped when the cache is full.
+
+   An answer is keyed by the open tree, shot and default node, the
+   expression text, the serialized arguments and everything that changes
+   the encoding of the reply (client type, compression, serialized output).
+   It is only stored for a pulse (shot > 0) of a local tree that is not
+   open for edit and has no time context, when the expression calls only
+   builtins known to depend on nothing but their arguments and the tree,
+   uses no variables, assignments, external calls or other trees, and when
+   the evaluation left the tree context as it was. The records of the
+   nodes it reads are trusted to be as well behaved.
+   With each answer the size and modification time of the tree,
+   characteristics and datafile of the tree and its open subtrees are kept;
+   a stored answer is only used while all of them are unchanged. Rows put
+   into preallocated segments leave the size as it is and may not move the
+   modification time within the resolution of the file system clock, so
+   answers are only stored when none of the files was modified during the
+   last MDSIP_RESULT_CACHE_SETTLE seconds (default 10): any later write then
+   shows as a new modification time.
+
+------------------------------------------------------------------------------*/
+#include <mdsplus/mdsconfig.h>
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <mdsshr.h>
+#include <pthread_port.h>
+#include <status.h>
+#include <treeshr.h>
+#include "../treeshr/treeshrp.h"
+#include "../mdsip_connections.h"
+
+//#define DEBUG
+#include <mdsmsg.h>
+
+#define CACHE_BUCKETS 1024
+
+typedef struct
+{
+  char *path;
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  time_t mtime;
+  long mtime_ns;
+} cache_file_t;
+
+struct result_cache
+{
+  struct result_cache *next; // in bucket
+  struct result_cache *newer;
+  struct result_cache *older;
+  int refs;
+  int cached;
+  uint64_t hash;
+  size_t key_len;
+  char *key;
+  int nfiles;
+  cache_file_t *files;
+  int wire_len;
+  Message *wire;
+};
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static result_cache_t *buckets[CACHE_BUCKETS];
+static result_cache_t *newest = NULL;
+static result_cache_t *oldest = NULL;
+static size_t cache_used = 0;
+static size_t cache_max = 0;
+static size_t entry_max = 0;
+static time_t settle_sec = 10;
+
+static size_t get_size(const char *env)
+{
+  char *end;
+  double size = strtod(env, &end);
+  switch (toupper(*end))
+  {
+  case 'G':
+    size *= 1024;
+    /* fall through */
+  case 'M':
+    size *= 1024;
+    /* fall through */
+  case 'K':
+    size *= 1024;
+  }
+  return size > 0 ? (size_t)size : 0;
+}
+
+static void cache_init()
+{
+  char *env = getenv("MDSIP_RESULT_CACHE");
+  if (env)
+    cache_max = get_size(env);
+  entry_max = cache_max / 8;
+  env = getenv("MDSIP_RESULT_CACHE_ENTRY");
+  if (env && cache_max)
+  {
+    entry_max = get_size(env);
+    if (entry_max > cache_max)
+      entry_max = cache_max;
+  }
+  env = getenv("MDSIP_RESULT_CACHE_SETTLE");
+  if (env)
+  {
+    const long val = strtol(env, NULL, 0);
+    settle_sec = val > 0 ? val : 0;
+  }
+}
+
+static size_t cache_size()
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, cache_init);
+  return cache_max;
+}
+
+static void entry_free(result_cache_t *e)
+{
+  int i;
+  for (i = 0; i < e->nfiles; i++)
+    free(e->files[i].path);
+  free(e->files);
+  free(e->key);
+  free(e->wire);
+  free(e);
+}
+
+static inline size_t entry_size(const result_cache_t *e)
+{
+  return sizeof(*e) + e->key_len + e->wire_len +
+         e->nfiles * (sizeof(cache_file_t) + 64);
+}
+
+/*------------------------------------------------------------------------------
+  Cacheable requests
+------------------------------------------------------------------------------*/
+
+/// TDI builtins known to depend only on their arguments and the tree,
+/// sorted; anything else called by name may be a user function
+static const char *const pure[] = {
+    "ABS", "ACOS", "ADJUSTL", "ADJUSTR", "AIMAG", "AINT", "ALL", "ANINT",
+    "ANY", "ARRAY", "ASIN", "ATAN", "ATAN2", "AXIS_OF", "BEGIN_OF",
+    "BUILD_DIM", "BUILD_RANGE", "BUILD_SIGNAL", "BUILD_WINDOW",
+    "BUILD_WITH_UNITS", "BYTE", "BYTE_UNSIGNED", "CEILING", "CMPLX", "CONCAT",
+    "CONJG", "COS", "COSH", "COUNT", "CVT", "DATA", "DATA_WITH_UNITS", "DBLE",
+    "DERIVATIVE", "DIM_OF", "D_FLOAT", "END_OF", "ERROR_OF", "EXP", "EXTRACT",
+    "FIRSTLOC", "FLOAT", "FLOOR", "FS_FLOAT", "FT_FLOAT", "F_FLOAT", "GETNCI",
+    "G_FLOAT", "HELP_OF", "IAND", "INT", "INTEGRAL", "IOR", "KIND", "LASTLOC",
+    "LBOUND", "LEN", "LEN_TRIM", "LOG", "LOG10", "LONG", "LONG_UNSIGNED",
+    "MAKE_DIM", "MAKE_RANGE", "MAKE_SIGNAL", "MAKE_WITH_UNITS", "MAX",
+    "MAXLOC", "MAXVAL", "MEAN", "MEDIAN", "MIN", "MINLOC", "MINVAL", "MOD",
+    "NINT", "PACK", "PRODUCT", "QUADWORD", "QUADWORD_UNSIGNED",
+    "QUALIFIERS_OF", "RAMP", "RAW_OF", "REAL", "REPLICATE", "RESHAPE", "RMS",
+    "SET_RANGE", "SHAPE", "SIGN", "SIN", "SINH", "SIZE", "SMOOTH", "SORT",
+    "SORTVAL", "SPREAD", "SQRT", "SQUARE", "STD_DEV", "SUBSCRIPT", "SUM",
+    "TAN", "TANH", "TEXT", "TRIM", "UBOUND", "UNITS", "UNITS_OF", "UPCASE",
+    "VALIDATION_OF", "VALUE_OF", "WINDOW_OF", "WORD", "WORD_UNSIGNED", "ZERO"};
+
+static int pure_name(const char *name, size_t len)
+{
+  char upper[32];
+  size_t i;
+  int lo = 0, hi = sizeof(pure) / sizeof(*pure) - 1;
+  if (len >= sizeof(upper))
+    return FALSE;
+  for (i = 0; i < len; i++)
+    upper[i] = toupper((unsigned char)name[i]);
+  upper[len] = '\0';
+  while (lo <= hi)
+  {
+    const int mid = (lo + hi) / 2, cmp = strcmp(upper, pure[mid]);
+    if (!cmp)
+      return TRUE;
+    if (cmp < 0)
+      hi = mid - 1;
+    else
+      lo = mid + 1;
+  }
+  return FALSE;
+}
+
+/// Only calls of pure builtins, nodes of the open tree and constants
+/// outside of strings: no variables, assignments, external calls (->) or
+/// references to other trees (::).
+static int pure_expression(const char *exp, size_t len)
+{
+  size_t i = 0;
+  while (i < len)
+  {
+    const unsigned char c = exp[i];
+    if (c == '"' || c == '\'')
+    {
+      for (i++; i < len && exp[i] != c; i++)
+        if (exp[i] == '\\')
+          i++;
+      i++;
+    }
+    else if (c == '_' || c == '$' || isalpha(c))
+    {
+      const size_t start = i;
+      size_t next;
+      for (i++; i < len && (isalnum((unsigned char)exp[i]) || exp[i] == '_' ||
+                            exp[i] == '$');
+           i++)
+        ;
+      for (next = i; next < len && isspace((unsigned char)exp[next]); next++)
+        ;
+      if (c == '_' ||
+          (next < len && exp[next] == '(' && !pure_name(exp + start, i - start)))
+        return FALSE;
+    }
+    else if (c == '=')
+    { // only ==, <=, >=, /= and != compare
+      if (i + 1 < len && exp[i + 1] == '=')
+        i += 2;
+      else if (i > 0 && strchr("<>/!", exp[i - 1]))
+        i++;
+      else
+        return FALSE;
+    }
+    else if ((c == '-' && i + 1 < len && exp[i + 1] == '>') ||
+             (c == ':' && i + 1 < len && exp[i + 1] == ':'))
+      return FALSE;
+    else
+      i++;
+  }
+  return TRUE;
+}
+
+/// Exported for the parallel GetMany of the C++ objects, which evaluates in
+/// other threads only what cannot see the private variables of the caller.
+EXPORT int IsPureExpression(const char *exp, int len)
+{
+  return exp && len >= 0 && pure_expression(exp, (size_t)len);
+}
+
+/// The open tree the answer depends on, or NULL if it is not a closed pulse.
+static PINO_DATABASE *cache_tree()
+{
+  PINO_DATABASE *dblist = (PINO_DATABASE *)TreeDbid();
+  if (!dblist || !dblist->open || dblist->open_for_edit || dblist->remote ||
+      dblist->shotid <= 0 || !dblist->main_treenam ||
+      dblist->timecontext.start.pointer || dblist->timecontext.end.pointer ||
+      dblist->timecontext.delta.pointer)
+    return NULL;
+  return dblist;
+}
+
+static void key_add(result_cache_t *e, const void *bytes, size_t len)
+{
+  e->key = realloc(e->key, e->key_len + len);
+  memcpy(e->key + e->key_len, bytes, len);
+  e->key_len += len;
+}
+
+static void key_add_tree(result_cache_t *e, PINO_DATABASE *dblist)
+{
+  int nid = 0;
+  _TreeGetDefaultNid(dblist, &nid);
+  key_add(e, dblist->main_treenam, strlen(dblist->main_treenam) + 1);
+  key_add(e, &dblist->shotid, sizeof(dblist->shotid));
+  key_add(e, &nid, sizeof(nid));
+}
+
+/// Build the key of the command held by c in the current tree context.
+/// \return NULL if the cache is off or the command is not cacheable
+result_cache_t *ResultCacheKey(Connection *c)
+{
+  if (!cache_size())
+    return NULL;
+  const mdsdsc_t *const exp = c->descrip[0];
+  if (!exp || (exp->dtype != DTYPE_T && exp->dtype != DTYPE_SERIAL) ||
+      !pure_expression(exp->pointer, exp->length))
+    return NULL;
+  PINO_DATABASE *dblist = cache_tree();
+  if (!dblist)
+    return NULL;
+  result_cache_t *e = calloc(1, sizeof(result_cache_t));
+  e->refs = 1;
+  const unsigned char encoding[4] = {(unsigned char)c->client_type,
+                                     (unsigned char)GetCompressionLevel(),
+                                     exp->dtype == DTYPE_SERIAL,
+                                     (unsigned char)c->nargs};
+  key_add(e, encoding, sizeof(encoding));
+  key_add_tree(e, dblist);
+  key_add(e, exp->pointer, exp->length);
+  int i;
+  for (i = 1; i < c->nargs; i++)
+  {
+    EMPTYXD(xd);
+    if (!c->descrip[i] || IS_NOT_OK(MdsSerializeDscOut(c->descrip[i], &xd)))
+    {
+      MdsFree1Dx(&xd, NULL);
+      entry_free(e);
+      return NULL;
+    }
+    const mdsdsc_a_t *const a = (mdsdsc_a_t *)xd.pointer;
+    const uint32_t len = a->arsize;
+    key_add(e, &len, sizeof(len));
+    key_add(e, a->pointer, len);
+    MdsFree1Dx(&xd, NULL);
+  }
+  uint64_t hash = 14695981039346656037ULL; // FNV-1a
+  size_t j;
+  for (j = 0; j < e->key_len; j++)
+    hash = (hash ^ (unsigned char)e->key[j]) * 1099511628211ULL;
+  e->hash = hash;
+  return e;
+}
+
+/*------------------------------------------------------------------------------
+  Pulse files
+------------------------------------------------------------------------------*/
+
+static int file_stat(cache_file_t *f)
+{
+  struct stat st;
+  if (stat(f->path, &st))
+    return FALSE;
+  f->dev = st.st_dev;
+  f->ino = st.st_ino;
+  f->size = st.st_size;
+  f->mtime = st.st_mtime;
+#ifdef __APPLE__
+  f->mtime_ns = st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+  f->mtime_ns = 0;
+#else
+  f->mtime_ns = st.st_mtim.tv_nsec;
+#endif
+  return TRUE;
+}
+
+static int file_unchanged(const cache_file_t *f)
+{
+  cache_file_t now = {f->path, 0, 0, 0, 0, 0};
+  return file_stat(&now) && now.dev == f->dev && now.ino == f->ino &&
+         now.size == f->size && now.mtime == f->mtime &&
+         now.mtime_ns == f->mtime_ns;
+}
+
+static int add_file(result_cache_t *e, const char *tree, const char *ext)
+{
+  const size_t baselen = strlen(tree) - sizeof("tree") + 1;
+  cache_file_t *f;
+  e->files = realloc(e->files, (e->nfiles + 1) * sizeof(cache_file_t));
+  f = &e->files[e->nfiles];
+  f->path = memcpy(malloc(baselen + strlen(ext) + 1), tree, baselen);
+  strcpy(f->path + baselen, ext);
+  e->nfiles++;
+  return file_stat(f);
+}
+
+/// Call after the evaluation, still in its tree context: records the pulse
+/// files of the answer.
+/// \return FALSE if the evaluation changed the tree context, the files
+///         cannot be checked or were modified too recently, the answer must
+///         not be stored then
+int ResultCacheBind(result_cache_t *e)
+{
+  PINO_DATABASE *dblist = cache_tree();
+  if (!dblist || (unsigned char)GetCompressionLevel() != (unsigned char)e->key[1])
+    return FALSE;
+  result_cache_t now;
+  memset(&now, 0, sizeof(now));
+  key_add_tree(&now, dblist);
+  const int same = now.key_len <= e->key_len - 4 &&
+                   !memcmp(now.key, e->key + 4, now.key_len);
+  free(now.key);
+  if (!same)
+    return FALSE;
+  TREE_INFO *info;
+  for (info = dblist->tree_info; info; info = info->next_info)
+  {
+    const size_t len = info->filespec ? strlen(info->filespec) : 0;
+    if (len < sizeof("tree") || strcmp(info->filespec + len - 4, "tree") ||
+        strstr(info->filespec, "::") || !add_file(e, info->filespec, "tree") ||
+        !add_file(e, info->filespec, "characteristics") ||
+        !add_file(e, info->filespec, "datafile"))
+      return FALSE;
+  }
+  const time_t settled = time(NULL) - settle_sec;
+  int i;
+  for (i = 0; i < e->nfiles; i++)
+    if (e->files[i].mtime >= settled)
+      return FALSE;
+  return e->nfiles > 0;
+}
+
+/*------------------------------------------------------------------------------
+  Cache
+------------------------------------------------------------------------------*/
+
+static void lru_unlink(result_cache_t *e)
+{
+  if (e->newer)
+    e->newer->older = e->older;
+  else
+    newest = e->older;
+  if (e->older)
+    e->older->newer = e->newer;
+  else
+    oldest = e->newer;
+  e->newer = e->older = NULL;
+}
+
+static void lru_push(result_cache_t *e)
+{
+  e->older = newest;
+  e->newer = NULL;
+  if (newest)
+    newest->newer = e;
+  else
+    oldest = e;
+  newest = e;
+}
+
+static void release(result_cache_t *e)
+{
+  if (--e->refs == 0)
+    entry_free(e);
+}
+
+/// remove e from the cache, called with cache_lock held
+static void evict(result_cache_t *e)
+{
+  result_cache_t **p;
+  for (p = &buckets[e->hash % CACHE_BUCKETS]; *p && *p != e; p = &(*p)->next)
+    ;
+  if (*p)
+    *p = e->next;
+  lru_unlink(e);
+  cache_used -= entry_size(e);
+  e->cached = FALSE;
+  release(e);
+}
+
+/// \return a reference to the stored answer for key if its pulse files are
+///         unchanged, NULL otherwise
+result_cache_t *ResultCacheFind(result_cache_t *key)
+{
+  result_cache_t *e;
+  pthread_mutex_lock(&cache_lock);
+  for (e = buckets[key->hash % CACHE_BUCKETS]; e; e = e->next)
+    if (e->hash == key->hash && e->key_len == key->key_len &&
+        !memcmp(e->key, key->key, key->key_len))
+      break;
+  if (e)
+    e->refs++;
+  pthread_mutex_unlock(&cache_lock);
+  if (!e)
+    return NULL;
+  int i;
+  for (i = 0; i < e->nfiles && file_unchanged(&e->files[i]); i++)
+    ;
+  pthread_mutex_lock(&cache_lock);
+  if (i < e->nfiles)
+  {
+    MDSDBG("pulse files changed, dropping %.*s", (int)(e->key_len - 4),
+           e->key + 4);
+    if (e->cached)
+      evict(e);
+    release(e);
+    e = NULL;
+  }
+  else if (e->cached)
+  {
+    lru_unlink(e);
+    lru_push(e);
+  }
+  pthread_mutex_unlock(&cache_lock);
+  return e;
+}
+
+/// Send the stored answer e as the reply to the current message of c and
+/// release the reference obtained by ResultCacheFind().
+int ResultCacheSend(Connection *c, result_cache_t *e)
+{
+  const int wire_len = e->wire_len;
+  Message *wire = memcpy(malloc(wire_len), e->wire, wire_len);
+  ResultCacheRelease(e);
+  wire->h.message_id = c->message_id;
+  if (c->io && c->io->flush)
+    c->io->flush(c);
+  const int status = SendEncodedMdsMsgC(c, wire, wire_len, 0);
+  free(wire);
+  return status;
+}
+
+/// Store the encoded answer wire for key, the caller keeps its reference.
+void ResultCacheStore(result_cache_t *key, const Message *wire, int wire_len)
+{
+  if (key->cached || key->wire || !key->nfiles)
+    return;
+  key->wire_len = wire_len;
+  if (entry_size(key) > entry_max)
+  {
+    key->wire_len = 0;
+    return;
+  }
+  key->wire = memcpy(malloc(wire_len), wire, wire_len);
+  pthread_mutex_lock(&cache_lock);
+  result_cache_t **p;
+  for (p = &buckets[key->hash % CACHE_BUCKETS]; *p; p = &(*p)->next)
+    if ((*p)->hash == key->hash && (*p)->key_len == key->key_len &&
+        !memcmp((*p)->key, key->key, key->key_len))
+    {
+      evict(*p); // a newer answer of a concurrent request
+      break;
+    }
+  while (oldest && cache_used + entry_size(key) > cache_max)
+    evict(oldest);
+  key->refs++;
+  key->cached = TRUE;
+  key->next = buckets[key->hash % CACHE_BUCKETS];
+  buckets[key->hash % CACHE_BUCKETS] = key;
+  lru_push(key);
+  cache_used += entry_size(key);
+  MDSDBG("stored %d bytes, cache uses %lu", wire_len, (unsigned long)cache_used);
+  pthread_mutex_unlock(&cache_lock);
+}
+
+void ResultCacheRelease(result_cache_t *e)
+{
+  if (!e)
+    return;
+  pthread_mutex_lock(&cache_lock);
+  release(e);
+  pthread_mutex_unlock(&cache_lock);
+}
@@ -75,13 +75,13 @@ static int send_bytes(Connection *c, void *buffer, size_t bytes_to_send, int opt
   return MDSplusSUCCESS;
 }
 
-// Can return non-MDSplus error code of SsINTERNAL because of send_bytes()
-int SendMdsMsgC(Connection *c, Message *m, int msg_options)
+// Puts m into wire format (byte order and compression). Returns either m
+// or a new compressed message that the caller must free.
+Message *EncodeMdsMsgC(Connection *c, Message *m, int *wire_len)
 {
   unsigned long len = m->h.msglen - sizeof(m->h);
   unsigned long clength = 0;
   Message *cm = 0;
-  int status;
   int do_swap = 0; /*Added to handle byte swapping with compression */
   if (len > 0 && c->compression_level > 0 &&
       m->h.client_type != SENDCAPABILITIES)
@@ -89,8 +89,6 @@ int SendMdsMsgC(Connection *c, Message *m, int msg_options)
     clength = len;
     cm = (Message *)malloc(m->h.msglen + 4);
   }
-  if (!msg_options && c && c->io && c->io->flush)
-    c->io->flush(c);
   if (m->h.client_type == SENDCAPABILITIES)
     m->h.status = c->compression_level;
   if ((m->h.client_type & SwapEndianOnServer) != 0)
@@ -116,11 +114,30 @@ int SendMdsMsgC(Connection *c, Message *m, int msg_options)
     MDSDBG(MESSAGE_PRI, MESSAGE_VAR(cm));
     if (do_swap)
       FlipBytes(4, (char *)&cm->h.msglen);
-    status = send_bytes(c, (char *)cm, msglen, msg_options);
+    *wire_len = msglen;
+    return cm;
   }
-  else
-    status = send_bytes(c, (char *)m, len + sizeof(MsgHdr), msg_options);
-  if (clength)
+  free(cm);
+  *wire_len = len + sizeof(MsgHdr);
+  return m;
+}
+
+// Can return non-MDSplus error code of SsINTERNAL because of send_bytes()
+int SendEncodedMdsMsgC(Connection *c, Message *wire, int wire_len,
+                       int msg_options)
+{
+  return send_bytes(c, (char *)wire, (uint32_t)wire_len, msg_options);
+}
+
+// Can return non-MDSplus error code of SsINTERNAL because of send_bytes()
+int SendMdsMsgC(Connection *c, Message *m, int msg_options)
+{
+  int wire_len;
+  if (!msg_options && c && c->io && c->io->flush)
+    c->io->flush(c);
+  Message *cm = EncodeMdsMsgC(c, m, &wire_len);
+  int status = send_bytes(c, (char *)cm, (uint32_t)wire_len, msg_options);
+  if (cm != m)
     free(cm);
   return status;
 }
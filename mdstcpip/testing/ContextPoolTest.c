@@ -0,0 +1,178 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <usagedef.h>
+
+#include "../mdsipshr/ContextPool.c"
+#include "testing.h"
+
+static const char *tree_name = "tree_test";
+
+/* a connection whose first command is expression with tree and shot */
+static void init_connection(Connection *c, const char *expression, int *shot)
+{
+  static mdsdsc_t exp_d = {0, DTYPE_T, CLASS_S, 0};
+  static mdsdsc_t tree_d = {0, DTYPE_T, CLASS_S, 0};
+  static mdsdsc_t shot_d = {sizeof(int), DTYPE_L, CLASS_S, 0};
+  memset(c, 0, sizeof(*c));
+  exp_d.length = strlen(expression);
+  exp_d.pointer = (char *)expression;
+  tree_d.length = strlen(tree_name);
+  tree_d.pointer = (char *)tree_name;
+  shot_d.pointer = (char *)shot;
+  c->nargs = 3;
+  c->descrip[0] = &exp_d;
+  c->descrip[1] = &tree_d;
+  c->descrip[2] = &shot_d;
+}
+
+/* what a client does during its session */
+static void *open_session(int shot, int set_default)
+{
+  void *dbid = NULL;
+  int nid, status = _TreeOpen(&dbid, tree_name, shot, 0);
+  TEST1(STATUS_OK);
+  if (set_default)
+  {
+    status = _TreeFindNode(dbid, "A", &nid);
+    TEST1(STATUS_OK);
+    status = _TreeSetDefaultNid(dbid, nid);
+    TEST1(STATUS_OK);
+    DESCRIPTOR_LONG(start_d, &shot);
+    status = _TreeSetTimeContext(dbid, (mdsdsc_t *)&start_d, NULL, NULL);
+    TEST1(STATUS_OK);
+  }
+  return dbid;
+}
+
+static int lease(Connection *c, const char *expression, int shot)
+{
+  init_connection(c, expression, &shot);
+  ContextPoolLease(c);
+  return c->dbid != NULL;
+}
+
+static int park(Connection *c, void *dbid)
+{
+  c->pooled = TRUE;
+  c->dbid = dbid;
+  return ContextPoolReturn(c);
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Context Pool);
+
+  Connection c;
+  void *dbid = NULL;
+  int nid, shot, status;
+  memset(&c, 0, sizeof(c));
+  MdsPutEnv("tree_test_path=.");
+  MdsPutEnv("MDSIP_CONTEXT_POOL=2");
+  TEST1(ContextPoolSize() == 2);
+
+  for (shot = 1; shot <= 3; shot++)
+  {
+    status = _TreeOpenNew(&dbid, tree_name, shot);
+    TEST1(STATUS_OK);
+    status = _TreeAddNode(dbid, "A", &nid, TreeUSAGE_STRUCTURE);
+    TEST1(STATUS_OK);
+    status = _TreeWriteTree(&dbid, tree_name, shot);
+    TEST1(STATUS_OK);
+    status = _TreeClose(&dbid, tree_name, shot);
+    TEST1(STATUS_OK);
+  }
+  TreeFreeDbid(dbid);
+
+  // a parked context comes back with its session state reset //
+  void *first = open_session(1, TRUE);
+  TEST1(park(&c, first));
+  TEST1(lease(&c, "TreeOpen($,$)", 1));
+  TEST1(c.dbid == first);
+  status = _TreeGetDefaultNid(c.dbid, &nid);
+  TEST1(STATUS_OK && nid == 0);
+  EMPTYXD(start);
+  EMPTYXD(end);
+  EMPTYXD(delta);
+  status = _TreeGetTimeContext(c.dbid, &start, &end, &delta);
+  TEST1(STATUS_OK && !start.pointer && !end.pointer && !delta.pointer);
+  TEST1(park(&c, c.dbid));
+
+  // only a TreeOpen of exactly that tree and shot leases it //
+  TEST0(lease(&c, "1+1", 1));
+  TEST1(c.pooled);
+  TEST0(lease(&c, "TreeOpen($,$)", 2));
+  TEST1(lease(&c, "treeopen($,$)", 1));
+  TEST1(c.dbid == first);
+
+  // contexts in edit mode or with several trees open stay private //
+  dbid = NULL;
+  status = _TreeOpenEdit(&dbid, tree_name, 2);
+  TEST1(STATUS_OK);
+  TEST0(park(&c, dbid));
+  TEST1(c.dbid == NULL);
+  dbid = open_session(2, FALSE);
+  status = _TreeOpen(&dbid, tree_name, 3, 0);
+  TEST1(STATUS_OK);
+  TEST0(park(&c, dbid));
+  TEST0(lease(&c, "TreeOpen($,$)", 3));
+
+  // the least recently returned context is released when the pool is full //
+  TEST1(park(&c, first));
+  TEST1(park(&c, open_session(2, FALSE)));
+  TEST1(park(&c, open_session(3, FALSE)));
+  TEST0(lease(&c, "TreeOpen($,$)", 1));
+  TEST1(lease(&c, "TreeOpen($,$)", 2));
+  TreeFreeDbid(c.dbid);
+  TEST1(lease(&c, "TreeOpen($,$)", 3));
+  TreeFreeDbid(c.dbid);
+
+  // a context whose tree file was rewritten is released, not leased //
+  TEST1(park(&c, open_session(1, FALSE)));
+  dbid = NULL;
+  status = _TreeOpenNew(&dbid, tree_name, 1);
+  TEST1(STATUS_OK);
+  status = _TreeAddNode(dbid, "B", &nid, TreeUSAGE_STRUCTURE);
+  TEST1(STATUS_OK);
+  status = _TreeWriteTree(&dbid, tree_name, 1);
+  TEST1(STATUS_OK);
+  status = _TreeClose(&dbid, tree_name, 1);
+  TEST1(STATUS_OK);
+  TreeFreeDbid(dbid);
+  TEST0(lease(&c, "TreeOpen($,$)", 1));
+  TEST1(c.dbid == NULL);
+  TEST1(park(&c, open_session(1, FALSE)));
+  TEST1(lease(&c, "TreeOpen($,$)", 1));
+  status = _TreeFindNode(c.dbid, "B", &nid);
+  TEST1(STATUS_OK);
+  TreeFreeDbid(c.dbid);
+
+  END_TESTING;
+  return 0;
+}
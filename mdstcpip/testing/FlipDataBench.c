@@ -0,0 +1,140 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*
+ * Throughput of FlipDataBytes and ConvertBinary against bytewise loops,
+ * run with "make bench"; FlipDataTest checks that they agree.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "../mdsipshr/FlipData.c"
+
+#define THROUGHPUT_BYTES (64 << 20)
+
+static void ref_flip(int length, char *ptr, int num)
+{
+  int i;
+  for (i = 0; i < num; i++, ptr += length)
+    FlipBytes(length, ptr);
+}
+
+static void ref_convert(int num, int sign_extend, short in_length,
+                        char *in_ptr, short out_length, char *out_ptr)
+{
+  int i;
+  int j;
+  signed char *in_p = (signed char *)in_ptr;
+  signed char *out_p = (signed char *)out_ptr;
+  short min_len = out_length < in_length ? out_length : in_length;
+  for (i = 0; i < num; i++, in_p += in_length, out_p += out_length)
+  {
+    for (j = 0; j < min_len; j++)
+      out_p[j] = in_p[j];
+    for (; j < out_length; j++)
+      out_p[j] = sign_extend ? (in_p[min_len - 1] < 0 ? -1 : 0) : 0;
+  }
+}
+
+static double seconds()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1E-6;
+}
+
+static const struct
+{
+  char dtype;
+  int length;
+  const char *name;
+} flip_types[] = {
+    {DTYPE_SHORT, 2, "SHORT"},
+    {DTYPE_LONG, 4, "LONG"},
+    {DTYPE_FLOAT, 4, "FLOAT"},
+    {DTYPE_LONGLONG, 8, "LONGLONG"},
+    {DTYPE_DOUBLE, 8, "DOUBLE"},
+    {DTYPE_COMPLEX, 8, "COMPLEX"},
+    {DTYPE_COMPLEX_DOUBLE, 16, "COMPLEX_DOUBLE"},
+};
+#define NUM_FLIP_TYPES (int)(sizeof(flip_types) / sizeof(flip_types[0]))
+
+static const struct
+{
+  short in_length;
+  short out_length;
+} conversions[] = {{2, 4}, {2, 8}, {4, 8}, {4, 2}, {8, 4}, {1, 4}, {8, 2}};
+#define NUM_CONVERSIONS (int)(sizeof(conversions) / sizeof(conversions[0]))
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  char *in = malloc(THROUGHPUT_BYTES);
+  char *out = malloc(THROUGHPUT_BYTES);
+  int t, c;
+  size_t i;
+  double start, flip, scalar;
+  srand(0);
+  for (i = 0; i < THROUGHPUT_BYTES; i++)
+    in[i] = (char)rand();
+  for (t = 0; t < NUM_FLIP_TYPES; t++)
+  {
+    MsgHdr header;
+    const int length = flip_types[t].length;
+    const int num = THROUGHPUT_BYTES / length;
+    memset(&header, 0, sizeof(header));
+    header.dtype = flip_types[t].dtype;
+    header.length = length;
+    header.ndims = 1;
+    header.dims[0] = num;
+    start = seconds();
+    FlipDataBytes(&header, in);
+    flip = seconds() - start;
+    start = seconds();
+    ref_flip(length, in, num);
+    scalar = seconds() - start;
+    printf("FlipData %-14s %8.0f MB/s (bytewise %8.0f MB/s)\n",
+           flip_types[t].name, THROUGHPUT_BYTES / 1E6 / flip,
+           THROUGHPUT_BYTES / 1E6 / scalar);
+  }
+  for (c = 0; c < NUM_CONVERSIONS; c++)
+  {
+    const short in_length = conversions[c].in_length;
+    const short out_length = conversions[c].out_length;
+    const int num = THROUGHPUT_BYTES / 8;
+    start = seconds();
+    ConvertBinary(num, 1, in_length, in, out_length, out);
+    flip = seconds() - start;
+    start = seconds();
+    ref_convert(num, 1, in_length, in, out_length, out);
+    scalar = seconds() - start;
+    printf("ConvertBinary %d -> %d %8.0f Melem/s (bytewise %8.0f Melem/s)\n",
+           in_length, out_length, num / 1E6 / flip, num / 1E6 / scalar);
+  }
+  free(in);
+  free(out);
+  return 0;
+}
@@ -0,0 +1,165 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../mdsipshr/FlipData.c"
+#include "testing.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//  reference  /////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+#define MAX_NUM 1037
+#define MAX_LENGTH 16
+
+static void ref_flip(int length, char *ptr, int num)
+{
+  int i;
+  for (i = 0; i < num; i++, ptr += length)
+    FlipBytes(length, ptr);
+}
+
+static void ref_convert(int num, int sign_extend, short in_length,
+                        char *in_ptr, short out_length, char *out_ptr)
+{
+  int i;
+  int j;
+  signed char *in_p = (signed char *)in_ptr;
+  signed char *out_p = (signed char *)out_ptr;
+  short min_len = out_length < in_length ? out_length : in_length;
+  for (i = 0; i < num; i++, in_p += in_length, out_p += out_length)
+  {
+    for (j = 0; j < min_len; j++)
+      out_p[j] = in_p[j];
+    for (; j < out_length; j++)
+      out_p[j] = sign_extend ? (in_p[min_len - 1] < 0 ? -1 : 0) : 0;
+  }
+}
+
+static void fill(char *buf, size_t len)
+{
+  size_t i;
+  for (i = 0; i < len; i++)
+    buf[i] = (char)rand();
+}
+
+static const struct
+{
+  char dtype;
+  int length;
+} flip_types[] = {
+    {DTYPE_SHORT, 2},
+    {DTYPE_LONG, 4},
+    {DTYPE_FLOAT, 4},
+    {DTYPE_LONGLONG, 8},
+    {DTYPE_DOUBLE, 8},
+    {DTYPE_COMPLEX, 8},
+    {DTYPE_COMPLEX_DOUBLE, 16},
+};
+#define NUM_FLIP_TYPES (int)(sizeof(flip_types) / sizeof(flip_types[0]))
+
+static const struct
+{
+  short in_length;
+  short out_length;
+} conversions[] = {{2, 4}, {2, 8}, {4, 8}, {4, 2}, {8, 4}, {1, 4}, {8, 2}};
+#define NUM_CONVERSIONS (int)(sizeof(conversions) / sizeof(conversions[0]))
+
+////////////////////////////////////////////////////////////////////////////////
+//  tests  /////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+static void test_flip()
+{
+  BEGIN_TESTING(FlipDataBytes);
+  const size_t size = MAX_NUM * MAX_LENGTH + 16;
+  char *data = malloc(size);
+  char *ref = malloc(size);
+  int t, num, offset;
+  for (t = 0; t < NUM_FLIP_TYPES; t++)
+    for (num = 0; num <= MAX_NUM; num += num < 40 ? 1 : 97)
+      for (offset = 0; offset < 4; offset++)
+      {
+        MsgHdr header;
+        const int length = flip_types[t].length;
+        const int is_complex = flip_types[t].dtype == DTYPE_COMPLEX ||
+                               flip_types[t].dtype == DTYPE_COMPLEX_DOUBLE;
+        memset(&header, 0, sizeof(header));
+        header.dtype = flip_types[t].dtype;
+        header.length = length;
+        header.ndims = 1;
+        header.dims[0] = num;
+        fill(data, size);
+        memcpy(ref, data, size);
+        FlipDataBytes(&header, data + offset);
+        if (is_complex)
+          ref_flip(length / 2, ref + offset, num * 2);
+        else
+          ref_flip(length, ref + offset, num);
+        TEST0(memcmp(data, ref, size));
+      }
+  free(data);
+  free(ref);
+  END_TESTING;
+}
+
+static void test_convert()
+{
+  BEGIN_TESTING(ConvertBinary);
+  const size_t size = MAX_NUM * 8 + 16;
+  char *in = malloc(size);
+  char *out = malloc(size);
+  char *ref = malloc(size);
+  int c, num, offset, sign_extend;
+  for (c = 0; c < NUM_CONVERSIONS; c++)
+    for (sign_extend = 0; sign_extend < 2; sign_extend++)
+      for (num = 0; num <= MAX_NUM; num += num < 40 ? 1 : 97)
+        for (offset = 0; offset < 4; offset++)
+        {
+          fill(in, size);
+          memset(out, 0x5a, size);
+          memset(ref, 0x5a, size);
+          ConvertBinary(num, sign_extend, conversions[c].in_length,
+                        in + offset, conversions[c].out_length, out + offset);
+          ref_convert(num, sign_extend, conversions[c].in_length, in + offset,
+                      conversions[c].out_length, ref + offset);
+          TEST0(memcmp(out, ref, size));
+        }
+  free(in);
+  free(out);
+  free(ref);
+  END_TESTING;
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  srand(0);
+  test_flip();
+  test_convert();
+  return 0;
+}
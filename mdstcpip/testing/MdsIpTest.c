@@ -28,11 +28,16 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#endif
 
 #include <mdsshr.h>
 #include <mdsdescrip.h>
 #include <status.h>
 
+#include "../mdsIo.h"
 #include "../mdsip_connections.h"
 #include <mdsmsg.h>
 
@@ -136,6 +141,42 @@ static void test_descr(int c, char *expr, int argn, mdsdsc_t **argv, class_t cls
     test_descr(c, expr, 0, NULL, CLASS_S, DTYPE_##DT, sizeof(v), &v); \
   } while (0)
 
+// answers above this size are chunked by servers that support it
+#define TEST_CHUNK_SIZE "65536"
+
+static void test_array(int c, int rows, int cols)
+{
+  char expr[80];
+  const int num = rows * cols;
+  struct descrip ans = {0};
+  if (rows > 1)
+    sprintf(expr, "SET_RANGE(%d, %d, DATA(0 : %d))", rows, cols, num - 1);
+  else
+    sprintf(expr, "DATA(0 : %d)", num - 1);
+  int status = MdsValue(c, expr, &ans, NULL);
+  if (STATUS_NOT_OK)
+    TEST_FAIL("'%s' : STATUS = %d : %s\n", expr, status, MdsGetMsg(status));
+  else if (ans.ndims != (rows > 1 ? 2 : 1))
+    TEST_FAIL("'%s' : NDIMS %d\n", expr, ans.ndims);
+  else if (rows > 1 ? ans.dims[0] != rows || ans.dims[1] != cols
+                    : ans.dims[0] != num)
+    TEST_FAIL("'%s' : DIMS\n", expr);
+  else if (ans.dtype != DTYPE_L || ans.length != sizeof(int))
+    TEST_FAIL("'%s' : DTYPE %d\n", expr, ans.dtype);
+  else
+  {
+    const int *v = (const int *)ans.ptr;
+    int i;
+    for (i = 0; i < num && v[i] == i; i++)
+      ;
+    if (i < num)
+      TEST_FAIL("'%s' : VALUE at %d\n", expr, i);
+    else
+      TEST_PASS();
+  }
+  free(ans.ptr);
+}
+
 void testio(char server[])
 {
   fprintf(stdout, "Testing io with '%s'\n", server);
@@ -146,6 +187,10 @@ void testio(char server[])
   TEST_VALUE("0xffffffffLU", LU, uint32_t, -1);
   TEST_VALUE("-1W", W, short, -1);
   TEST_VALUE("-1B", B, char, -1);
+  // below and well above TEST_CHUNK_SIZE, flat and shaped //
+  test_array(c, 1, 10);
+  test_array(c, 1, 1 << 20);
+  test_array(c, 4, 1 << 18);
 }
 
 typedef struct
@@ -191,6 +236,43 @@ int start_mdsip(mdsip_t *mdsip, char *prot, int mode, char server[32], char *por
   return pthread_create(&mdsip->thread, NULL, (void *)mdsip_main, (void *)mdsip);
 }
 
+#ifndef _WIN32
+static pid_t old_pid = 0, old_parent = 0;
+
+static void stop_old_mdsip()
+{ // not from children forked by the local protocol
+  if (old_pid > 0 && getpid() == old_parent)
+  {
+    kill(old_pid, SIGTERM);
+    waitpid(old_pid, NULL, 0);
+    old_pid = 0;
+  }
+}
+
+// Serve from a child process that negotiates the protocol version just
+// below MDSIP_VERSION_CHUNKED, so its answers are never chunked. It must be
+// forked before this process has served anything.
+static void start_old_mdsip(char server[32], char *port)
+{
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    char version[12];
+    mdsip_t mdsip = {0, NULL, NULL, 0};
+    snprintf(version, sizeof(version), "%d", MDSIP_VERSION_CHUNKED - 1);
+    setenv("MDSIP_MAX_VERSION", version, 1);
+    if (!start_mdsip(&mdsip, "Tcp", MODE_SS, server, port))
+      pthread_join(mdsip.thread, NULL);
+    _exit(0);
+  }
+  sprintf(server, "localhost:%s", port);
+  old_pid = pid;
+  old_parent = getpid();
+  if (pid > 0)
+    atexit(stop_old_mdsip);
+}
+#endif
+
 int main(int argc, char **argv)
 {
   (void)test_value;
@@ -216,6 +298,12 @@ int main(int argc, char **argv)
     int port = 8001 + test_port_offset;
     char port_str[12];
     snprintf(port_str, sizeof(port_str), "%d", port);
+    setenv("MDSIP_CHUNK_SIZE", TEST_CHUNK_SIZE, 1);
+#ifndef _WIN32
+    char old_port_str[12], old_server[32] = "";
+    snprintf(old_port_str, sizeof(old_port_str), "%d", 8020 + test_port_offset);
+    start_old_mdsip(old_server, old_port_str);
+#endif
 
     testio("thread://0");
     testio("local://0");
@@ -233,6 +321,13 @@ int main(int argc, char **argv)
 #endif
     }
     free(mdsip.argv);
+#ifndef _WIN32
+    if (old_pid > 0)
+    {
+      testio(old_server);
+      stop_old_mdsip();
+    }
+#endif
   }
   return 0;
 }
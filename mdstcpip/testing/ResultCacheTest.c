@@ -0,0 +1,162 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <usagedef.h>
+
+#include "../mdsipshr/ResultCache.c"
+#include "testing.h"
+
+/* not exported by MdsIpShr, ResultCacheSend is not tested here */
+int SendEncodedMdsMsgC(Connection *c __attribute__((unused)),
+                       Message *wire __attribute__((unused)),
+                       int wire_len __attribute__((unused)),
+                       int msg_options __attribute__((unused)))
+{
+  return MDSplusERROR;
+}
+
+static const char *tree_name = "tree_test";
+static const int shot = 11;
+
+static int is_pure(const char *exp) { return pure_expression(exp, strlen(exp)); }
+
+static void test_pure_expression()
+{
+  TEST1(is_pure("DATA(\\TOP:IP)"));
+  TEST1(is_pure("dim_of (.SIG:A)[0 : 10] * 1E3"));
+  TEST1(is_pure("size(getnci('***', 'nid_number'))"));
+  TEST1(is_pure("A == 1 && B >= $PI"));
+  TEST1(is_pure("'MdsMisc->GetXY(_x=1)' // \"::\""));
+  TEST0(is_pure("_x"));
+  TEST0(is_pure("A = 1"));
+  TEST0(is_pure("MdsMisc->GetXYSignal(A)"));
+  TEST0(is_pure("USING(\\IP, \\TOP, 1, 'other')"));
+  TEST0(is_pure("DATA(\\OTHER::IP)"));
+  TEST0(is_pure("my_fun(A)"));
+  TEST0(is_pure("DATA(A) + random(10)"));
+  TEST0(is_pure("execute('1')"));
+}
+
+static result_cache_t *key_of(Connection *c)
+{
+  static mdsdsc_t exp_d = {0, DTYPE_T, CLASS_S, 0};
+  memset(c, 0, sizeof(*c));
+  exp_d.length = strlen("DATA(A)");
+  exp_d.pointer = "DATA(A)";
+  c->nargs = 1;
+  c->descrip[0] = &exp_d;
+  return ResultCacheKey(c);
+}
+
+/* pretend nothing touched the pulse files for an hour */
+static void age_files()
+{
+  static const char *const ext[] = {"tree", "characteristics", "datafile"};
+  struct timeval tv[2];
+  char path[64];
+  int i;
+  gettimeofday(&tv[0], NULL);
+  tv[0].tv_sec -= 3600;
+  tv[1] = tv[0];
+  for (i = 0; i < 3; i++)
+  {
+    sprintf(path, "%s_%03d.%s", tree_name, shot, ext[i]);
+    TEST0(utimes(path, tv));
+  }
+}
+
+static void put_row(int nid, int value)
+{
+  int64_t t = value;
+  DESCRIPTOR_LONG(row_d, &value);
+  int status = TreePutRow(nid, 10, &t, (mdsdsc_a_t *)&row_d);
+  TEST1(STATUS_OK);
+}
+
+static void test_bind()
+{
+  Connection c;
+  Message wire;
+  result_cache_t *key, *hit;
+  int nid, status, init[10] = {0};
+  DESCRIPTOR_A(init_d, sizeof(int), DTYPE_L, init, sizeof(init));
+  memset(&wire, 0, sizeof(wire));
+
+  status = TreeOpenNew(tree_name, shot);
+  TEST1(STATUS_OK);
+  status = TreeAddNode("A", &nid, TreeUSAGE_SIGNAL);
+  TEST1(STATUS_OK);
+  status = TreeWriteTree(tree_name, shot);
+  TEST1(STATUS_OK);
+  status = TreeClose(tree_name, shot);
+  TEST1(STATUS_OK);
+  status = TreeOpen(tree_name, shot, 0);
+  TEST1(STATUS_OK);
+  status = TreeBeginTimestampedSegment(nid, (mdsdsc_a_t *)&init_d, -1);
+  TEST1(STATUS_OK);
+  put_row(nid, 1);
+
+  // files that were just written may still change within their mtime //
+  key = key_of(&c);
+  TEST1(key != NULL);
+  TEST0(ResultCacheBind(key));
+  ResultCacheRelease(key);
+
+  age_files();
+  key = key_of(&c);
+  TEST1(ResultCacheBind(key));
+  ResultCacheStore(key, &wire, sizeof(wire));
+  ResultCacheRelease(key);
+  key = key_of(&c);
+  hit = ResultCacheFind(key);
+  TEST1(hit != NULL);
+  ResultCacheRelease(hit);
+  ResultCacheRelease(key);
+
+  // a row put in place into the preallocated segment drops the answer //
+  put_row(nid, 2);
+  key = key_of(&c);
+  TEST1(ResultCacheFind(key) == NULL);
+  ResultCacheRelease(key);
+
+  status = TreeClose(tree_name, shot);
+  TEST1(STATUS_OK);
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Result Cache);
+  MdsPutEnv("tree_test_path=.");
+  MdsPutEnv("MDSIP_RESULT_CACHE=1M");
+  test_pure_expression();
+  test_bind();
+  END_TESTING;
+  return 0;
+}
@@ -0,0 +1,201 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+// first, it defines _GNU_SOURCE
+#include "../io_routines/IoRoutinesShm.c"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testing.h"
+
+#ifdef __linux__
+
+#define MESSAGE_SIZE 100000
+
+static int listen_sock = -1;
+static io_shm_t server_shm;
+static int server_ok;
+
+/* server side of the handshake, io_listen without the dispatching */
+static void *accept_client(void *arg __attribute__((unused)))
+{
+  int sock = accept4(listen_sock, NULL, NULL, SOCK_CLOEXEC);
+  server_ok = sock >= 0 && shm_create(&server_shm, sock) == C_OK;
+  return NULL;
+}
+
+static int connect_pair(Connection *client, Connection *server,
+                        const char *name)
+{
+  struct sockaddr_un addr;
+  socklen_t addr_len = shm_address(&addr, name);
+  pthread_t thread;
+  int status;
+  memset(client, 0, sizeof(*client));
+  memset(server, 0, sizeof(*server));
+  listen_sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_sock < 0 || bind(listen_sock, (struct sockaddr *)&addr, addr_len) ||
+      listen(listen_sock, 1) ||
+      pthread_create(&thread, NULL, accept_client, NULL))
+    return 0;
+  status = io_connect(client, PROTOCOL, (char *)name);
+  pthread_join(thread, NULL);
+  close(listen_sock);
+  if (status != C_OK || !server_ok)
+    return 0;
+  ConnectionSetInfo(server, PROTOCOL, server_shm.sock, &server_shm,
+                    sizeof(server_shm));
+  return 1;
+}
+
+static void free_connection(Connection *c)
+{
+  io_disconnect(c);
+  free(c->info);
+  free(c->info_name);
+}
+
+typedef struct
+{
+  Connection *c;
+  char *buffer;
+  size_t len;
+} send_args_t;
+
+static void *send_thread(void *arg)
+{
+  send_args_t *args = (send_args_t *)arg;
+  size_t sent = 0;
+  while (sent < args->len)
+  {
+    ssize_t n = io_send(args->c, args->buffer + sent, args->len - sent, 0);
+    if (n <= 0)
+      break;
+    sent += n;
+  }
+  args->len = sent;
+  return NULL;
+}
+
+/* send a message much larger than the ring from one side to the other */
+static int round_trip(Connection *from, Connection *to)
+{
+  char *out = malloc(MESSAGE_SIZE), *in = malloc(MESSAGE_SIZE);
+  send_args_t args = {from, out, MESSAGE_SIZE};
+  pthread_t thread;
+  size_t got = 0;
+  int i, ok;
+  for (i = 0; i < MESSAGE_SIZE; i++)
+    out[i] = (char)(i * 7 + i / 251);
+  if (pthread_create(&thread, NULL, send_thread, &args))
+    return 0;
+  while (got < MESSAGE_SIZE)
+  {
+    ssize_t n = io_recv_to(to, in + got, MESSAGE_SIZE - got, 5000);
+    if (n <= 0)
+      break;
+    got += n;
+  }
+  pthread_join(thread, NULL);
+  ok = args.len == MESSAGE_SIZE && got == MESSAGE_SIZE &&
+       !memcmp(in, out, MESSAGE_SIZE);
+  free(out);
+  free(in);
+  return ok;
+}
+
+static void test_shm()
+{
+  Connection client, server;
+  char name[64], hostfile[64];
+  char buf[16];
+  struct passwd *pwd = getpwuid(getuid());
+  FILE *f;
+  sprintf(name, "ShmIoTest-%d", (int)getpid());
+  setenv("MDSIP_SHM_SIZE", "4096", 1);
+  TEST1(connect_pair(&client, &server, name));
+  io_shm_t *cs = get_shm(&client), *ss = get_shm(&server);
+  TEST1(cs && ss && cs->size == 4096 && ss->size == 4096);
+
+  // data wraps around the rings many times in both directions
+  TEST1(round_trip(&client, &server));
+  TEST1(round_trip(&server, &client));
+  TEST1(io_recv_to(&server, buf, sizeof(buf), 10) == -1);
+
+  // the size in the shared header is not trusted
+  cs->hdr->size = (uint64_t)1 << 40;
+  TEST1(round_trip(&client, &server));
+  TEST1(round_trip(&server, &client));
+  cs->hdr->size = 4096;
+
+  // counters moved by the peer cannot exceed the ring
+  shm_ring_t *r = &cs->hdr->ring[CLIENT];
+  const uint64_t head = r->head;
+  r->head = r->tail + 3 * 4096;
+  TEST1(ring_ready(ss, CLIENT, DATA) == 4096);
+  TEST1(ring_ready(cs, CLIENT, SPACE) == 0);
+  r->head = r->tail - 5;
+  TEST1(ring_ready(ss, CLIENT, DATA) == 0);
+  TEST1(ring_ready(cs, CLIENT, SPACE) == 4096);
+  r->head = head;
+
+  // the claimed user must be the owner of the peer process
+  sprintf(hostfile, "ShmIoTest-%d.hosts", (int)getpid());
+  f = fopen(hostfile, "w");
+  TEST1(f != NULL);
+  fputs("*|SELF\n", f);
+  fclose(f);
+  SetHostfile(hostfile);
+  TEST1(pwd != NULL);
+  if (pwd)
+  {
+    char *other = strcat(strcpy(malloc(strlen(pwd->pw_name) + 2), "x"),
+                         pwd->pw_name);
+    TEST1(io_authorize(&server, pwd->pw_name) == ACCESS_GRANTED);
+    TEST1(io_authorize(&server, other) == ACCESS_DENIED);
+    free(other);
+  }
+  remove(hostfile);
+
+  free_connection(&client);
+  free_connection(&server);
+}
+
+#endif /* __linux__ */
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Shm IoRoutines);
+#ifdef __linux__
+  test_shm();
+#else
+  SKIP_TEST("The shm protocol is only available on Linux");
+#endif
+  END_TESTING;
+  return 0;
+}
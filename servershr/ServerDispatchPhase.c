@@ -52,6 +52,18 @@ int SERVER$DISPATCH_PHASE(int efn, DispatchTable *table, struct descriptor
 
         Description:
 
+   Sequential actions are dispatched in groups of sequence numbers and a
+   group is only started once the previous one has completed. With
+   MDSPLUS_DISPATCH_GRAPH defined in the environment an action instead
+   only waits for the actions of the previous group on its own server,
+   and ready actions are dispatched longest remaining path first using
+   the durations measured in earlier phases. Conditional actions are
+   dispatched when the actions they reference complete.
+
+   After each phase the critical path, the longest chain of dependent
+   actions weighted by their execution time, is logged and kept in the
+   table for ServerGetCriticalPath.
+
 ------------------------------------------------------------------------------*/
 
 #include <mdsplus/mdsconfig.h>
@@ -97,6 +109,7 @@ static int check_actions_done(int s, int e);
 static void record_status(int s, int e);
 static void wait_for_actions(int conditionals, int first_g, int last_g,
                              int first_c, int last_c);
+static inline double now_seconds();
 
 typedef struct _send_monitor
 {
@@ -211,6 +224,7 @@ static void before(int idx)
       ActionInfo *actions = table->actions;
       char logmsg[1024];
       actions[idx].doing = 1;
+      actions[idx].started = now_seconds();
       send_monitor(MonitorDoing, idx);
       if (Output)
       {
@@ -423,6 +437,395 @@ static void wait_for_actions(int all, int first_g, int last_g,
   _CONDITION_UNLOCK(&JobWaitC);
 }
 
+static inline double now_seconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static inline double action_seconds(const ActionInfo *action)
+{
+  if (action->started > 0 && action->finished > action->started)
+    return action->finished - action->started;
+  return 0;
+}
+
+/// reset the timing of a range of actions before the phase is dispatched
+static void reset_actions(int s, int e, int graph)
+{
+  int i;
+  RDLOCK_TABLE;
+  if (table)
+  {
+    ActionInfo *actions = table->actions;
+    for (i = s; i < e; i++)
+    {
+      WRLOCK_ACTION(i, ra);
+      actions[i].started = actions[i].finished = 0;
+      if (graph)
+        actions[i].done = actions[i].dispatched = actions[i].doing = 0;
+      UNLOCK_ACTION(i, ra);
+    }
+  }
+  UNLOCK_TABLE;
+}
+
+/* Execution times of the actions of the last tree dispatched, used to
+ * estimate the remaining path of the actions of the next phases.
+ */
+#define HISTORY_SIZE 4096
+static struct
+{
+  int key; // nid + 1, 0 if free
+  float seconds;
+} history[HISTORY_SIZE];
+static char history_tree[13];
+static pthread_mutex_t history_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int history_find(int nid)
+{
+  unsigned int h = ((unsigned int)nid * 2654435761u) & (HISTORY_SIZE - 1);
+  int n;
+  for (n = 0; n < HISTORY_SIZE; n++, h = (h + 1) & (HISTORY_SIZE - 1))
+    if (history[h].key == nid + 1 || history[h].key == 0)
+      return h;
+  return -1;
+}
+
+/// estimated execution time of an action, 1 second if never measured
+static double history_get(int nid)
+{
+  double seconds = 1;
+  pthread_mutex_lock(&history_mutex);
+  if (strcmp(history_tree, table->tree) == 0)
+  {
+    int h = history_find(nid);
+    if (h >= 0 && history[h].key)
+      seconds = history[h].seconds;
+  }
+  pthread_mutex_unlock(&history_mutex);
+  return seconds;
+}
+
+static void history_put(int s, int e)
+{
+  int i;
+  ActionInfo *actions = table->actions;
+  pthread_mutex_lock(&history_mutex);
+  if (strcmp(history_tree, table->tree))
+  {
+    memset(history, 0, sizeof(history));
+    strcpy(history_tree, table->tree);
+  }
+  for (i = s; i < e; i++)
+  {
+    double seconds = action_seconds(&actions[i]);
+    int h;
+    if (seconds > 0 && (h = history_find(actions[i].nid)) >= 0)
+    {
+      history[h].key = actions[i].nid + 1;
+      history[h].seconds = (float)seconds;
+    }
+  }
+  pthread_mutex_unlock(&history_mutex);
+}
+
+/* Dependency graph of the sequential actions of a phase. Each action
+ * depends on the actions of the closest earlier sequence group that run
+ * on the same server. All actions of a group on a server share their
+ * predecessor list, so the lists are stored once in pool.
+ */
+typedef struct
+{
+  int num;
+  int *start; // first predecessor of each action in pool
+  int *count; // number of predecessors of each action
+  int *pool;  // predecessors, relative to first_s
+  double *rank; // estimated time from the start of the action to the end
+} graph_t;
+
+static void graph_free(graph_t *g)
+{
+  free(g->start);
+  free(g->count);
+  free(g->pool);
+  free(g->rank);
+  memset(g, 0, sizeof(*g));
+}
+
+static int graph_build(graph_t *g, int sync)
+{
+  int num = last_s - first_s;
+  if (num <= 0)
+    return B_FALSE;
+  int i, k, pool_len = 0, num_servers = 0;
+  int *server = malloc(num * sizeof(int));    // first action of each server
+  int *last = malloc(num * sizeof(int));      // last action of each server
+  int *group = malloc(num * sizeof(int));     // group of that action
+  int *pstart = malloc(num * sizeof(int));    // current predecessors
+  int *pcount = malloc(num * sizeof(int));
+  int *chain = malloc(num * sizeof(int));     // previous action on server
+  double *succ = calloc(num, sizeof(double)); // longest successor rank
+  g->num = num;
+  g->start = malloc(num * sizeof(int));
+  g->count = malloc(num * sizeof(int));
+  g->pool = malloc(num * sizeof(int));
+  g->rank = malloc(num * sizeof(double));
+  RDLOCK_TABLE;
+  if (table)
+  {
+    ActionInfo *actions = table->actions;
+    for (i = 0; i < num; i++)
+    {
+      ActionInfo *action = &actions[first_s + i];
+      int grp = action->sequence / sync;
+      int sv;
+      for (sv = 0; sv < num_servers; sv++)
+        if (!memcmp(actions[first_s + server[sv]].server, action->server,
+                    sizeof(action->server)))
+          break;
+      if (sv == num_servers)
+      {
+        server[sv] = i;
+        last[sv] = -1;
+        pstart[sv] = pcount[sv] = 0;
+        num_servers++;
+      }
+      else if (group[sv] != grp)
+      { // the group of the last action on this server is complete
+        pstart[sv] = pool_len;
+        for (k = last[sv];
+             k >= 0 && actions[first_s + k].sequence / sync == group[sv];
+             k = chain[k])
+          g->pool[pool_len++] = k;
+        pcount[sv] = pool_len - pstart[sv];
+      }
+      chain[i] = last[sv];
+      last[sv] = i;
+      group[sv] = grp;
+      g->start[i] = pstart[sv];
+      g->count[i] = pcount[sv];
+    }
+    for (i = num - 1; i >= 0; i--)
+    {
+      g->rank[i] = history_get(actions[first_s + i].nid) + succ[i];
+      for (k = 0; k < g->count[i]; k++)
+      {
+        int p = g->pool[g->start[i] + k];
+        if (succ[p] < g->rank[i])
+          succ[p] = g->rank[i];
+      }
+    }
+  }
+  else
+    num = 0;
+  UNLOCK_TABLE;
+  free(server);
+  free(last);
+  free(group);
+  free(pstart);
+  free(pcount);
+  free(chain);
+  free(succ);
+  if (!num)
+    graph_free(g);
+  return num > 0;
+}
+
+/// collect the actions whose predecessors have all completed
+static int graph_ready(const graph_t *g, int *ready, int *all_done)
+{
+  int i, k, num = 0;
+  *all_done = B_TRUE;
+  RDLOCK_TABLE;
+  if (table)
+  {
+    ActionInfo *actions = table->actions;
+    for (i = 0; i < g->num; i++)
+    {
+      RDLOCK_ACTION(first_s + i, gr);
+      int done = actions[first_s + i].done;
+      int waiting = !done && !actions[first_s + i].dispatched;
+      UNLOCK_ACTION(first_s + i, gr);
+      if (!done)
+        *all_done = B_FALSE;
+      if (!waiting)
+        continue;
+      for (k = 0; k < g->count[i]; k++)
+      {
+        int p = first_s + g->pool[g->start[i] + k];
+        RDLOCK_ACTION(p, grp);
+        done = actions[p].done;
+        UNLOCK_ACTION(p, grp);
+        if (!done)
+          break;
+      }
+      if (k == g->count[i])
+      { // keep ready sorted by decreasing rank
+        for (k = num++; k > 0 && g->rank[ready[k - 1]] < g->rank[i]; k--)
+          ready[k] = ready[k - 1];
+        ready[k] = i;
+      }
+    }
+  }
+  UNLOCK_TABLE;
+  return num;
+}
+
+static void dispatch_graph(const graph_t *g)
+{
+  int *ready = malloc(g->num * sizeof(int));
+  int all_done = B_FALSE;
+  int i, num;
+  while (!is_abort_in_progress())
+  {
+    num = graph_ready(g, ready, &all_done);
+    if (all_done)
+      break;
+    for (i = 0; i < num && !is_abort_in_progress(); i++)
+      dispatch(first_s + ready[i]);
+    if (num)
+      continue; // failed dispatches may have released other actions
+    _CONDITION_LOCK(&JobWaitC);
+    if (!graph_ready(g, ready, &all_done) && !all_done &&
+        !is_abort_in_progress())
+    {
+      struct timespec tp;
+      clock_gettime(CLOCK_REALTIME, &tp);
+      tp.tv_sec++;
+      pthread_cond_timedwait(&JobWaitC.cond, &JobWaitC.mutex, &tp);
+    }
+    _CONDITION_UNLOCK(&JobWaitC);
+  }
+  free(ready);
+}
+
+/* Compute the critical path of the phase from the measured execution
+ * times. Without a graph every action of a group depends on all actions
+ * of the previous group. Conditional actions depend on the actions they
+ * reference.
+ */
+static void critical_path(const graph_t *g, int sync, int first_c, int last_c,
+                          const char *phasenam, double elapsed)
+{
+  WRLOCK_TABLE;
+  if (table && table->num > 0)
+  {
+    ActionInfo *actions = table->actions;
+    int num = table->num;
+    double *length = calloc(num, sizeof(double));
+    int *from = malloc(num * sizeof(int));
+    int i, k, pass, changed;
+    int best = -1, group_best = -1, prev_best = -1, group = 0;
+    for (i = 0; i < num; i++)
+      from[i] = -1;
+    for (i = first_s; i < last_s; i++)
+    {
+      int pred = -1;
+      if (g)
+      {
+        for (k = 0; k < g->count[i - first_s]; k++)
+        {
+          int p = first_s + g->pool[g->start[i - first_s] + k];
+          if (pred < 0 || length[p] > length[pred])
+            pred = p;
+        }
+      }
+      else
+      {
+        int grp = actions[i].sequence / sync;
+        if (i == first_s || grp != group)
+        {
+          prev_best = group_best;
+          group_best = -1;
+          group = grp;
+        }
+        pred = prev_best;
+      }
+      from[i] = pred;
+      length[i] = action_seconds(&actions[i]) + (pred >= 0 ? length[pred] : 0);
+      if (group_best < 0 || length[i] > length[group_best])
+        group_best = i;
+    }
+    for (i = first_c; i < last_c; i++)
+      length[i] = action_seconds(&actions[i]);
+    for (pass = 0, changed = 1; changed && pass <= last_c - first_c; pass++)
+    {
+      changed = 0;
+      for (i = 0; i < num; i++)
+        for (k = 0; k < actions[i].num_references; k++)
+        {
+          int c = actions[i].referenced_by[k];
+          double l = action_seconds(&actions[c]) + length[i];
+          if (c >= first_c && c < last_c && l > length[c])
+          {
+            length[c] = l;
+            from[c] = i;
+            changed = 1;
+          }
+        }
+    }
+    for (i = first_c; i < last_c; i++)
+      if (best < 0 || length[i] > length[best])
+        best = i;
+    for (i = first_s; i < last_s; i++)
+      if (best < 0 || length[i] > length[best])
+        best = i;
+    free(table->critical_path);
+    table->critical_path = NULL;
+    table->critical_time = 0;
+    if (best >= 0)
+    {
+      int *path = malloc(num * sizeof(int));
+      int n = 0;
+      for (i = best; i >= 0 && n < num; i = from[i])
+        path[n++] = i;
+      size_t len = 256 + strlen(phasenam);
+      for (k = 0; k < n; k++)
+        len += strlen(actions[path[k]].path ? actions[path[k]].path : "") + 64;
+      char *msg = malloc(len);
+      char now[32];
+      char *p = msg + sprintf(msg, "%s, Critical path of phase %s is %.3f "
+                                   "seconds in %d actions, phase took %.3f "
+                                   "seconds",
+                              Now32(now), phasenam, length[best], n, elapsed);
+      while (n-- > 0)
+        p += sprintf(p, "\n    %s, %.3f seconds",
+                     actions[path[n]].path ? actions[path[n]].path : "",
+                     action_seconds(&actions[path[n]]));
+      table->critical_path = msg;
+      table->critical_time = length[best];
+      free(path);
+      MDSDBG("%s", msg);
+      if (Output)
+        (*Output)(msg);
+    }
+    history_put(first_s, last_s);
+    history_put(first_c, last_c);
+    free(length);
+    free(from);
+  }
+  UNLOCK_TABLE;
+}
+
+EXPORT char *ServerGetCriticalPath(void *vtable, double *seconds)
+{
+  // returns NULL if no phase was dispatched
+  char *path = NULL;
+  RDLOCK_TABLE;
+  if (vtable)
+  {
+    DispatchTable *table = (DispatchTable *)vtable;
+    if (seconds)
+      *seconds = table->critical_time;
+    if (table->critical_path)
+      path = strdup(table->critical_path);
+  }
+  UNLOCK_TABLE;
+  return path;
+}
+
 static char *detail_proc(int full)
 {
   char *msg;
@@ -520,23 +923,41 @@ EXPORT int ServerDispatchPhase(int *id __attribute__((unused)), void *vtable,
   ProgLoc = 6006;
   if (STATUS_OK && (phase > 0))
   {
+    graph_t graph = {0};
+    char *env = getenv("MDSPLUS_DISPATCH_GRAPH");
+    int use_graph = env && *env && *env != '0';
+    double started = now_seconds();
+    sync = (sync < 1) ? 1 : sync;
     set_monitor(monitor);
     ProgLoc = 6007;
     set_action_ranges(phase, &first_c, &last_c);
+    reset_actions(first_c, last_c, B_FALSE);
+    reset_actions(first_s, last_s, use_graph);
     ProgLoc = 6008;
     ServerSetDetailProc(detail_proc);
     ProgLoc = 6009;
-    first_g = first_s;
-    while (!is_abort_in_progress() && (first_g < last_s))
+    if (use_graph && graph_build(&graph, sync))
     {
       ProgLoc = 6010;
-      set_group(sync, first_g, &last_g);
-      ProgLoc = 6011;
-      for (i = first_g; i < last_g; i++)
-        dispatch(i);
-      ProgLoc = 6012;
-      wait_for_actions(0, first_g, last_g, first_c, last_c);
-      first_g = last_g;
+      dispatch_graph(&graph);
+      first_g = first_s;
+      last_g = last_s;
+    }
+    else
+    {
+      use_graph = B_FALSE;
+      first_g = first_s;
+      while (!is_abort_in_progress() && (first_g < last_s))
+      {
+        ProgLoc = 6010;
+        set_group(sync, first_g, &last_g);
+        ProgLoc = 6011;
+        for (i = first_g; i < last_g; i++)
+          dispatch(i);
+        ProgLoc = 6012;
+        wait_for_actions(0, first_g, last_g, first_c, last_c);
+        first_g = last_g;
+      }
     }
     ProgLoc = 6013;
     if (setAbortInProgress(0))
@@ -574,6 +995,9 @@ EXPORT int ServerDispatchPhase(int *id __attribute__((unused)), void *vtable,
     if (!noact)
       record_status(first_s, last_s);
     ProgLoc = 6018;
+    critical_path(use_graph ? &graph : NULL, sync, first_c, last_c, phasenam,
+                  now_seconds() - started);
+    graph_free(&graph);
   }
   ProgLoc = 6019;
   return status;
@@ -613,6 +1037,8 @@ static void dispatch(int i)
     actions[i].done = 0;
     actions[i].doing = 0;
     actions[i].dispatched = 0;
+    actions[i].started = now_seconds();
+    actions[i].finished = 0;
     if (Output)
     {
       char now[32];
@@ -676,6 +1102,7 @@ static void action_done_action_locked(int idx)
     (*Output)(logmsg);
   }
   actions[idx].done = 1;
+  actions[idx].finished = now_seconds();
   actions[idx].recorded = 0;
   EMPTYXD(xd);
   char expression[60];
@@ -977,6 +1404,7 @@ static inline void server_dispatch_table_free(void *vtable)
       free(actions[i].condition);
     }
   }
+  free(((DispatchTable *)vtable)->critical_path);
   free(vtable);
 }
 
@@ -155,6 +155,8 @@ typedef struct
   unsigned recorded : 1;
   char *path;
   char *event;
+  double started;  /* monotonic time the action began */
+  double finished; /* monotonic time the action completed */
   pthread_rwlock_t lock;
 } ActionInfo;
 
@@ -164,6 +166,8 @@ typedef struct
   char tree[13];
   int shot;
   int failed_essential;
+  double critical_time; /* critical path of the last dispatched phase */
+  char *critical_path;
   ActionInfo actions[1];
 } DispatchTable;
 
@@ -0,0 +1,146 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../ServerDispatchPhase.c"
+#include "testing.h"
+
+/* Five sequential actions on two servers and two conditional actions:
+
+     action  sequence  server  seconds  referenced by
+     A0      1         S1      1
+     A1      1         S2      3
+     A2      2         S1      2
+     A3      2         S2      1        C5
+     A4      3         S1      1.5
+     C5                        4        C6
+     C6                        0.5
+
+   With groups every action waits for the longest action of the previous
+   group, with the graph an action only waits for the actions of its
+   server in the previous group.
+*/
+#define NUM 7
+static const int sequence[NUM] = {1, 1, 2, 2, 3, 0, 0};
+static const double seconds[NUM] = {1, 3, 2, 1, 1.5, 4, 0.5};
+
+static DispatchTable *make_table()
+{
+  static int ref3 = 5, ref5 = 6;
+  static char *paths[NUM] = {"\\A0", "\\A1", "\\A2", "\\A3",
+                             "\\A4", "\\C5", "\\C6"};
+  DispatchTable *t =
+      calloc(1, sizeof(DispatchTable) + (NUM - 1) * sizeof(ActionInfo));
+  int i;
+  t->num = NUM;
+  strcpy(t->tree, "TEST");
+  for (i = 0; i < NUM; i++)
+  {
+    t->actions[i].nid = i + 1;
+    t->actions[i].sequence = sequence[i];
+    t->actions[i].path = paths[i];
+    t->actions[i].started = 10;
+    t->actions[i].finished = 10 + seconds[i];
+  }
+  t->actions[3].num_references = 1;
+  t->actions[3].referenced_by = &ref3;
+  t->actions[5].num_references = 1;
+  t->actions[5].referenced_by = &ref5;
+  return t;
+}
+
+/// path lines of the report, separated by ' '
+static void report_path(const char *report, char *out)
+{
+  const char *p;
+  *out = 0;
+  for (p = strchr(report, '\n'); p; p = strchr(p + 1, '\n'))
+  {
+    const char *end = strchr(p, ',');
+    if (*out)
+      strcat(out, " ");
+    strncat(out, p + 5, end - p - 5);
+  }
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(CriticalPath);
+  char path[256];
+  char *report;
+  double length;
+  table = make_table();
+  first_s = 0;
+  last_s = 5;
+
+  // groups, the conditionals follow A1 A3 //
+  critical_path(NULL, 1, 5, 7, "INIT", 9);
+  report = ServerGetCriticalPath(table, &length);
+  TEST1(report != NULL);
+  TEST1(length == 8.5);
+  TEST1(strstr(report, "phase INIT is 8.500 seconds in 4 actions") != NULL);
+  report_path(report, path);
+  TEST0(strcmp(path, "\\A1 \\A3 \\C5 \\C6"));
+  free(report);
+
+  // groups of two sequence numbers make one group //
+  critical_path(NULL, 2, 5, 5, "INIT", 9);
+  report = ServerGetCriticalPath(table, &length);
+  TEST1(length == 5);
+  report_path(report, path);
+  TEST0(strcmp(path, "\\A1 \\A2"));
+  free(report);
+
+  // graph: A2 after A0, A3 after A1 and A4 after A2 //
+  static int start[5] = {0, 0, 0, 1, 2};
+  static int count[5] = {0, 0, 1, 1, 1};
+  static int pool[3] = {0, 1, 2};
+  graph_t g = {5, start, count, pool, NULL};
+  critical_path(&g, 1, 5, 5, "STORE", 5);
+  report = ServerGetCriticalPath(table, &length);
+  TEST1(length == 4.5);
+  TEST1(strstr(report, "phase STORE is 4.500 seconds in 3 actions") != NULL);
+  report_path(report, path);
+  TEST0(strcmp(path, "\\A0 \\A2 \\A4"));
+  free(report);
+
+  // the report has room for a long phase name //
+  char phase[2048];
+  memset(phase, 'P', sizeof(phase) - 1);
+  phase[sizeof(phase) - 1] = 0;
+  critical_path(NULL, 1, 5, 7, phase, 9);
+  report = ServerGetCriticalPath(table, &length);
+  TEST1(strstr(report, phase) != NULL);
+  report_path(report, path);
+  TEST0(strcmp(path, "\\A1 \\A3 \\C5 \\C6"));
+  free(report);
+
+  free(table->critical_path);
+  free(table);
+  END_TESTING;
+}
@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdlib.h>
+#include <string.h>
+
+#include <dcl.h>
+#include <mdsdcl_messages.h>
+#include <mdsshr.h>
+#include <treeshr.h>
+
+#include "tcl_p.h"
+
+/**********************************************************************
+ * TCL_SHOW_PERF.C --
+ *
+ * TclShowPerf:  Display the latency statistics of tree access.
+ *
+ ************************************************************************/
+
+/***************************************************************
+ * TclShowPerf:
+ ***************************************************************/
+EXPORT int TclShowPerf(void *ctx, char **error, char **output)
+{
+  char *report = TreePerfReport();
+  if (!report)
+  {
+    *error = strdup("Failed to get performance statistics.\n");
+    return MdsdclERROR;
+  }
+  *output = report;
+  if (cli_present(ctx, "RESET") & 1)
+    TreeResetPerfStats();
+  return MdsdclSUCCESS;
+}
@@ -87,6 +87,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ** CvtConvertFloat              - General purpose conversion routine between
 **                                two floating point data types.
 **
+** CvtConvertFloatArray         - Converts an array of values, using direct
+**                                bit manipulation for the common VAX/IEEE
+**                                pairs.
+**
 ** pack_vax_f                   - Converts the standard intermediate data type
 **                                to VAX F_Floating.
 **
@@ -841,6 +845,266 @@ extern EXPORT CVT_STATUS CvtConvertFloat(void *input_value, uint32_t input_type,
   return return_status;
 }
 
+/*
+**=============================================================================
+**
+**  Array conversion
+**
+**  CvtConvertFloatArray converts count consecutive values. The conversions
+**  between VAX F and IEEE S, VAX D and IEEE T and VAX G and IEEE T only
+**  differ in word order, exponent bias and, for D to T, fraction length, so
+**  they are done directly on the bits in loops without branches that the
+**  compiler can vectorize. The array is processed in chunks: a chunk is
+**  first scanned for values these kernels do not handle (reserved operands,
+**  denormals, infinities, NaNs and values out of range), and such chunks
+**  are converted with CvtConvertFloat one value at a time. Arrays of the
+**  same VAX or IEEE type are copied and scanned for reserved operands. All
+**  other pairs always use CvtConvertFloat.
+**
+**=============================================================================
+*/
+#define CVT_ARRAY_CHUNK 1024
+#define T_SIGN 0x8000000000000000ULL
+#define T_FRACTION 0x000fffffffffffffULL
+
+static inline uint32_t rotate_words(uint32_t x) { return (x << 16) | (x >> 16); }
+
+static inline uint64_t reverse_words(uint64_t x)
+{
+  x = ((x & 0x0000ffff0000ffffULL) << 16) | ((x >> 16) & 0x0000ffff0000ffffULL);
+  return (x << 32) | (x >> 32);
+}
+
+static int vax_f_to_ieee_s(const uint32_t *in, uint32_t *out, int n)
+{
+  int i;
+  uint32_t unusual = 0;
+  for (i = 0; i < n; i++)
+  {
+    uint32_t exp = (in[i] >> 7) & 0xff;
+    unusual |= (exp < 3) & ((in[i] & 0xff80) != 0);
+  }
+  if (unusual)
+    return 0;
+  for (i = 0; i < n; i++)
+  {
+    uint32_t x = in[i];
+    out[i] = (x & 0xff80) ? rotate_words(x) - (2u << 23) : 0;
+  }
+  return 1;
+}
+
+static int ieee_s_to_vax_f(const uint32_t *in, uint32_t *out, int n)
+{
+  int i;
+  uint32_t unusual = 0;
+  for (i = 0; i < n; i++)
+  {
+    uint32_t exp = (in[i] >> 23) & 0xff;
+    unusual |= ((exp == 0) | (exp > 253)) & ((in[i] & 0x7fffffff) != 0);
+  }
+  if (unusual)
+    return 0;
+  for (i = 0; i < n; i++)
+  {
+    uint32_t x = in[i];
+    out[i] = (x & 0x7fffffff) ? rotate_words(x + (2u << 23)) : 0;
+  }
+  return 1;
+}
+
+static int vax_d_to_ieee_t(const uint64_t *in, uint64_t *out, int n)
+{
+  int i;
+  uint32_t unusual = 0;
+  for (i = 0; i < n; i++)
+    unusual |= (in[i] & 0xff80) == 0x8000;
+  if (unusual)
+    return 0;
+  for (i = 0; i < n; i++)
+  {
+    uint64_t x = reverse_words(in[i]);
+    uint64_t exp = (x >> 55) & 0xff;
+    uint64_t fraction = x & 0x007fffffffffffffULL;
+    uint64_t mantissa = fraction >> 3;
+    uint64_t rest = fraction & 7;
+    /* round to nearest even, a carry propagates into the exponent */
+    mantissa += (rest > 4) | ((rest == 4) & (mantissa & 1));
+    out[i] = exp ? (x & T_SIGN) | (((exp + 894) << 52) + mantissa) : 0;
+  }
+  return 1;
+}
+
+static int ieee_t_to_vax_d(const uint64_t *in, uint64_t *out, int n)
+{
+  int i;
+  uint32_t unusual = 0;
+  for (i = 0; i < n; i++)
+  {
+    uint64_t exp = (in[i] >> 52) & 0x7ff;
+    unusual |= ((exp < 895) | (exp > 1149)) & ((in[i] & ~T_SIGN) != 0);
+  }
+  if (unusual)
+    return 0;
+  for (i = 0; i < n; i++)
+  {
+    uint64_t x = in[i];
+    uint64_t exp = (x >> 52) & 0x7ff;
+    out[i] = (x & ~T_SIGN) ? reverse_words((x & T_SIGN) | ((exp - 894) << 55) |
+                                          ((x & T_FRACTION) << 3))
+                           : 0;
+  }
+  return 1;
+}
+
+static int vax_g_to_ieee_t(const uint64_t *in, uint64_t *out, int n)
+{
+  int i;
+  uint32_t unusual = 0;
+  for (i = 0; i < n; i++)
+  {
+    uint64_t exp = (in[i] >> 4) & 0x7ff;
+    unusual |= (exp < 3) & ((in[i] & 0xfff0) != 0);
+  }
+  if (unusual)
+    return 0;
+  for (i = 0; i < n; i++)
+  {
+    uint64_t x = in[i];
+    out[i] = (x & 0xfff0) ? reverse_words(x) - (2ULL << 52) : 0;
+  }
+  return 1;
+}
+
+static int ieee_t_to_vax_g(const uint64_t *in, uint64_t *out, int n)
+{
+  int i;
+  uint32_t unusual = 0;
+  for (i = 0; i < n; i++)
+  {
+    uint64_t exp = (in[i] >> 52) & 0x7ff;
+    unusual |= ((exp == 0) | (exp > 2045)) & ((in[i] & ~T_SIGN) != 0);
+  }
+  if (unusual)
+    return 0;
+  for (i = 0; i < n; i++)
+  {
+    uint64_t x = in[i];
+    out[i] = (x & ~T_SIGN) ? reverse_words(x + (2ULL << 52)) : 0;
+  }
+  return 1;
+}
+
+static int float_length(int dtype)
+{
+  switch (dtype)
+  {
+  case VAX_F:
+  case IEEE_S:
+  case IBM_SHORT:
+    return 4;
+  case VAX_D:
+  case VAX_G:
+  case IEEE_T:
+  case IBM_LONG:
+  case CRAY:
+    return 8;
+  case VAX_H:
+  case IEEE_X:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+extern EXPORT CVT_STATUS CvtConvertFloatArray(void const *input_values,
+                                              uint32_t input_type,
+                                              void *output_values,
+                                              uint32_t output_type,
+                                              int count)
+{
+  CVT_STATUS return_status = cvt_s_normal;
+  const char *ip = (const char *)input_values;
+  char *op = (char *)output_values;
+  int in_length = float_length(input_type);
+  int out_length = float_length(output_type);
+  int (*kernel32)(const uint32_t *, uint32_t *, int) = NULL;
+  int (*kernel64)(const uint64_t *, uint64_t *, int) = NULL;
+  if (!in_length)
+    RAISE(cvt_s_invalid_input_type);
+  if (!out_length)
+    RAISE(cvt_s_invalid_output_type);
+  if (count <= 0)
+    return return_status;
+  if (input_type == output_type && input_type != VAX_H &&
+      input_type != IEEE_X && input_type != IBM_LONG &&
+      input_type != IBM_SHORT && input_type != CRAY)
+  {
+    /* a copy, failing on reserved operands like CvtConvertFloat */
+    int i;
+    if (ip != op)
+      memmove(op, ip, (size_t)count * in_length);
+    for (i = 0; i < count; i++, op += in_length)
+    {
+      switch (input_type)
+      {
+      case VAX_F:
+      case VAX_D:
+        if (IsRoprandF(op))
+          return_status = 0;
+        break;
+      case VAX_G:
+        if (IsRoprandG(op))
+          return_status = 0;
+        break;
+      case IEEE_S:
+        if (IsRoprandS(op))
+          return_status = 0;
+        break;
+      default:
+        if (IsRoprandT(op))
+          return_status = 0;
+        break;
+      }
+    }
+    return return_status;
+  }
+#ifndef WORDS_BIGENDIAN
+  if (input_type == VAX_F && output_type == IEEE_S)
+    kernel32 = vax_f_to_ieee_s;
+  else if (input_type == IEEE_S && output_type == VAX_F)
+    kernel32 = ieee_s_to_vax_f;
+  else if (input_type == VAX_D && output_type == IEEE_T)
+    kernel64 = vax_d_to_ieee_t;
+  else if (input_type == IEEE_T && output_type == VAX_D)
+    kernel64 = ieee_t_to_vax_d;
+  else if (input_type == VAX_G && output_type == IEEE_T)
+    kernel64 = vax_g_to_ieee_t;
+  else if (input_type == IEEE_T && output_type == VAX_G)
+    kernel64 = ieee_t_to_vax_g;
+#endif
+  while (count > 0)
+  {
+    int i, n = count < CVT_ARRAY_CHUNK ? count : CVT_ARRAY_CHUNK;
+    if (!(kernel32 && kernel32((const uint32_t *)ip, (uint32_t *)op, n)) &&
+        !(kernel64 && kernel64((const uint64_t *)ip, (uint64_t *)op, n)))
+    {
+      for (i = 0; i < n; i++)
+      {
+        CVT_STATUS status = CvtConvertFloat((void *)(ip + i * in_length),
+                                            input_type, op + i * out_length,
+                                            output_type);
+        if (!(status & 1))
+          return_status = status;
+      }
+    }
+    ip += n * in_length;
+    op += n * out_length;
+    count -= n;
+  }
+  return return_status;
+}
+
 static void FlipDouble(int *in)
 {
   int tmp = in[0];
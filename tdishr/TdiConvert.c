@@ -32,6 +32,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MAXTYPE (DTYPE_FTC + 1)
 
 extern void CvtConvertFloat();
+extern int CvtConvertFloatArray();
 extern int IsRoprand();
 
 #define TWO_32 (double)4294967296.
@@ -300,29 +301,13 @@ extern int IsRoprand();
 #define O_OU(lena, pa, lenb, pb, numb) CONVERT_BINARY_SMALLER(pa, pb, numb, lena, lenb)
 #define O_Q(lena, pa, lenb, pb, numb) CONVERT_BINARY_SMALLER(pa, pb, numb, lena, lenb)
 /*********** Binary to Floating Point ****************************/
-#define CONVERT_FLOAT(pb, numb, otype)                           \
-  if (otype != DTYPE_NATIVE_FLOAT)                               \
-  {                                                              \
-    int i = numb;                                                \
-    float *op = (float *)pb;                                     \
-    while (i-- > 0)                                              \
-    {                                                            \
-      float tmp = *op;                                           \
-      CvtConvertFloat(&tmp, DTYPE_NATIVE_FLOAT, op++, otype, 0); \
-    }                                                            \
-  }
+#define CONVERT_FLOAT(pb, numb, otype) \
+  if (otype != DTYPE_NATIVE_FLOAT)     \
+    CvtConvertFloatArray(pb, DTYPE_NATIVE_FLOAT, pb, otype, numb);
 
-#define CONVERT_DOUBLE(pb, numb, otype)                           \
-  if (otype != DTYPE_NATIVE_DOUBLE)                               \
-  {                                                               \
-    int i = numb;                                                 \
-    double *op = (double *)pb;                                    \
-    while (i-- > 0)                                               \
-    {                                                             \
-      double tmp = *op;                                           \
-      CvtConvertFloat(&tmp, DTYPE_NATIVE_DOUBLE, op++, otype, 0); \
-    }                                                             \
-  }
+#define CONVERT_DOUBLE(pb, numb, otype) \
+  if (otype != DTYPE_NATIVE_DOUBLE)     \
+    CvtConvertFloatArray(pb, DTYPE_NATIVE_DOUBLE, pb, otype, numb);
 
 #define BINARY_TO_FLOAT(ti, pa, pb, numb, otype) \
   {                                              \
@@ -793,14 +778,7 @@ typedef union {
 
 #define FLOAT_TO_FLOAT(itype, it, pa, otype, ot, pb, numb) \
   {                                                        \
-    int i = numb;                                          \
-    binary_##it *ip = (binary_##it *)pa;                   \
-    binary_##ot *op = (binary_##ot *)pb;                   \
-    while (i-- > 0)                                        \
-    {                                                      \
-      binary_##it tmp = *ip++;                             \
-      CvtConvertFloat(&tmp, itype, op++, otype, 0);        \
-    }                                                      \
+    CvtConvertFloatArray(pa, itype, pb, otype, numb);      \
     status = MDSplusSUCCESS;                               \
   }
 
@@ -60,11 +60,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "tdirefcat.h"
 #include "tdirefstandard.h"
 #include "tdithreadstatic.h"
+#include <limits.h>
 #include <mdsshr.h>
 #include <mdsshr_messages.h>
 #include <stdlib.h>
 #include <string.h>
 #include <tdishr_messages.h>
+#include <treeshr.h>
 
 extern int TdiGetArgs();
 extern int TdiMasterData();
@@ -86,12 +88,152 @@ extern int TdiWindowOf();
 extern int TdiSubtract();
 extern int TdiEq();
 extern int TdiGetLong();
+extern int TdiGetNid();
+extern int TdiDimOf();
 
 typedef struct
 {
   int x[2];
 } quadw;
 
+/*----------------------------------------------------------------------------
+        Subscripts of a segmented node are pushed down to TreeShr:
+                node[t1 : t2]           segments overlapping t1 to t2
+                DATA(node)[i1 : i2]     segments holding rows i1 to i2
+                DIM_OF(node)[i1 : i2]
+        are the only ones read, scalar subscripts and stepped ranges alike.
+        The part read stands in for the whole record: the time window gets
+        one more segment on each side for nearest points, and the rows keep
+        their index as array bounds. Only for one dimensional segments, with
+        subscript limits that are constants or variables, and without a time
+        context, which must keep resampling the record.
+*/
+static int get_limit(struct descriptor *in, struct descriptor_xd *out)
+{
+  if (!in || in->dtype == DTYPE_MISSING)
+    return 0;
+  if (in->class != CLASS_S)
+    return -1;
+  switch (in->dtype)
+  {
+  case DTYPE_IDENT:
+  case DTYPE_B:
+  case DTYPE_BU:
+  case DTYPE_W:
+  case DTYPE_WU:
+  case DTYPE_L:
+  case DTYPE_LU:
+  case DTYPE_Q:
+  case DTYPE_QU:
+  case DTYPE_F:
+  case DTYPE_FS:
+  case DTYPE_D:
+  case DTYPE_G:
+  case DTYPE_FT:
+    break;
+  default:
+    return -1;
+  }
+  if (IS_NOT_OK(TdiData(in, out MDS_END_ARG)) || !out->pointer ||
+      out->pointer->class != CLASS_S || out->pointer->dtype == DTYPE_T)
+    return -1;
+  return 1;
+}
+
+static int subscript_pushdown(int narg, struct descriptor *list[],
+                              struct descriptor_xd *out_ptr)
+{
+  struct descriptor *pnode = list[0], *psub;
+  struct descriptor_xd lo = EMPTY_XD, hi = EMPTY_XD, sig = EMPTY_XD,
+                       dat = EMPTY_XD, tc[3] = {EMPTY_XD, EMPTY_XD, EMPTY_XD};
+  opcode_t opcode = 0;
+  int status, has_lo, has_hi, nid, first = -1, last = -1, dims[MAX_DIMS],
+                                   next_row, done = 0;
+  char dtype, dimct;
+  int64_t offset = 0;
+  if (narg != 2 || !pnode || !(psub = list[1]))
+    return 0;
+  if (pnode->class == CLASS_R && pnode->dtype == DTYPE_FUNCTION &&
+      ((struct descriptor_r *)pnode)->ndesc == 1)
+  {
+    opcode = *(opcode_t *)pnode->pointer;
+    if (opcode != OPC_DATA && opcode != OPC_DIM_OF)
+      return 0;
+    pnode = ((struct descriptor_r *)pnode)->dscptrs[0];
+  }
+  if (!pnode || pnode->class != CLASS_S ||
+      (pnode->dtype != DTYPE_NID && pnode->dtype != DTYPE_PATH))
+    return 0;
+  if (psub->class == CLASS_R && psub->dtype == DTYPE_RANGE)
+  {
+    struct descriptor_range *prange = (struct descriptor_range *)psub;
+    if (prange->ndesc < 2)
+      return 0;
+    has_lo = get_limit(prange->begin, &lo);
+    has_hi = get_limit(prange->ending, &hi);
+  }
+  else
+  {
+    has_lo = get_limit(psub, &lo);
+    has_hi = has_lo > 0 ? MdsCopyDxXd(lo.pointer, &hi) & 1 : has_lo;
+  }
+  if (has_lo < 0 || has_hi < 0 || IS_NOT_OK(TdiGetNid(pnode, &nid)))
+    goto done;
+  status = TreeGetTimeContext(&tc[0], &tc[1], &tc[2]);
+  if (STATUS_NOT_OK || tc[0].pointer || tc[1].pointer || tc[2].pointer)
+    goto done;
+  status = TreeGetSegmentInfo(nid, 0, &dtype, &dimct, dims, &next_row);
+  if (STATUS_NOT_OK || dimct != 1)
+    goto done;
+  if (!opcode)
+  {
+    done = TreeGetSegmentedRecordWindow(nid, has_lo ? lo.pointer : NULL,
+                                        has_hi ? hi.pointer : NULL,
+                                        out_ptr) &
+           1;
+    goto done;
+  }
+  if (has_lo)
+    status = TdiGetLong(lo.pointer, &first);
+  if (STATUS_OK && has_hi)
+    status = TdiGetLong(hi.pointer, &last);
+  if (STATUS_OK)
+    status = TreeGetSegmentedRecordRows(nid, first < 0 ? 0 : first,
+                                        has_hi ? last : -1, &offset, &sig);
+  if (STATUS_OK && sig.pointer)
+    status = opcode == OPC_DATA ? TdiData(sig.pointer, &dat MDS_END_ARG)
+                                : TdiDimOf(sig.pointer, &dat MDS_END_ARG);
+  if (STATUS_OK && dat.pointer && dat.pointer->class == CLASS_A &&
+      ((struct descriptor_a *)dat.pointer)->dimct == 1 &&
+      !((struct descriptor_a *)dat.pointer)->aflags.coeff)
+  {
+    struct descriptor_a *pa = (struct descriptor_a *)dat.pointer;
+    int n = pa->length ? pa->arsize / pa->length : 0;
+    /* bounds are ints, leave rows beyond that to the full path */
+    if (offset < 0 || offset + n - 1 > INT_MAX)
+      goto done;
+    ARRAY_BOUNDS(char, 1)
+    bounded = {pa->length, pa->dtype, CLASS_A, pa->pointer, 0, 0,
+               {0, 1, 1, 1, 1}, 1, pa->arsize, 0, {0}, {{0, 0}}};
+    bounded.a0 = pa->pointer - offset * pa->length;
+    bounded.m[0] = n;
+    bounded.bounds[0].l = (int)offset;
+    bounded.bounds[0].u = (int)offset + n - 1;
+    done = MdsCopyDxXd((struct descriptor *)&bounded, out_ptr) & 1;
+  }
+done:
+  MdsFree1Dx(&lo, NULL);
+  MdsFree1Dx(&hi, NULL);
+  MdsFree1Dx(&sig, NULL);
+  MdsFree1Dx(&dat, NULL);
+  MdsFree1Dx(&tc[0], NULL);
+  MdsFree1Dx(&tc[1], NULL);
+  MdsFree1Dx(&tc[2], NULL);
+  if (!done)
+    MdsFree1Dx(out_ptr, NULL);
+  return done;
+}
+
 int Tdi1Subscript(opcode_t opcode, int narg, struct descriptor *list[],
                   struct descriptor_xd *out_ptr)
 {
@@ -110,10 +252,16 @@ int Tdi1Subscript(opcode_t opcode, int narg, struct descriptor *list[],
   struct descriptor ddim = {sizeof(dim), DTYPE_L, CLASS_S, 0};
   struct descriptor_xd ii[MAX_DIMS], xx[MAX_DIMS];
   struct descriptor_xd sig[1] = {EMPTY_XD}, uni[1] = {EMPTY_XD},
-                       dat[1] = {EMPTY_XD};
+                       dat[1] = {EMPTY_XD}, part = EMPTY_XD;
   struct TdiCatStruct cats[2];
   ddim.pointer = (char *)&dim;
-  status = TdiGetArgs(opcode, 1, list, sig, uni, dat, cats);
+  if (subscript_pushdown(narg, list, &part))
+  {
+    struct descriptor *part_list[2] = {part.pointer, list[1]};
+    status = TdiGetArgs(opcode, 1, part_list, sig, uni, dat, cats);
+  }
+  else
+    status = TdiGetArgs(opcode, 1, list, sig, uni, dat, cats);
   if (STATUS_NOT_OK)
   {
     if (dat[0].pointer && dat[0].pointer->dtype == DTYPE_DICTIONARY)
@@ -379,6 +527,7 @@ baddat:
   MdsFree1Dx(&sig[0], NULL);
   MdsFree1Dx(&uni[0], NULL);
   MdsFree1Dx(&dat[0], NULL);
+  MdsFree1Dx(&part, NULL);
   return status;
 }
 
@@ -1380,6 +1380,49 @@ extern EXPORT int TdiDeleteContext(void *ptr[6])
   return 1;
 }
 
+/*-------------------------------------------------------------
+        Clean a saved private context for reuse.
+        Variable values are released but compiled FUN definitions
+        are kept so a reused context does not recompile them.
+*/
+static void clean_one(node_type *const node_ptr, void **const data_zone)
+{
+  if (node_ptr->left)
+    clean_one(node_ptr->left, data_zone);
+  if (node_ptr->right)
+    clean_one(node_ptr->right, data_zone);
+  const mdsdsc_r_t *const ptr = (mdsdsc_r_t *)node_ptr->xd.pointer;
+  if (ptr && ptr->dtype == DTYPE_FUNCTION && ptr->pointer &&
+      *(unsigned short *)ptr->pointer == OPC_FUN)
+    return;
+  if (node_ptr->xd.l_length)
+    LibFreeVm(&node_ptr->xd.l_length, (void *)&node_ptr->xd.pointer,
+              data_zone);
+  node_ptr->xd = NULL_XD;
+}
+
+extern EXPORT int TdiCleanContext(void *ptr[6])
+{
+  if (ptr[0])
+    clean_one((node_type *)ptr[0], &ptr[2]);
+  return 1;
+}
+
+/*-------------------------------------------------------------
+        Exchange the private variables with a saved private context.
+*/
+extern EXPORT int TdiSwapPrivateContext(void *ptr[3])
+{
+  TDITHREADSTATIC_INIT;
+  void *const tmp[3] = {(void *)_private.head, _private.head_zone,
+                        _private.data_zone};
+  _private.head = (node_type *)ptr[0];
+  _private.head_zone = ptr[1];
+  _private.data_zone = ptr[2];
+  memcpy(ptr, tmp, sizeof(tmp));
+  return 1;
+}
+
 /*-------------------------------------------------------------
         Restore variable context
 */
@@ -0,0 +1,187 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../CvtConvertFloat.c"
+#include "testing.h"
+
+// CvtConvertFloatArray must give the bytes and status of converting every
+// element with CvtConvertFloat, for the bit manipulating kernels as well as
+// for the pairs and values that fall back to the scalar conversion.
+
+static const int types[] = {VAX_F, VAX_D, VAX_G, IEEE_S,
+                            IEEE_T, IBM_LONG, IBM_SHORT, CRAY};
+#define NUM_TYPES (int)(sizeof(types) / sizeof(*types))
+
+// odd lengths leave tails after the unrolled loops and the chunks
+static const int counts[] = {1, 3, 7, 17, CVT_ARRAY_CHUNK - 1,
+                             CVT_ARRAY_CHUNK + 1, 2 * CVT_ARRAY_CHUNK + 3};
+#define NUM_COUNTS (int)(sizeof(counts) / sizeof(*counts))
+#define MAX_COUNT (2 * CVT_ARRAY_CHUNK + 3)
+
+static uint32_t seed = 12345;
+static uint32_t next_random()
+{
+  seed = seed * 1103515245 + 12345;
+  return seed;
+}
+
+// bit patterns of special values of a type, and then random bits
+static void special_values(int type, char *out, int n)
+{
+  static const uint32_t s[] = {
+      0x00000000, 0x80000000, 0x3f800000, 0xbfc00000, // zeros, 1, -1.5
+      0x00000001, 0x807fffff, 0x00800000, 0x7f7fffff, // denormals, extremes
+      0x7f800000, 0xff800000, 0x7fc00000, 0xffbfffff, // infinities, NaNs
+      0x01000000, 0x00ffffff, 0x7e800000, 0x7f000000}; // VAX range limits
+  static const uint64_t t[] = {
+      0x0000000000000000ULL, 0x8000000000000000ULL, 0x3ff0000000000000ULL,
+      0xbff8000000000000ULL, 0x0000000000000001ULL, 0x800fffffffffffffULL,
+      0x0010000000000000ULL, 0x7fefffffffffffffULL, 0x7ff0000000000000ULL,
+      0xfff0000000000000ULL, 0x7ff8000000000000ULL, 0xfff7ffffffffffffULL,
+      0x3800000000000000ULL, 0x37ffffffffffffffULL, 0x47e0000000000000ULL,
+      0x0020000000000000ULL, 0x7fd0000000000000ULL, 0x3fffffffffffffffULL};
+  // VAX patterns in memory order: reserved operands, dirty zeros, extremes
+  static const uint32_t vax32[] = {0x00008000, 0x0000807f, 0x12340000,
+                                   0x0000007f, 0x00000080, 0xffff7fff,
+                                   0xffffffff, 0x00004080};
+  static const uint64_t vax64[] = {
+      0x0000000000008000ULL, 0x000000000000800fULL, 0x1234567800000000ULL,
+      0x000000000000000fULL, 0x0000000000000010ULL, 0xffffffffffff7fffULL,
+      0xffffffffffffffffULL, 0x0000000000004080ULL, 0x000000000000401fULL};
+  const int length = float_length(type);
+  int i = 0, j;
+  if (length == 4)
+  {
+    for (j = 0; i < n && j < (int)(sizeof(s) / sizeof(*s)); j++, i++)
+      memcpy(out + i * 4, &s[j], 4);
+    for (j = 0; i < n && j < (int)(sizeof(vax32) / sizeof(*vax32)); j++, i++)
+      memcpy(out + i * 4, &vax32[j], 4);
+  }
+  else
+  {
+    for (j = 0; i < n && j < (int)(sizeof(t) / sizeof(*t)); j++, i++)
+      memcpy(out + i * 8, &t[j], 8);
+    for (j = 0; i < n && j < (int)(sizeof(vax64) / sizeof(*vax64)); j++, i++)
+      memcpy(out + i * 8, &vax64[j], 8);
+  }
+  for (; i < n * length / 4; i++)
+    ((uint32_t *)out)[i] = next_random();
+}
+
+// ordinary values only, so the kernels convert whole chunks
+static void usual_values(int type, char *out, int n)
+{
+  int i;
+  for (i = 0; i < n; i++)
+  {
+    double value = ((double)(next_random() % 2000001) - 1000000.) /
+                   (1 + next_random() % 1000);
+    CvtConvertFloat(&value, IEEE_T, out + i * float_length(type), type);
+  }
+}
+
+static int check_pair(int in_type, int out_type, const char *in, int count)
+{
+  const int out_length = float_length(out_type);
+  char *array = malloc((size_t)count * out_length);
+  char *scalar = malloc((size_t)count * out_length);
+  int i, ok = array && scalar;
+  CVT_STATUS scalar_status = cvt_s_normal;
+  if (ok)
+  {
+    memset(array, 0x55, (size_t)count * out_length);
+    memset(scalar, 0x55, (size_t)count * out_length);
+    for (i = 0; i < count; i++)
+    {
+      CVT_STATUS status =
+          CvtConvertFloat((void *)(in + i * float_length(in_type)), in_type,
+                          scalar + i * out_length, out_type);
+      if (!(status & 1))
+        scalar_status = status;
+    }
+    CVT_STATUS status =
+        CvtConvertFloatArray(in, in_type, array, out_type, count);
+    ok = (status & 1) == (scalar_status & 1) &&
+         !memcmp(array, scalar, (size_t)count * out_length);
+    if (ok && float_length(in_type) == out_length)
+    { // in place, values that fail to convert may be left as they were
+      memcpy(array, in, (size_t)count * out_length);
+      memcpy(scalar, in, (size_t)count * out_length);
+      for (i = 0; i < count; i++)
+        CvtConvertFloat(scalar + i * out_length, in_type,
+                        scalar + i * out_length, out_type);
+      CvtConvertFloatArray(array, in_type, array, out_type, count);
+      ok = !memcmp(array, scalar, (size_t)count * out_length);
+    }
+    if (!ok)
+      fprintf(stderr, "%d -> %d, count %d differs\n", in_type, out_type,
+              count);
+  }
+  free(array);
+  free(scalar);
+  return ok;
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(CvtConvertFloatArray);
+  char *in = malloc(MAX_COUNT * 8);
+  TEST1(in != NULL);
+  int i, o, c;
+  for (i = 0; i < NUM_TYPES; i++)
+    for (o = 0; o < NUM_TYPES; o++)
+      for (c = 0; c < NUM_COUNTS; c++)
+      {
+        special_values(types[i], in, counts[c]);
+        TEST1(check_pair(types[i], types[o], in, counts[c]));
+        usual_values(types[i], in, counts[c]);
+        TEST1(check_pair(types[i], types[o], in, counts[c]));
+      }
+  // a single special value in a chunk of usual ones //
+  for (i = 0; i < NUM_TYPES; i++)
+    for (o = 0; o < NUM_TYPES; o++)
+    {
+      const int length = float_length(types[i]);
+      char special[64 * 8];
+      special_values(types[i], special, 64);
+      for (c = 0; c < 34; c++)
+      {
+        usual_values(types[i], in, MAX_COUNT);
+        memcpy(in + (size_t)(c * 61) * length, special + c * length, length);
+        TEST1(check_pair(types[i], types[o], in, MAX_COUNT));
+      }
+    }
+  // invalid types //
+  TEST0(CvtConvertFloatArray(in, 99, in, IEEE_T, 1) & 1);
+  TEST0(CvtConvertFloatArray(in, IEEE_T, in, 99, 1) & 1);
+  TEST1(CvtConvertFloatArray(in, IEEE_T, in, VAX_D, 0) & 1);
+  free(in);
+  END_TESTING;
+}
@@ -302,7 +302,7 @@ int ConnectTreeRemote(PINO_DATABASE *dblist, char const *tree,
           info->flush = (dblist->shotid == -1);
           info->header = (TREE_HEADER *)&info[1];
           info->treenam = strdup(tree);
-          TreeCallHookFun("TreeHook", "OpenTree", tree, dblist->shotid, NULL);
+          TREE_HOOKS(OpenTree, tree, dblist->shotid, 0, NULL);
           TreeCallHook(OpenTree, info, 0);
           info->channel = conid;
           dblist->tree_info = info;
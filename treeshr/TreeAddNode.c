@@ -946,8 +946,7 @@ int _TreeWriteTree(void **dbid, char const *exp_ptr, int shotid)
                     MDS_IO_LOCK_RD | MDS_IO_LOCK_NOWAIT, 0);
         status = TreeSUCCESS;
         (*dblist)->modified = 0;
-        TreeCallHookFun("TreeHook", "WriteTree", info_ptr->treenam,
-                        (*dblist)->shotid, NULL);
+        TREE_HOOKS(WriteTree, info_ptr->treenam, (*dblist)->shotid, 0, NULL);
         TreeCallHook(WriteTree, info_ptr, 0);
       }
       else
@@ -0,0 +1,668 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*------------------------------------------------------------------------------
+
+                Name: TreeAsyncWriter
+
+                Type:   C functions
+
+                Purpose: Queue segment writes and store them from a
+                         background thread.
+
+------------------------------------------------------------------------------
+
+        Description:
+
+   Every TreePutRow call locks the datafile, reloads the segment header and
+   writes a single row. A writer created with TreeAsyncWriterOpen copies
+   rows and segments into a queue instead and returns immediately. A
+   worker thread takes the whole queue at once and stores it through a
+   private context the writer opens on the same tree and shot. Queued rows
+   of one node are merged and stored with a single TreePutTimestampedSegment
+   per segment.
+
+   The private context has its own nci and datafile buffers, so the worker
+   never touches the PINO_DATABASE of the application. Writes through the
+   two contexts exclude each other through the file locks, which are taken
+   per open file (OFD locks) and so also between threads of one process.
+   Rows are appended to the last segment of a node only if its dtype and
+   shape match, as TreePutRow requires.
+
+   The queue is bounded by max_bytes. Callers block while it is full. The
+   first error seen by the worker is returned by the next call on the
+   writer. Closing the tree the writer was created from flushes the writer,
+   later writes fail with TreeNOT_OPEN.
+
++-----------------------------------------------------------------------------*/
+#include <mdsplus/mdsconfig.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+#include <treeshr.h>
+
+#include "treeshrp.h"
+
+#define DEFAULT_MAX_BYTES 0x4000000
+
+typedef enum
+{
+  ASYNC_ROW,
+  ASYNC_PUT_SEGMENT,
+  ASYNC_MAKE_SEGMENT,
+} async_type_t;
+
+typedef struct async_item
+{
+  struct async_item *next;
+  async_type_t type;
+  int nid;
+  size_t bytes;
+  int64_t enqueued;
+  // ASYNC_ROW
+  int bufsize;
+  dtype_t dtype;
+  length_t length;
+  int dimct;
+  int dims[MAX_DIMS];
+  int row_bytes;
+  int rows;
+  int max_rows;
+  int64_t *times;
+  char *data;
+  // ASYNC_PUT_SEGMENT and ASYNC_MAKE_SEGMENT
+  int idx;
+  int filled;
+  mdsdsc_xd_t xd_data;
+  mdsdsc_xd_t xd_start;
+  mdsdsc_xd_t xd_end;
+  mdsdsc_xd_t xd_dim;
+} async_item_t;
+
+typedef struct tree_async_writer
+{
+  struct tree_async_writer *next;
+  void *owner; // NULL once the tree has been closed
+  void *dbid;  // private context of the worker on the tree of the owner
+  int refs;    // held by tree_async_close_owner without writers_lock
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t more;
+  pthread_cond_t done;
+  async_item_t *head;
+  async_item_t *tail;
+  int64_t max_bytes;
+  int busy;
+  int stop;
+  int status;
+  TREE_ASYNC_WRITER_STATS stats;
+} tree_async_writer_t;
+
+static pthread_mutex_t writers_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writers_released = PTHREAD_COND_INITIALIZER;
+static tree_async_writer_t *writers = NULL;
+
+static inline int64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void free_item(async_item_t *item)
+{
+  free(item->times);
+  free(item->data);
+  MdsFree1Dx(&item->xd_data, NULL);
+  MdsFree1Dx(&item->xd_start, NULL);
+  MdsFree1Dx(&item->xd_end, NULL);
+  MdsFree1Dx(&item->xd_dim, NULL);
+  free(item);
+}
+
+static inline void init_xd(mdsdsc_xd_t *xd)
+{
+  static const mdsdsc_xd_t empty_xd = {0, DTYPE_DSC, CLASS_XD, 0, 0};
+  *xd = empty_xd;
+}
+
+static async_item_t *new_item(async_type_t type, int nid)
+{
+  async_item_t *item = calloc(1, sizeof(async_item_t));
+  if (item)
+  {
+    item->type = type;
+    item->nid = nid;
+    init_xd(&item->xd_data);
+    init_xd(&item->xd_start);
+    init_xd(&item->xd_end);
+    init_xd(&item->xd_dim);
+  }
+  return item;
+}
+
+///// WORKER /////
+
+/* Rows left in the last segment of nid, 0 if a new segment is needed.
+ * Rows are only appended to a segment of the same dtype and row shape.
+ */
+static int rows_left(void *dbid, async_item_t *item, int *left)
+{
+  char dtype, dimct;
+  int dims[MAX_DIMS], next_row;
+  *left = 0;
+  if (IS_NOT_OK(_TreeGetSegmentInfo(dbid, item->nid, -1, &dtype,
+                                    &dimct, dims, &next_row)))
+    return TreeSUCCESS;
+  if (dimct < 1 || dimct > MAX_DIMS || dims[dimct - 1] <= next_row)
+    return TreeSUCCESS;
+  if ((dtype_t)dtype != item->dtype)
+    return TreeINVDTYPE;
+  if (dimct != item->dimct + 1 ||
+      memcmp(dims, item->dims, item->dimct * sizeof(int)))
+    return TreeINVSHAPE;
+  *left = dims[dimct - 1] - next_row;
+  return TreeSUCCESS;
+}
+
+static int begin_row_segment(void *dbid, async_item_t *item)
+{
+  const int dimct = item->dimct + 1;
+  DESCRIPTOR_A_COEFF(initValue, item->length, item->dtype, NULL, 8, 0);
+  initValue.arsize = (l_length_t)item->row_bytes * item->bufsize;
+  initValue.pointer = initValue.a0 = calloc(1, initValue.arsize);
+  if (!initValue.pointer)
+    return MDSplusERROR;
+  initValue.dimct = dimct;
+  memcpy(initValue.m, item->dims, item->dimct * sizeof(int));
+  initValue.m[item->dimct] = item->bufsize;
+  int status = _TreeBeginTimestampedSegment(dbid, item->nid,
+                                            (mdsdsc_a_t *)&initValue, -1);
+  free(initValue.pointer);
+  return status;
+}
+
+/* Store all rows of a merged row item, starting new segments of bufsize
+ * rows whenever the current one is full, as TreePutRow does per row.
+ */
+static int write_rows(tree_async_writer_t *writer, void *dbid,
+                      async_item_t *item)
+{
+  int status = TreeSUCCESS;
+  int done = 0;
+  while (STATUS_OK && done < item->rows)
+  {
+    int left;
+    status = rows_left(dbid, item, &left);
+    BREAK_IF_STATUS_NOT_OK;
+    if (left == 0)
+    {
+      status = begin_row_segment(dbid, item);
+      BREAK_IF_STATUS_NOT_OK;
+      writer->stats.segments_begun++;
+      left = item->bufsize;
+    }
+    const int rows = (item->rows - done < left) ? item->rows - done : left;
+    DESCRIPTOR_A_COEFF(rows_d, item->length, item->dtype,
+                       item->data + (size_t)done * item->row_bytes, 8,
+                       (l_length_t)rows * item->row_bytes);
+    rows_d.a0 = rows_d.pointer;
+    rows_d.dimct = item->dimct + 1;
+    memcpy(rows_d.m, item->dims, item->dimct * sizeof(int));
+    rows_d.m[item->dimct] = rows;
+    status = _TreePutTimestampedSegment(dbid, item->nid, item->times + done,
+                                        (mdsdsc_a_t *)&rows_d);
+    writer->stats.write_calls++;
+    done += rows;
+  }
+  if (STATUS_OK)
+    writer->stats.rows_written += item->rows;
+  return status;
+}
+
+static int write_item(tree_async_writer_t *writer, void *dbid,
+                      async_item_t *item)
+{
+  switch (item->type)
+  {
+  case ASYNC_ROW:
+    return write_rows(writer, dbid, item);
+  case ASYNC_PUT_SEGMENT:
+    writer->stats.write_calls++;
+    return _TreePutSegment(dbid, item->nid, item->idx,
+                           (mdsdsc_a_t *)item->xd_data.pointer);
+  case ASYNC_MAKE_SEGMENT:
+    writer->stats.write_calls++;
+    writer->stats.segments_begun++;
+    return _TreeMakeSegment(dbid, item->nid, item->xd_start.pointer,
+                            item->xd_end.pointer, item->xd_dim.pointer,
+                            (mdsdsc_a_t *)item->xd_data.pointer, item->idx,
+                            item->filled);
+  }
+  return TreeFAILURE;
+}
+
+static void *writer_thread(void *arg)
+{
+  tree_async_writer_t *writer = (tree_async_writer_t *)arg;
+  pthread_mutex_lock(&writer->lock);
+  for (;;)
+  {
+    while (!writer->head && !writer->stop)
+      pthread_cond_wait(&writer->more, &writer->lock);
+    if (!writer->head)
+      break;
+    async_item_t *batch = writer->head;
+    writer->head = writer->tail = NULL;
+    writer->busy = 1;
+    // the owner is only detached while the worker is idle
+    void *const dbid = writer->owner ? writer->dbid : NULL;
+    pthread_mutex_unlock(&writer->lock);
+    int status = dbid ? TreeSUCCESS : TreeNOT_OPEN;
+    int64_t bytes = 0, items = 0, latency = 0, max_latency = 0;
+    while (batch)
+    {
+      async_item_t *item = batch;
+      batch = item->next;
+      if (STATUS_OK)
+        status = write_item(writer, dbid, item);
+      const int64_t item_latency = now_ns() - item->enqueued;
+      latency += item_latency;
+      if (item_latency > max_latency)
+        max_latency = item_latency;
+      bytes += item->bytes;
+      items++;
+      free_item(item);
+    }
+    pthread_mutex_lock(&writer->lock);
+    if (STATUS_NOT_OK && IS_OK(writer->status))
+      writer->status = status;
+    writer->stats.queued_bytes -= bytes;
+    writer->stats.queue_depth -= items;
+    writer->stats.bytes_written += bytes;
+    writer->stats.items_written += items;
+    writer->stats.batches++;
+    writer->stats.total_latency_ns += latency;
+    writer->stats.last_latency_ns = items ? latency / items : 0;
+    if (max_latency > writer->stats.max_latency_ns)
+      writer->stats.max_latency_ns = max_latency;
+    writer->busy = 0;
+    pthread_cond_broadcast(&writer->done);
+  }
+  pthread_mutex_unlock(&writer->lock);
+  return NULL;
+}
+
+///// PRODUCER /////
+
+/* wait for room in the queue; called with writer->lock held */
+static void wait_for_room(tree_async_writer_t *writer, size_t bytes)
+{
+  if (writer->head &&
+      writer->stats.queued_bytes + (int64_t)bytes > writer->max_bytes)
+  {
+    writer->stats.blocked++;
+    while (writer->head &&
+           writer->stats.queued_bytes + (int64_t)bytes > writer->max_bytes)
+      pthread_cond_wait(&writer->done, &writer->lock);
+  }
+}
+
+static int enqueue(tree_async_writer_t *writer, async_item_t *item)
+{
+  int status;
+  pthread_mutex_lock(&writer->lock);
+  status = writer->status;
+  if (STATUS_OK)
+  {
+    wait_for_room(writer, item->bytes);
+    item->enqueued = now_ns();
+    if (writer->tail)
+      writer->tail->next = item;
+    else
+      writer->head = item;
+    writer->tail = item;
+    writer->stats.queued_bytes += item->bytes;
+    writer->stats.queue_depth++;
+    if (writer->stats.queue_depth > writer->stats.max_queue_depth)
+      writer->stats.max_queue_depth = writer->stats.queue_depth;
+    pthread_cond_signal(&writer->more);
+  }
+  pthread_mutex_unlock(&writer->lock);
+  if (STATUS_NOT_OK)
+    free_item(item);
+  return status;
+}
+
+/* the last queued item of nid if it can take one more row like item */
+static async_item_t *find_mergeable(tree_async_writer_t *writer,
+                                    async_item_t *row)
+{
+  async_item_t *item, *last = NULL;
+  for (item = writer->head; item; item = item->next)
+    if (item->nid == row->nid)
+      last = item;
+  if (last && last->type == ASYNC_ROW && last->dtype == row->dtype &&
+      last->length == row->length && last->dimct == row->dimct &&
+      last->bufsize == row->bufsize &&
+      !memcmp(last->dims, row->dims, row->dimct * sizeof(int)))
+    return last;
+  return NULL;
+}
+
+static int merge_row(async_item_t *item, int64_t timestamp, const char *row)
+{
+  if (item->rows == item->max_rows)
+  {
+    const int max_rows = item->max_rows * 2;
+    int64_t *times = realloc(item->times, max_rows * sizeof(int64_t));
+    if (!times)
+      return MDSplusERROR;
+    item->times = times;
+    char *data = realloc(item->data, (size_t)max_rows * item->row_bytes);
+    if (!data)
+      return MDSplusERROR;
+    item->data = data;
+    item->max_rows = max_rows;
+  }
+  item->times[item->rows] = timestamp;
+  memcpy(item->data + (size_t)item->rows * item->row_bytes, row,
+         item->row_bytes);
+  item->rows++;
+  item->bytes += item->row_bytes + sizeof(int64_t);
+  return TreeSUCCESS;
+}
+
+EXPORT int TreeAsyncPutRow(void *writer_in, int nid, int bufsize,
+                           int64_t *timestamp, mdsdsc_a_t *data)
+{
+  tree_async_writer_t *writer = (tree_async_writer_t *)writer_in;
+  if (!writer)
+    return TreeFAILURE;
+  while (data && data->dtype == DTYPE_DSC)
+    data = (mdsdsc_a_t *)data->pointer;
+  if (!data || bufsize < 1)
+    return TreeFAILURE;
+  async_item_t row = {0};
+  row.type = ASYNC_ROW;
+  row.nid = nid;
+  row.bufsize = bufsize;
+  row.dtype = data->dtype;
+  row.length = data->length;
+  if (data->class == CLASS_A)
+  {
+    if (data->dimct > MAX_DIMS - 1 || data->length == 0)
+      return TreeINVDTYPE;
+    if (data->dimct > 1 && !data->aflags.coeff)
+      return TreeINVDTYPE;
+    row.row_bytes = data->arsize;
+    row.dimct = data->dimct;
+    if (data->dimct == 1)
+      row.dims[0] = data->arsize / data->length;
+    else
+      memcpy(row.dims, ((array_coeff *)data)->m, data->dimct * sizeof(int));
+  }
+  else if (data->class == CLASS_S || data->class == CLASS_D)
+  {
+    row.row_bytes = data->length;
+    row.dimct = 0;
+  }
+  else
+    return TreeINVDTYPE;
+  int status;
+  pthread_mutex_lock(&writer->lock);
+  status = writer->status;
+  if (STATUS_OK)
+  {
+    async_item_t *item = find_mergeable(writer, &row);
+    if (item)
+    {
+      wait_for_room(writer, row.row_bytes + sizeof(int64_t));
+      // the worker may have taken the queue while we were waiting
+      if (find_mergeable(writer, &row) == item)
+      {
+        status = merge_row(item, *timestamp, data->pointer);
+        if (STATUS_OK)
+        {
+          writer->stats.queued_bytes += row.row_bytes + sizeof(int64_t);
+          writer->stats.rows_merged++;
+        }
+        pthread_mutex_unlock(&writer->lock);
+        return status;
+      }
+    }
+  }
+  pthread_mutex_unlock(&writer->lock);
+  RETURN_IF_STATUS_NOT_OK;
+  async_item_t *item = new_item(ASYNC_ROW, nid);
+  if (!item)
+    return MDSplusERROR;
+  item->bufsize = row.bufsize;
+  item->dtype = row.dtype;
+  item->length = row.length;
+  item->dimct = row.dimct;
+  memcpy(item->dims, row.dims, sizeof(row.dims));
+  item->row_bytes = row.row_bytes;
+  item->max_rows = bufsize < 64 ? bufsize : 64;
+  item->times = malloc(item->max_rows * sizeof(int64_t));
+  item->data = malloc((size_t)item->max_rows * item->row_bytes);
+  if (!item->times || !item->data)
+  {
+    free_item(item);
+    return MDSplusERROR;
+  }
+  merge_row(item, *timestamp, data->pointer);
+  return enqueue(writer, item);
+}
+
+EXPORT int TreeAsyncPutSegment(void *writer_in, int nid, int rowidx,
+                               mdsdsc_a_t *data)
+{
+  tree_async_writer_t *writer = (tree_async_writer_t *)writer_in;
+  if (!writer)
+    return TreeFAILURE;
+  async_item_t *item = new_item(ASYNC_PUT_SEGMENT, nid);
+  if (!item)
+    return MDSplusERROR;
+  int status = MdsCopyDxXd((mdsdsc_t *)data, &item->xd_data);
+  if (STATUS_NOT_OK)
+  {
+    free_item(item);
+    return status;
+  }
+  item->idx = rowidx;
+  item->bytes = item->xd_data.l_length;
+  return enqueue(writer, item);
+}
+
+EXPORT int TreeAsyncMakeSegment(void *writer_in, int nid, mdsdsc_t *start,
+                                mdsdsc_t *end, mdsdsc_t *dim,
+                                mdsdsc_a_t *data, int idx, int filled)
+{
+  tree_async_writer_t *writer = (tree_async_writer_t *)writer_in;
+  if (!writer)
+    return TreeFAILURE;
+  async_item_t *item = new_item(ASYNC_MAKE_SEGMENT, nid);
+  if (!item)
+    return MDSplusERROR;
+  int status = MdsCopyDxXd((mdsdsc_t *)data, &item->xd_data);
+  if (STATUS_OK)
+    status = MdsCopyDxXd(start, &item->xd_start);
+  if (STATUS_OK)
+    status = MdsCopyDxXd(end, &item->xd_end);
+  if (STATUS_OK)
+    status = MdsCopyDxXd(dim, &item->xd_dim);
+  if (STATUS_NOT_OK)
+  {
+    free_item(item);
+    return status;
+  }
+  item->idx = idx;
+  item->filled = filled;
+  item->bytes = item->xd_data.l_length + item->xd_start.l_length +
+                item->xd_end.l_length + item->xd_dim.l_length;
+  return enqueue(writer, item);
+}
+
+///// CONTROL /////
+
+static int flush_writer(tree_async_writer_t *writer)
+{
+  int status;
+  pthread_mutex_lock(&writer->lock);
+  while (writer->head || writer->busy)
+    pthread_cond_wait(&writer->done, &writer->lock);
+  status = writer->status;
+  pthread_mutex_unlock(&writer->lock);
+  return status;
+}
+
+EXPORT int TreeAsyncWriterFlush(void *writer)
+{
+  return writer ? flush_writer((tree_async_writer_t *)writer) : TreeFAILURE;
+}
+
+/* Called by close_top_tree so data queued for a tree is stored before the
+ * tree it was written through goes away. The writers are detached from the
+ * context afterwards. writers_lock is not held while flushing; the refs
+ * keep TreeAsyncWriterClose from freeing a writer in the meantime.
+ */
+void tree_async_close_owner(void *owner)
+{
+  tree_async_writer_t *writer;
+  for (;;)
+  {
+    pthread_mutex_lock(&writers_lock);
+    for (writer = writers; writer && writer->owner != owner;
+         writer = writer->next)
+      ;
+    if (writer)
+      writer->refs++;
+    pthread_mutex_unlock(&writers_lock);
+    if (!writer)
+      break;
+    pthread_mutex_lock(&writer->lock);
+    while (writer->head || writer->busy)
+      pthread_cond_wait(&writer->done, &writer->lock);
+    writer->owner = NULL;
+    pthread_mutex_unlock(&writer->lock);
+    pthread_mutex_lock(&writers_lock);
+    writer->refs--;
+    pthread_cond_broadcast(&writers_released);
+    pthread_mutex_unlock(&writers_lock);
+  }
+}
+
+EXPORT int _TreeAsyncWriterOpen(void *dbid, int64_t max_bytes,
+                                void **writer_out)
+{
+  PINO_DATABASE *dblist = (PINO_DATABASE *)dbid;
+  *writer_out = NULL;
+  if (!IS_OPEN(dblist))
+    return TreeNOT_OPEN;
+  if (dblist->open_readonly)
+    return TreeREADONLY;
+  if (IS_OPEN_FOR_EDIT(dblist))
+    return TreeOPEN_EDIT;
+  tree_async_writer_t *writer = calloc(1, sizeof(tree_async_writer_t));
+  if (!writer)
+    return MDSplusERROR;
+  int status = _TreeOpen(&writer->dbid, dblist->experiment, dblist->shotid, 0);
+  if (STATUS_NOT_OK)
+  {
+    TreeFreeDbid(writer->dbid);
+    free(writer);
+    return status;
+  }
+  writer->owner = dbid;
+  writer->max_bytes = max_bytes > 0 ? max_bytes : DEFAULT_MAX_BYTES;
+  writer->status = TreeSUCCESS;
+  pthread_mutex_init(&writer->lock, NULL);
+  pthread_cond_init(&writer->more, NULL);
+  pthread_cond_init(&writer->done, NULL);
+  if (pthread_create(&writer->thread, NULL, writer_thread, writer))
+  {
+    pthread_cond_destroy(&writer->done);
+    pthread_cond_destroy(&writer->more);
+    pthread_mutex_destroy(&writer->lock);
+    TreeFreeDbid(writer->dbid);
+    free(writer);
+    return MDSplusERROR;
+  }
+  pthread_mutex_lock(&writers_lock);
+  writer->next = writers;
+  writers = writer;
+  pthread_mutex_unlock(&writers_lock);
+  *writer_out = writer;
+  return TreeSUCCESS;
+}
+
+EXPORT int TreeAsyncWriterOpen(int64_t max_bytes, void **writer)
+{
+  return _TreeAsyncWriterOpen(*TreeCtx(), max_bytes, writer);
+}
+
+EXPORT int TreeAsyncWriterClose(void *writer_in)
+{
+  tree_async_writer_t *writer = (tree_async_writer_t *)writer_in;
+  if (!writer)
+    return TreeFAILURE;
+  tree_async_writer_t **prev;
+  pthread_mutex_lock(&writers_lock);
+  for (prev = &writers; *prev && *prev != writer; prev = &(*prev)->next)
+    ;
+  if (*prev)
+    *prev = writer->next;
+  while (writer->refs)
+    pthread_cond_wait(&writers_released, &writers_lock);
+  pthread_mutex_unlock(&writers_lock);
+  pthread_mutex_lock(&writer->lock);
+  writer->stop = 1;
+  pthread_cond_signal(&writer->more);
+  pthread_mutex_unlock(&writer->lock);
+  pthread_join(writer->thread, NULL);
+  int status = writer->status;
+  TreeFreeDbid(writer->dbid);
+  pthread_cond_destroy(&writer->done);
+  pthread_cond_destroy(&writer->more);
+  pthread_mutex_destroy(&writer->lock);
+  free(writer);
+  return status;
+}
+
+EXPORT int TreeAsyncWriterGetStats(void *writer_in,
+                                   TREE_ASYNC_WRITER_STATS *stats)
+{
+  tree_async_writer_t *writer = (tree_async_writer_t *)writer_in;
+  if (!writer)
+    return TreeFAILURE;
+  pthread_mutex_lock(&writer->lock);
+  *stats = writer->stats;
+  pthread_mutex_unlock(&writer->lock);
+  return TreeSUCCESS;
+}
@@ -23,15 +23,16 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include "treeshrp.h"
-#include <ctype.h>
 #include <libroutines.h>
 #include <mds_stdarg.h>
 #include <mdsshr.h>
 #include <ncidef.h>
-#include <stdarg.h>
 #include <stdlib.h>
+#include <pthread_port.h>
 #include <string.h>
+#include <strings.h>
 #include <treeshr_hooks.h>
+#include <treeshr_messages.h>
 
 static int (*Notify)(TreeshrHookType, char *, int, int) = NULL;
 static void load_Notify()
@@ -47,144 +48,172 @@ int TreeCallHook(TreeshrHookType htype, TREE_INFO *info, int nid)
   return 1;
 }
 
-static char *_strcasestr(char *s1_in, char *s2_in)
+/* TDI names of the hooks, indexed by TreeshrHookType */
+static const char *const hook_names[] = {
+    "OpenTree", "OpenTreeEdit", "RetrieveTree", "WriteTree", "CloseTree",
+    "OpenNCIFileWrite", "OpenDataFileWrite", "GetData", "GetNci", "PutData",
+    "PutNci", "PutDataFull", "MakeSegment", "MakeSegmentFull",
+    "MakeTimestampedSegment", "MakeTimestampedSegmentFull", "UpdateSegment",
+    "PutSegment", "PutSegmentFull", "PutTimestampedSegment",
+    "PutTimestampedSegmentFull"};
+#define HOOK_TYPES (int)(sizeof(hook_names) / sizeof(hook_names[0]))
+#define MAX_HOOK_CALLBACKS 8
+
+uint32_t _TreeHookMask = (uint32_t)-1;
+static pthread_mutex_t hook_lock = PTHREAD_MUTEX_INITIALIZER;
+static TreeHookCallback hook_callbacks[HOOK_TYPES][MAX_HOOK_CALLBACKS];
+static int hook_count[HOOK_TYPES];
+static int (*TdiExecute)() = NULL;
+
+static inline int is_full(int type)
 {
-  /* This is needed because strcasestr() is no available on all platforms */
-  char *s1 = strdup(s1_in);
-  char *s2 = strdup(s2_in);
-  char *s;
-  for (s = s1; *s; s++)
-    *s = toupper((unsigned char)*s);
-  for (s = s2; *s; s++)
-    *s = toupper((unsigned char)*s);
-  s = strstr(s1, s2);
-  if (s)
-    s = s1_in + (s - s1);
-  free(s1);
-  free(s2);
-  return s;
+  return strstr(hook_names[type], "Full") != NULL;
 }
 
-static int isEnabled(char *hookName)
+static inline int is_tree_hook(int type)
 {
-  char *enabledHooks = getenv("TreeHooks");
-  if (enabledHooks == NULL)
-    return 0;
-  enabledHooks = strdup(enabledHooks);
-  if ((_strcasestr(enabledHooks, "allhooks") != NULL) &&
-      (_strcasestr(hookName, "full") == NULL))
-    return 1;
-  if ((_strcasestr(enabledHooks, "fullhooks") != NULL) &&
-      (_strcasestr(hookName, "full") != NULL))
-    return 1;
-
-  char *p = enabledHooks;
-  while (p)
-  {
-    p = _strcasestr(p, hookName);
-    if (p)
-    {
-      if (p == enabledHooks || p[-1] == ',')
-      {
-        size_t len = strlen(hookName);
-        if (p[len] == ',' || p[len] == '\0')
-          return 1;
-        else
-          p = p + len;
-      }
-      else
-        return 0;
-    }
-  }
-  free(enabledHooks);
-  return 0;
+  return type <= OpenDataFileWrite;
 }
 
-void TreeCallHookFun(char *hookType, char *hookName, ...)
+/* The TreeHooks configuration evaluates TreeShrHook($) with a dictionary of
+ * the hook arguments. It is registered like any other consumer.
+ */
+static void tdi_hook(TreeshrHookType type, char const *tree, int shot,
+                     int nid, struct descriptor *data)
 {
-  static int (*TdiExecute)() = NULL;
-  int status;
-  status = LibFindImageSymbol_C("TdiShr", "TdiExecute", &TdiExecute);
-  if (!(isEnabled(hookName) && STATUS_OK))
-    return;
   DESCRIPTOR(expression_d, "TreeShrHook($)");
   static DESCRIPTOR(hooktype_key_d, "type");
-  DESCRIPTOR_FROM_CSTRING(hooktype_d, hookName);
   static DESCRIPTOR(tree_key_d, "tree");
   static DESCRIPTOR(shot_key_d, "shot");
   static DESCRIPTOR(nid_key_d, "nid");
   static DESCRIPTOR(data_key_d, "data");
-  EMPTYXD(defaultAns);
-  struct descriptor_xd *ans = &defaultAns;
-  struct descriptor *dict = NULL;
-  if (strcmp(hookType, "TreeHook") == 0)
-  {
-    va_list ap;
-    va_start(ap, hookName);
-    char *tree = va_arg(ap, char *);
-    int shot = va_arg(ap, int);
-    struct descriptor_xd *this_ans = va_arg(ap, struct descriptor_xd *);
-    DESCRIPTOR_FROM_CSTRING(tree_d, tree);
-    DESCRIPTOR_LONG(shot_d, &shot);
-    va_end(ap);
-    ans = this_ans ? this_ans : &defaultAns;
-    struct descriptor *hook_dscs[] = {
-        (struct descriptor *)&hooktype_key_d, (struct descriptor *)&hooktype_d,
-        (struct descriptor *)&tree_key_d, (struct descriptor *)&tree_d,
-        (struct descriptor *)&shot_key_d, (struct descriptor *)&shot_d};
-    DESCRIPTOR_APD(hook_d, DTYPE_DICTIONARY, &hook_dscs, 6);
-    dict = (struct descriptor *)&hook_d;
-    (*TdiExecute)(&expression_d, dict, ans MDS_END_ARG);
-  }
-  else if (strcmp(hookType, "TreeNidHook") == 0)
+  DESCRIPTOR_FROM_CSTRING(hooktype_d, hook_names[type]);
+  DESCRIPTOR_FROM_CSTRING(tree_d, tree);
+  DESCRIPTOR_LONG(shot_d, &shot);
+  DESCRIPTOR_NID(nid_d, &nid);
+  EMPTYXD(ans);
+  struct descriptor *hook_dscs[] = {
+      (struct descriptor *)&hooktype_key_d, (struct descriptor *)&hooktype_d,
+      (struct descriptor *)&tree_key_d, (struct descriptor *)&tree_d,
+      (struct descriptor *)&shot_key_d, (struct descriptor *)&shot_d,
+      (struct descriptor *)&nid_key_d, (struct descriptor *)&nid_d,
+      (struct descriptor *)&data_key_d, data};
+  const int ndscs = is_tree_hook(type) ? 6 : (is_full(type) ? 10 : 8);
+  DESCRIPTOR_APD(hook_d, DTYPE_DICTIONARY, &hook_dscs, ndscs);
+  (*TdiExecute)(&expression_d, &hook_d, &ans MDS_END_ARG);
+  MdsFree1Dx(&ans, 0);
+}
+
+static void update_mask()
+{
+  uint32_t mask = 0;
+  int type;
+  for (type = 0; type < HOOK_TYPES; type++)
+    if (hook_count[type])
+      mask |= 1u << type;
+  _TreeHookMask = mask;
+}
+
+static int add_hook(int type, TreeHookCallback callback)
+{
+  int i;
+  for (i = 0; i < hook_count[type]; i++)
+    if (hook_callbacks[type][i] == callback)
+      return TreeSUCCESS;
+  if (hook_count[type] == MAX_HOOK_CALLBACKS)
+    return TreeFAILURE;
+  hook_callbacks[type][hook_count[type]++] = callback;
+  return TreeSUCCESS;
+}
+
+/* TreeHooks is a comma separated list of hook names, "allhooks" enables all
+ * but the *Full hooks and "fullhooks" enables those.
+ */
+static void hooks_init()
+{
+  uint32_t tdi_mask = 0;
+  int type;
+  char *env = getenv("TreeHooks");
+  if (env && *env &&
+      IS_OK(LibFindImageSymbol_C("TdiShr", "TdiExecute", &TdiExecute)))
   {
-    va_list ap;
-    va_start(ap, hookName);
-    char *tree = va_arg(ap, char *);
-    int shot = va_arg(ap, int);
-    int nid = va_arg(ap, int);
-    struct descriptor_xd *this_ans = va_arg(ap, struct descriptor_xd *);
-    DESCRIPTOR_FROM_CSTRING(tree_d, tree);
-    DESCRIPTOR_LONG(shot_d, &shot);
-    DESCRIPTOR_NID(nid_d, &nid);
-    va_end(ap);
-    ans = this_ans ? this_ans : &defaultAns;
-    struct descriptor *hook_dscs[] = {
-        (struct descriptor *)&hooktype_key_d, (struct descriptor *)&hooktype_d,
-        (struct descriptor *)&tree_key_d, (struct descriptor *)&tree_d,
-        (struct descriptor *)&shot_key_d, (struct descriptor *)&shot_d,
-        (struct descriptor *)&nid_key_d, (struct descriptor *)&nid_d};
-    DESCRIPTOR_APD(hook_d, DTYPE_DICTIONARY, &hook_dscs, 8);
-    dict = (struct descriptor *)&hook_d;
-    (*TdiExecute)(&expression_d, dict, ans MDS_END_ARG);
+    char *list = strdup(env);
+    char *saveptr = NULL;
+    char *name;
+    for (name = strtok_r(list, ",", &saveptr); name;
+         name = strtok_r(NULL, ",", &saveptr))
+    {
+      for (type = 0; type < HOOK_TYPES; type++)
+      {
+        if ((strcasecmp(name, "allhooks") == 0 && !is_full(type)) ||
+            (strcasecmp(name, "fullhooks") == 0 && is_full(type)) ||
+            strcasecmp(name, hook_names[type]) == 0)
+          tdi_mask |= 1u << type;
+      }
+    }
+    free(list);
   }
-  else if (strcmp(hookType, "TreeNidDataHook") == 0)
+  pthread_mutex_lock(&hook_lock);
+  for (type = 0; type < HOOK_TYPES; type++)
+    if (tdi_mask & (1u << type))
+      add_hook(type, tdi_hook);
+  update_mask();
+  pthread_mutex_unlock(&hook_lock);
+}
+
+EXPORT int TreeRegisterHook(TreeshrHookType type, TreeHookCallback callback)
+{
+  int status;
+  if ((int)type < 0 || (int)type >= HOOK_TYPES || !callback)
+    return TreeFAILURE;
+  RUN_FUNCTION_ONCE(hooks_init);
+  pthread_mutex_lock(&hook_lock);
+  status = add_hook(type, callback);
+  update_mask();
+  pthread_mutex_unlock(&hook_lock);
+  return status;
+}
+
+EXPORT int TreeUnregisterHook(TreeshrHookType type, TreeHookCallback callback)
+{
+  int status = TreeFAILURE;
+  int i;
+  if ((int)type < 0 || (int)type >= HOOK_TYPES)
+    return TreeFAILURE;
+  RUN_FUNCTION_ONCE(hooks_init);
+  pthread_mutex_lock(&hook_lock);
+  for (i = 0; i < hook_count[type]; i++)
   {
-    va_list ap;
-    va_start(ap, hookName);
-    char *tree = va_arg(ap, char *);
-    int shot = va_arg(ap, int);
-    int nid = va_arg(ap, int);
-    struct descriptor *data_d = va_arg(ap, struct descriptor *);
-    struct descriptor_xd *this_ans = va_arg(ap, struct descriptor_xd *);
-    DESCRIPTOR_FROM_CSTRING(tree_d, tree);
-    DESCRIPTOR_LONG(shot_d, &shot);
-    DESCRIPTOR_NID(nid_d, &nid);
-    va_end(ap);
-    ans = this_ans ? this_ans : &defaultAns;
-    struct descriptor *hook_dscs[] = {
-        (struct descriptor *)&hooktype_key_d, (struct descriptor *)&hooktype_d,
-        (struct descriptor *)&tree_key_d, (struct descriptor *)&tree_d,
-        (struct descriptor *)&shot_key_d, (struct descriptor *)&shot_d,
-        (struct descriptor *)&nid_key_d, (struct descriptor *)&nid_d,
-        (struct descriptor *)&data_key_d, data_d};
-    DESCRIPTOR_APD(hook_d, DTYPE_DICTIONARY, &hook_dscs, 10);
-    dict = (struct descriptor *)&hook_d;
-    (*TdiExecute)(&expression_d, dict, ans MDS_END_ARG);
+    if (hook_callbacks[type][i] == callback)
+    {
+      memmove(&hook_callbacks[type][i], &hook_callbacks[type][i + 1],
+              (hook_count[type] - i - 1) * sizeof(TreeHookCallback));
+      hook_count[type]--;
+      status = TreeSUCCESS;
+      break;
+    }
   }
-  else
-  {
+  update_mask();
+  pthread_mutex_unlock(&hook_lock);
+  return status;
+}
+
+/* Slow path of TREE_HOOKS, only reached for types with a consumer (and for
+ * the first hook before the configuration was read). The callbacks are
+ * copied so they run without holding the lock.
+ */
+void TreeCallHooks(TreeshrHookType type, char const *tree, int shot, int nid,
+                   struct descriptor *data)
+{
+  TreeHookCallback callbacks[MAX_HOOK_CALLBACKS];
+  int i, n;
+  RUN_FUNCTION_ONCE(hooks_init);
+  if ((int)type < 0 || (int)type >= HOOK_TYPES)
     return;
-  }
-  MdsFree1Dx(&defaultAns, 0);
+  pthread_mutex_lock(&hook_lock);
+  n = hook_count[type];
+  memcpy(callbacks, hook_callbacks[type], n * sizeof(TreeHookCallback));
+  pthread_mutex_unlock(&hook_lock);
+  for (i = 0; i < n; i++)
+    callbacks[i](type, tree, shot, nid, data);
 }
@@ -225,6 +225,8 @@ static int TreeCreateTreeFilesOne(char const *tree, int shot, int source_shot,
     if (dst[i] >= 0)
       MDS_IO_CLOSE(dst[i]);
   }
+  if (STATUS_OK)
+    tree_segcache_purge(tree, shot);
   return status;
 }
 
@@ -100,6 +100,7 @@ static inline int TreeDeleteTreeFilesOne(char *tree, int shot, char *treepath)
       retstatus = MDS_IO_REMOVE(tmp[i]);
     free(tmp[i]);
   }
+  tree_segcache_purge(tree, shot);
   return retstatus ? TreeFAILURE : status;
 }
 
@@ -76,6 +76,10 @@ static NODELIST *FindMembersOrChildren(PINO_DATABASE *dblist, SEARCH_TERM *term,
 static NODELIST *FindTagWild(PINO_DATABASE *dblist, SEARCH_TERM *term,
                              NODELIST **tail);
 static NODELIST *Filter(NODELIST *list, int mask);
+static int IndexFind(TREE_INDEX *index, SEARCH_TERM *term, NODE *start,
+                     NODELIST **answer, NODELIST **tail);
+static int IndexFindNamed(TREE_INDEX *index, SEARCH_TERM *term, NODE *start,
+                          NODELIST **answer, NODELIST **tail);
 /*
  * External routines (not exported) defined here
  */
@@ -289,10 +293,41 @@ static void FreeSearchCtx(SEARCH_CTX *ctx)
   free(ctx->wildcard);
   FreeSearchTerms(ctx->terms);
 }
+
+/* Map the lazily opened subtrees a term looks into, see TreeOpen.c.
+ * Returns the node to search from.
+ */
+static NODE *LazyStart(PINO_DATABASE *dblist, SEARCH_TERM *term, NODE *start)
+{
+  switch (term->search_type)
+  {
+  case (CHILD_SEARCH):
+  case (MEMBER_SEARCH):
+  case (CHILD_OR_MEMBER_SEARCH):
+    start = tree_lazy_node(dblist, start);
+    tree_lazy_load_below(dblist, start);
+    return start;
+  case (CHILD):
+  case (MEMBER):
+  case (CHILD_OR_MEMBER):
+    return tree_lazy_node(dblist, start);
+  default:
+    return start;
+  }
+}
+
 static NODELIST *Search(PINO_DATABASE *dblist, SEARCH_CTX *ctx,
                         SEARCH_TERM *term, NODE *start, NODELIST **tail)
 {
-  NODELIST *nodes = term ? Find(dblist, term, start, tail) : NULL;
+  NODELIST *nodes = NULL;
+  TREE_INDEX *index;
+  if (term && start && dblist->lazy)
+    start = LazyStart(dblist, term, start);
+  if (term && term->next && (index = tree_index_get(dblist)) &&
+      IndexFindNamed(index, term, start, &nodes, tail))
+    term = term->next; // answered both terms
+  else
+    nodes = term ? Find(dblist, term, start, tail) : NULL;
   if (nodes)
   {
     NODELIST *more_nodes = NULL;
@@ -335,6 +370,9 @@ static NODELIST *Find(PINO_DATABASE *dblist, SEARCH_TERM *term, NODE *start,
   {
     term->search_type = CHILD_OR_MEMBER;
   }
+  TREE_INDEX *index = tree_index_get(dblist);
+  if (index && IndexFind(index, term, start, &answer, tail))
+    return answer;
   char trimmed[sizeof(NODE_NAME) + 1];
   switch (term->search_type)
   {
@@ -440,6 +478,153 @@ static NODELIST *Find(PINO_DATABASE *dblist, SEARCH_TERM *term, NODE *start,
   return (answer);
 }
 
+/* is entry i below entry s, through member (1), child (0) or any (-1) links
+ */
+static int IndexBelow(const TREE_INDEX *index, int i, int s, int kind)
+{
+  const int depth = index->entry[s].depth;
+  while (index->entry[i].depth > depth)
+  {
+    if (kind >= 0 && index->entry[i].is_member != kind)
+      return FALSE;
+    i = index->entry[i].parent;
+  }
+  return i == s;
+}
+
+/* Answer a search term from the index, in the order of the node walks of
+ * Find. Returns FALSE if the term must be searched by walking the nodes.
+ */
+static int IndexFind(TREE_INDEX *index, SEARCH_TERM *term, NODE *start,
+                     NODELIST **answer, NODELIST **tail)
+{
+  const int s = tree_index_entry(index, start);
+  if (s < 0)
+    return FALSE;
+  const TREE_INDEX_ENTRY *const entry = index->entry;
+  const char *search_term = (strlen(term->term)) ? term->term : "*";
+  int i, first, last, kind;
+  switch (term->search_type)
+  {
+  case (CHILD_OR_MEMBER):
+  {
+    if (is_wild3(term->term))
+      return FALSE;
+    /* names are unique among the members and children of a node */
+    if ((i = tree_index_child(index, s, term->term)) >= 0)
+      *answer = AddNodeList(*answer, tail, entry[i].node);
+    return TRUE;
+  }
+  case (CHILD):
+  case (MEMBER):
+  {
+    first = entry[s].kids;
+    last = first + entry[s].members;
+    if (term->search_type == CHILD)
+    {
+      first = last;
+      last += entry[s].children;
+    }
+    for (i = first; i < last; i++)
+      if (match(term->term, (char *)entry[i].name))
+        *answer = AddNodeList(*answer, tail, entry[i].node);
+    return TRUE;
+  }
+  case (CHILD_SEARCH):
+  case (MEMBER_SEARCH):
+  case (CHILD_OR_MEMBER_SEARCH):
+    break;
+  default:
+    return FALSE;
+  }
+  kind = term->search_type == MEMBER_SEARCH  ? 1
+         : term->search_type == CHILD_SEARCH ? 0
+                                             : -1;
+  *tail = NULL;
+  if (kind < 0)
+    *answer = AddNodeList(*answer, tail, start);
+  if (!is_wild3(search_term))
+  {
+    /* the nodes of one name are chained in breadth first order */
+    for (i = tree_index_named(index, search_term); i >= 0;
+         i = entry[i].next_name)
+      if (i != s && IndexBelow(index, i, s, kind))
+        *answer = AddNodeList(*answer, tail, entry[i].node);
+    return TRUE;
+  }
+  /* breadth first walk of the subtree, the kids of a node are consecutive */
+  int *queue = malloc(index->count * sizeof(int));
+  int head = 0, count = 0;
+  queue[count++] = s;
+  while (head < count)
+  {
+    const int p = queue[head++];
+    first = entry[p].kids;
+    last = first + entry[p].members + entry[p].children;
+    if (kind == 0)
+      first += entry[p].members;
+    else if (kind == 1)
+      last = first + entry[p].members;
+    for (i = first; i < last; i++)
+    {
+      queue[count++] = i;
+      if (match((char *)search_term, (char *)entry[i].name))
+        *answer = AddNodeList(*answer, tail, entry[i].node);
+    }
+  }
+  free(queue);
+  return TRUE;
+}
+
+/* Answer a subtree search followed by a plain name, as in ***:NAME, from
+ * the nodes of that name instead of looking at the kids of every node of
+ * the subtree. Returns FALSE if the terms do not have this form.
+ */
+static int IndexFindNamed(TREE_INDEX *index, SEARCH_TERM *term, NODE *start,
+                          NODELIST **answer, NODELIST **tail)
+{
+  const SEARCH_TERM *const next = term->next;
+  int kind;
+  switch (term->search_type)
+  {
+  case (CHILD_SEARCH):
+    kind = 0;
+    break;
+  case (MEMBER_SEARCH):
+    kind = 1;
+    break;
+  case (CHILD_OR_MEMBER_SEARCH):
+    kind = -1;
+    break;
+  default:
+    return FALSE;
+  }
+  if ((next->search_type != CHILD && next->search_type != MEMBER &&
+       next->search_type != CHILD_OR_MEMBER) ||
+      is_wild3(next->term))
+    return FALSE;
+  const int s = tree_index_entry(index, start);
+  if (s < 0)
+    return FALSE;
+  const TREE_INDEX_ENTRY *const entry = index->entry;
+  const char *search_term = (strlen(term->term)) ? term->term : "*";
+  int i;
+  *tail = NULL;
+  /* a plain name matches either link, see Find, and names are unique among
+   * the kids of a node, so the answers are in the order of their parents */
+  for (i = tree_index_named(index, next->term); i >= 0; i = entry[i].next_name)
+  {
+    const int p = entry[i].parent;
+    if (p < 0)
+      continue;
+    if ((p == s) ? kind < 0
+                 : IndexBelow(index, p, s, kind) &&
+                       match((char *)search_term, (char *)entry[p].name))
+      *answer = AddNodeList(*answer, tail, entry[i].node);
+  }
+  return TRUE;
+}
+
 static NODELIST *FindTags(PINO_DATABASE *dblist, TREE_INFO *info, int treenum,
                           char *tagname, NODELIST **tail)
 {
@@ -450,6 +635,9 @@ static NODELIST *FindTags(PINO_DATABASE *dblist, TREE_INFO *info, int treenum,
   int tag_wild = is_wild2(tagname);
   *tail = NULL;
   NODE *n;
+  TREE_INDEX *index;
+  if (tree_lazy(info))
+    tree_lazy_load(dblist, info);
   nid.tree = treenum;
   if (match(tagname, "TOP"))
   {
@@ -459,6 +647,12 @@ static NODELIST *FindTags(PINO_DATABASE *dblist, TREE_INFO *info, int treenum,
       n = child_of(dblist, n);
     answer = AddNodeList(answer, tail, n);
   }
+  else if (!is_wild3(tagname) && (index = tree_index_get(dblist)))
+  {
+    n = tree_index_tag(index, info, tagname);
+    if (n)
+      answer = AddNodeList(answer, tail, n);
+  }
   else
   {
     char trimmed[sizeof(TAG_NAME) + 1];
@@ -173,6 +173,8 @@ int _TreeFindTag(PINO_DATABASE *db, NODE *default_node, short treelen,
   }
   if (tsearch.info == NULL)
     return TreeTNF;
+  if (tree_lazy(tsearch.info))
+    tree_lazy_load(db, tsearch.info);
 
   /***********************************************
   If the tag name specified is the reserved name
@@ -337,7 +337,11 @@ static int nextTagTree(PINO_DATABASE *dblist, TAG_SEARCH *ctx)
   {
     DESCRIPTOR_FROM_CSTRING(treenam, ctx->this_tree_info->treenam);
     if (IS_OK(StrMatchWild(&treenam, (mdsdsc_t *)&ctx->search_tree)))
+    {
+      if (tree_lazy(ctx->this_tree_info))
+        tree_lazy_load(dblist, ctx->this_tree_info);
       return TreeSUCCESS;
+    }
   }
   return TreeNMT;
 }
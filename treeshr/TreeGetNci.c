@@ -52,8 +52,7 @@ static inline int minInt(int a, int b) { return a < b ? a : b; }
   if (nci_version != version)                                                \
   {                                                                          \
     nid_to_tree_nidx(dblist, (&nid), info, node_number);                     \
-    TreeCallHookFun("TreeNidHook", "GetNci", info->treenam, info->shot, nid, \
-                    NULL);                                                   \
+    TREE_HOOKS(GetNci, info->treenam, info->shot, nid_in, NULL);             \
     status = TreeCallHook(GetNci, info, nid_in);                             \
     if (status && STATUS_NOT_OK)                                             \
       break;                                                                 \
@@ -243,6 +242,8 @@ int TreeGetNci(int nid_in, struct nci_itm *nci_itm)
   if (dblist->remote)
     return GetNciRemote(dbid, nid_in, nci_itm);
   saved_node = nid_to_node(dblist, &nid);
+  if (dblist->lazy)
+    saved_node = tree_lazy_node(dblist, saved_node);
   node_exists = saved_node && (saved_node->name[0] < 'a');
   for (itm = nci_itm; itm->code != NciEND_OF_LIST && STATUS_OK; itm++)
   {
@@ -929,8 +930,8 @@ int _TreeIsOn(void *dbid, int nid)
 }
 int TreeIsOn(int nid) { return _TreeIsOn(*TreeCtx(), nid); }
 
-int tree_get_nci(TREE_INFO *info, int node_num, NCI *nci, unsigned int version,
-                 int *locked)
+static int get_nci(TREE_INFO *info, int node_num, NCI *nci,
+                   unsigned int version, int *locked)
 {
   int status = TreeSUCCESS;
   /******************************************
@@ -1011,6 +1012,15 @@ int tree_get_nci(TREE_INFO *info, int node_num, NCI *nci, unsigned int version,
   return status;
 }
 
+int tree_get_nci(TREE_INFO *info, int node_num, NCI *nci, unsigned int version,
+                 int *locked)
+{
+  uint64_t start = tree_perf_now();
+  int status = get_nci(info, node_num, nci, version, locked);
+  tree_perf_record(TREE_PERF_NCI_READ, start, NULL, info, node_num);
+  return status;
+}
+
 int TreeOpenNciR(TREE_INFO *info)
 {
   INIT_STATUS_AS TreeSUCCESS;
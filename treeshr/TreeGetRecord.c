@@ -75,7 +75,7 @@ static inline int read_descriptor(TREE_INFO *info, int length, NCI *nci, int nid
   return status;
 }
 
-int _TreeGetRecord(void *dbid, int nid_in, mdsdsc_xd_t *dsc)
+static int tree_get_record(void *dbid, int nid_in, mdsdsc_xd_t *dsc)
 {
   PINO_DATABASE *dblist = (PINO_DATABASE *)dbid;
   NID *nid = (NID *)&nid_in;
@@ -91,8 +91,7 @@ int _TreeGetRecord(void *dbid, int nid_in, mdsdsc_xd_t *dsc)
   int nidx = nid_to_tree_idx(dblist, nid, &info);
   if (info)
   {
-    TreeCallHookFun("TreeNidHook", "GetNci", info->treenam, info->shot, nid,
-                    NULL);
+    TREE_HOOKS(GetNci, info->treenam, info->shot, nid_in, NULL);
     status = TreeCallHook(GetNci, info, nid_in);
     if (status && STATUS_NOT_OK)
       return 0;
@@ -105,8 +104,7 @@ int _TreeGetRecord(void *dbid, int nid_in, mdsdsc_xd_t *dsc)
       {
         if (nci.length)
         {
-          TreeCallHookFun("TreeNidHook", "GetData", info->treenam,
-                          info->shot, nid, NULL);
+          TREE_HOOKS(GetData, info->treenam, info->shot, nid_in, NULL);
           status = TreeCallHook(GetData, info, nid_in);
           if (status && STATUS_NOT_OK)
             return 0;
@@ -136,11 +134,20 @@ int _TreeGetRecord(void *dbid, int nid_in, mdsdsc_xd_t *dsc)
                   status = TreeBADRECORD;
                 else if (attributes.facility_offset[STANDARD_RECORD_FACILITY] != -1)
                 {
-                  status = tree_get_dsc(
-                      info, nid->tree,
-                      attributes.facility_offset[STANDARD_RECORD_FACILITY],
-                      attributes.facility_length[STANDARD_RECORD_FACILITY],
-                      dsc);
+                  const int64_t offset =
+                      attributes.facility_offset[STANDARD_RECORD_FACILITY];
+                  status = tree_cache_get(info, nidx, offset,
+                                          nci.time_inserted, dsc);
+                  if (STATUS_NOT_OK)
+                  {
+                    status = tree_get_dsc(
+                        info, nid->tree, offset,
+                        attributes.facility_length[STANDARD_RECORD_FACILITY],
+                        dsc);
+                    if (STATUS_OK)
+                      tree_cache_put(info, nidx, offset, nci.time_inserted,
+                                     dsc);
+                  }
                 }
                 else if (attributes.facility_offset[SEGMENTED_RECORD_FACILITY] != -1)
                 {
@@ -189,7 +196,17 @@ int _TreeGetRecord(void *dbid, int nid_in, mdsdsc_xd_t *dsc)
                   int length = nci.DATA_INFO.DATA_LOCATION.record_length;
                   if (length > 0)
                   {
-                    status = read_descriptor(info, length, &nci, nidx, dsc);
+                    const int64_t offset =
+                        RfaToSeek(nci.DATA_INFO.DATA_LOCATION.rfa);
+                    status = tree_cache_get(info, nidx, offset,
+                                            nci.time_inserted, dsc);
+                    if (STATUS_NOT_OK)
+                    {
+                      status = read_descriptor(info, length, &nci, nidx, dsc);
+                      if (STATUS_OK)
+                        tree_cache_put(info, nidx, offset, nci.time_inserted,
+                                       dsc);
+                    }
                   }
                   else
                     status = TreeBADRECORD;
@@ -214,6 +231,15 @@ int _TreeGetRecord(void *dbid, int nid_in, mdsdsc_xd_t *dsc)
   return status;
 }
 
+int _TreeGetRecord(void *dbid, int nid_in, mdsdsc_xd_t *dsc)
+{
+  uint64_t start = tree_perf_now();
+  int status = tree_get_record(dbid, nid_in, dsc);
+  tree_perf_record(TREE_PERF_GET_RECORD, start, (PINO_DATABASE *)dbid, NULL,
+                   nid_in);
+  return status;
+}
+
 int TreeOpenDatafileR(TREE_INFO *info)
 {
   int status = 1;
@@ -0,0 +1,318 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*------------------------------------------------------------------------------
+
+                Name: TreeIndex
+
+                Type:   C functions
+
+                Purpose: In memory index of node names and tags for path lookup
+
+------------------------------------------------------------------------------
+
+        Description:
+
+   Resolving a path walks the brother links of every level and wildcard
+   searches (***) test every node with is_member, which scans the member
+   list of the parent, so large flat trees are searched in quadratic time.
+   The index is built once per open tree context, the first time a path is
+   looked up, and holds:
+
+     - every node in breadth first order, which is the order in which the
+       searches report their answers; the members and then the children of
+       a node are consecutive so a subtree is walked without node links,
+     - a hash of (parent, name) for non wild path components,
+     - a hash of names, chaining all nodes of the same name in breadth
+       first order, for non wild ***, ... and ::: terms,
+     - a hash of (tree, tag) for tag references.
+
+   Trees open for edit are not indexed. The index is released when the top
+   tree of the context is closed, so a tree that was edited is indexed
+   again from its new structure the next time it is opened.
+
++-----------------------------------------------------------------------------*/
+#include <mdsplus/mdsconfig.h>
+#include <mdsplus/mdsplus.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <treeshr.h>
+
+#include "treeshrp.h"
+
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t hash_name(const char *name, uint32_t h)
+{
+  for (; *name; name++)
+    h = (h ^ (uint8_t)*name) * 16777619u;
+  return h;
+}
+
+static inline uint32_t hash_node(const NODE *node)
+{
+  const uintptr_t p = (uintptr_t)node / sizeof(NODE);
+  return (uint32_t)(p ^ (p >> 29)) * 2654435761u;
+}
+
+static void trim_cpy(char *buf, const char *str, size_t len)
+{
+  size_t i;
+  for (i = 0; i < len && str[i] != ' '; i++)
+    buf[i] = str[i];
+  buf[i] = '\0';
+}
+
+static int node_slot(const TREE_INDEX *index, const NODE *node)
+{
+  uint32_t h = hash_node(node) & index->mask;
+  int i;
+  while ((i = index->nodes[h]) >= 0 && index->entry[i].node != node)
+    h = (h + 1) & index->mask;
+  return h;
+}
+
+static int add_node(TREE_INDEX *index, NODE *node, int parent, int is_member)
+{
+  const int h = node_slot(index, node);
+  if (index->nodes[h] >= 0)
+    return FALSE; // already indexed, a damaged tree would otherwise loop
+  const int i = index->count++;
+  TREE_INDEX_ENTRY *e = &index->entry[i];
+  index->nodes[h] = i;
+  e->node = node;
+  e->parent = parent;
+  e->depth = parent < 0 ? 0 : index->entry[parent].depth + 1;
+  e->is_member = is_member;
+  e->next_name = -1;
+  trim_cpy(e->name, node->name, sizeof(NODE_NAME));
+  return TRUE;
+}
+
+static void add_names(TREE_INDEX *index)
+{
+  int i;
+  // backwards, so every chain of names is in breadth first order
+  for (i = index->count; i-- > 0;)
+  {
+    TREE_INDEX_ENTRY *e = &index->entry[i];
+    uint32_t h = hash_name(e->name, 2166136261u) & index->mask;
+    int j;
+    while ((j = index->names[h]) >= 0 && strcmp(index->entry[j].name, e->name))
+      h = (h + 1) & index->mask;
+    e->next_name = j;
+    index->names[h] = i;
+    if (e->parent < 0)
+      continue;
+    h = hash_name(e->name, 2166136261u ^ (uint32_t)e->parent) & index->mask;
+    while ((j = index->edges[h]) >= 0 && (index->entry[j].parent != e->parent ||
+                                         strcmp(index->entry[j].name, e->name)))
+      h = (h + 1) & index->mask;
+    index->edges[h] = i; // keeps the first of duplicate names
+  }
+}
+
+static void add_tags(TREE_INDEX *index, PINO_DATABASE *dblist)
+{
+  TREE_INFO *info;
+  int ntags = 0, treenum;
+  for (info = dblist->tree_info; info; info = info->next_info)
+    ntags += info->header->tags;
+  for (index->tag_mask = 15; index->tag_mask < 2 * ntags;)
+    index->tag_mask = index->tag_mask * 2 + 1;
+  index->tag = calloc(ntags + 1, sizeof(*index->tag));
+  index->tags = malloc((index->tag_mask + 1) * sizeof(int));
+  memset(index->tags, -1, (index->tag_mask + 1) * sizeof(int));
+  for (treenum = 0, info = dblist->tree_info; info;
+       info = info->next_info, treenum++)
+  {
+    int t;
+    NID nid;
+    nid.tree = treenum;
+    for (t = 0; t < info->header->tags; t++)
+    {
+      TREE_INDEX_TAG *tag = &index->tag[index->ntags];
+      trim_cpy(tag->name, info->tag_info[t].name, sizeof(TAG_NAME));
+      nid.node = swapint32(&info->tag_info[t].node_idx);
+      tag->info = info;
+      tag->node = nid_to_node(dblist, &nid);
+      if (!tag->node)
+        continue;
+      if (tag->node->usage == TreeUSAGE_SUBTREE_REF)
+        tag->node = child_of(dblist, tag->node);
+      uint32_t h = hash_name(tag->name, (uint32_t)(uintptr_t)info) &
+                   index->tag_mask;
+      int j;
+      while ((j = index->tags[h]) >= 0 &&
+             (index->tag[j].info != info || strcmp(index->tag[j].name, tag->name)))
+        h = (h + 1) & index->tag_mask;
+      if (j < 0)
+        index->tags[h] = index->ntags++;
+    }
+  }
+}
+
+static TREE_INDEX *build(PINO_DATABASE *dblist)
+{
+  TREE_INFO *info;
+  int capacity = 0;
+  for (info = dblist->tree_info; info; info = info->next_info)
+    capacity += info->header->nodes ? info->header->nodes
+                                    : 1; // stand-in top of a lazy subtree
+  if (capacity <= 0 || !dblist->tree_info->root)
+    return NULL;
+  TREE_INDEX *index = calloc(1, sizeof(TREE_INDEX));
+  index->tree_info = dblist->tree_info;
+  for (index->mask = 15; index->mask < 2 * capacity;)
+    index->mask = index->mask * 2 + 1;
+  const size_t table = (index->mask + 1) * sizeof(int);
+  index->entry = malloc(capacity * sizeof(TREE_INDEX_ENTRY));
+  index->nodes = malloc(table);
+  index->names = malloc(table);
+  index->edges = malloc(table);
+  memset(index->nodes, -1, table);
+  memset(index->names, -1, table);
+  memset(index->edges, -1, table);
+  add_node(index, dblist->tree_info->root, -1, FALSE);
+  int i;
+  for (i = 0; i < index->count; i++)
+  {
+    NODE *n;
+    index->entry[i].kids = index->count;
+    index->entry[i].members = index->entry[i].children = 0;
+    for (n = member_of(index->entry[i].node);
+         n && index->count < capacity; n = brother_of(dblist, n))
+      if (add_node(index, n, i, TRUE))
+        index->entry[i].members++;
+    for (n = child_of(dblist, index->entry[i].node);
+         n && index->count < capacity; n = brother_of(dblist, n))
+      if (add_node(index, n, i, FALSE))
+        index->entry[i].children++;
+  }
+  add_names(index);
+  add_tags(index, dblist);
+  return index;
+}
+
+static void index_free(TREE_INDEX *index)
+{
+  while (index)
+  {
+    TREE_INDEX *retired = index->retired;
+    free(index->entry);
+    free(index->nodes);
+    free(index->names);
+    free(index->edges);
+    free(index->tag);
+    free(index->tags);
+    free(index);
+    index = retired;
+  }
+}
+
+/* Index of the open trees, built on first use; NULL if not indexed */
+TREE_INDEX *tree_index_get(PINO_DATABASE *dblist)
+{
+  if (!dblist || !dblist->tree_info || dblist->open_for_edit ||
+      dblist->remote)
+    return NULL;
+  TREE_INDEX *index;
+  pthread_mutex_lock(&index_lock);
+  index = dblist->index;
+  if (index && index->tree_info != dblist->tree_info)
+  {
+    index_free(index);
+    index = dblist->index = NULL;
+  }
+  if (!index)
+    index = dblist->index = build(dblist);
+  else if (index->stale)
+  {
+    TREE_INDEX *fresh = build(dblist);
+    if (fresh)
+    {
+      fresh->retired = index;
+      index = dblist->index = fresh;
+    }
+  }
+  pthread_mutex_unlock(&index_lock);
+  return index;
+}
+
+void tree_index_free(PINO_DATABASE *dblist)
+{
+  pthread_mutex_lock(&index_lock);
+  index_free(dblist->index);
+  dblist->index = NULL;
+  pthread_mutex_unlock(&index_lock);
+}
+
+/* Rebuild the index on next use after the trees changed (a lazy subtree was
+   mapped). Other threads may still search the current one, so it is kept
+   until the trees are closed. */
+void tree_index_retire(PINO_DATABASE *dblist)
+{
+  pthread_mutex_lock(&index_lock);
+  if (dblist->index)
+    dblist->index->stale = 1;
+  pthread_mutex_unlock(&index_lock);
+}
+
+int tree_index_entry(const TREE_INDEX *index, const NODE *node)
+{
+  return index->nodes[node_slot(index, node)];
+}
+
+int tree_index_child(const TREE_INDEX *index, int parent, const char *name)
+{
+  uint32_t h = hash_name(name, 2166136261u ^ (uint32_t)parent) & index->mask;
+  int j;
+  while ((j = index->edges[h]) >= 0 && (index->entry[j].parent != parent ||
+                                       strcmp(index->entry[j].name, name)))
+    h = (h + 1) & index->mask;
+  return j;
+}
+
+int tree_index_named(const TREE_INDEX *index, const char *name)
+{
+  uint32_t h = hash_name(name, 2166136261u) & index->mask;
+  int j;
+  while ((j = index->names[h]) >= 0 && strcmp(index->entry[j].name, name))
+    h = (h + 1) & index->mask;
+  return j;
+}
+
+NODE *tree_index_tag(const TREE_INDEX *index, const TREE_INFO *info,
+                     const char *name)
+{
+  uint32_t h = hash_name(name, (uint32_t)(uintptr_t)info) & index->tag_mask;
+  int j;
+  while ((j = index->tags[h]) >= 0 &&
+         (index->tag[j].info != info || strcmp(index->tag[j].name, name)))
+    h = (h + 1) & index->tag_mask;
+  return j < 0 ? NULL : index->tag[j].node;
+}
@@ -33,6 +33,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <string.h>
 #include <strroutines.h>
+#include <sys/stat.h>
 #include <treeshr.h>
 
 #include <mdsplus/mdsconfig.h>
@@ -74,13 +75,16 @@ int treeshr_errno = 0;
 extern int MDSEventCan();
 static void RemoveBlanksAndUpcase(char *out, char const *in);
 static int close_top_tree(PINO_DATABASE *dblist, int call_hook);
+typedef struct prefetch prefetch_t;
 static int ConnectTree(PINO_DATABASE *dblist, char *tree, NODE *parent,
-                       char *subtree_list);
+                       char *subtree_list, prefetch_t *prefetch);
 static int CreateDbSlot(PINO_DATABASE **dblist, char *tree, int shot,
                         int editting);
 static int MapFile(int fd, TREE_INFO *info, int nomap);
 static int GetVmForTree(TREE_INFO *info, int nomap);
 static int MapTree(TREE_INFO *info, TREE_INFO *root, int edit_flag);
+int OpenOne(TREE_INFO *info, TREE_INFO *root, tree_type_t type, int new,
+            int edit_flag, char **filespec, int *fd_out);
 static void SubtreeNodeConnect(PINO_DATABASE *dblist, NODE *parent,
                                NODE *subtreetop);
 extern void TreeCleanupConnections();
@@ -194,7 +198,7 @@ static void free_top_db(PINO_DATABASE **dblist)
   }
 }
 
-EXPORT int _TreeOpen(void **dbid, char const *tree_in, int shot_in,
+static int tree_open(void **dbid, char const *tree_in, int shot_in,
                      int read_only_flag)
 {
   int status;
@@ -230,7 +234,7 @@ EXPORT int _TreeOpen(void **dbid, char const *tree_in, int shot_in,
       int db_slot_status = CreateDbSlot(dblist, tree, shot, 0);
       if (db_slot_status == TreeSUCCESS || db_slot_status == TreeALREADY_OPEN)
       {
-        status = ConnectTree(*dblist, tree, 0, subtree_list);
+        status = ConnectTree(*dblist, tree, 0, subtree_list, NULL);
         if (status == TreeUNSUPTHICKOP)
           if (strlen(path) > 2 && path[strlen(path) - 2] == ':' &&
               path[strlen(path) - 1] == ':')
@@ -259,6 +263,15 @@ EXPORT int _TreeOpen(void **dbid, char const *tree_in, int shot_in,
   return status;
 }
 
+EXPORT int _TreeOpen(void **dbid, char const *tree_in, int shot_in,
+                     int read_only_flag)
+{
+  uint64_t start = tree_perf_now();
+  int status = tree_open(dbid, tree_in, shot_in, read_only_flag);
+  tree_perf_record(TREE_PERF_OPEN, start, STATUS_OK ? *dbid : NULL, NULL, -1);
+  return status;
+}
+
 static void RemoveBlanksAndUpcase(char *out, char const *in)
 {
   while (*in)
@@ -334,6 +347,8 @@ static int close_top_tree(PINO_DATABASE *dblist, int call_hook)
   int status = TreeSUCCESS;
   if (!dblist)
     return status;
+  tree_async_close_owner(dblist);
+  tree_index_free(dblist);
   if (dblist->dispatch_table)
   {
     static int (*ServerFreeDispatchTable)() = NULL;
@@ -444,12 +459,13 @@ static int close_top_tree(PINO_DATABASE *dblist, int call_hook)
             free(local_info->nci_file);
             local_info->nci_file = NULL;
           }
-          if (call_hook)
+          if (call_hook && local_info->root != &local_info->lazy_top)
           {
-            TreeCallHookFun("TreeHook", "CloseTree", local_info->treenam,
-                            local_info->shot, NULL);
+            TREE_HOOKS(CloseTree, local_info->treenam, local_info->shot, 0,
+                       NULL);
             TreeCallHook(CloseTree, local_info, 0);
           }
+          tree_segcache_close(local_info);
           free(local_info->filespec);
           free(local_info->treenam);
           if (local_info->has_lock)
@@ -470,6 +486,7 @@ static int close_top_tree(PINO_DATABASE *dblist, int call_hook)
     dblist->open_for_edit = 0;
     dblist->modified = 0;
     dblist->remote = 0;
+    dblist->lazy = 0;
     free(dblist->experiment);
     dblist->experiment = NULL;
     free(dblist->main_treenam);
@@ -485,14 +502,537 @@ int _TreeIsOpen(void *dbid)
                                   : (IS_OPEN(dblist) ? TreeOPEN : TreeNOT_OPEN);
 }
 
+/// Identify the file at filespec, all zero if it cannot be stat'ed (e.g. a
+/// tree file accessed through mdsip).
+static void tree_file_id(const char *filespec, int64_t id[3])
+{
+  struct stat st;
+  if (filespec && !stat(filespec, &st))
+  {
+    id[0] = (int64_t)st.st_ino;
+    id[1] = (int64_t)st.st_size;
+    id[2] = (int64_t)st.st_mtime;
+  }
+  else
+    id[0] = id[1] = id[2] = 0;
+}
+
+/// TreeSUCCESS if a tree file of the open trees was replaced or rewritten
+/// since it was mapped, e.g. by a new model or a re-created shot, so that
+/// the open tree no longer shows what is on disk; TreeFAILURE otherwise.
+int _TreeFilesChanged(void *dbid)
+{
+  PINO_DATABASE *dblist = (PINO_DATABASE *)dbid;
+  TREE_INFO *info;
+  if (!IS_OPEN(dblist))
+    return TreeFAILURE;
+  for (info = dblist->tree_info; info; info = info->next_info)
+  {
+    int64_t id[3];
+    if (!info->file_id[0])
+      continue; // not known, or a lazy subtree not mapped yet
+    tree_file_id(info->filespec, id);
+    if (memcmp(id, info->file_id, sizeof(id)))
+      return TreeSUCCESS;
+  }
+  return TreeFAILURE;
+}
+
 int _TreeEditing(void *dbid)
 {
   PINO_DATABASE *dblist = (PINO_DATABASE *)dbid;
   return IS_OPEN_FOR_EDIT(dblist) ? TreeSUCCESS : TreeNOEDIT;
 }
 
-static int ConnectTree(PINO_DATABASE *dblist, char *tree, NODE *parent,
+static int in_subtree_list(char *tree, char *subtree_list)
+{
+  char *found;
+  char *tmp_list = malloc(strlen(subtree_list) + 3);
+  char *tmp_tree = malloc(strlen(tree) + 3);
+  strcpy(tmp_list, ",");
+  strcat(tmp_list, subtree_list);
+  strcat(tmp_list, ",");
+  strcpy(tmp_tree, ",");
+  strcat(tmp_tree, tree);
+  strcat(tmp_tree, ",");
+  found = strstr(tmp_list, tmp_tree);
+  free(tmp_list);
+  free(tmp_tree);
+  return found != NULL;
+}
+
+static char *external_name(NODE *external_node)
+{
+  char *subtree = strncpy(calloc(1, sizeof(NODE_NAME) + 1),
+                          external_node->name, sizeof(NODE_NAME));
+  subtree[sizeof(NODE_NAME)] = '\0';
+  char *blank = strchr(subtree, ' ');
+  if (blank)
+    *blank = '\0';
+  return subtree;
+}
+
+static TREE_INFO *find_tree_info(PINO_DATABASE *dblist, char *tree)
+{
+  TREE_INFO *info;
+  for (info = dblist->tree_info; info && strcmp(tree, info->treenam);
+       info = info->next_info)
+    ;
+  return info;
+}
+
+static TREE_INFO *new_tree_info(PINO_DATABASE *dblist, char *tree)
+{
+  TREE_INFO *info = calloc(1, sizeof(TREE_INFO));
+  if (info)
+  {
+    info->has_lock = !TreeUsingPrivateCtx();
+    if (info->has_lock)
+      pthread_rwlock_init(&info->lock, NULL);
+    info->flush = (dblist->shotid == -1);
+    info->treenam = strdup(tree);
+    info->shot = dblist->shotid;
+  }
+  return info;
+}
+
+static void free_tree_info(TREE_INFO *info, int mapped)
+{
+  if (mapped)
+  {
+    if (info->channel)
+      MDS_IO_CLOSE(info->channel);
+#ifndef _WIN32
+    if (info->mapped)
+      munmap(info->section_addr[0], (size_t)info->alq * 512);
+#endif
+    free(info->vm_addr);
+    free(info->filespec);
+  }
+  if (info->has_lock)
+    pthread_rwlock_destroy(&info->lock);
+  free(info->treenam);
+  free(info);
+}
+
+/*------------------------------------------------------------------------------
+
+  Subtree prefetch: before ConnectTree links the subtrees of a tree, their
+  tree files are located and mapped concurrently, so that the searches of
+  the <tree>_path directories and the reads of files on slow (network)
+  file systems overlap. Subtrees served by mdsip (a path or a thick client
+  root with "::") are mapped by the opening thread while the workers deal
+  with the others, as mdsip connections belong to the thread that opened
+  them. Linking is still done one subtree at a time and in the original
+  order, which keeps the tree indices and hence the nids unchanged.
+
+  TreeOpenThreads sets the number of threads mapping subtrees (default 8);
+  0 or 1 maps them one by one in the opening thread as before.
+
+------------------------------------------------------------------------------*/
+
+#define PREFETCH_THREADS 8
+
+typedef struct
+{
+  TREE_INFO *info;
+  int remote;
+  int claimed;
+  int status;
+} prefetch_job_t;
+
+struct prefetch
+{
+  pthread_mutex_t lock;
+  TREE_INFO *root;
+  prefetch_job_t *jobs;
+  int njobs;
+};
+
+static int prefetch_threads = PREFETCH_THREADS;
+static void prefetch_init()
+{
+  char *str = getenv("TreeOpenThreads");
+  if (str)
+    prefetch_threads = atoi(str);
+}
+
+static int is_remote_tree(TREE_INFO *root, char *tree)
+{
+  if (root && root->filespec && root->speclen > 2 &&
+      root->filespec[root->speclen - 1] == ':' &&
+      root->filespec[root->speclen - 2] == ':')
+    return B_TRUE;
+  char *path = TreePath(tree, 0);
+  int remote = !path || strstr(path, "::");
+  free(path);
+  return remote;
+}
+
+/// Map unclaimed subtrees until there are none left, the remote ones only
+/// when called by the opening thread.
+static void prefetch_run(prefetch_t *prefetch, int opener)
+{
+  for (;;)
+  {
+    prefetch_job_t *job = NULL;
+    int i;
+    pthread_mutex_lock(&prefetch->lock);
+    for (i = 0; i < prefetch->njobs; i++)
+      if (!prefetch->jobs[i].claimed && (opener || !prefetch->jobs[i].remote))
+      {
+        job = &prefetch->jobs[i];
+        job->claimed = B_TRUE;
+        break;
+      }
+    pthread_mutex_unlock(&prefetch->lock);
+    if (!job)
+      break;
+    job->status = MapTree(job->info, prefetch->root, 0);
+  }
+}
+
+static void *prefetch_worker(void *arg)
+{
+  prefetch_run((prefetch_t *)arg, B_FALSE);
+  return NULL;
+}
+
+static void free_prefetch(prefetch_t *prefetch)
+{
+  int i;
+  if (!prefetch)
+    return;
+  for (i = 0; i < prefetch->njobs; i++)
+    if (prefetch->jobs[i].info)
+      free_tree_info(prefetch->jobs[i].info,
+                     prefetch->jobs[i].status == TreeSUCCESS);
+  pthread_mutex_destroy(&prefetch->lock);
+  free(prefetch->jobs);
+  free(prefetch);
+}
+
+/// Map the not yet connected subtrees of info concurrently. Returns NULL
+/// when there is nothing to gain, i.e. fewer than two subtrees to map or
+/// none of them local.
+static prefetch_t *prefetch_subtrees(PINO_DATABASE *dblist, TREE_INFO *info,
+                                     char *subtree_list)
+{
+  RUN_FUNCTION_ONCE(prefetch_init);
+  if (prefetch_threads < 2 || info->header->externals < 2)
+    return NULL;
+  prefetch_t *prefetch = calloc(1, sizeof(prefetch_t));
+  if (!prefetch)
+    return NULL;
+  prefetch->jobs = calloc(info->header->externals, sizeof(prefetch_job_t));
+  if (!prefetch->jobs)
+  {
+    free(prefetch);
+    return NULL;
+  }
+  pthread_mutex_init(&prefetch->lock, NULL);
+  prefetch->root = dblist->tree_info;
+  int i, j, local = 0;
+  for (i = 0; i < info->header->externals; i++)
+  {
+    NODE *external_node = info->node + swapint32(&info->external[i]);
+    if (external_node->usage != TreeUSAGE_SUBTREE)
+      continue;
+    char *subtree = external_name(external_node);
+    if ((!subtree_list || in_subtree_list(subtree, subtree_list)) &&
+        !find_tree_info(dblist, subtree))
+    {
+      for (j = 0; j < prefetch->njobs &&
+                  strcmp(subtree, prefetch->jobs[j].info->treenam);
+           j++)
+        ;
+      if (j == prefetch->njobs)
+      {
+        prefetch->jobs[j].info = new_tree_info(dblist, subtree);
+        if (prefetch->jobs[j].info)
+        {
+          prefetch->jobs[j].remote = is_remote_tree(prefetch->root, subtree);
+          local += !prefetch->jobs[j].remote;
+          prefetch->njobs++;
+        }
+      }
+    }
+    free(subtree);
+  }
+  if (prefetch->njobs < 2 || !local)
+  {
+    free_prefetch(prefetch);
+    return NULL;
+  }
+  int nthreads = prefetch_threads - 1 < local ? prefetch_threads - 1 : local;
+  pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+  int started = 0;
+  if (threads)
+    for (; started < nthreads; started++)
+      if (pthread_create(&threads[started], NULL, prefetch_worker, prefetch))
+        break;
+  prefetch_run(prefetch, B_TRUE);
+  for (i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+  free(threads);
+  return prefetch;
+}
+
+/// Hand over the prefetched info block of tree, if any, with its status.
+static TREE_INFO *prefetched_info(prefetch_t *prefetch, char *tree,
+                                  int *status)
+{
+  int i;
+  if (prefetch)
+    for (i = 0; i < prefetch->njobs; i++)
+    {
+      TREE_INFO *info = prefetch->jobs[i].info;
+      if (info && !strcmp(info->treenam, tree))
+      {
+        prefetch->jobs[i].info = NULL;
+        *status = prefetch->jobs[i].status;
+        return info;
+      }
+    }
+  return NULL;
+}
+
+/*------------------------------------------------------------------------------
+
+  Lazy subtrees: with TreeOpenLazy set to a non zero value, TreeOpen maps the
+  main tree only. Each of its subtrees gets a placeholder info block with an
+  empty header and a single stand-in top node connected to the referencing
+  node, so paths and the node walks reach the subtree without mapping it.
+  The tree file is mapped by tree_lazy_load on the first access to one of
+  its nids (nid_to_tree_idx) or the first search below its top node.
+
+  A regular open numbers the subtrees depth first, so the tree index (and
+  hence the nids) of a subtree depends on the number of subtrees nested in
+  the ones before it, which a lazy open cannot know without reading them.
+  The lazy open therefore reads the header of every subtree first and opens
+  the tree regularly if one of them cannot be read or has subtrees of its
+  own. The placeholders are then numbered in the order of a regular open.
+
+------------------------------------------------------------------------------*/
+
+static TREE_HEADER lazy_header;
+static pthread_mutex_t lazy_lock;
+static int lazy_open = 0;
+static void lazy_init()
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&lazy_lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+  char *str = getenv("TreeOpenLazy");
+  if (str)
+    lazy_open = atoi(str);
+}
+
+static int open_lazily()
+{
+  RUN_FUNCTION_ONCE(lazy_init);
+  return lazy_open;
+}
+
+/// Add a placeholder for the subtree referenced by parent.
+static int lazy_subtree(PINO_DATABASE *dblist, char *tree, NODE *parent,
+                        char *subtree_list)
+{
+  if (parent->usage != TreeUSAGE_SUBTREE)
+    return TreeSUCCESS;
+  if (subtree_list && !in_subtree_list(tree, subtree_list))
+    return TreeNOT_IN_LIST;
+  if (find_tree_info(dblist, tree))
+    return TreeSUCCESS;
+  TREE_INFO *iptr, *info = new_tree_info(dblist, tree);
+  if (!info)
+    return TreeMEMERR;
+  info->blockid = TreeBLOCKID;
+  info->header = &lazy_header;
+  info->node = info->root = &info->lazy_top;
+  info->lazy = 1;
+  for (iptr = dblist->tree_info; iptr->next_info; iptr = iptr->next_info)
+    ;
+  iptr->next_info = info;
+  SubtreeNodeConnect(dblist, parent, info->node);
+  return TreeSUCCESS;
+}
+
+/// Whether the tree file of a subtree can be read and has no subtrees of
+/// its own, reading its header only.
+static int lazy_leaf(PINO_DATABASE *dblist, char *tree)
+{
+  int fd, leaf = 0;
+  TREE_HEADER header;
+  TREE_INFO info = {0};
+  info.treenam = tree;
+  info.shot = dblist->shotid;
+  if (IS_OK(OpenOne(&info, dblist->tree_info, TREE_TREEFILE_TYPE, 0, 0,
+                    &info.filespec, &fd)))
+  {
+    if (MDS_IO_READ(fd, &header, sizeof(header)) == sizeof(header))
+      leaf = swapint32(&header.externals) == 0;
+    MDS_IO_CLOSE(fd);
+  }
+  free(info.filespec);
+  return leaf;
+}
+
+/// Whether all subtrees of info that would be connected are leaves.
+static int lazy_leaves(PINO_DATABASE *dblist, TREE_INFO *info,
                        char *subtree_list)
+{
+  int i, leaves = 1;
+  for (i = 0; leaves && i < info->header->externals; i++)
+  {
+    NODE *external_node = info->node + swapint32(&info->external[i]);
+    char *subtree = external_name(external_node);
+    if (external_node->usage == TreeUSAGE_SUBTREE &&
+        (!subtree_list || in_subtree_list(subtree, subtree_list)))
+      leaves = lazy_leaf(dblist, subtree);
+    free(subtree);
+  }
+  return leaves;
+}
+
+static int lazy_subtrees(PINO_DATABASE *dblist, TREE_INFO *info,
+                         char *subtree_list)
+{
+  int status = TreeSUCCESS;
+  int i;
+  for (i = 0; i < info->header->externals; i++)
+  {
+    NODE *external_node = info->node + swapint32(&info->external[i]);
+    char *subtree = external_name(external_node);
+    if (IS_NOT_OK(lazy_subtree(dblist, subtree, external_node, subtree_list)))
+      status = TreeNOTALLSUBS;
+    free(subtree);
+  }
+  return status;
+}
+
+/// Move the tree file mapped in map to the placeholder info. The top node
+/// takes the connections of the stand-in one, and the nodes are stored
+/// before the header so that node_to_nid in another thread never pairs the
+/// node count of the tree with the stand-in top node.
+static void lazy_publish(TREE_INFO *info, TREE_INFO *map)
+{
+  map->node->usage = TreeUSAGE_SUBTREE_TOP;
+  map->node->parent = info->lazy_top.parent;
+  map->node->brother = info->lazy_top.brother;
+  memcpy(map->node->name, info->lazy_top.name, sizeof(map->node->name));
+  info->vm_pages = map->vm_pages;
+  info->vm_addr = map->vm_addr;
+  info->section_addr[0] = map->section_addr[0];
+  info->section_addr[1] = map->section_addr[1];
+  info->tags = map->tags;
+  info->tag_info = map->tag_info;
+  info->external = map->external;
+  info->channel = map->channel;
+  info->alq = map->alq;
+  info->speclen = map->speclen;
+  info->filespec = map->filespec;
+  memcpy(info->dvi, map->dvi, sizeof(info->dvi));
+  memcpy(info->tree_info_w_fid, map->tree_info_w_fid,
+         sizeof(info->tree_info_w_fid));
+  memcpy(info->file_id, map->file_id, sizeof(info->file_id));
+  info->mapped = map->mapped;
+  info->rundown_id = map->rundown_id;
+  __atomic_store_n(&info->node, map->node, __ATOMIC_RELEASE);
+  __atomic_store_n(&info->header, map->header, __ATOMIC_RELEASE);
+  info->root = info->node;
+  free_tree_info(map, 0);
+}
+
+/// Map a placeholder subtree and connect it in place of its stand-in top
+/// node. Returns the status of the mapping, the tree stays empty if it
+/// failed. Subtrees added to the file since the open are not connected.
+int tree_lazy_load(PINO_DATABASE *dblist, TREE_INFO *info)
+{
+  int status = TreeSUCCESS;
+  RUN_FUNCTION_ONCE(lazy_init);
+  pthread_mutex_lock(&lazy_lock);
+  if (info->lazy == 1)
+  {
+    info->lazy = 2; // loading, a hook of this thread may get here again
+    TREE_INFO *map = new_tree_info(dblist, info->treenam);
+    if (map)
+    {
+      map->shot = info->shot;
+      status = MapTree(map, dblist->tree_info, 0);
+      if (STATUS_NOT_OK && (status == TreeFILE_NOT_FOUND ||
+                            treeshr_errno == TreeFILE_NOT_FOUND))
+      {
+        TREE_HOOKS(RetrieveTree, map->treenam, map->shot, 0, NULL);
+        status = TreeCallHook(RetrieveTree, map, 0);
+        if (STATUS_OK)
+          status = MapTree(map, dblist->tree_info, 0);
+      }
+      if (status == TreeSUCCESS)
+      {
+        TREE_HOOKS(OpenTree, map->treenam, map->shot, 0, NULL);
+        TreeCallHook(OpenTree, map, 0);
+        lazy_publish(info, map);
+        tree_index_retire(dblist);
+      }
+      else
+        free_tree_info(map, 0);
+    }
+    else
+      status = TreeMEMERR;
+    __atomic_store_n(&info->lazy, 0, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&lazy_lock);
+  return status;
+}
+
+/// The node to use for node, i.e. the top node of the subtree if node is the
+/// stand-in top node of a placeholder, mapping the subtree if needed.
+NODE *tree_lazy_node(PINO_DATABASE *dblist, NODE *node)
+{
+  TREE_INFO *info;
+  if (node && dblist->lazy &&
+      __atomic_load_n(&node->usage, __ATOMIC_ACQUIRE) == TreeUSAGE_SUBTREE)
+  {
+    // a reference not connected yet, the tree holding it may be loading
+    RUN_FUNCTION_ONCE(lazy_init);
+    pthread_mutex_lock(&lazy_lock);
+    pthread_mutex_unlock(&lazy_lock);
+    if (node->usage == TreeUSAGE_SUBTREE_REF)
+      node = nid_to_node(dblist, (NID *)&node->child);
+  }
+  if (!node || node->usage != TreeUSAGE_SUBTREE_TOP)
+    return node;
+  for (info = dblist->tree_info; info; info = info->next_info)
+    if (node == &info->lazy_top)
+    {
+      if (tree_lazy(info))
+        tree_lazy_load(dblist, info);
+      return info->node;
+    }
+  return node;
+}
+
+/// Map the placeholder subtrees below node, or all of them if node is NULL.
+void tree_lazy_load_below(PINO_DATABASE *dblist, NODE *node)
+{
+  TREE_INFO *info;
+  NODE *n;
+  for (info = dblist->tree_info; info; info = info->next_info)
+    if (tree_lazy(info))
+    {
+      for (n = &info->lazy_top; node && n && n != node;
+           n = parent_of(dblist, n))
+        ;
+      if (n)
+        tree_lazy_load(dblist, info);
+    }
+}
+
+static int ConnectTree(PINO_DATABASE *dblist, char *tree, NODE *parent,
+                       char *subtree_list, prefetch_t *prefetch)
 {
   /***********************************************
     If the parent's usage is not subtree then
@@ -505,23 +1045,8 @@ static int ConnectTree(PINO_DATABASE *dblist, char *tree, NODE *parent,
     this tree is not in it then just return
     success notinlist.
   ************************************************/
-  if (subtree_list)
-  {
-    char *found;
-    char *tmp_list = malloc(strlen(subtree_list) + 3);
-    char *tmp_tree = malloc(strlen(tree) + 3);
-    strcpy(tmp_list, ",");
-    strcat(tmp_list, subtree_list);
-    strcat(tmp_list, ",");
-    strcpy(tmp_tree, ",");
-    strcat(tmp_tree, tree);
-    strcat(tmp_tree, ",");
-    found = strstr(tmp_list, tmp_tree);
-    free(tmp_list);
-    free(tmp_tree);
-    if (!found)
-      return TreeNOT_IN_LIST;
-  }
+  if (subtree_list && !in_subtree_list(tree, subtree_list))
+    return TreeNOT_IN_LIST;
 
   int status = TreeSUCCESS;
   int ext_status;
@@ -534,38 +1059,34 @@ static int ConnectTree(PINO_DATABASE *dblist, char *tree, NODE *parent,
     information structure and zero the structure.
   ***********************************************/
 
-  for (info = dblist->tree_info; info && strcmp(tree, info->treenam);
-       info = info->next_info)
-    ;
+  info = find_tree_info(dblist, tree);
   if (!info)
   {
-    info = calloc(1, sizeof(TREE_INFO));
+    /***********************************************
+    Next we map the file (unless a prefetch already
+    did) and if successful copy the tree name
+    (blank filled) into the info block.
+    ***********************************************/
+    info = prefetched_info(prefetch, tree, &status);
+    if (!info)
+    {
+      info = new_tree_info(dblist, tree);
+      if (info)
+        status = MapTree(info, dblist->tree_info, 0);
+    }
     if (info)
     {
-
-      /***********************************************
-      Next we map the file and if successful copy
-      the tree name (blank filled) into the info block.
-      ***********************************************/
-      info->has_lock = !TreeUsingPrivateCtx();
-      if (info->has_lock)
-        pthread_rwlock_init(&info->lock, NULL);
-      info->flush = (dblist->shotid == -1);
-      info->treenam = strdup(tree);
-      info->shot = dblist->shotid;
-      status = MapTree(info, dblist->tree_info, 0);
       if (STATUS_NOT_OK && (status == TreeFILE_NOT_FOUND ||
                             treeshr_errno == TreeFILE_NOT_FOUND))
       {
-        TreeCallHookFun("TreeHook", "RetrieveTree", info->treenam, info->shot,
-                        NULL);
+        TREE_HOOKS(RetrieveTree, info->treenam, info->shot, 0, NULL);
         status = TreeCallHook(RetrieveTree, info, 0);
         if (STATUS_OK)
           status = MapTree(info, dblist->tree_info, 0);
       }
       if (status == TreeSUCCESS)
       {
-        TreeCallHookFun("TreeHook", "OpenTree", tree, info->shot, NULL);
+        TREE_HOOKS(OpenTree, tree, info->shot, 0, NULL);
         TreeCallHook(OpenTree, info, 0);
 
         /**********************************************
@@ -601,24 +1122,27 @@ static int ConnectTree(PINO_DATABASE *dblist, char *tree, NODE *parent,
       }
       if (STATUS_NOT_OK && info)
       {
-        free(info->treenam);
-        free(info);
+        free_tree_info(info, 0);
         info = 0;
       }
     }
   }
-  if (info)
+  if (info && parent == 0 && open_lazily() &&
+      lazy_leaves(dblist, info, subtree_list))
+  {
+    dblist->lazy = 1;
+    if (IS_NOT_OK(lazy_subtrees(dblist, info, subtree_list)))
+      status = TreeNOTALLSUBS;
+  }
+  else if (info)
   {
+    prefetch_t *subtrees = prefetch_subtrees(dblist, info, subtree_list);
     for (i = 0; i < info->header->externals; i++)
     {
       NODE *external_node = info->node + swapint32(&info->external[i]);
-      char *subtree = strncpy(calloc(1, sizeof(NODE_NAME) + 1),
-                              external_node->name, sizeof(NODE_NAME));
-      subtree[sizeof(NODE_NAME)] = '\0';
-      char *blank = strchr(subtree, ' ');
-      if (blank)
-        *blank = '\0';
-      ext_status = ConnectTree(dblist, subtree, external_node, subtree_list);
+      char *subtree = external_name(external_node);
+      ext_status = ConnectTree(dblist, subtree, external_node, subtree_list,
+                               subtrees);
       free(subtree);
       if (IS_NOT_OK(ext_status))
       {
@@ -627,6 +1151,7 @@ static int ConnectTree(PINO_DATABASE *dblist, char *tree, NODE *parent,
           break;
       }
     }
+    free_prefetch(subtrees);
   }
   return status;
 }
@@ -1049,7 +1574,10 @@ static int MapTree(TREE_INFO *info, TREE_INFO *root, int edit_flag)
     }
   }
   if (status == TreeSUCCESS)
+  {
+    tree_file_id(info->filespec, info->file_id);
     status = MapFile(fd, info, nomap);
+  }
   return status;
 }
 
@@ -1175,7 +1703,6 @@ static void SubtreeNodeConnect(PINO_DATABASE *dblist, NODE *parent,
 {
   NID child_nid, parent_nid, brother_nid = {0, 0};
   NODE *brother = brother_of(dblist, parent);
-  parent->usage = TreeUSAGE_SUBTREE_REF;
   subtreetop->usage = TreeUSAGE_SUBTREE_TOP;
   node_to_nid(dblist, subtreetop, &child_nid);
   node_to_nid(dblist, parent_of(dblist, parent), &parent_nid);
@@ -1185,6 +1712,8 @@ static void SubtreeNodeConnect(PINO_DATABASE *dblist, NODE *parent,
   subtreetop->parent = *(int *)&parent_nid;
   subtreetop->brother = *(int *)&brother_nid;
   memcpy(subtreetop->name, parent->name, sizeof(subtreetop->name));
+  // last, the node walks of other threads may look at a lazy subtree
+  __atomic_store_n(&parent->usage, TreeUSAGE_SUBTREE_REF, __ATOMIC_RELEASE);
   return;
 }
 
@@ -1308,7 +1837,7 @@ int _TreeOpenEdit(void **dbid, char const *tree_in, int shot_in)
         if (STATUS_NOT_OK && (status == TreeFILE_NOT_FOUND ||
                               treeshr_errno == TreeFILE_NOT_FOUND))
         {
-          TreeCallHookFun("TreeHook", "RetrieveTree", tree, info->shot, NULL);
+          TREE_HOOKS(RetrieveTree, tree, info->shot, 0, NULL);
           status = MapTree(info, (*dblist)->tree_info, 1);
           if (STATUS_NOT_OK && (status == TreeFILE_NOT_FOUND ||
                                 treeshr_errno == TreeFILE_NOT_FOUND))
@@ -1320,7 +1849,7 @@ int _TreeOpenEdit(void **dbid, char const *tree_in, int shot_in)
         }
         if (STATUS_OK)
         {
-          TreeCallHookFun("TreeHook", "OpenTreeEdit", tree, info->shot, NULL);
+          TREE_HOOKS(OpenTreeEdit, tree, info->shot, 0, NULL);
           TreeCallHook(OpenTreeEdit, info, 0);
           info->edit = (TREE_EDIT *)calloc(1, sizeof(TREE_EDIT));
           if (info->edit)
@@ -1406,8 +1935,7 @@ int _TreeOpenNew(void **dbid, char const *tree_in, int shot_in)
         }
         if (STATUS_OK)
         {
-          TreeCallHookFun("TreeHook", "OpenTreeEdit", info->treenam,
-                          info->shot, NULL);
+          TREE_HOOKS(OpenTreeEdit, info->treenam, info->shot, 0, NULL);
           TreeCallHook(OpenTreeEdit, info, 0);
           info->edit = (TREE_EDIT *)calloc(1, sizeof(TREE_EDIT));
           if (info->edit)
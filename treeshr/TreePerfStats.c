@@ -0,0 +1,282 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*------------------------------------------------------------------------------
+
+                Name: TreePerfStats
+
+                Type:   C functions
+
+                Purpose: Always available latency statistics of tree access
+
+------------------------------------------------------------------------------
+
+        Description:
+
+   Every thread using treeshr owns a slot holding, for each instrumented
+   operation (TreeOpen, TreeGetRecord, TreePutRecord, segment reads and
+   writes, NCI reads and file lock waits), a call count, the total and
+   maximum latency, the node that took longest and a log2 histogram of the
+   latencies in nanoseconds.
+
+   Only the owning thread writes to its slot, so recording a call costs two
+   clock reads and a few plain stores. Slots are kept in a list that is
+   only ever prepended to and are handed over to new threads when their
+   thread exits, so TreeGetPerfStats can sum them without taking any lock.
+   TreeResetPerfStats bumps a generation number; each thread clears its
+   own slot the next time it records a call and readers skip slots of an
+   older generation.
+
+   The statistics are reported by TreePerfReport(), the TDI function
+   TreePerf() and the TCL command SHOW PERF.
+
++-----------------------------------------------------------------------------*/
+#include <mdsplus/mdsconfig.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+#include <treeshr.h>
+
+#include "treeshrp.h"
+
+typedef struct perf_slot
+{
+  struct perf_slot *next;
+  int in_use;
+  int generation;
+  TREE_PERF_STATS op[TREE_PERF_NUM_OPS];
+} perf_slot_t;
+
+static const char *const op_names[TREE_PERF_NUM_OPS] = {
+    "TreeOpen",     "TreeGetRecord", "TreePutRecord", "SegmentRead",
+    "SegmentWrite", "NciRead",       "LockWait"};
+
+static perf_slot_t *slots = NULL;
+static int generation = 0;
+static pthread_key_t slot_key;
+
+static void release_slot(void *slot)
+{
+  __atomic_store_n(&((perf_slot_t *)slot)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void create_slot_key() { pthread_key_create(&slot_key, release_slot); }
+
+static perf_slot_t *get_slot()
+{
+  RUN_FUNCTION_ONCE(create_slot_key);
+  perf_slot_t *slot = (perf_slot_t *)pthread_getspecific(slot_key);
+  if (slot)
+    return slot;
+  for (slot = __atomic_load_n(&slots, __ATOMIC_ACQUIRE); slot;
+       slot = slot->next)
+  {
+    int unused = 0;
+    if (__atomic_compare_exchange_n(&slot->in_use, &unused, 1, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+      break;
+  }
+  if (!slot)
+  {
+    slot = (perf_slot_t *)calloc(1, sizeof(perf_slot_t));
+    if (!slot)
+      return NULL;
+    slot->in_use = 1;
+    slot->generation = __atomic_load_n(&generation, __ATOMIC_RELAXED);
+    slot->next = __atomic_load_n(&slots, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&slots, &slot->next, slot, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      ;
+  }
+  pthread_setspecific(slot_key, slot);
+  return slot;
+}
+
+uint64_t tree_perf_now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline int bucket_of(uint64_t ns)
+{
+  int bucket = ns ? 63 - __builtin_clzll(ns) : 0;
+  return bucket < TREE_PERF_BUCKETS ? bucket : TREE_PERF_BUCKETS - 1;
+}
+
+#define STORE(field, value) \
+  __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+void tree_perf_record(int op, uint64_t start, PINO_DATABASE *dblist,
+                      TREE_INFO *info, int nid)
+{
+  int64_t ns = (int64_t)(tree_perf_now() - start);
+  perf_slot_t *slot = get_slot();
+  if (!slot || op < 0 || op >= TREE_PERF_NUM_OPS)
+    return;
+  int gen = __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+  if (slot->generation != gen)
+  {
+    memset(slot->op, 0, sizeof(slot->op));
+    __atomic_store_n(&slot->generation, gen, __ATOMIC_RELEASE);
+  }
+  TREE_PERF_STATS *stats = &slot->op[op];
+  STORE(stats->count, stats->count + 1);
+  STORE(stats->total_ns, stats->total_ns + ns);
+  STORE(stats->histogram[bucket_of(ns)], stats->histogram[bucket_of(ns)] + 1);
+  if (ns > stats->max_ns)
+  {
+    if (!info && dblist && IS_OPEN(dblist))
+    {
+      NID nid_s;
+      memcpy(&nid_s, &nid, sizeof(nid_s));
+      if (nid == -1)
+        info = dblist->tree_info;
+      else
+        nid_to_tree(dblist, &nid_s, info);
+    }
+    stats->max_nid = nid;
+    stats->max_shot = info ? info->shot : 0;
+    strncpy(stats->max_tree, info ? info->treenam : "",
+            sizeof(stats->max_tree) - 1);
+    STORE(stats->max_ns, ns);
+  }
+}
+
+EXPORT int TreeGetPerfStats(int op, TREE_PERF_STATS *stats)
+{
+  if (op < 0 || op >= TREE_PERF_NUM_OPS || !stats)
+    return TreeFAILURE;
+  memset(stats, 0, sizeof(*stats));
+  stats->max_nid = -1;
+  int gen = __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+  perf_slot_t *slot;
+  for (slot = __atomic_load_n(&slots, __ATOMIC_ACQUIRE); slot;
+       slot = slot->next)
+  {
+    if (__atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE) != gen)
+      continue;
+    TREE_PERF_STATS *s = &slot->op[op];
+    int i;
+    stats->count += __atomic_load_n(&s->count, __ATOMIC_RELAXED);
+    stats->total_ns += __atomic_load_n(&s->total_ns, __ATOMIC_RELAXED);
+    for (i = 0; i < TREE_PERF_BUCKETS; i++)
+      stats->histogram[i] +=
+          __atomic_load_n(&s->histogram[i], __ATOMIC_RELAXED);
+    int64_t max_ns = __atomic_load_n(&s->max_ns, __ATOMIC_RELAXED);
+    if (max_ns > stats->max_ns)
+    {
+      stats->max_ns = max_ns;
+      stats->max_nid = s->max_nid;
+      stats->max_shot = s->max_shot;
+      memcpy(stats->max_tree, s->max_tree, sizeof(stats->max_tree) - 1);
+    }
+  }
+  return TreeSUCCESS;
+}
+
+EXPORT void TreeResetPerfStats()
+{
+  __atomic_add_fetch(&generation, 1, __ATOMIC_ACQ_REL);
+}
+
+EXPORT const char *TreePerfOpName(int op)
+{
+  return (op >= 0 && op < TREE_PERF_NUM_OPS) ? op_names[op] : NULL;
+}
+
+/* upper bound in us of the bucket holding the given fraction of the calls */
+static double percentile(TREE_PERF_STATS *stats, double fraction)
+{
+  int64_t limit = (int64_t)(stats->count * fraction);
+  int64_t sum = 0;
+  int i;
+  for (i = 0; i < TREE_PERF_BUCKETS - 1; i++)
+  {
+    sum += stats->histogram[i];
+    if (sum > limit)
+      break;
+  }
+  return (double)((int64_t)2 << i) / 1000.;
+}
+
+EXPORT char *TreePerfReport()
+{
+  size_t size = 128 + TREE_PERF_NUM_OPS * 160;
+  char *report = malloc(size);
+  if (!report)
+    return NULL;
+  int len = snprintf(report, size, "%-14s %10s %10s %10s %10s %12s  %s\n",
+                     "Operation", "Count", "Avg(us)", "p50(us)", "p99(us)",
+                     "Max(us)", "Slowest");
+  if (len >= (int)size)
+    len = size - 1;
+  int op;
+  for (op = 0; op < TREE_PERF_NUM_OPS; op++)
+  {
+    TREE_PERF_STATS stats;
+    TreeGetPerfStats(op, &stats);
+    if (stats.count == 0)
+      len += snprintf(report + len, size - len, "%-14s %10d\n", op_names[op],
+                      0);
+    else if (stats.max_nid == -1 || !stats.max_tree[0])
+      len += snprintf(report + len, size - len,
+                      "%-14s %10" PRId64 " %10.1f %10.1f %10.1f %12.1f  %s\n",
+                      op_names[op], stats.count,
+                      stats.total_ns / 1000. / stats.count,
+                      percentile(&stats, .5), percentile(&stats, .99),
+                      stats.max_ns / 1000., stats.max_tree);
+    else
+      len += snprintf(report + len, size - len,
+                      "%-14s %10" PRId64
+                      " %10.1f %10.1f %10.1f %12.1f  %s shot %d nid %d\n",
+                      op_names[op], stats.count,
+                      stats.total_ns / 1000. / stats.count,
+                      percentile(&stats, .5), percentile(&stats, .99),
+                      stats.max_ns / 1000., stats.max_tree, stats.max_shot,
+                      stats.max_nid);
+    if (len >= (int)size) // truncated, keep size - len positive
+      len = size - 1;
+  }
+  return report;
+}
+
+EXPORT int TreeGetPerfReport(mdsdsc_xd_t *out)
+{
+  char *report = TreePerfReport();
+  if (!report)
+    return TreeFAILURE;
+  struct descriptor report_d = {(length_t)strlen(report), DTYPE_T, CLASS_S,
+                                report};
+  int status = MdsCopyDxXd(&report_d, out);
+  free(report);
+  return status;
+}
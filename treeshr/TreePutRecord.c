@@ -109,8 +109,9 @@ int TreePutRecord(int nid, struct descriptor *descriptor_ptr,
   return _TreePutRecord(*TreeCtx(), nid, descriptor_ptr, utility_update);
 }
 
-int _TreePutRecord(void *dbid, int nid, struct descriptor *descriptor_ptr,
-                   int utility_update)
+static int tree_put_record(void *dbid, int nid,
+                           struct descriptor *descriptor_ptr,
+                           int utility_update)
 {
   PINO_DATABASE *dblist = (PINO_DATABASE *)dbid;
   NID *nid_ptr = (NID *)&nid;
@@ -150,10 +151,9 @@ int _TreePutRecord(void *dbid, int nid, struct descriptor *descriptor_ptr,
     int stv;
     NCI local_nci, old_nci;
     int64_t saved_viewdate;
-    TreeCallHookFun("TreeNidHook", "PutData", info_ptr->treenam, info_ptr->shot,
-                    nid, NULL);
-    TreeCallHookFun("TreeNidDataHook", "PutDataFull", info_ptr->treenam,
-                    info_ptr->shot, nid, descriptor_ptr, NULL);
+    TREE_HOOKS(PutData, info_ptr->treenam, info_ptr->shot, nid, NULL);
+    TREE_HOOKS(PutDataFull, info_ptr->treenam, info_ptr->shot, nid,
+               descriptor_ptr);
     status = TreeCallHook(PutData, info_ptr, nid);
     if (status && STATUS_NOT_OK)
       return status;
@@ -321,6 +321,26 @@ int _TreePutRecord(void *dbid, int nid, struct descriptor *descriptor_ptr,
   return status;
 }
 
+int _TreePutRecord(void *dbid, int nid, struct descriptor *descriptor_ptr,
+                   int utility_update)
+{
+  uint64_t start = tree_perf_now();
+  segcache_write_t cache = {NULL, NULL};
+  if (tree_segcache_enabled())
+  { // a record replaces the segments of a segmented node
+    unsigned int flags = 0;
+    NCI_ITM itmlst[] = {{sizeof(flags), NciGET_FLAGS, &flags, 0},
+                        {0, NciEND_OF_LIST, 0, 0}};
+    if (IS_OK(_TreeGetNci(dbid, nid, itmlst)) && (flags & NciM_SEGMENTED))
+      tree_segcache_begin(dbid, nid, &cache);
+  }
+  int status = tree_put_record(dbid, nid, descriptor_ptr, utility_update);
+  tree_segcache_end_invalidate(&cache);
+  tree_perf_record(TREE_PERF_PUT_RECORD, start, (PINO_DATABASE *)dbid, NULL,
+                   nid);
+  return status;
+}
+
 static int check_usage(PINO_DATABASE *dblist, NID *nid_ptr, NCI *nci)
 {
 
@@ -498,8 +518,7 @@ int _TreeOpenDatafileW(TREE_INFO *info, int *stv_ptr, int tmpfile)
   info->data_file = df_ptr;
   if (STATUS_OK)
   {
-    TreeCallHookFun("TreeHook", "OpenDataFileWrite", info->treenam,
-                    info->shot, NULL);
+    TREE_HOOKS(OpenDataFileWrite, info->treenam, info->shot, 0, NULL);
     TreeCallHook(OpenDataFileWrite, info, 0);
   }
   return status;
@@ -688,10 +707,12 @@ int TreeLockDatafile(TREE_INFO *info, int readonly, int64_t offset)
   {
     while (deleted && STATUS_OK)
     {
+      uint64_t start = tree_perf_now();
       status =
           MDS_IO_LOCK(readonly ? info->data_file->get : info->data_file->put,
                       offset, offset >= 0 ? 12 : (DATAF_C_MAX_RECORD_SIZE * 3),
                       readonly ? MDS_IO_LOCK_RD : MDS_IO_LOCK_WRT, &deleted);
+      tree_perf_record(TREE_PERF_LOCK_WAIT, start, NULL, info, -1);
       if (deleted && STATUS_OK)
         status = TreeReopenDatafile(info);
     }
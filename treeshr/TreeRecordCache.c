@@ -0,0 +1,338 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*------------------------------------------------------------------------------
+
+                Name: TreeRecordCache
+
+                Type:   C functions
+
+                Purpose: Process wide cache of deserialized records
+
+------------------------------------------------------------------------------
+
+        Description:
+
+   _TreeGetRecord deserializes (and decompresses) a record every time it is
+   read. Nodes holding calibrations, geometry or setup information are read
+   over and over by servers, so the decoded XD can be kept here and a copy
+   handed out on the next read.
+
+   Entries are keyed by (tree, shot, node index, record offset, time
+   inserted). The offset and the insertion time come from the NCI that
+   _TreeGetRecord reads anyway, so a record rewritten by another process
+   shows up as a miss. Writes done by this process invalidate the node
+   explicitly in tree_put_nci.
+
+   The cache is disabled unless a limit is set, either with the
+   TreeRecordCacheSize environment variable (bytes, k/M/G suffix allowed)
+   or with TreeSetRecordCacheSize(). Least recently used entries are
+   evicted once the limit is exceeded.
+
++-----------------------------------------------------------------------------*/
+#include <mdsplus/mdsconfig.h>
+#include <mdsplus/mdsplus.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+#include <treeshr.h>
+
+#include "treeshrp.h"
+
+#define CACHE_BUCKETS 4096
+#define CACHE_TREENAM_SIZE 13
+
+typedef struct cache_entry
+{
+  struct cache_entry *next_hash;
+  struct cache_entry *prev_lru;
+  struct cache_entry *next_lru;
+  uint32_t hash;
+  char treenam[CACHE_TREENAM_SIZE];
+  int shot;
+  int nidx;
+  int64_t offset;
+  int64_t time_inserted;
+  size_t size;
+  mdsdsc_xd_t xd;
+} cache_entry_t;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static cache_entry_t *cache_bucket[CACHE_BUCKETS];
+static cache_entry_t *cache_mru = NULL;
+static cache_entry_t *cache_lru = NULL;
+static int64_t cache_limit = 0;
+static TREE_RECORD_CACHE_STATS cache_stats;
+
+static void cache_init();
+INIT_SHARED_FUNCTION_ONCE(cache_init);
+static void cache_init()
+{
+  char *size_str = getenv("TreeRecordCacheSize");
+  if (size_str)
+  {
+    char *unit;
+    int64_t size = strtoll(size_str, &unit, 0);
+    switch (toupper((unsigned char)*unit))
+    {
+    case 'G':
+      size *= 1024;
+      MDS_ATTR_FALLTHROUGH
+    case 'M':
+      size *= 1024;
+      MDS_ATTR_FALLTHROUGH
+    case 'K':
+      size *= 1024;
+      break;
+    }
+    cache_limit = size > 0 ? size : 0;
+  }
+}
+
+static inline int cache_enabled()
+{
+  RUN_SHARED_FUNCTION_ONCE(cache_init);
+  return cache_limit > 0;
+}
+
+static inline uint32_t cache_hash(const char *treenam, int shot, int nidx)
+{
+  // FNV-1a over the tree name followed by shot and node index
+  uint32_t hash = 2166136261u;
+  const char *c;
+  for (c = treenam; *c; c++)
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  hash = (hash ^ (uint32_t)shot) * 16777619u;
+  hash = (hash ^ (uint32_t)nidx) * 16777619u;
+  return hash;
+}
+
+static inline int cache_match(cache_entry_t *entry, uint32_t hash,
+                              const char *treenam, int shot, int nidx)
+{
+  return entry->hash == hash && entry->nidx == nidx && entry->shot == shot &&
+         strcmp(entry->treenam, treenam) == 0;
+}
+
+static void lru_unlink(cache_entry_t *entry)
+{
+  if (entry->prev_lru)
+    entry->prev_lru->next_lru = entry->next_lru;
+  else
+    cache_mru = entry->next_lru;
+  if (entry->next_lru)
+    entry->next_lru->prev_lru = entry->prev_lru;
+  else
+    cache_lru = entry->prev_lru;
+  entry->prev_lru = entry->next_lru = NULL;
+}
+
+static void lru_push(cache_entry_t *entry)
+{
+  entry->prev_lru = NULL;
+  entry->next_lru = cache_mru;
+  if (cache_mru)
+    cache_mru->prev_lru = entry;
+  cache_mru = entry;
+  if (!cache_lru)
+    cache_lru = entry;
+}
+
+static void entry_remove(cache_entry_t *entry)
+{
+  cache_entry_t **prev = &cache_bucket[entry->hash % CACHE_BUCKETS];
+  while (*prev && *prev != entry)
+    prev = &(*prev)->next_hash;
+  if (*prev)
+    *prev = entry->next_hash;
+  lru_unlink(entry);
+  cache_stats.bytes -= entry->size;
+  cache_stats.entries--;
+  MdsFree1Dx(&entry->xd, NULL);
+  free(entry);
+}
+
+static void cache_trim(int64_t limit)
+{
+  while (cache_lru && cache_stats.bytes > limit)
+  {
+    entry_remove(cache_lru);
+    cache_stats.evictions++;
+  }
+}
+
+/* Copy a cached record into dsc.
+ * Returns TreeSUCCESS on a hit, TreeFAILURE if the record has to be read.
+ */
+int tree_cache_get(TREE_INFO *info, int nidx, int64_t offset,
+                   int64_t time_inserted, mdsdsc_xd_t *dsc)
+{
+  if (!cache_enabled())
+    return TreeFAILURE;
+  int status = TreeFAILURE;
+  const uint32_t hash = cache_hash(info->treenam, info->shot, nidx);
+  pthread_mutex_lock(&cache_lock);
+  cache_entry_t *entry;
+  for (entry = cache_bucket[hash % CACHE_BUCKETS]; entry;
+       entry = entry->next_hash)
+  {
+    if (cache_match(entry, hash, info->treenam, info->shot, nidx))
+      break;
+  }
+  if (entry)
+  {
+    if (entry->offset == offset && entry->time_inserted == time_inserted)
+    {
+      status = MdsCopyDxXd((mdsdsc_t *)&entry->xd, dsc);
+      if (STATUS_OK)
+      {
+        lru_unlink(entry);
+        lru_push(entry);
+      }
+    }
+    else
+    { // record was rewritten elsewhere
+      entry_remove(entry);
+      cache_stats.invalidations++;
+    }
+  }
+  if (STATUS_OK)
+    cache_stats.hits++;
+  else
+    cache_stats.misses++;
+  pthread_mutex_unlock(&cache_lock);
+  return status;
+}
+
+/* Store a copy of a freshly deserialized record.
+ */
+void tree_cache_put(TREE_INFO *info, int nidx, int64_t offset,
+                    int64_t time_inserted, mdsdsc_xd_t *dsc)
+{
+  if (!cache_enabled() || !dsc->pointer ||
+      strlen(info->treenam) >= CACHE_TREENAM_SIZE)
+    return;
+  const size_t size = sizeof(cache_entry_t) + dsc->l_length;
+  if ((int64_t)size > cache_limit)
+    return;
+  cache_entry_t *new_entry = calloc(1, sizeof(cache_entry_t));
+  if (!new_entry)
+    return;
+  new_entry->xd.class = CLASS_XD;
+  new_entry->xd.dtype = DTYPE_DSC;
+  if (!(MdsCopyDxXd((mdsdsc_t *)dsc, &new_entry->xd) & 1))
+  {
+    free(new_entry);
+    return;
+  }
+  new_entry->hash = cache_hash(info->treenam, info->shot, nidx);
+  strcpy(new_entry->treenam, info->treenam);
+  new_entry->shot = info->shot;
+  new_entry->nidx = nidx;
+  new_entry->offset = offset;
+  new_entry->time_inserted = time_inserted;
+  new_entry->size = sizeof(cache_entry_t) + new_entry->xd.l_length;
+  pthread_mutex_lock(&cache_lock);
+  cache_entry_t **bucket = &cache_bucket[new_entry->hash % CACHE_BUCKETS];
+  cache_entry_t *entry;
+  for (entry = *bucket; entry; entry = entry->next_hash)
+  {
+    if (cache_match(entry, new_entry->hash, info->treenam, info->shot, nidx))
+    {
+      entry_remove(entry);
+      break;
+    }
+  }
+  new_entry->next_hash = *bucket;
+  *bucket = new_entry;
+  lru_push(new_entry);
+  cache_stats.bytes += new_entry->size;
+  cache_stats.entries++;
+  cache_trim(cache_limit);
+  pthread_mutex_unlock(&cache_lock);
+}
+
+/* Drop the cached record of a node, called whenever its NCI is written.
+ */
+void tree_cache_invalidate(TREE_INFO *info, int nidx)
+{
+  if (!cache_enabled())
+    return;
+  const uint32_t hash = cache_hash(info->treenam, info->shot, nidx);
+  pthread_mutex_lock(&cache_lock);
+  cache_entry_t *entry;
+  for (entry = cache_bucket[hash % CACHE_BUCKETS]; entry;
+       entry = entry->next_hash)
+  {
+    if (cache_match(entry, hash, info->treenam, info->shot, nidx))
+    {
+      entry_remove(entry);
+      cache_stats.invalidations++;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&cache_lock);
+}
+
+EXPORT int64_t TreeSetRecordCacheSize(int64_t size)
+{
+  RUN_SHARED_FUNCTION_ONCE(cache_init);
+  pthread_mutex_lock(&cache_lock);
+  const int64_t old_size = cache_limit;
+  cache_limit = size > 0 ? size : 0;
+  cache_trim(cache_limit);
+  pthread_mutex_unlock(&cache_lock);
+  return old_size;
+}
+
+EXPORT void TreeFlushRecordCache()
+{
+  pthread_mutex_lock(&cache_lock);
+  cache_trim(-1);
+  pthread_mutex_unlock(&cache_lock);
+}
+
+EXPORT int TreeGetRecordCacheStats(TREE_RECORD_CACHE_STATS *stats)
+{
+  RUN_SHARED_FUNCTION_ONCE(cache_init);
+  pthread_mutex_lock(&cache_lock);
+  *stats = cache_stats;
+  stats->limit = cache_limit;
+  pthread_mutex_unlock(&cache_lock);
+  return TreeSUCCESS;
+}
+
+EXPORT void TreeResetRecordCacheStats()
+{
+  pthread_mutex_lock(&cache_lock);
+  cache_stats.hits = 0;
+  cache_stats.misses = 0;
+  cache_stats.evictions = 0;
+  cache_stats.invalidations = 0;
+  pthread_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,1235 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*------------------------------------------------------------------------------
+
+                Name: TreeSegmentCache
+
+                Type:   C functions
+
+                Purpose: Host wide shared memory cache of recent segments
+
+------------------------------------------------------------------------------
+
+        Description:
+
+   Live readers of a segmented node (scopes in continuous mode, monitors)
+   read the segment that is being written over and over. With the cache
+   enabled, writers on this host publish every segment they make or extend
+   into a shared memory object per (tree, shot) and _TreeGetSegment reads
+   from there before going to the datafile.
+
+   The object holds a table of nodes and, for each node, a ring of the
+   most recent TreeSegmentCacheDepth segments; segment idx lives in slot
+   idx % depth and the slot records idx, so a slot that has been reused
+   for a newer segment is a miss. Each node also records the index of its
+   last segment, which decides how many rows of a segment are visible,
+   exactly as in read_segment.
+
+   Writers update the datafile first and then the cache, serialised by a
+   robust process shared mutex per node; a writer that dies holding it
+   leaves the node cleared. Readers take no lock: every slot is protected
+   by a sequence counter and a reader retries (or falls back to the
+   datafile) if the slot changed while it was being copied. A hit is only
+   served if the segment header in the datafile still agrees with the
+   cache on the number of segments and on the next row of the last one,
+   so a write the cache did not see turns into a miss. A reader that
+   misses stores what it has read from the datafile, unless a writer
+   touched the node in the meantime.
+
+   Only writers that have the cache enabled keep it coherent, so every
+   process writing a tree on this host must use the same settings:
+
+     TreeSegmentCacheDepth     segments per node, the cache is off if unset
+     TreeSegmentCacheSlotSize  bytes per segment (k/M suffix), default 1M
+     TreeSegmentCacheNodes     nodes per tree, default 64
+     TreeSegmentCacheMaxSize   bytes of all objects on the host, default 256M
+
+   The first process to create the object fixes its geometry, with fewer
+   nodes if it would not fit in TreeSegmentCacheMaxSize. Segments that do
+   not fit in a slot are not cached. The memory of an object is allocated
+   when it is created, so a full /dev/shm makes the cache unavailable
+   instead of raising SIGBUS on a later write.
+
+   The object counts the processes that use it. Closing the last tree that
+   uses it in the last process unlinks it. Creating or deleting the pulse
+   files of a shot retires it, and so does making room for a new object:
+   objects left behind by crashed processes go first, then the ones used
+   least recently. A process notices that its object has been retired on
+   the next access and maps the current one.
+
++-----------------------------------------------------------------------------*/
+#include <mdsplus/mdsconfig.h>
+#include <mdsplus/mdsplus.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mdsdescrip.h>
+#include <mdsmsg.h>
+#include <mdsshr.h>
+#include <treeshr.h>
+
+#include "treeshr_xnci.h"
+#include "treeshrp.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SEGCACHE_MAGIC 0x4d445347 /* "MDSG" */
+#define SEGCACHE_VERSION 3
+#define SEGCACHE_PREFIX "mdsplus_segcache_"
+#define SEGCACHE_SHM_DIR "/dev/shm" /* where shm_open keeps its objects */
+#define SEGCACHE_PROBES 16
+#define SEGCACHE_RETRIES 8
+#define SEGCACHE_ALIGN(n) (((n) + 63) & ~(size_t)63)
+
+typedef ARRAY_COEFF(char, 8) A_COEFF_TYPE;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t retired; /* set once the object has been unlinked */
+  uint32_t depth;
+  uint32_t nodes;
+  uint32_t users; /* processes mapping the object */
+  uint64_t slot_size;
+  uint64_t last_used; /* time of the last access */
+} segcache_header_t;
+
+typedef struct
+{
+  pthread_mutex_t lock; /* robust, process shared */
+  uint32_t key;         /* node index + 1, 0 if the entry is free */
+  uint32_t writers;     /* writers between datafile update and cache update */
+  int32_t last;         /* index + 1 of the last segment, 0 if unknown */
+  uint32_t spare;
+  uint64_t version; /* bumped by every completed write */
+} segcache_node_t;
+
+typedef struct
+{
+  uint32_t seq; /* odd while the slot is being updated */
+  int32_t idx;  /* segment index + 1, 0 if the slot is empty */
+  uint8_t kind;
+  uint8_t dtype;
+  uint8_t dimct;
+  uint8_t spare;
+  uint16_t length;
+  uint16_t spare2;
+  int32_t dims[8];
+  int32_t next_row;
+  uint32_t dim_bytes;  /* timestamps or serialized dimension */
+  uint32_t data_bytes; /* full segment, all rows */
+} segcache_slot_t;
+#define SLOT_PAYLOAD(slot) ((char *)(slot) + SEGCACHE_ALIGN(sizeof(segcache_slot_t)))
+#define SLOT_DATA(slot) (SLOT_PAYLOAD(slot) + (((slot)->dim_bytes + 7) & ~7u))
+
+typedef struct segcache_map
+{
+  struct segcache_map *next;
+  char treenam[13];
+  int shot;
+  int refs; /* TREE_INFOs using the map */
+  segcache_header_t *header;
+  size_t size;
+} segcache_map_t;
+
+static pthread_mutex_t map_lock = PTHREAD_MUTEX_INITIALIZER;
+static segcache_map_t *maps = NULL;
+static uint32_t cache_depth = 0;
+static uint64_t cache_slot_size = 1024 * 1024;
+static uint32_t cache_nodes = 64;
+static uint64_t cache_max_size = 256 * 1024 * 1024;
+
+static int64_t parse_size(const char *str)
+{
+  char *unit;
+  int64_t size = strtoll(str, &unit, 0);
+  switch (toupper((unsigned char)*unit))
+  {
+  case 'G':
+    size *= 1024;
+    MDS_ATTR_FALLTHROUGH
+  case 'M':
+    size *= 1024;
+    MDS_ATTR_FALLTHROUGH
+  case 'K':
+    size *= 1024;
+    break;
+  }
+  return size;
+}
+
+static void cache_init();
+INIT_SHARED_FUNCTION_ONCE(cache_init);
+static void cache_init()
+{
+  char *str = getenv("TreeSegmentCacheDepth");
+  if (str && atoi(str) > 0)
+    cache_depth = atoi(str);
+  str = getenv("TreeSegmentCacheSlotSize");
+  if (str && parse_size(str) > (int64_t)SEGCACHE_ALIGN(sizeof(segcache_slot_t)))
+    cache_slot_size = SEGCACHE_ALIGN(parse_size(str));
+  str = getenv("TreeSegmentCacheNodes");
+  if (str && atoi(str) > 0)
+    cache_nodes = atoi(str);
+  str = getenv("TreeSegmentCacheMaxSize");
+  if (str && parse_size(str) > 0)
+    cache_max_size = parse_size(str);
+}
+
+static inline int cache_enabled()
+{
+  RUN_SHARED_FUNCTION_ONCE(cache_init);
+  return cache_depth > 0;
+}
+
+int tree_segcache_enabled() { return cache_enabled(); }
+
+static inline size_t nodes_offset() { return SEGCACHE_ALIGN(sizeof(segcache_header_t)); }
+
+static inline size_t slots_offset(const segcache_header_t *header)
+{
+  return nodes_offset() +
+         SEGCACHE_ALIGN(header->nodes * sizeof(segcache_node_t));
+}
+
+static inline size_t cache_size(const segcache_header_t *header)
+{
+  return slots_offset(header) +
+         (size_t)header->nodes * header->depth * header->slot_size;
+}
+
+static void shm_name(char *name, size_t len, const char *tree, int shot)
+{
+  int i = snprintf(name, len, "/" SEGCACHE_PREFIX);
+  for (; *tree && i < (int)len - 16; tree++)
+    name[i++] = toupper((unsigned char)*tree);
+  snprintf(name + i, len - i, "_%d", shot);
+}
+
+static inline segcache_node_t *node_table(segcache_header_t *header)
+{
+  return (segcache_node_t *)((char *)header + nodes_offset());
+}
+
+/* the node mutexes outlive any one process, so they must be robust */
+static int init_locks(segcache_header_t *header)
+{
+  pthread_mutexattr_t attr;
+  segcache_node_t *nodes = node_table(header);
+  uint32_t i;
+  int err = pthread_mutexattr_init(&attr);
+  if (!err)
+    err = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  if (!err)
+    err = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  for (i = 0; !err && i < header->nodes; i++)
+    err = pthread_mutex_init(&nodes[i].lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+  return err;
+}
+
+static inline void touch(segcache_header_t *header)
+{
+  const uint64_t now = (uint64_t)time(NULL);
+  if (__atomic_load_n(&header->last_used, __ATOMIC_RELAXED) != now)
+    __atomic_store_n(&header->last_used, now, __ATOMIC_RELAXED);
+}
+
+/* Unlink an object and tell the processes mapping it. Returns the size it
+ * had or 0 if it did not exist.
+ */
+static off_t retire(const char *name)
+{
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd == -1)
+    return 0;
+  struct stat st;
+  if (fstat(fd, &st))
+    st.st_size = 0;
+  segcache_header_t *header =
+      (size_t)st.st_size >= sizeof(*header)
+          ? mmap(NULL, sizeof(*header), PROT_READ | PROT_WRITE, MAP_SHARED,
+                 fd, 0)
+          : MAP_FAILED;
+  close(fd);
+  shm_unlink(name);
+  if (header != MAP_FAILED)
+  {
+    __atomic_store_n(&header->retired, 1, __ATOMIC_RELEASE);
+    munmap(header, sizeof(*header));
+  }
+  return st.st_size;
+}
+
+typedef struct
+{
+  char name[NAME_MAX + 2];
+  off_t size;
+  int orphan; /* no process maps it any more */
+  uint64_t last_used;
+} segcache_object_t;
+
+static int object_cmp(const void *a_in, const void *b_in)
+{
+  const segcache_object_t *a = a_in, *b = b_in;
+  if (a->orphan != b->orphan)
+    return b->orphan - a->orphan;
+  return a->last_used < b->last_used ? -1 : a->last_used > b->last_used;
+}
+
+/* Retire cache objects of other shots until an object of size bytes fits in
+ * TreeSegmentCacheMaxSize: orphans first, then the least recently used.
+ * Objects that are still being created are left alone.
+ */
+static void make_room(size_t size)
+{
+  DIR *dir = opendir(SEGCACHE_SHM_DIR);
+  if (!dir)
+    return;
+  segcache_object_t *objects = NULL;
+  size_t count = 0, allocated = 0, i;
+  uint64_t total = size;
+  struct dirent *entry;
+  while ((entry = readdir(dir)))
+  {
+    if (strncmp(entry->d_name, SEGCACHE_PREFIX, sizeof(SEGCACHE_PREFIX) - 1) ||
+        strlen(entry->d_name) > NAME_MAX)
+      continue;
+    segcache_object_t object;
+    snprintf(object.name, sizeof(object.name), "/%s", entry->d_name);
+    int fd = shm_open(object.name, O_RDONLY, 0);
+    if (fd == -1)
+      continue;
+    struct stat st;
+    segcache_header_t *header = MAP_FAILED;
+    if (!fstat(fd, &st) && (size_t)st.st_size >= sizeof(*header))
+      header = mmap(NULL, sizeof(*header), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED)
+      continue;
+    const int ready =
+        __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == SEGCACHE_MAGIC;
+    object.size = st.st_size;
+    object.orphan = !__atomic_load_n(&header->users, __ATOMIC_RELAXED);
+    object.last_used = __atomic_load_n(&header->last_used, __ATOMIC_RELAXED);
+    munmap(header, sizeof(*header));
+    total += object.size;
+    if (!ready)
+      continue;
+    if (count == allocated)
+    {
+      allocated = allocated ? allocated * 2 : 16;
+      segcache_object_t *grown =
+          realloc(objects, allocated * sizeof(segcache_object_t));
+      if (!grown)
+        break;
+      objects = grown;
+    }
+    objects[count++] = object;
+  }
+  closedir(dir);
+  qsort(objects, count, sizeof(segcache_object_t), object_cmp);
+  for (i = 0; i < count && total > cache_max_size; i++)
+  {
+    MDSDBG("retiring %s to make room", objects[i].name);
+    total -= retire(objects[i].name);
+  }
+  free(objects);
+}
+
+/* Map the cache object of a tree, creating it if this is the first user.
+ * The object is counted in users until unmap_object.
+ */
+static segcache_header_t *map_create(const char *treenam, int shot,
+                                     size_t *size_out)
+{
+  char name[64];
+  shm_name(name, sizeof(name), treenam, shot);
+  segcache_header_t geometry = {0, 0, 0, cache_depth, cache_nodes, 0,
+                                cache_slot_size, 0};
+  size_t size = cache_size(&geometry);
+  if (size > cache_max_size)
+  { // fewer nodes, the slots are what takes the space
+    geometry.nodes = cache_max_size / (geometry.depth * geometry.slot_size);
+    while (geometry.nodes > 0 && cache_size(&geometry) > cache_max_size)
+      geometry.nodes--;
+    if (geometry.nodes == 0)
+      return NULL;
+    size = cache_size(&geometry);
+  }
+  int attempt;
+  for (attempt = 0; attempt < 3; attempt++)
+  {
+    int creator = FALSE;
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd == -1 && errno == ENOENT)
+    {
+      make_room(size);
+      fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+      creator = fd != -1;
+      if (!creator && errno == EEXIST)
+        fd = shm_open(name, O_RDWR, 0);
+    }
+    if (fd == -1)
+      return NULL;
+    // allocate the memory now, writing to a sparse object could SIGBUS
+    if (creator && posix_fallocate(fd, 0, size))
+    {
+      close(fd);
+      shm_unlink(name);
+      return NULL;
+    }
+    size_t mapped = size;
+    struct stat st;
+    if (!creator)
+    { // wait for the creator to size the object
+      int i;
+      for (i = 0; i < 1000; i++)
+      {
+        if (fstat(fd, &st) == 0 &&
+            st.st_size >= (off_t)sizeof(segcache_header_t))
+          break;
+        usleep(1000);
+      }
+      if (i == 1000)
+      {
+        close(fd);
+        return NULL;
+      }
+      mapped = st.st_size;
+    }
+    segcache_header_t *header =
+        mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED)
+      return NULL;
+    if (creator)
+    {
+      header->version = SEGCACHE_VERSION;
+      header->depth = geometry.depth;
+      header->nodes = geometry.nodes;
+      header->slot_size = geometry.slot_size;
+      header->users = 1;
+      touch(header);
+      if (init_locks(header))
+      {
+        munmap(header, mapped);
+        shm_unlink(name);
+        return NULL;
+      }
+      __atomic_store_n(&header->magic, SEGCACHE_MAGIC, __ATOMIC_RELEASE);
+    }
+    else
+    {
+      int i;
+      for (i = 0; i < 1000 && __atomic_load_n(&header->magic,
+                                              __ATOMIC_ACQUIRE) !=
+                                  SEGCACHE_MAGIC;
+           i++)
+        usleep(1000);
+      if (i == 1000 || header->version != SEGCACHE_VERSION ||
+          cache_size(header) > mapped)
+      {
+        munmap(header, mapped);
+        return NULL;
+      }
+      __atomic_add_fetch(&header->users, 1, __ATOMIC_ACQ_REL);
+      if (__atomic_load_n(&header->retired, __ATOMIC_ACQUIRE))
+      { // unlinked by its last user in the meantime, create a new one
+        __atomic_sub_fetch(&header->users, 1, __ATOMIC_ACQ_REL);
+        munmap(header, mapped);
+        continue;
+      }
+      touch(header);
+    }
+    *size_out = mapped;
+    return header;
+  }
+  return NULL;
+}
+
+/* Drop the reference of this process to an object, unlinking it if this was
+ * the last one. Called with map_lock held.
+ */
+static void map_release(segcache_map_t *map)
+{
+  segcache_map_t **prev;
+  if (--map->refs > 0)
+    return;
+  for (prev = &maps; *prev && *prev != map; prev = &(*prev)->next)
+    ;
+  if (*prev)
+    *prev = map->next;
+  if (map->header)
+  {
+    if (!__atomic_sub_fetch(&map->header->users, 1, __ATOMIC_ACQ_REL) &&
+        !__atomic_exchange_n(&map->header->retired, 1, __ATOMIC_ACQ_REL))
+    { // nobody else retired it, so the name still refers to this object
+      char name[64];
+      shm_name(name, sizeof(name), map->treenam, map->shot);
+      shm_unlink(name);
+    }
+    munmap(map->header, map->size);
+  }
+  free(map);
+}
+
+/* Return the cache object of a tree. A failed attempt is remembered while
+ * the tree stays open, so a host without shared memory does not retry on
+ * every call.
+ */
+static segcache_header_t *get_header(TREE_INFO *info)
+{
+  segcache_map_t *map = (segcache_map_t *)info->segcache;
+  if (map && map->header &&
+      !__atomic_load_n(&map->header->retired, __ATOMIC_ACQUIRE))
+  {
+    touch(map->header);
+    return map->header;
+  }
+  if (strlen(info->treenam) >= sizeof(maps->treenam))
+    return NULL;
+  pthread_mutex_lock(&map_lock);
+  if (map && map->header)
+  { // the object was retired, map the current one
+    info->segcache = NULL;
+    map_release(map);
+    map = NULL;
+  }
+  if (!map)
+  {
+    for (map = maps; map; map = map->next)
+      if (map->shot == info->shot && strcmp(map->treenam, info->treenam) == 0 &&
+          !(map->header &&
+            __atomic_load_n(&map->header->retired, __ATOMIC_ACQUIRE)))
+        break;
+    if (!map && (map = calloc(1, sizeof(segcache_map_t))))
+    {
+      strcpy(map->treenam, info->treenam);
+      map->shot = info->shot;
+      map->header = map_create(info->treenam, info->shot, &map->size);
+      map->next = maps;
+      maps = map;
+    }
+    if (map)
+    {
+      map->refs++;
+      info->segcache = map;
+    }
+  }
+  segcache_header_t *header = map ? map->header : NULL;
+  pthread_mutex_unlock(&map_lock);
+  return header;
+}
+
+void tree_segcache_close(TREE_INFO *info)
+{
+  if (!info->segcache)
+    return;
+  pthread_mutex_lock(&map_lock);
+  map_release((segcache_map_t *)info->segcache);
+  info->segcache = NULL;
+  pthread_mutex_unlock(&map_lock);
+}
+
+static segcache_node_t *find_node(segcache_header_t *header, int nidx)
+{
+  segcache_node_t *nodes = node_table(header);
+  const uint32_t key = (uint32_t)nidx + 1;
+  uint32_t i = (key * 2654435761u) % header->nodes;
+  int probe;
+  for (probe = 0; probe < SEGCACHE_PROBES; probe++, i = (i + 1) % header->nodes)
+  {
+    uint32_t current = __atomic_load_n(&nodes[i].key, __ATOMIC_ACQUIRE);
+    if (current == 0 &&
+        !__atomic_compare_exchange_n(&nodes[i].key, &current, key, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      ; // someone else claimed it, current holds their key
+    else if (current == 0)
+      return &nodes[i];
+    if (current == key)
+      return &nodes[i];
+  }
+  return NULL;
+}
+
+static inline segcache_slot_t *get_slot(segcache_header_t *header,
+                                        segcache_node_t *node, int idx)
+{
+  const size_t n = (size_t)(node - node_table(header)) * header->depth +
+                   (uint32_t)idx % header->depth;
+  return (segcache_slot_t *)((char *)header + slots_offset(header) +
+                             n * header->slot_size);
+}
+
+static inline size_t slot_capacity(segcache_header_t *header)
+{
+  return header->slot_size - SEGCACHE_ALIGN(sizeof(segcache_slot_t));
+}
+
+static void node_clear(segcache_header_t *header, segcache_node_t *node);
+
+static void node_lock(segcache_header_t *header, segcache_node_t *node)
+{
+  if (pthread_mutex_lock(&node->lock) == EOWNERDEAD)
+  { // the previous owner died in the middle of an update, its slots cannot
+    // be trusted; its writers count stays raised so fills remain off
+    node_clear(header, node);
+    pthread_mutex_consistent(&node->lock);
+  }
+}
+
+static inline void node_unlock(segcache_node_t *node)
+{
+  pthread_mutex_unlock(&node->lock);
+}
+
+static inline void slot_begin(segcache_slot_t *slot)
+{ // the seq may already be odd if the last writer died
+  __atomic_store_n(&slot->seq, slot->seq | 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void slot_end(segcache_slot_t *slot)
+{
+  __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* forget everything about a node, called with the node locked */
+static void node_clear(segcache_header_t *header, segcache_node_t *node)
+{
+  uint32_t i;
+  node->last = 0;
+  for (i = 0; i < header->depth; i++)
+  {
+    segcache_slot_t *slot = get_slot(header, node, i);
+    if (slot->idx)
+    {
+      slot_begin(slot);
+      slot->idx = 0;
+      slot_end(slot);
+    }
+  }
+}
+
+static inline int bytes_per_row(const segcache_slot_t *slot)
+{
+  int i, bytes = slot->length;
+  for (i = 0; i < slot->dimct - 1; i++)
+    bytes *= slot->dims[i];
+  return bytes;
+}
+
+/* Same rule as get_filled_rows_ts for segments that are not the last one */
+static int filled_rows_ts(const int64_t *timestamps, int rows)
+{
+  if (rows > 1 && timestamps[rows - 2] >= 0)
+    for (; rows > 0 && timestamps[rows - 1] == 0; rows--)
+      ;
+  return rows;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// readers
+///////////////////////////////////////////////////////////////////////////////
+
+/* Copy a cached segment into segment and dim.
+ * Returns TreeSUCCESS on a hit, TreeFAILURE if the datafile has to be read.
+ * On a miss fill is prepared for tree_segcache_fill.
+ */
+int tree_segcache_get(PINO_DATABASE *dblist, int nid, int idx,
+                      mdsdsc_xd_t *segment, mdsdsc_xd_t *dim,
+                      segcache_fill_t *fill)
+{
+  fill->node = NULL;
+  if (!cache_enabled() || !dblist || dblist->remote || !IS_OPEN(dblist) ||
+      (!segment && !dim))
+    return TreeFAILURE;
+  TREE_INFO *info;
+  int nidx;
+  nid_to_tree_nidx(dblist, (NID *)&nid, info, nidx);
+  if (!info)
+    return TreeFAILURE;
+  segcache_header_t *header = get_header(info);
+  if (!header)
+    return TreeFAILURE;
+  segcache_node_t *node = find_node(header, nidx);
+  if (!node)
+    return TreeFAILURE;
+  fill->header = header;
+  fill->node = node;
+  fill->writers = __atomic_load_n(&node->writers, __ATOMIC_ACQUIRE);
+  fill->version = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+  const int last = __atomic_load_n(&node->last, __ATOMIC_ACQUIRE) - 1;
+  if (last < 0)
+    return TreeFAILURE;
+  // the segment header is small, reading it catches writes the cache missed
+  int head_last, head_next_row;
+  if (IS_NOT_OK(tree_segment_head(dblist, nid, &head_last, &head_next_row)) ||
+      head_last != last)
+    return TreeFAILURE;
+  if (idx == -1)
+    idx = last;
+  if (idx < 0 || idx > last)
+    return TreeFAILURE;
+  segcache_slot_t *slot = get_slot(header, node, idx);
+  segcache_slot_t snap;
+  char *payload = NULL;
+  int filled = -1, retry;
+  for (retry = 0; retry < SEGCACHE_RETRIES; retry++)
+  {
+    const uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+    {
+      sched_yield();
+      continue;
+    }
+    memcpy(&snap, slot, sizeof(snap));
+    if (snap.idx != idx + 1 || snap.dimct < 1 || snap.dimct > 8 ||
+        snap.dim_bytes + snap.data_bytes + 8 > slot_capacity(header))
+      break;
+    const size_t bytes = ((snap.dim_bytes + 7) & ~7u) + snap.data_bytes;
+    char *buf = realloc(payload, bytes ? bytes : 1);
+    if (!buf)
+      break;
+    payload = buf;
+    memcpy(payload, SLOT_PAYLOAD(slot), bytes);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+      continue;
+    const int rows = snap.dims[snap.dimct - 1];
+    if (idx == last)
+      filled = snap.next_row == head_next_row ? snap.next_row : -1;
+    else if (snap.kind == SEGCACHE_DIM_TIMESTAMPS)
+      filled = filled_rows_ts((int64_t *)payload, rows);
+    else
+      filled = rows;
+    // a partial dimension would have to be trimmed by TDI, read it instead
+    if (snap.kind == SEGCACHE_DIM_DSC && filled != rows && dim)
+      filled = -1;
+    if (filled > rows)
+      filled = -1;
+    break;
+  }
+  if (filled < 0)
+  {
+    free(payload);
+    return TreeFAILURE;
+  }
+  int status = TreeSUCCESS;
+  char *data = payload + ((snap.dim_bytes + 7) & ~7u);
+  mdsdsc_xd_t *data_out = segment;
+  if (!data_out && snap.kind == SEGCACHE_DIM_NONE)
+    data_out = dim; // no dimension stored, it is the data itself
+  if (data_out)
+  {
+    DESCRIPTOR_A_COEFF(ans, snap.length, snap.dtype, NULL, 8, 0);
+    ans.dimct = snap.dimct;
+    memcpy(ans.m, snap.dims, sizeof(snap.dims));
+    ans.m[snap.dimct - 1] = filled;
+    int i;
+    ans.arsize = ans.length;
+    for (i = 0; i < ans.dimct; i++)
+      ans.arsize *= ans.m[i];
+    ans.pointer = ans.a0 = ans.arsize ? data : NULL;
+    status = MdsCopyDxXd((mdsdsc_t *)&ans, data_out);
+  }
+  if (STATUS_OK && dim && dim != data_out)
+  {
+    if (snap.kind == SEGCACHE_DIM_TIMESTAMPS)
+    {
+      DESCRIPTOR_A(ans, 8, DTYPE_Q, 0, 0);
+      ans.arsize = filled * sizeof(int64_t);
+      ans.pointer = ans.arsize ? payload : NULL;
+      status = MdsCopyDxXd((mdsdsc_t *)&ans, dim);
+    }
+    else if (snap.kind == SEGCACHE_DIM_DSC)
+      status = MdsSerializeDscIn(payload, dim);
+    else
+      status = MdsCopyDxXd((mdsdsc_t *)segment, dim);
+  }
+  free(payload);
+  if (STATUS_NOT_OK)
+    return status;
+  fill->node = NULL;
+  return TreeSUCCESS;
+}
+
+/* Store a segment that was read from the datafile after a miss.
+ * rows is the allocated number of rows of segment idx, last the index of the
+ * last segment of the node and next_row its next_row; kind tells how the
+ * dimension is stored.
+ */
+void tree_segcache_fill(segcache_fill_t *fill, int idx, int rows, int last,
+                        int next_row, int kind, mdsdsc_xd_t *segment,
+                        mdsdsc_xd_t *dim)
+{
+  if (!fill->node || !segment || !segment->pointer ||
+      (kind != SEGCACHE_DIM_NONE && (!dim || !dim->pointer)))
+    return;
+  segcache_header_t *header = fill->header;
+  segcache_node_t *node = fill->node;
+  mdsdsc_a_t *data = (mdsdsc_a_t *)segment->pointer;
+  if (data->class != CLASS_A || data->dimct < 1 || data->dimct > 8 ||
+      !data->length)
+    return;
+  int dims[8] = {0}, i;
+  if (data->dimct == 1)
+    dims[0] = data->arsize / data->length;
+  else
+    memcpy(dims, ((A_COEFF_TYPE *)data)->m, data->dimct * sizeof(int));
+  const int filled = dims[data->dimct - 1];
+  if (rows < filled || (idx == last && (next_row < 0 || next_row > rows)))
+    return;
+  // the unwritten rows of a partial segment are only known to be zero for
+  // timestamped segments, and a partial dimension has been trimmed
+  if (idx == last && next_row != rows && kind != SEGCACHE_DIM_TIMESTAMPS)
+    return;
+  dims[data->dimct - 1] = rows;
+  size_t data_bytes = data->length;
+  for (i = 0; i < data->dimct; i++)
+    data_bytes *= dims[i];
+  EMPTYXD(ser);
+  uint32_t dim_bytes = 0;
+  if (kind == SEGCACHE_DIM_TIMESTAMPS)
+  {
+    mdsdsc_a_t *ts = (mdsdsc_a_t *)dim->pointer;
+    if (ts->class != CLASS_A || ts->dtype != DTYPE_Q ||
+        ts->arsize != filled * sizeof(int64_t))
+      return;
+    dim_bytes = rows * sizeof(int64_t);
+  }
+  else if (kind == SEGCACHE_DIM_DSC)
+  {
+    if (IS_NOT_OK(MdsSerializeDscOut(dim->pointer, &ser)) || !ser.pointer)
+      return;
+    dim_bytes = ((mdsdsc_a_t *)ser.pointer)->arsize;
+  }
+  if (((dim_bytes + 7) & ~7u) + data_bytes > slot_capacity(header) ||
+      data->arsize > data_bytes)
+  {
+    MdsFree1Dx(&ser, NULL);
+    return;
+  }
+  node_lock(header, node);
+  if (node->writers == 0 && fill->writers == 0 &&
+      node->version == fill->version)
+  {
+    segcache_slot_t *slot = get_slot(header, node, idx);
+    slot_begin(slot);
+    slot->idx = idx + 1;
+    slot->kind = kind;
+    slot->dtype = data->dtype;
+    slot->dimct = data->dimct;
+    slot->length = data->length;
+    memcpy(slot->dims, dims, sizeof(dims));
+    slot->next_row = (idx == last) ? next_row : rows;
+    slot->dim_bytes = dim_bytes;
+    slot->data_bytes = data_bytes;
+    if (kind == SEGCACHE_DIM_TIMESTAMPS)
+    {
+      const size_t valid = filled * sizeof(int64_t);
+      memcpy(SLOT_PAYLOAD(slot), ((mdsdsc_a_t *)dim->pointer)->pointer, valid);
+      memset(SLOT_PAYLOAD(slot) + valid, 0, dim_bytes - valid);
+    }
+    else if (kind == SEGCACHE_DIM_DSC)
+      memcpy(SLOT_PAYLOAD(slot), ((mdsdsc_a_t *)ser.pointer)->pointer,
+             dim_bytes);
+    memcpy(SLOT_DATA(slot), data->pointer, data->arsize);
+    memset(SLOT_DATA(slot) + data->arsize, 0, data_bytes - data->arsize);
+    slot_end(slot);
+    __atomic_store_n(&node->last, last + 1, __ATOMIC_RELEASE);
+  }
+  node_unlock(node);
+  MdsFree1Dx(&ser, NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// writers
+///////////////////////////////////////////////////////////////////////////////
+
+/* Announce a write to a segmented node. Must be called before the datafile
+ * is updated and be followed by exactly one of the tree_segcache_end_*
+ * calls.
+ */
+void tree_segcache_begin(PINO_DATABASE *dblist, int nid, segcache_write_t *w)
+{
+  w->node = NULL;
+  if (!cache_enabled() || !dblist || dblist->remote || !IS_OPEN(dblist))
+    return;
+  TREE_INFO *info;
+  int nidx;
+  nid_to_tree_nidx(dblist, (NID *)&nid, info, nidx);
+  if (!info)
+    return;
+  w->header = get_header(info);
+  if (!w->header)
+    return;
+  w->node = find_node(w->header, nidx);
+  if (w->node)
+    __atomic_add_fetch(&((segcache_node_t *)w->node)->writers, 1,
+                       __ATOMIC_ACQ_REL);
+}
+
+static inline void write_done(segcache_write_t *w)
+{
+  segcache_node_t *node = w->node;
+  node->version++;
+  __atomic_sub_fetch(&node->writers, 1, __ATOMIC_ACQ_REL);
+  node_unlock(node);
+}
+
+/* resolve DTYPE_DSC and scalars the same way the segment routines do */
+static mdsdsc_a_t *get_array(mdsdsc_a_t *data, mdsdsc_a_t *scalar)
+{
+  while (data && data->dtype == DTYPE_DSC)
+    data = (mdsdsc_a_t *)data->pointer;
+  if (data && (data->class == CLASS_S || data->class == CLASS_D))
+  {
+    scalar->pointer = data->pointer;
+    scalar->length = data->length;
+    scalar->class = CLASS_A;
+    scalar->dtype = data->dtype;
+    scalar->arsize = data->length;
+    scalar->dimct = 1;
+    data = scalar;
+  }
+  if (!data || data->class != CLASS_A || data->dimct < 1 || data->dimct > 8)
+    return NULL;
+  return data;
+}
+
+/* Start a new slot for segment idx, called with the node locked.
+ * rows_data may be NULL for an empty (zeroed) segment.
+ */
+static int publish_segment(segcache_header_t *header, segcache_node_t *node,
+                           int idx, int kind, int dtype, int length, int dimct,
+                           const int *dims, const void *data, int rows_filled,
+                           const void *dim, uint32_t dim_bytes)
+{
+  int i;
+  size_t data_bytes = length;
+  for (i = 0; i < dimct; i++)
+    data_bytes *= dims[i];
+  const int rows = dims[dimct - 1];
+  if (kind == SEGCACHE_DIM_TIMESTAMPS)
+    dim_bytes = rows * sizeof(int64_t);
+  if (((dim_bytes + 7) & ~7u) + data_bytes > slot_capacity(header))
+    return TreeFAILURE;
+  if (rows_filled < 0 || rows_filled > rows)
+    rows_filled = rows;
+  segcache_slot_t *slot = get_slot(header, node, idx);
+  slot_begin(slot);
+  slot->idx = idx + 1;
+  slot->kind = kind;
+  slot->dtype = dtype;
+  slot->dimct = dimct;
+  slot->length = length;
+  memset(slot->dims, 0, sizeof(slot->dims));
+  memcpy(slot->dims, dims, dimct * sizeof(int));
+  slot->next_row = rows_filled;
+  slot->dim_bytes = dim_bytes;
+  slot->data_bytes = data_bytes;
+  if (kind == SEGCACHE_DIM_TIMESTAMPS)
+  { // as putdim_ts: rows past rows_filled have zero timestamps
+    const size_t valid = dim ? rows_filled * sizeof(int64_t) : 0;
+    if (valid)
+      memcpy(SLOT_PAYLOAD(slot), dim, valid);
+    memset(SLOT_PAYLOAD(slot) + valid, 0, dim_bytes - valid);
+  }
+  else if (dim_bytes)
+    memcpy(SLOT_PAYLOAD(slot), dim, dim_bytes);
+  if (data)
+    memcpy(SLOT_DATA(slot), data, data_bytes);
+  else
+    memset(SLOT_DATA(slot), 0, data_bytes);
+  slot_end(slot);
+  node->last = idx + 1;
+  return TreeSUCCESS;
+}
+
+/* Append rows to the last segment as _TreeXNciPutSegment and
+ * _TreeXNciPutTimestampedSegment do, called with the node locked.
+ */
+static int append_rows(segcache_header_t *header, segcache_node_t *node,
+                       int start_idx, const int64_t *timestamps,
+                       mdsdsc_a_t *data_in)
+{
+  const int last = node->last - 1;
+  if (last < 0)
+    return TreeFAILURE;
+  DESCRIPTOR_A(scalar, 0, 0, 0, 0);
+  mdsdsc_a_t *data = get_array(data_in, (mdsdsc_a_t *)&scalar);
+  segcache_slot_t *slot = get_slot(header, node, last);
+  if (!data || slot->idx != last + 1 ||
+      (timestamps != NULL) != (slot->kind == SEGCACHE_DIM_TIMESTAMPS))
+    return TreeFAILURE;
+  A_COEFF_TYPE *a_coeff = (A_COEFF_TYPE *)data;
+  if (data->dtype != slot->dtype ||
+      (data->dimct != slot->dimct && data->dimct != slot->dimct - 1) ||
+      (data->dimct > 1 &&
+       memcmp(slot->dims, a_coeff->m, (data->dimct - 1) * sizeof(int))))
+    return TreeFAILURE;
+  const int rows = slot->dims[slot->dimct - 1];
+  if (start_idx == -1)
+    start_idx = slot->next_row;
+  if (start_idx < 0 || start_idx >= rows)
+    return TreeFAILURE;
+  int rows_to_insert;
+  if (data->dimct < slot->dimct)
+    rows_to_insert = 1;
+  else if (data->dimct == 1)
+    rows_to_insert = data->arsize / data->length;
+  else
+    rows_to_insert = a_coeff->m[a_coeff->dimct - 1];
+  if (rows_to_insert > rows - start_idx)
+    rows_to_insert = rows - start_idx;
+  const uint32_t row_bytes = bytes_per_row(slot);
+  if (rows_to_insert * row_bytes < data->arsize)
+    return TreeFAILURE;
+  slot_begin(slot);
+  memcpy(SLOT_DATA(slot) + (size_t)start_idx * row_bytes, data->pointer,
+         data->arsize);
+  if (timestamps)
+    memcpy(SLOT_PAYLOAD(slot) + start_idx * sizeof(int64_t), timestamps,
+           rows_to_insert * sizeof(int64_t));
+  if (timestamps || start_idx == slot->next_row)
+    slot->next_row = start_idx + rows_to_insert;
+  slot_end(slot);
+  return TreeSUCCESS;
+}
+
+static int last_segment(PINO_DATABASE *dblist, int nid)
+{
+  int num = 0;
+  if (IS_NOT_OK(_TreeXNciGetNumSegments(dblist, nid, NULL, &num)))
+    return -1;
+  return num - 1;
+}
+
+/* _TreeMakeSegment, _TreeMakeTimestampedSegment and the Begin variants */
+void tree_segcache_end_make(segcache_write_t *w, int status,
+                            PINO_DATABASE *dblist, int nid,
+                            mdsdsc_t *dimension, int64_t *timestamps,
+                            int timestamped, mdsdsc_a_t *initialValue,
+                            int rows_filled)
+{
+  if (!w->node)
+    return;
+  segcache_header_t *header = w->header;
+  segcache_node_t *node = w->node;
+  const int idx = STATUS_OK ? last_segment(dblist, nid) : -1;
+  DESCRIPTOR_A(scalar, 0, 0, 0, 0);
+  mdsdsc_a_t *data = get_array(initialValue, (mdsdsc_a_t *)&scalar);
+  EMPTYXD(ser);
+  int kind = timestamped ? SEGCACHE_DIM_TIMESTAMPS
+                         : (dimension ? SEGCACHE_DIM_DSC : SEGCACHE_DIM_NONE);
+  if (kind == SEGCACHE_DIM_DSC)
+    MdsSerializeDscOut(dimension, &ser);
+  node_lock(header, node);
+  int ok = idx >= 0 && data && data->dtype != DTYPE_OPAQUE &&
+           (kind != SEGCACHE_DIM_DSC || ser.pointer);
+  if (ok)
+  {
+    int dims[8];
+    if (data->dimct == 1)
+      dims[0] = data->arsize / data->length;
+    else
+      memcpy(dims, ((A_COEFF_TYPE *)data)->m, data->dimct * sizeof(int));
+    ok = IS_OK(publish_segment(
+        header, node, idx, kind, data->dtype, data->length, data->dimct, dims,
+        data->pointer, rows_filled,
+        kind == SEGCACHE_DIM_DSC ? ((mdsdsc_a_t *)ser.pointer)->pointer
+                                 : (char *)timestamps,
+        kind == SEGCACHE_DIM_DSC ? ((mdsdsc_a_t *)ser.pointer)->arsize : 0));
+  }
+  if (!ok)
+    node_clear(header, node);
+  write_done(w);
+  MdsFree1Dx(&ser, NULL);
+}
+
+/* _TreePutSegment (timestamps NULL) and _TreePutTimestampedSegment */
+void tree_segcache_end_put(segcache_write_t *w, int status, int start_idx,
+                           int64_t *timestamps, mdsdsc_a_t *data)
+{
+  if (!w->node)
+    return;
+  node_lock(w->header, w->node);
+  if (STATUS_NOT_OK ||
+      IS_NOT_OK(append_rows(w->header, w->node, start_idx, timestamps, data)))
+    node_clear(w->header, w->node);
+  write_done(w);
+}
+
+/* _TreePutRow: append to the last segment or, if that was full, start a
+ * new one of bufsize rows the way _TreeXNciPutRow does.
+ */
+void tree_segcache_end_put_row(segcache_write_t *w, int status,
+                               PINO_DATABASE *dblist, int nid, int bufsize,
+                               int64_t *timestamp, mdsdsc_a_t *data_in)
+{
+  if (!w->node)
+    return;
+  segcache_header_t *header = w->header;
+  segcache_node_t *node = w->node;
+  DESCRIPTOR_A(scalar, 0, 0, 0, 0);
+  mdsdsc_a_t *data = get_array(data_in, (mdsdsc_a_t *)&scalar);
+  int ok = STATUS_OK && data;
+  if (ok)
+  {
+    node_lock(header, node);
+    const int last = node->last - 1;
+    segcache_slot_t *slot = last >= 0 ? get_slot(header, node, last) : NULL;
+    const int room = slot && slot->idx == last + 1 &&
+                     slot->next_row < slot->dims[slot->dimct - 1];
+    node_unlock(node);
+    int idx = room ? last : last_segment(dblist, nid);
+    node_lock(header, node);
+    if (idx == last && room)
+      ok = IS_OK(append_rows(header, node, -1, timestamp, data_in));
+    else if (idx >= 0)
+    {
+      int dims[8], dimct;
+      if (data == (mdsdsc_a_t *)&scalar)
+      {
+        dimct = 1;
+        dims[0] = bufsize;
+      }
+      else
+      {
+        dimct = data->dimct + 1;
+        if (data->dimct == 1)
+          dims[0] = data->arsize / data->length;
+        else
+          memcpy(dims, ((A_COEFF_TYPE *)data)->m, data->dimct * sizeof(int));
+        dims[data->dimct] = bufsize;
+      }
+      ok = dimct <= 8 &&
+           IS_OK(publish_segment(header, node, idx, SEGCACHE_DIM_TIMESTAMPS,
+                                 data->dtype, data->length, dimct, dims, NULL,
+                                 0, NULL, 0)) &&
+           IS_OK(append_rows(header, node, -1, timestamp, data_in));
+    }
+    else
+      ok = 0;
+  }
+  else
+    node_lock(header, node);
+  if (!ok)
+    node_clear(header, node);
+  write_done(w);
+}
+
+/* anything else that changes segments: forget the node */
+void tree_segcache_end_invalidate(segcache_write_t *w)
+{
+  if (!w->node)
+    return;
+  node_lock(w->header, w->node);
+  node_clear(w->header, w->node);
+  write_done(w);
+}
+
+/* Retire the cache object of a shot whose pulse files are being replaced.
+ * Processes still mapping it notice on their next access.
+ */
+void tree_segcache_purge(char const *tree, int shot)
+{
+  char name[64];
+  if (!cache_enabled())
+    return;
+  shm_name(name, sizeof(name), tree, shot);
+  retire(name);
+}
+
+#else /* _WIN32 */
+
+int tree_segcache_enabled() { return FALSE; }
+
+int tree_segcache_get(PINO_DATABASE *dblist __attribute__((unused)),
+                      int nid __attribute__((unused)),
+                      int idx __attribute__((unused)),
+                      mdsdsc_xd_t *segment __attribute__((unused)),
+                      mdsdsc_xd_t *dim __attribute__((unused)),
+                      segcache_fill_t *fill)
+{
+  fill->node = NULL;
+  return TreeFAILURE;
+}
+void tree_segcache_fill(segcache_fill_t *fill __attribute__((unused)),
+                        int idx __attribute__((unused)),
+                        int rows __attribute__((unused)),
+                        int last __attribute__((unused)),
+                        int next_row __attribute__((unused)),
+                        int kind __attribute__((unused)),
+                        mdsdsc_xd_t *segment __attribute__((unused)),
+                        mdsdsc_xd_t *dim __attribute__((unused))) {}
+void tree_segcache_begin(PINO_DATABASE *dblist __attribute__((unused)),
+                         int nid __attribute__((unused)), segcache_write_t *w)
+{
+  w->node = NULL;
+}
+void tree_segcache_end_make(segcache_write_t *w __attribute__((unused)),
+                            int status __attribute__((unused)),
+                            PINO_DATABASE *dblist __attribute__((unused)),
+                            int nid __attribute__((unused)),
+                            mdsdsc_t *dimension __attribute__((unused)),
+                            int64_t *timestamps __attribute__((unused)),
+                            int timestamped __attribute__((unused)),
+                            mdsdsc_a_t *initialValue __attribute__((unused)),
+                            int rows_filled __attribute__((unused))) {}
+void tree_segcache_end_put(segcache_write_t *w __attribute__((unused)),
+                           int status __attribute__((unused)),
+                           int start_idx __attribute__((unused)),
+                           int64_t *timestamps __attribute__((unused)),
+                           mdsdsc_a_t *data __attribute__((unused))) {}
+void tree_segcache_end_put_row(segcache_write_t *w __attribute__((unused)),
+                               int status __attribute__((unused)),
+                               PINO_DATABASE *dblist __attribute__((unused)),
+                               int nid __attribute__((unused)),
+                               int bufsize __attribute__((unused)),
+                               int64_t *timestamp __attribute__((unused)),
+                               mdsdsc_a_t *data __attribute__((unused))) {}
+void tree_segcache_end_invalidate(segcache_write_t *w __attribute__((unused))) {}
+void tree_segcache_close(TREE_INFO *info __attribute__((unused))) {}
+void tree_segcache_purge(char const *tree __attribute__((unused)),
+                         int shot __attribute__((unused))) {}
+
+#endif /* _WIN32 */
@@ -368,8 +368,8 @@ static int open_datafile_write0(vars_t *vars)
   RETURN_IF_NOT_OK(load_node_ptr(vars));
   RETURN_IF_NOT_OK(check_segment_remote(vars));
   RETURN_IF_NOT_OK(load_info_ptr(vars));
-  TreeCallHookFun("TreeNidHook", "PutData", vars->tinfo->treenam,
-                  vars->tinfo->shot, *vars->nid_ptr, NULL);
+  TREE_HOOKS(PutData, vars->tinfo->treenam, vars->tinfo->shot,
+             *(int *)vars->nid_ptr, NULL);
   status = TreeCallHook(PutData, vars->tinfo, *(int *)vars->nid_ptr);
   if (status && STATUS_NOT_OK)
     return status;
@@ -1438,13 +1438,13 @@ int _TreeXNciMakeSegment(void *dbid, int nid, const char *xnci, mdsdsc_t *start,
   GOTO_IF_NOT_OK(end, begin_sinfo(vars, initialValue, check_compress_dim));
   GOTO_IF_NOT_OK(end, putdata_initialvalue(vars, initialValue));
   GOTO_IF_NOT_OK(end, putdim_dim(vars, start, end, dimension));
-  TreeCallHookFun("TreeNidHook", "MakeSegment", vars->tinfo->treenam,
-                  vars->tinfo->shot, *vars->nid_ptr, NULL);
+  TREE_HOOKS(MakeSegment, vars->tinfo->treenam, vars->tinfo->shot,
+             *(int *)vars->nid_ptr, NULL);
   SIGNAL(1)
   signal = {
       0, DTYPE_SIGNAL, CLASS_R, 0, 3, __fill_value__(mdsdsc_t *) initValIn, NULL, {dimension}};
-  TreeCallHookFun("TreeNidDataHook", "MakeSegmentFull", vars->tinfo->treenam,
-                  vars->tinfo->shot, *vars->nid_ptr, &signal, NULL);
+  TREE_HOOKS(MakeSegmentFull, vars->tinfo->treenam, vars->tinfo->shot,
+             *(int *)vars->nid_ptr, (mdsdsc_t *)&signal);
   status = begin_finish(vars);
 end:;
   CLEANUP_NCI_POP;
@@ -1469,15 +1469,14 @@ int _TreeXNciMakeTimestampedSegment(void *dbid, int nid, const char *xnci,
   GOTO_IF_NOT_OK(end, begin_sinfo(vars, initialValue, check_compress_ts));
   GOTO_IF_NOT_OK(end, putdata_initialvalue(vars, initialValue));
   GOTO_IF_NOT_OK(end, putdim_ts(vars, timestamps));
-  TreeCallHookFun("TreeNidHook", "MakeTimestampedSegment", vars->tinfo->treenam,
-                  vars->tinfo->shot, *vars->nid_ptr, NULL);
+  TREE_HOOKS(MakeTimestampedSegment, vars->tinfo->treenam, vars->tinfo->shot,
+             *(int *)vars->nid_ptr, NULL);
   DESCRIPTOR_A(dimension, sizeof(int64_t), DTYPE_Q, timestamps,
                rows_filled * sizeof(int64_t));
   SIGNAL(1)
   signal = {0, DTYPE_SIGNAL, CLASS_R, 0, 3, __fill_value__(mdsdsc_t *) initValIn, NULL, {(mdsdsc_t *)&dimension}};
-  TreeCallHookFun("TreeNidDataHook", "MakeTimestampedSegmentFull",
-                  vars->tinfo->treenam, vars->tinfo->shot, *vars->nid_ptr,
-                  &signal, NULL);
+  TREE_HOOKS(MakeTimestampedSegmentFull, vars->tinfo->treenam,
+             vars->tinfo->shot, *(int *)vars->nid_ptr, (mdsdsc_t *)&signal);
   status = begin_finish(vars);
 end:;
   CLEANUP_NCI_POP;
@@ -1552,8 +1551,8 @@ int _TreeXNciUpdateSegment(void *dbid, int nid, const char *xnci,
   }
   GOTO_IF_NOT_OK(end, check_sinfo(vars));
   GOTO_IF_NOT_OK(end, putdim_dim(vars, start, end, dimension));
-  TreeCallHookFun("TreeNidHook", "UpdateSegment", vars->tinfo->treenam,
-                  vars->tinfo->shot, *vars->nid_ptr, NULL);
+  TREE_HOOKS(UpdateSegment, vars->tinfo->treenam, vars->tinfo->shot,
+             *(int *)vars->nid_ptr, NULL);
   status = put_segment_index(vars->tinfo, &vars->sindex, &vars->index_offset);
 end:;
   CLEANUP_NCI_POP;
@@ -1656,10 +1655,10 @@ int _TreeXNciPutSegment(void *dbid, int nid, const char *xnci,
   if (STATUS_OK)
   {
     status = save_segment_header(vars);
-    TreeCallHookFun("TreeNidHook", "PutSegment", vars->tinfo->treenam,
-                    vars->tinfo->shot, *vars->nid_ptr, NULL);
-    TreeCallHookFun("TreeNidDataHook", "PutSegmentFull", vars->tinfo->treenam,
-                    vars->tinfo->shot, *vars->nid_ptr, data, NULL);
+    TREE_HOOKS(PutSegment, vars->tinfo->treenam, vars->tinfo->shot,
+               *(int *)vars->nid_ptr, NULL);
+    TREE_HOOKS(PutSegmentFull, vars->tinfo->treenam, vars->tinfo->shot,
+               *(int *)vars->nid_ptr, (mdsdsc_t *)data);
   }
 end:;
   CLEANUP_NCI_POP;
@@ -1769,16 +1768,14 @@ int _TreeXNciPutTimestampedSegment(void *dbid, int nid, const char *xnci,
   {
     vars->shead.next_row = start_idx + rows_to_insert;
     status = save_segment_header(vars);
-    TreeCallHookFun("TreeNidHook", "PutTimestampedSegment",
-                    vars->tinfo->treenam, vars->tinfo->shot, *vars->nid_ptr,
-                    NULL);
+    TREE_HOOKS(PutTimestampedSegment, vars->tinfo->treenam, vars->tinfo->shot,
+               *(int *)vars->nid_ptr, NULL);
     DESCRIPTOR_A(dimension, sizeof(int64_t), DTYPE_Q, timestamp,
                  rows_to_insert * sizeof(int64_t));
     SIGNAL(1)
     signal = {0, DTYPE_SIGNAL, CLASS_R, 0, 3, __fill_value__(mdsdsc_t *) data_in, NULL, {(mdsdsc_t *)&dimension}};
-    TreeCallHookFun("TreeNidDataHook", "PutTimestampedSegmentFull",
-                    vars->tinfo->treenam, vars->tinfo->shot, *vars->nid_ptr,
-                    &signal, NULL);
+    TREE_HOOKS(PutTimestampedSegmentFull, vars->tinfo->treenam,
+               vars->tinfo->shot, *(int *)vars->nid_ptr, (mdsdsc_t *)&signal);
   }
 end:;
   CLEANUP_NCI_POP;
@@ -1982,6 +1979,36 @@ int _TreeXNciGetSegmentTimes(void *dbid, int nid, const char *xnci, int *nsegs,
   return status;
 }
 
+int _TreeXNciGetSegmentRows(void *dbid, int nid, const char *xnci, int *nsegs,
+                            int **rows)
+{
+  *rows = NULL;
+  INIT_VARS;
+  RETURN_IF_NOT_OK(open_index_read(vars));
+  int numsegs = vars->shead.idx + 1;
+  *nsegs = numsegs;
+  int *ans = (int *)calloc(numsegs, sizeof(int));
+  if (!ans)
+    return TreeMEMERR;
+  *rows = ans;
+  for (vars->idx = numsegs; STATUS_OK && vars->idx-- > 0;)
+  {
+    int index_idx = vars->idx % SEGMENTS_PER_INDEX;
+    vars->sinfo = &vars->sindex.segment[index_idx];
+    if (vars->idx == vars->shead.idx)
+      ans[vars->idx] = vars->shead.next_row;
+    else if (vars->sinfo->rows < 1)
+      status = get_compressed_segment_rows(
+          vars->tinfo, vars->sinfo->data_offset, &ans[vars->idx]);
+    else
+      ans[vars->idx] = vars->sinfo->rows;
+    if (STATUS_OK && index_idx == 0 && vars->idx > 0)
+      status = get_segment_index(vars->tinfo, vars->sindex.previous_offset,
+                                 &vars->sindex);
+  }
+  return status;
+}
+
 int _TreeXNciGetNumSegments(void *dbid, int nid, const char *xnci, int *num)
 {
   *num = 0;
@@ -1995,6 +2022,19 @@ int _TreeXNciGetNumSegments(void *dbid, int nid, const char *xnci, int *num)
   return TreeSUCCESS;
 }
 
+/* index of the last segment and its next_row, used to validate cache hits */
+int tree_segment_head(void *dbid, int nid, int *last, int *next_row)
+{
+  const char *xnci = NULL;
+  INIT_VARS;
+  RETURN_IF_NOT_OK(open_datafile_read(vars));
+  RETURN_IF_NOT_OK(load_extended_nci(vars));
+  RETURN_IF_NOT_OK(load_segment_header(vars));
+  *last = vars->shead.idx;
+  *next_row = vars->shead.next_row;
+  return TreeSUCCESS;
+}
+
 static int (*_TdiExecute)() = NULL;
 static int (*_TdiCompile)() = NULL;
 /* checks last segment and trims it down to last written row if necessary */
@@ -2648,6 +2688,16 @@ inline static int get_opaque_list(void *dbid, int nid, const char *xnci,
   return status;
 }
 
+/* The time context of the tree, unless one was begun by the calling thread
+ */
+static timecontext_t *get_timecontext(void *dbid)
+{
+  TREETHREADSTATIC_INIT;
+  if (TREE_TIMECONTEXT)
+    return &TREE_TIMECONTEXT->tc;
+  return &((PINO_DATABASE *)dbid)->timecontext;
+}
+
 int _TreeXNciGetSegmentedRecord(
     void *dbid, int nid, const char *xnci,
     mdsdsc_xd_t *data)
@@ -2665,7 +2715,7 @@ int _TreeXNciGetSegmentedRecord(
             "records.\n");
     return status;
   }
-  timecontext_t *tc = &((PINO_DATABASE *)dbid)->timecontext;
+  timecontext_t *tc = get_timecontext(dbid);
   return (*_XTreeGetTimedRecord)(dbid, nid, tc->start.pointer, tc->end.pointer,
                                  tc->delta.pointer, data);
 }
@@ -2762,14 +2812,33 @@ int _TreeXNciGetSegmentLimits(void *dbid, int nid, const char *xnci, int idx,
   return get_segment_limits(vars, retStart, retEnd);
 }
 
-int _TreeXNciGetSegment(void *dbid, int nid, const char *xnci, int idx,
-                        mdsdsc_xd_t *segment, mdsdsc_xd_t *dim)
+static int get_segment_cached(void *dbid, int nid, const char *xnci, int idx,
+                              mdsdsc_xd_t *segment, mdsdsc_xd_t *dim,
+                              segcache_fill_t *fill)
 {
   INIT_VARS;
   vars->idx = idx;
   RETURN_IF_NOT_OK(get_segment(vars));
-  return read_segment(dbid, vars->tinfo, nid, &vars->shead, vars->sinfo,
-                      vars->idx, segment, dim);
+  status = read_segment(dbid, vars->tinfo, nid, &vars->shead, vars->sinfo,
+                        vars->idx, segment, dim);
+  if (STATUS_OK && fill && fill->node && vars->sinfo->rows >= 0)
+  {
+    const SEGMENT_INFO *sinfo = vars->sinfo;
+    const int kind =
+        (sinfo->dimension_offset != -1 && sinfo->dimension_length == 0)
+            ? SEGCACHE_DIM_TIMESTAMPS
+            : (sinfo->dimension_length != -1 ? SEGCACHE_DIM_DSC
+                                             : SEGCACHE_DIM_NONE);
+    tree_segcache_fill(fill, vars->idx, sinfo->rows, vars->shead.idx,
+                       vars->shead.next_row, kind, segment, dim);
+  }
+  return status;
+}
+
+int _TreeXNciGetSegment(void *dbid, int nid, const char *xnci, int idx,
+                        mdsdsc_xd_t *segment, mdsdsc_xd_t *dim)
+{
+  return get_segment_cached(dbid, nid, xnci, idx, segment, dim, NULL);
 }
 
 int _TreeXNciGetSegmentInfo(void *dbid, int nid, const char *xnci, int idx,
@@ -2931,8 +3000,15 @@ int _TreeMakeSegment(void *dbid, int nid, mdsdsc_t *start, mdsdsc_t *end,
                      mdsdsc_t *dimension, mdsdsc_a_t *initialValue, int idx,
                      int rows_filled)
 {
-  return _TreeXNciMakeSegment(dbid, nid, NULL, start, end, dimension,
-                              initialValue, idx, rows_filled);
+  uint64_t perf_start = tree_perf_now();
+  segcache_write_t cache;
+  tree_segcache_begin(dbid, nid, &cache);
+  int status = _TreeXNciMakeSegment(dbid, nid, NULL, start, end, dimension,
+                                    initialValue, idx, rows_filled);
+  tree_segcache_end_make(&cache, status, dbid, nid, dimension, NULL, 0,
+                         initialValue, rows_filled);
+  tree_perf_record(TREE_PERF_SEGMENT_WRITE, perf_start, dbid, NULL, nid);
+  return status;
 }
 int TreeMakeSegment(int nid, mdsdsc_t *start, mdsdsc_t *end,
                     mdsdsc_t *dimension, mdsdsc_a_t *initialValue, int idx,
@@ -2951,8 +3027,13 @@ int _TreeXNciBeginSegment(void *dbid, int nid, const char *xnci,
 int _TreeBeginSegment(void *dbid, int nid, mdsdsc_t *start, mdsdsc_t *end,
                       mdsdsc_t *dimension, mdsdsc_a_t *initialValue, int idx)
 {
-  return _TreeXNciBeginSegment(dbid, nid, NULL, start, end, dimension,
-                               initialValue, idx);
+  segcache_write_t cache;
+  tree_segcache_begin(dbid, nid, &cache);
+  int status = _TreeXNciBeginSegment(dbid, nid, NULL, start, end, dimension,
+                                     initialValue, idx);
+  tree_segcache_end_make(&cache, status, dbid, nid, dimension, NULL, 0,
+                         initialValue, 0);
+  return status;
 }
 int TreeBeginSegment(int nid, mdsdsc_t *start, mdsdsc_t *end,
                      mdsdsc_t *dimension, mdsdsc_a_t *initialValue, int idx)
@@ -2962,7 +3043,13 @@ int TreeBeginSegment(int nid, mdsdsc_t *start, mdsdsc_t *end,
 }
 int _TreePutSegment(void *dbid, int nid, const int startIdx, mdsdsc_a_t *data)
 {
-  return _TreeXNciPutSegment(dbid, nid, NULL, startIdx, data);
+  uint64_t perf_start = tree_perf_now();
+  segcache_write_t cache;
+  tree_segcache_begin(dbid, nid, &cache);
+  int status = _TreeXNciPutSegment(dbid, nid, NULL, startIdx, data);
+  tree_segcache_end_put(&cache, status, startIdx, NULL, data);
+  tree_perf_record(TREE_PERF_SEGMENT_WRITE, perf_start, dbid, NULL, nid);
+  return status;
 }
 int TreePutSegment(const int nid, const int startIdx, mdsdsc_a_t *data)
 {
@@ -2979,8 +3066,15 @@ int _TreeMakeTimestampedSegment(void *dbid, int nid, int64_t *timestamps,
                                 mdsdsc_a_t *initialValue, int idx,
                                 int rows_filled)
 {
-  return _TreeXNciMakeTimestampedSegment(dbid, nid, NULL, timestamps,
-                                         initialValue, idx, rows_filled);
+  uint64_t perf_start = tree_perf_now();
+  segcache_write_t cache;
+  tree_segcache_begin(dbid, nid, &cache);
+  int status = _TreeXNciMakeTimestampedSegment(dbid, nid, NULL, timestamps,
+                                               initialValue, idx, rows_filled);
+  tree_segcache_end_make(&cache, status, dbid, nid, NULL, timestamps, 1,
+                         initialValue, rows_filled);
+  tree_perf_record(TREE_PERF_SEGMENT_WRITE, perf_start, dbid, NULL, nid);
+  return status;
 }
 int TreeMakeTimestampedSegment(int nid, int64_t *timestamps,
                                mdsdsc_a_t *initialValue, int idx,
@@ -2998,7 +3092,13 @@ int _TreeXNciBeginTimestampedSegment(void *dbid, int nid, const char *xnci,
 int _TreeBeginTimestampedSegment(void *dbid, int nid, mdsdsc_a_t *initialValue,
                                  int idx)
 {
-  return _TreeXNciBeginTimestampedSegment(dbid, nid, NULL, initialValue, idx);
+  segcache_write_t cache;
+  tree_segcache_begin(dbid, nid, &cache);
+  int status =
+      _TreeXNciBeginTimestampedSegment(dbid, nid, NULL, initialValue, idx);
+  tree_segcache_end_make(&cache, status, dbid, nid, NULL, NULL, 1,
+                         initialValue, 0);
+  return status;
 }
 int TreeBeginTimestampedSegment(int nid, mdsdsc_a_t *initialValue, int idx)
 {
@@ -3007,7 +3107,13 @@ int TreeBeginTimestampedSegment(int nid, mdsdsc_a_t *initialValue, int idx)
 int _TreePutTimestampedSegment(void *dbid, int nid, int64_t *timestamp,
                                mdsdsc_a_t *data)
 {
-  return _TreeXNciPutTimestampedSegment(dbid, nid, NULL, timestamp, data);
+  uint64_t perf_start = tree_perf_now();
+  segcache_write_t cache;
+  tree_segcache_begin(dbid, nid, &cache);
+  int status = _TreeXNciPutTimestampedSegment(dbid, nid, NULL, timestamp, data);
+  tree_segcache_end_put(&cache, status, -1, timestamp, data);
+  tree_perf_record(TREE_PERF_SEGMENT_WRITE, perf_start, dbid, NULL, nid);
+  return status;
 }
 int TreePutTimestampedSegment(int nid, int64_t *timestamp, mdsdsc_a_t *data)
 {
@@ -3016,7 +3122,14 @@ int TreePutTimestampedSegment(int nid, int64_t *timestamp, mdsdsc_a_t *data)
 int _TreePutRow(void *dbid, int nid, int bufsize, int64_t *timestamp,
                 mdsdsc_a_t *data)
 {
-  return _TreeXNciPutRow(dbid, nid, NULL, bufsize, timestamp, data);
+  uint64_t perf_start = tree_perf_now();
+  segcache_write_t cache;
+  tree_segcache_begin(dbid, nid, &cache);
+  int status = _TreeXNciPutRow(dbid, nid, NULL, bufsize, timestamp, data);
+  tree_segcache_end_put_row(&cache, status, dbid, nid, bufsize, timestamp,
+                            data);
+  tree_perf_record(TREE_PERF_SEGMENT_WRITE, perf_start, dbid, NULL, nid);
+  return status;
 }
 int TreePutRow(int nid, int bufsize, int64_t *timestamp, mdsdsc_a_t *data)
 {
@@ -3029,7 +3142,11 @@ int TreePutRow(int nid, int bufsize, int64_t *timestamp, mdsdsc_a_t *data)
  */
 int _TreeSetRowsFilled(void *dbid, int nid, int rows_filled)
 {
-  return _TreeXNciSetRowsFilled(dbid, nid, NULL, rows_filled);
+  segcache_write_t cache;
+  tree_segcache_begin(dbid, nid, &cache);
+  int status = _TreeXNciSetRowsFilled(dbid, nid, NULL, rows_filled);
+  tree_segcache_end_invalidate(&cache);
+  return status;
 }
 int TreeSetRowsFilled(int nid, int rows_filled)
 {
@@ -3042,7 +3159,12 @@ int TreeSetRowsFilled(int nid, int rows_filled)
 int _TreeUpdateSegment(void *dbid, int nid, mdsdsc_t *start, mdsdsc_t *end,
                        mdsdsc_t *dimension, int idx)
 {
-  return _TreeXNciUpdateSegment(dbid, nid, NULL, start, end, dimension, idx);
+  segcache_write_t cache;
+  tree_segcache_begin(dbid, nid, &cache);
+  int status =
+      _TreeXNciUpdateSegment(dbid, nid, NULL, start, end, dimension, idx);
+  tree_segcache_end_invalidate(&cache);
+  return status;
 }
 int TreeUpdateSegment(int nid, mdsdsc_t *start, mdsdsc_t *end,
                       mdsdsc_t *dimension, int idx)
@@ -3105,12 +3227,19 @@ int TreeSetSegmentScale(int nid, mdsdsc_t *value)
 
 /* TreeGetSegment returns data and dimension of the requested segment idx
  * if segment is NULL loading the data part will be skipped for better
- * performance
+ * performance. Segments published in the shared memory segment cache are
+ * served from there.
  */
 int _TreeGetSegment(void *dbid, int nid, int idx, mdsdsc_xd_t *segment,
                     mdsdsc_xd_t *dim)
 {
-  return _TreeXNciGetSegment(dbid, nid, NULL, idx, segment, dim);
+  uint64_t perf_start = tree_perf_now();
+  segcache_fill_t fill;
+  int status = tree_segcache_get(dbid, nid, idx, segment, dim, &fill);
+  if (STATUS_NOT_OK)
+    status = get_segment_cached(dbid, nid, NULL, idx, segment, dim, &fill);
+  tree_perf_record(TREE_PERF_SEGMENT_READ, perf_start, dbid, NULL, nid);
+  return status;
 }
 int TreeGetSegment(int nid, int idx, mdsdsc_xd_t *segment, mdsdsc_xd_t *dim)
 {
@@ -3119,7 +3248,10 @@ int TreeGetSegment(int nid, int idx, mdsdsc_xd_t *segment, mdsdsc_xd_t *dim)
 int _TreeGetSegments(void *dbid, int nid, mdsdsc_t *start, mdsdsc_t *end,
                      mdsdsc_xd_t *out)
 {
-  return _TreeXNciGetSegments(dbid, nid, NULL, start, end, out);
+  uint64_t perf_start = tree_perf_now();
+  int status = _TreeXNciGetSegments(dbid, nid, NULL, start, end, out);
+  tree_perf_record(TREE_PERF_SEGMENT_READ, perf_start, dbid, NULL, nid);
+  return status;
 }
 int TreeGetSegments(int nid, mdsdsc_t *start, mdsdsc_t *end, mdsdsc_xd_t *out)
 {
@@ -3146,6 +3278,15 @@ int TreeGetSegmentTimes(int nid, int *nsegs, int64_t **times)
   return _TreeGetSegmentTimes(*TreeCtx(), nid, nsegs, times);
 }
 
+int _TreeGetSegmentRows(void *dbid, int nid, int *nsegs, int **rows)
+{
+  return _TreeXNciGetSegmentRows(dbid, nid, NULL, nsegs, rows);
+}
+int TreeGetSegmentRows(int nid, int *nsegs, int **rows)
+{
+  return _TreeGetSegmentRows(*TreeCtx(), nid, nsegs, rows);
+}
+
 int _TreeGetSegmentedRecord(void *dbid, int nid, mdsdsc_xd_t *data)
 {
   return _TreeXNciGetSegmentedRecord(dbid, nid, NULL, data);
@@ -3155,13 +3296,86 @@ int TreeGetSegmentedRecord(int nid, mdsdsc_xd_t *data)
   return _TreeGetSegmentedRecord(*TreeCtx(), nid, data);
 }
 
+/* TreeGetSegmentedRecordWindow and TreeGetSegmentedRecordRows return part of
+ * the segmented record of nid without resampling and regardless of the time
+ * context: the segments overlapping the time window [start, end], widened by
+ * one segment on each side, or the segments holding rows first to last.
+ * Negative rows stand for the first or last row of the record. *offset
+ * receives the index of the first returned row in the full record.
+ * Opaque segments are not supported.
+ */
+static int is_plain_segmented(void *dbid, int nid)
+{
+  unsigned char data_type;
+  NCI_ITM itmlst[] = {{1, NciDTYPE, &data_type, 0},
+                      {0, NciEND_OF_LIST, 0, 0}};
+  int status = _TreeGetNci(dbid, nid, itmlst);
+  return STATUS_OK && data_type != DTYPE_OPAQUE;
+}
+
+int _TreeGetSegmentedRecordWindow(void *dbid, int nid, mdsdsc_t *start,
+                                  mdsdsc_t *end, mdsdsc_xd_t *data)
+{
+  static int (*_XTreeGetTimedSegments)() = NULL;
+  int status;
+  if (!is_plain_segmented(dbid, nid))
+    return TreeNOSEGMENTS;
+  RETURN_IF_NOT_OK(LibFindImageSymbol_C("XTreeShr", "_XTreeGetTimedSegments",
+                                        &_XTreeGetTimedSegments));
+  return (*_XTreeGetTimedSegments)(dbid, nid, start, end, data);
+}
+int TreeGetSegmentedRecordWindow(int nid, mdsdsc_t *start, mdsdsc_t *end,
+                                 mdsdsc_xd_t *data)
+{
+  return _TreeGetSegmentedRecordWindow(*TreeCtx(), nid, start, end, data);
+}
+
+int _TreeGetSegmentedRecordRows(void *dbid, int nid, int64_t first,
+                                int64_t last, int64_t *offset,
+                                mdsdsc_xd_t *data)
+{
+  static int (*_XTreeGetSegmentRange)() = NULL;
+  int status, nsegs = 0, *rows = NULL, start_idx, end_idx;
+  int64_t row = 0;
+  if (!is_plain_segmented(dbid, nid))
+    return TreeNOSEGMENTS;
+  RETURN_IF_NOT_OK(LibFindImageSymbol_C("XTreeShr", "_XTreeGetSegmentRange",
+                                        &_XTreeGetSegmentRange));
+  status = _TreeGetSegmentRows(dbid, nid, &nsegs, &rows);
+  if (STATUS_OK && nsegs < 1)
+    status = TreeNOSEGMENTS;
+  if (STATUS_NOT_OK)
+  {
+    free(rows);
+    return status;
+  }
+  for (start_idx = 0; start_idx < nsegs - 1 && first >= row + rows[start_idx];
+       start_idx++)
+    row += rows[start_idx];
+  *offset = row;
+  if (last < 0)
+    end_idx = nsegs - 1;
+  else
+    for (end_idx = start_idx;
+         end_idx < nsegs - 1 && last >= row + rows[end_idx]; end_idx++)
+      row += rows[end_idx];
+  free(rows);
+  return (*_XTreeGetSegmentRange)(dbid, nid, start_idx, end_idx, data);
+}
+int TreeGetSegmentedRecordRows(int nid, int64_t first, int64_t last,
+                               int64_t *offset, mdsdsc_xd_t *data)
+{
+  return _TreeGetSegmentedRecordRows(*TreeCtx(), nid, first, last, offset,
+                                     data);
+}
+
 /*****************************************
  TimeContext sticks with current db (tree)
  *****************************************/
 int _TreeSetTimeContext(void *dbid, mdsdsc_t *start, mdsdsc_t *end,
                         mdsdsc_t *delta)
 {
-  timecontext_t *tc = &((PINO_DATABASE *)dbid)->timecontext;
+  timecontext_t *tc = get_timecontext(dbid);
   int status = MdsCopyDxXd(start, &tc->start);
   if (STATUS_OK)
   {
@@ -3180,7 +3394,7 @@ int TreeSetTimeContext(mdsdsc_t *start, mdsdsc_t *end, mdsdsc_t *delta)
 int _TreeGetTimeContext(void *dbid, mdsdsc_xd_t *start, mdsdsc_xd_t *end,
                         mdsdsc_xd_t *delta)
 {
-  timecontext_t *tc = &((PINO_DATABASE *)dbid)->timecontext;
+  timecontext_t *tc = get_timecontext(dbid);
   int status;
   if (start)
     RETURN_IF_NOT_OK(MdsCopyDxXd(tc->start.pointer, start));
@@ -3196,6 +3410,51 @@ int TreeGetTimeContext(mdsdsc_xd_t *start, mdsdsc_xd_t *end,
   return _TreeGetTimeContext(*TreeCtx(), start, end, delta);
 }
 
+/* TreeBeginTimeContext sets a time context for the calling thread only. Until
+ * the matching TreeEndTimeContext it replaces the time context of any tree,
+ * for segmented record reads as well as for TreeSetTimeContext and
+ * TreeGetTimeContext. Calls may be nested.
+ */
+void free_thread_timecontext(thread_timecontext_t *ttc)
+{
+  MdsFree1Dx(&ttc->tc.start, NULL);
+  MdsFree1Dx(&ttc->tc.end, NULL);
+  MdsFree1Dx(&ttc->tc.delta, NULL);
+  free(ttc);
+}
+
+int TreeBeginTimeContext(mdsdsc_t *start, mdsdsc_t *end, mdsdsc_t *delta)
+{
+  TREETHREADSTATIC_INIT;
+  thread_timecontext_t *ttc = calloc(1, sizeof(thread_timecontext_t));
+  if (!ttc)
+    return MDSplusERROR;
+  int status = MdsCopyDxXd(start, &ttc->tc.start);
+  if (STATUS_OK)
+    status = MdsCopyDxXd(end, &ttc->tc.end);
+  if (STATUS_OK)
+    status = MdsCopyDxXd(delta, &ttc->tc.delta);
+  if (STATUS_NOT_OK)
+  {
+    free_thread_timecontext(ttc);
+    return status;
+  }
+  ttc->prev = TREE_TIMECONTEXT;
+  TREE_TIMECONTEXT = ttc;
+  return TreeSUCCESS;
+}
+
+int TreeEndTimeContext()
+{
+  TREETHREADSTATIC_INIT;
+  thread_timecontext_t *ttc = TREE_TIMECONTEXT;
+  if (!ttc)
+    return TreeFAILURE;
+  TREE_TIMECONTEXT = ttc->prev;
+  free_thread_timecontext(ttc);
+  return TreeSUCCESS;
+}
+
 ////////////RESAMPLED STUFF
 
 inline static float toFloat(char dtype, void *ptr, int idx)
@@ -104,9 +104,11 @@ int tree_lock_nci(TREE_INFO *info, int readonly, int nodenum, int *deleted,
   {
     if (*locked == 0)
     { // acquire lock
+      uint64_t start = tree_perf_now();
       status = MDS_IO_LOCK(
           readonly ? info->nci_file->get : info->nci_file->put, nodenum * 42,
           42, readonly ? MDS_IO_LOCK_RD : MDS_IO_LOCK_WRT, deleted_ptr);
+      tree_perf_record(TREE_PERF_LOCK_WAIT, start, NULL, info, nodenum);
       if (STATUS_OK)
       {
         if (!*deleted_ptr)
@@ -509,6 +511,7 @@ int _TreeOpenNciW(TREE_INFO *info, int tmpfile)
 int tree_put_nci(TREE_INFO *info, int node_num, NCI *nci, int *locked)
 {
   int status = TreeSUCCESS;
+  tree_cache_invalidate(info, node_num);
   /***************************************
     If the tree is not open for edit
   ****************************************/
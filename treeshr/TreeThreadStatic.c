@@ -80,6 +80,12 @@ static void buffer_free(TREETHREADSTATIC_ARG)
       TreeFreeDbid(TREE_DBID);
     }
   }
+  while (TREE_TIMECONTEXT)
+  {
+    thread_timecontext_t *ttc = TREE_TIMECONTEXT;
+    TREE_TIMECONTEXT = ttc->prev;
+    free_thread_timecontext(ttc);
+  }
   Host *host;
   while (TREE_HOSTLIST)
   {
@@ -0,0 +1,225 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <pthread.h>
+#include <stdlib.h>
+
+// MDsplus //
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+#include <treeshr.h>
+#include <usagedef.h>
+
+// testing //
+#include "testing.h"
+
+#define NUM_ROWS 1000
+#define BUFSIZE 100
+
+static const char *tree_name = "tree_test";
+static const int shot = 1;
+
+typedef struct
+{
+  void *ctx;
+  int nid;
+  int status;
+} sync_job_t;
+
+// rows written synchronously by another thread on the same context
+static void *sync_rows(void *arg)
+{
+  sync_job_t *job = (sync_job_t *)arg;
+  int64_t t;
+  int value;
+  DESCRIPTOR_LONG(value_d, &value);
+  job->status = TreeSUCCESS;
+  for (t = 0; t < NUM_ROWS && (job->status & 1); t++)
+  {
+    value = -(int)t;
+    job->status = _TreePutRow(job->ctx, job->nid, BUFSIZE, &t,
+                              (mdsdsc_a_t *)&value_d);
+  }
+  return NULL;
+}
+
+static int check_rows(void *ctx, int nid, int sign)
+{
+  int num = 0, idx, row = 0, ok = 1;
+  int status = _TreeGetNumSegments(ctx, nid, &num);
+  if (!(status & 1) || num != NUM_ROWS / BUFSIZE)
+    return 0;
+  for (idx = 0; idx < num && ok; idx++)
+  {
+    EMPTYXD(data);
+    EMPTYXD(dim);
+    status = _TreeGetSegment(ctx, nid, idx, &data, &dim);
+    mdsdsc_a_t *a = (mdsdsc_a_t *)data.pointer;
+    if (!(status & 1) || !a || a->class != CLASS_A || a->dtype != DTYPE_L ||
+        a->arsize != BUFSIZE * sizeof(int))
+      ok = 0;
+    else
+    {
+      int i;
+      for (i = 0; i < BUFSIZE; i++, row++)
+        if (((int *)a->pointer)[i] != sign * row)
+        {
+          ok = 0;
+          break;
+        }
+    }
+    MdsFree1Dx(&data, NULL);
+    MdsFree1Dx(&dim, NULL);
+  }
+  return ok;
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Tree Async Writer);
+
+  void *ctx = NULL;
+  void *writer = NULL;
+  int status, async_nid, sync_nid, record_nid, mixed_nid;
+  MdsPutEnv("tree_test_path=.");
+
+  status = _TreeOpenNew(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  status = _TreeAddNode(ctx, "ASYNC", &async_nid, TreeUSAGE_SIGNAL);
+  TEST1(STATUS_OK);
+  status = _TreeAddNode(ctx, "SYNC", &sync_nid, TreeUSAGE_SIGNAL);
+  TEST1(STATUS_OK);
+  status = _TreeAddNode(ctx, "RECORD", &record_nid, TreeUSAGE_NUMERIC);
+  TEST1(STATUS_OK);
+  status = _TreeAddNode(ctx, "MIXED", &mixed_nid, TreeUSAGE_SIGNAL);
+  TEST1(STATUS_OK);
+  status = _TreeWriteTree(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+
+  status = _TreeOpen(&ctx, tree_name, shot, 0);
+  TEST1(STATUS_OK);
+  // a small queue so the producer has to wait for the worker
+  status = _TreeAsyncWriterOpen(ctx, 4096, &writer);
+  TEST1(STATUS_OK);
+  TEST1(writer != NULL);
+
+  // queue rows while another thread and this one write synchronously
+  // through the context of the application
+  sync_job_t job = {ctx, sync_nid, 0};
+  pthread_t thread;
+  TEST0(pthread_create(&thread, NULL, sync_rows, &job));
+  int64_t t;
+  int value;
+  DESCRIPTOR_LONG(value_d, &value);
+  for (t = 0; t < NUM_ROWS; t++)
+  {
+    value = (int)t;
+    status = TreeAsyncPutRow(writer, async_nid, BUFSIZE, &t,
+                             (mdsdsc_a_t *)&value_d);
+    TEST1(STATUS_OK);
+    if (t % 100 == 0)
+    {
+      status = _TreePutRecord(ctx, record_nid, (mdsdsc_t *)&value_d, 0);
+      TEST1(STATUS_OK);
+    }
+  }
+  pthread_join(thread, NULL);
+  TEST1(job.status & 1);
+  status = TreeAsyncWriterFlush(writer);
+  TEST1(STATUS_OK);
+
+  TREE_ASYNC_WRITER_STATS stats;
+  status = TreeAsyncWriterGetStats(writer, &stats);
+  TEST1(STATUS_OK);
+  TEST1(stats.rows_written == NUM_ROWS);
+  TEST1(stats.segments_begun == NUM_ROWS / BUFSIZE);
+  TEST0(stats.queue_depth);
+  TEST0(stats.queued_bytes);
+
+  TEST1(check_rows(ctx, async_nid, 1));
+  TEST1(check_rows(ctx, sync_nid, -1));
+
+  { // rows are not appended to a segment of another dtype or shape
+    void *mixed = NULL;
+    status = _TreeAsyncWriterOpen(ctx, 0, &mixed);
+    TEST1(STATUS_OK);
+    float fvalue = 1;
+    DESCRIPTOR_FLOAT(fvalue_d, &fvalue);
+    t = 0;
+    status = _TreePutRow(ctx, mixed_nid, BUFSIZE, &t, (mdsdsc_a_t *)&fvalue_d);
+    TEST1(STATUS_OK);
+    t = 1;
+    status = TreeAsyncPutRow(mixed, mixed_nid, BUFSIZE, &t,
+                             (mdsdsc_a_t *)&value_d);
+    TEST1(STATUS_OK);
+    status = TreeAsyncWriterFlush(mixed);
+    TEST1(status == TreeINVDTYPE);
+    status = TreeAsyncWriterClose(mixed);
+    TEST1(status == TreeINVDTYPE);
+    status = _TreeAsyncWriterOpen(ctx, 0, &mixed);
+    TEST1(STATUS_OK);
+    float frow[2] = {1, 2};
+    DESCRIPTOR_A(frow_d, sizeof(float), DTYPE_FLOAT, frow, sizeof(frow));
+    status = TreeAsyncPutRow(mixed, mixed_nid, BUFSIZE, &t,
+                             (mdsdsc_a_t *)&frow_d);
+    TEST1(STATUS_OK);
+    status = TreeAsyncWriterClose(mixed);
+    TEST1(status == TreeINVSHAPE);
+    // a multi-dimensional array needs its coefficients
+    status = _TreeAsyncWriterOpen(ctx, 0, &mixed);
+    TEST1(STATUS_OK);
+    frow_d.dimct = 2;
+    status = TreeAsyncPutRow(mixed, mixed_nid, BUFSIZE, &t,
+                             (mdsdsc_a_t *)&frow_d);
+    TEST1(status == TreeINVDTYPE);
+    status = TreeAsyncWriterClose(mixed);
+    TEST1(STATUS_OK);
+  }
+
+  // closing the tree flushes and detaches the writer
+  value = NUM_ROWS;
+  t = NUM_ROWS;
+  status = TreeAsyncPutRow(writer, async_nid, BUFSIZE, &t,
+                           (mdsdsc_a_t *)&value_d);
+  TEST1(STATUS_OK);
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  status = TreeAsyncWriterGetStats(writer, &stats);
+  TEST1(STATUS_OK);
+  TEST1(stats.rows_written == NUM_ROWS + 1);
+  status = TreeAsyncPutRow(writer, async_nid, BUFSIZE, &t,
+                           (mdsdsc_a_t *)&value_d);
+  TEST1(STATUS_OK);
+  status = TreeAsyncWriterFlush(writer);
+  TEST1(status == TreeNOT_OPEN);
+  status = TreeAsyncWriterClose(writer);
+  TEST1(status == TreeNOT_OPEN);
+  TreeFreeDbid(ctx);
+
+  END_TESTING;
+  return 0;
+}
@@ -0,0 +1,117 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// MDsplus //
+#include <mdsshr.h>
+#include <treeshr.h>
+#include <usagedef.h>
+
+// testing //
+#include "testing.h"
+
+#define MAX_ANSWERS 64
+
+static const char *paths[] = {
+    ".ALPHA~A*", ".ALPHA~*",  ".ALPHA~A1", ".ALPHA~%B", ".ALPHA:*",
+    ".ALPHA.*",  "***",       "***:A*",    "***~A*",   ".ALPHA***~B*",
+    "\\TOP::TOP~*", ".ALPHA.A2~*",
+};
+#define NUM_PATHS (int)(sizeof(paths) / sizeof(paths[0]))
+
+/* nids answered for path, in order, -1 terminated */
+static void find_all(void *ctx, const char *path, int *nids)
+{
+  void *fctx = NULL;
+  int i = 0, nid;
+  while (i < MAX_ANSWERS - 1 &&
+         IS_OK(_TreeFindNodeWild(ctx, path, &nid, &fctx, -1)))
+    nids[i++] = nid;
+  nids[i] = -1;
+  _TreeFindNodeEnd(ctx, &fctx);
+}
+
+static void add_node(void *ctx, const char *path, char usage)
+{
+  int nid, status = _TreeAddNode(ctx, path, &nid, usage);
+  TEST1(STATUS_OK);
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Tree Find Node Index);
+
+  void *ctx = NULL;
+  const int shot = 1;
+  const char *tree_name = "tree_test";
+  static int walked[NUM_PATHS][MAX_ANSWERS], indexed[MAX_ANSWERS];
+  int status, i;
+  MdsPutEnv("tree_test_path=.");
+
+  // children and members of mixed names under the same parent //
+  status = _TreeOpenNew(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  add_node(ctx, ".ALPHA", TreeUSAGE_STRUCTURE);
+  add_node(ctx, ".ALPHA:A1", TreeUSAGE_NUMERIC);
+  add_node(ctx, ".ALPHA:AB", TreeUSAGE_NUMERIC);
+  add_node(ctx, ".ALPHA:B1", TreeUSAGE_NUMERIC);
+  add_node(ctx, ".ALPHA.A2", TreeUSAGE_STRUCTURE);
+  add_node(ctx, ".ALPHA.BB", TreeUSAGE_STRUCTURE);
+  add_node(ctx, ".ALPHA.A2:A3", TreeUSAGE_NUMERIC);
+  add_node(ctx, ".ALPHA.A2.B2", TreeUSAGE_STRUCTURE);
+  add_node(ctx, ".ALPHA.BB:A4", TreeUSAGE_TEXT);
+
+  // trees open for edit are searched by walking the nodes //
+  for (i = 0; i < NUM_PATHS; i++)
+    find_all(ctx, paths[i], walked[i]);
+  TEST1(walked[0][0] != -1 && walked[1][0] != -1);
+  status = _TreeWriteTree(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+
+  // the index must give the same answers in the same order //
+  status = _TreeOpen(&ctx, tree_name, shot, 1);
+  TEST1(STATUS_OK);
+  for (i = 0; i < NUM_PATHS; i++)
+  {
+    int j;
+    find_all(ctx, paths[i], indexed);
+    for (j = 0; walked[i][j] != -1 && walked[i][j] == indexed[j]; j++)
+      ;
+    if (walked[i][j] != indexed[j])
+      fprintf(stderr, "%s: answer %d differs\n", paths[i], j);
+    TEST1(walked[i][j] == indexed[j]);
+  }
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  TreeFreeDbid(ctx);
+
+  END_TESTING;
+  return 0;
+}
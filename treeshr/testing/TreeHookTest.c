@@ -0,0 +1,152 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// MDsplus //
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+#include <treeshr.h>
+#include <treeshr_hooks.h>
+#include <usagedef.h>
+
+// testing //
+#include "testing.h"
+
+#define NUM_TYPES (PutTimestampedSegmentFull + 1)
+
+static int calls[2][NUM_TYPES];
+static int last_shot, last_nid, last_value, tree_ok;
+
+static void record(int which, TreeshrHookType type, char const *tree,
+                   int shot, int nid, struct descriptor *data)
+{
+  calls[which][type]++;
+  last_shot = shot;
+  last_nid = nid;
+  tree_ok = tree && strcasecmp(tree, "tree_test") == 0;
+  last_value = data && data->dtype == DTYPE_L && data->pointer
+                   ? *(int *)data->pointer
+                   : -1;
+}
+
+static void hook_a(TreeshrHookType type, char const *tree, int shot, int nid,
+                   struct descriptor *data)
+{
+  record(0, type, tree, shot, nid, data);
+}
+
+static void hook_b(TreeshrHookType type, char const *tree, int shot, int nid,
+                   struct descriptor *data)
+{
+  record(1, type, tree, shot, nid, data);
+}
+
+static void put_value(void *ctx, int nid, int value)
+{
+  DESCRIPTOR_LONG(value_d, &value);
+  int status = _TreePutRecord(ctx, nid, (struct descriptor *)&value_d, 0);
+  TEST1(STATUS_OK);
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Tree Hooks);
+
+  void *ctx = NULL;
+  const int shot = 1;
+  const char *tree_name = "tree_test";
+  int nid, status;
+  MdsPutEnv("tree_test_path=.");
+
+  status = _TreeOpenNew(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  status = _TreeAddNode(ctx, "N", &nid, TreeUSAGE_NUMERIC);
+  TEST1(STATUS_OK);
+  status = _TreeWriteTree(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+
+  // registration //
+  TEST0(TreeRegisterHook((TreeshrHookType)-1, hook_a) & 1);
+  TEST0(TreeRegisterHook((TreeshrHookType)NUM_TYPES, hook_a) & 1);
+  TEST0(TreeRegisterHook(PutData, NULL) & 1);
+  TEST1(TreeRegisterHook(OpenTree, hook_a) & 1);
+  TEST1(TreeRegisterHook(PutData, hook_a) & 1);
+  TEST1(TreeRegisterHook(PutData, hook_a) & 1); // once only
+  TEST1(TreeRegisterHook(PutData, hook_b) & 1);
+  TEST1(TreeRegisterHook(PutDataFull, hook_b) & 1);
+
+  // tree level hooks have no nid //
+  status = _TreeOpen(&ctx, tree_name, shot, 0);
+  TEST1(STATUS_OK);
+  TEST1(calls[0][OpenTree] == 1);
+  TEST0(calls[1][OpenTree]);
+  TEST1(tree_ok && last_shot == shot && last_nid == 0);
+
+  // every consumer of a type is called once, only full hooks get the data //
+  put_value(ctx, nid, 42);
+  TEST1(calls[0][PutData] == 1);
+  TEST1(calls[1][PutData] == 1);
+  TEST1(calls[1][PutDataFull] == 1);
+  TEST0(calls[0][PutDataFull]);
+  TEST1(tree_ok && last_shot == shot && last_nid == nid);
+  TEST1(last_value == 42);
+
+  // types nobody registered for are not reported //
+  TEST0(calls[0][GetData] + calls[1][GetData]);
+  TEST0(calls[0][CloseTree] + calls[1][CloseTree]);
+
+  // unregistering stops the calls, and only for that consumer and type //
+  TEST1(TreeUnregisterHook(PutData, hook_a) & 1);
+  TEST0(TreeUnregisterHook(PutData, hook_a) & 1);
+  TEST0(TreeUnregisterHook(GetData, hook_a) & 1);
+  put_value(ctx, nid, 43);
+  TEST1(calls[0][PutData] == 1);
+  TEST1(calls[1][PutData] == 2);
+  TEST1(calls[1][PutDataFull] == 2);
+  TEST1(last_value == 43);
+  TEST1(TreeUnregisterHook(PutData, hook_b) & 1);
+  TEST1(TreeUnregisterHook(PutDataFull, hook_b) & 1);
+  put_value(ctx, nid, 44);
+  TEST1(calls[1][PutData] == 2);
+  TEST1(calls[1][PutDataFull] == 2);
+
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  TEST1(TreeUnregisterHook(OpenTree, hook_a) & 1);
+  status = _TreeOpen(&ctx, tree_name, shot, 1);
+  TEST1(STATUS_OK);
+  TEST1(calls[0][OpenTree] == 1);
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  TreeFreeDbid(ctx);
+
+  END_TESTING;
+  return 0;
+}
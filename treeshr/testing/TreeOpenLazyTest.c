@@ -0,0 +1,248 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// MDsplus //
+#include <mdsshr.h>
+#include <treeshr.h>
+#include <usagedef.h>
+#include "../treeshrp.h"
+
+// testing //
+#include "testing.h"
+
+#define NUM_THREADS 8
+#define NUM_ROUNDS 20
+
+static const int shot = 1;
+
+/*
+  tree_test_f       opened lazily
+    .TREE_TEST_C
+    .TREE_TEST_D
+  tree_test         opened regularly, its subtrees have subtrees
+    .TREE_TEST_A
+      .TREE_TEST_C
+    .TREE_TEST_B
+      .TREE_TEST_D
+*/
+static const char *paths[] = {
+    ":X",
+    ".TREE_TEST_C:X",
+    ".TREE_TEST_D:X",
+    ".TREE_TEST_C.S:Y",
+    ".TREE_TEST_D.S:Y",
+};
+#define NUM_PATHS (int)(sizeof(paths) / sizeof(paths[0]))
+
+static const char *nested_paths[] = {
+    ":X",
+    ".TREE_TEST_A:X",
+    ".TREE_TEST_B:X",
+    ".TREE_TEST_A.TREE_TEST_C:X",
+    ".TREE_TEST_B.TREE_TEST_D:X",
+};
+#define NUM_NESTED_PATHS (int)(sizeof(nested_paths) / sizeof(nested_paths[0]))
+
+static void add_node(void *ctx, const char *path, char usage)
+{
+  int nid, status = _TreeAddNode(ctx, path, &nid, usage);
+  TEST1(STATUS_OK);
+}
+
+static void add_subtree(void *ctx, const char *path)
+{
+  int nid, status = _TreeAddNode(ctx, path, &nid, TreeUSAGE_SUBTREE);
+  TEST1(STATUS_OK);
+  status = _TreeSetSubtree(ctx, nid);
+  TEST1(STATUS_OK);
+}
+
+static void write_tree(void **ctx, const char *tree)
+{
+  int status = _TreeWriteTree(ctx, tree, shot);
+  TEST1(STATUS_OK);
+  status = _TreeClose(ctx, tree, shot);
+  TEST1(STATUS_OK);
+}
+
+static void create_trees(void **ctx)
+{
+  static const char *leaves[] = {"tree_test_c", "tree_test_d"};
+  int status, i;
+  for (i = 0; i < 2; i++)
+  {
+    status = _TreeOpenNew(ctx, leaves[i], shot);
+    TEST1(STATUS_OK);
+    add_node(*ctx, ":X", TreeUSAGE_NUMERIC);
+    add_node(*ctx, ".S", TreeUSAGE_STRUCTURE);
+    add_node(*ctx, ".S:Y", TreeUSAGE_NUMERIC);
+    write_tree(ctx, leaves[i]);
+  }
+  status = _TreeOpenNew(ctx, "tree_test_a", shot);
+  TEST1(STATUS_OK);
+  add_node(*ctx, ":X", TreeUSAGE_NUMERIC);
+  add_subtree(*ctx, ".TREE_TEST_C");
+  write_tree(ctx, "tree_test_a");
+  status = _TreeOpenNew(ctx, "tree_test_b", shot);
+  TEST1(STATUS_OK);
+  add_node(*ctx, ":X", TreeUSAGE_NUMERIC);
+  add_subtree(*ctx, ".TREE_TEST_D");
+  write_tree(ctx, "tree_test_b");
+  status = _TreeOpenNew(ctx, "tree_test", shot);
+  TEST1(STATUS_OK);
+  add_node(*ctx, ":X", TreeUSAGE_NUMERIC);
+  add_subtree(*ctx, ".TREE_TEST_A");
+  add_subtree(*ctx, ".TREE_TEST_B");
+  write_tree(ctx, "tree_test");
+  status = _TreeOpenNew(ctx, "tree_test_f", shot);
+  TEST1(STATUS_OK);
+  add_node(*ctx, ":X", TreeUSAGE_NUMERIC);
+  add_subtree(*ctx, ".TREE_TEST_C");
+  add_subtree(*ctx, ".TREE_TEST_D");
+  write_tree(ctx, "tree_test_f");
+}
+
+/* nids of paths, resolved in the given order */
+static void find_paths(void *ctx, const char **paths, const int *order,
+                       int num, int *nids)
+{
+  int i;
+  for (i = 0; i < num; i++)
+  {
+    int status = _TreeFindNode(ctx, paths[order[i]], &nids[order[i]]);
+    if (STATUS_NOT_OK)
+      fprintf(stderr, "%s not found\n", paths[order[i]]);
+    TEST1(STATUS_OK);
+  }
+}
+
+typedef struct
+{
+  void *ctx;
+  const int *nids;
+  int first;
+  int errors;
+} find_job_t;
+
+// resolve all paths, starting at a different one in each thread, while the
+// other threads map the subtrees and replace the name index
+static void *find_all(void *arg)
+{
+  find_job_t *job = (find_job_t *)arg;
+  int round, i;
+  for (round = 0; round < NUM_ROUNDS; round++)
+    for (i = 0; i < NUM_PATHS; i++)
+    {
+      const int p = (job->first + i) % NUM_PATHS;
+      int nid;
+      if (IS_NOT_OK(_TreeFindNode(job->ctx, paths[p], &nid)) ||
+          nid != job->nids[p])
+        job->errors++;
+    }
+  return NULL;
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Tree Open Lazy);
+
+  static const int forward[] = {0, 1, 2, 3, 4};
+  static const int backward[] = {4, 3, 2, 1, 0};
+  void *ctx = NULL;
+  int first[NUM_PATHS], second[NUM_PATHS], nested[NUM_NESTED_PATHS];
+  int status, i;
+  MdsPutEnv("tree_test_path=.");
+  MdsPutEnv("tree_test_f_path=.");
+  MdsPutEnv("tree_test_a_path=.");
+  MdsPutEnv("tree_test_b_path=.");
+  MdsPutEnv("tree_test_c_path=.");
+  MdsPutEnv("tree_test_d_path=.");
+  MdsPutEnv("TreeOpenLazy=1");
+  create_trees(&ctx);
+
+  // subtrees are numbered in order whatever the access order //
+  status = _TreeOpen(&ctx, "tree_test_f", shot, 1);
+  TEST1(STATUS_OK);
+  TEST1(((PINO_DATABASE *)ctx)->lazy);
+  find_paths(ctx, paths, forward, NUM_PATHS, first);
+  status = _TreeClose(&ctx, "tree_test_f", shot);
+  TEST1(STATUS_OK);
+  status = _TreeOpen(&ctx, "tree_test_f", shot, 1);
+  TEST1(STATUS_OK);
+  find_paths(ctx, paths, backward, NUM_PATHS, second);
+  status = _TreeClose(&ctx, "tree_test_f", shot);
+  TEST1(STATUS_OK);
+  for (i = 0; i < NUM_PATHS; i++)
+  {
+    if (first[i] != second[i])
+      fprintf(stderr, "%s: nid %d then %d\n", paths[i], first[i], second[i]);
+    TEST1(first[i] == second[i]);
+  }
+  TEST1(first[0] >> 24 == 0);
+  TEST1(first[1] >> 24 == 1);
+  TEST1(first[2] >> 24 == 2);
+
+  // a tree whose subtrees have subtrees is numbered depth first //
+  status = _TreeOpen(&ctx, "tree_test", shot, 1);
+  TEST1(STATUS_OK);
+  TEST0(((PINO_DATABASE *)ctx)->lazy);
+  find_paths(ctx, nested_paths, backward, NUM_NESTED_PATHS, nested);
+  status = _TreeClose(&ctx, "tree_test", shot);
+  TEST1(STATUS_OK);
+  TEST1(nested[0] >> 24 == 0);
+  TEST1(nested[1] >> 24 == 1);
+  TEST1(nested[3] >> 24 == 2);
+  TEST1(nested[2] >> 24 == 3);
+  TEST1(nested[4] >> 24 == 4);
+
+  // threads searching while others map subtrees keep valid answers //
+  status = _TreeOpen(&ctx, "tree_test_f", shot, 1);
+  TEST1(STATUS_OK);
+  pthread_t threads[NUM_THREADS];
+  find_job_t jobs[NUM_THREADS];
+  for (i = 0; i < NUM_THREADS; i++)
+  {
+    jobs[i].ctx = ctx;
+    jobs[i].nids = first;
+    jobs[i].first = NUM_PATHS - 1 - i % NUM_PATHS;
+    jobs[i].errors = 0;
+    TEST0(pthread_create(&threads[i], NULL, find_all, &jobs[i]));
+  }
+  for (i = 0; i < NUM_THREADS; i++)
+  {
+    pthread_join(threads[i], NULL);
+    TEST0(jobs[i].errors);
+  }
+  status = _TreeClose(&ctx, "tree_test_f", shot);
+  TEST1(STATUS_OK);
+  TreeFreeDbid(ctx);
+
+  END_TESTING;
+  return 0;
+}
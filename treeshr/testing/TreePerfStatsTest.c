@@ -0,0 +1,150 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// MDsplus //
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+#include <treeshr.h>
+#include <usagedef.h>
+
+// testing //
+#include "testing.h"
+
+#define NUM_THREADS 4
+#define NUM_GETS 50
+
+static const char *tree_name = "tree_test";
+static const int shot = 1;
+
+static void *get_records(void *arg)
+{
+  int nid = *(int *)arg;
+  void *ctx = NULL;
+  int i;
+  if (_TreeOpen(&ctx, tree_name, shot, 1) & 1)
+  {
+    for (i = 0; i < NUM_GETS; i++)
+    {
+      EMPTYXD(xd);
+      _TreeGetRecord(ctx, nid, &xd);
+      MdsFree1Dx(&xd, NULL);
+    }
+    _TreeClose(&ctx, tree_name, shot);
+  }
+  TreeFreeDbid(ctx);
+  return NULL;
+}
+
+static int64_t count_of(int op)
+{
+  TREE_PERF_STATS stats;
+  TreeGetPerfStats(op, &stats);
+  return stats.count;
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Tree Perf Stats);
+
+  void *ctx = NULL;
+  int status, nid, i;
+  MdsPutEnv("tree_test_path=.");
+
+  status = _TreeOpenNew(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  status = _TreeAddNode(ctx, "VALUE", &nid, TreeUSAGE_NUMERIC);
+  TEST1(STATUS_OK);
+  status = _TreeWriteTree(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+
+  TREE_PERF_STATS stats;
+  TEST1(TreeGetPerfStats(-1, &stats) == TreeFAILURE);
+  TEST1(TreeGetPerfStats(TREE_PERF_NUM_OPS, &stats) == TreeFAILURE);
+  TEST1(TreePerfOpName(TREE_PERF_NUM_OPS) == NULL);
+  TEST0(strcmp(TreePerfOpName(TREE_PERF_GET_RECORD), "TreeGetRecord"));
+
+  // calls of this thread are counted //
+  TreeResetPerfStats();
+  status = _TreeOpen(&ctx, tree_name, shot, 0);
+  TEST1(STATUS_OK);
+  TEST1(count_of(TREE_PERF_OPEN) == 1);
+  int value = 42;
+  DESCRIPTOR_LONG(value_d, &value);
+  for (i = 0; i < 10; i++)
+  {
+    status = _TreePutRecord(ctx, nid, (mdsdsc_t *)&value_d, 0);
+    TEST1(STATUS_OK);
+  }
+  TEST1(count_of(TREE_PERF_PUT_RECORD) == 10);
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+
+  // calls of other threads are summed, also after the threads exited //
+  TreeResetPerfStats();
+  TEST0(count_of(TREE_PERF_GET_RECORD));
+  pthread_t threads[NUM_THREADS];
+  for (i = 0; i < NUM_THREADS; i++)
+    TEST0(pthread_create(&threads[i], NULL, get_records, &nid));
+  for (i = 0; i < NUM_THREADS; i++)
+    pthread_join(threads[i], NULL);
+  TEST1(count_of(TREE_PERF_GET_RECORD) == NUM_THREADS * NUM_GETS);
+  TEST1(count_of(TREE_PERF_OPEN) == NUM_THREADS);
+  status = TreeGetPerfStats(TREE_PERF_GET_RECORD, &stats);
+  TEST1(STATUS_OK);
+  int64_t histogram_count = 0;
+  for (i = 0; i < TREE_PERF_BUCKETS; i++)
+    histogram_count += stats.histogram[i];
+  TEST1(histogram_count == stats.count);
+  TEST1(stats.max_ns <= stats.total_ns);
+  TEST0(strcmp(stats.max_tree, "TREE_TEST"));
+  TEST1(stats.max_nid == nid);
+
+  // the report has a header and one line per operation //
+  char *report = TreePerfReport();
+  TEST1(report != NULL);
+  int lines = 0;
+  char *c;
+  for (c = report; *c; c++)
+    lines += *c == '\n';
+  TEST1(lines == TREE_PERF_NUM_OPS + 1);
+  for (i = 0; i < TREE_PERF_NUM_OPS; i++)
+    TEST1(strstr(report, TreePerfOpName(i)) != NULL);
+  free(report);
+
+  // reset clears the slots of all threads //
+  TreeResetPerfStats();
+  for (i = 0; i < TREE_PERF_NUM_OPS; i++)
+    TEST0(count_of(i));
+
+  TreeFreeDbid(ctx);
+  END_TESTING;
+  return 0;
+}
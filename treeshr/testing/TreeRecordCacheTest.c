@@ -0,0 +1,188 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdlib.h>
+
+// MDsplus //
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+#include <ncidef.h>
+#include <treeshr.h>
+#include <usagedef.h>
+
+// testing //
+#include "testing.h"
+
+#define NUM_NODES 8
+#define ARR_SIZE 256
+
+static TREE_RECORD_CACHE_STATS stats;
+
+static void get_stats()
+{
+  TreeGetRecordCacheStats(&stats);
+}
+
+static int check_record(void *ctx, int nid, int value)
+{
+  EMPTYXD(xd);
+  int status = _TreeGetRecord(ctx, nid, &xd);
+  int ok = STATUS_OK && xd.pointer && xd.pointer->class == CLASS_A &&
+           xd.pointer->dtype == DTYPE_L &&
+           ((mdsdsc_a_t *)xd.pointer)->arsize == ARR_SIZE * sizeof(int);
+  if (ok)
+  {
+    int *data = (int *)xd.pointer->pointer;
+    int i;
+    for (i = 0; i < ARR_SIZE; i++)
+      if (data[i] != value + i)
+      {
+        ok = 0;
+        break;
+      }
+  }
+  MdsFree1Dx(&xd, NULL);
+  return ok;
+}
+
+static void put_record(void *ctx, int nid, int value)
+{
+  int data[ARR_SIZE];
+  int i;
+  for (i = 0; i < ARR_SIZE; i++)
+    data[i] = value + i;
+  DESCRIPTOR_A(data_d, sizeof(int), DTYPE_L, data, sizeof(data));
+  int status = _TreePutRecord(ctx, nid, (mdsdsc_t *)&data_d, 0);
+  TEST1(STATUS_OK);
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Tree Record Cache);
+
+  void *ctx = NULL;
+  const int shot = 1;
+  const char *tree_name = "tree_test";
+  int nid[NUM_NODES];
+  char name[16];
+  int status, i;
+  // keep records uncompressed so reads hand back the array itself //
+  int flags = NciM_DO_NOT_COMPRESS;
+  NCI_ITM flag_itm[] = {{sizeof(flags), NciSET_FLAGS, &flags, 0},
+                        {0, NciEND_OF_LIST, 0, 0}};
+  MdsPutEnv("tree_test_path=.");
+
+  // build a tree with a few numeric nodes //
+  status = _TreeOpenNew(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  for (i = 0; i < NUM_NODES; i++)
+  {
+    sprintf(name, "N%d", i);
+    status = _TreeAddNode(ctx, name, &nid[i], TreeUSAGE_NUMERIC);
+    TEST1(STATUS_OK);
+    status = _TreeSetNci(ctx, nid[i], flag_itm);
+    TEST1(STATUS_OK);
+  }
+  status = _TreeWriteTree(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+
+  status = _TreeOpen(&ctx, tree_name, shot, 0);
+  TEST1(STATUS_OK);
+  for (i = 0; i < NUM_NODES; i++)
+    put_record(ctx, nid[i], i * 1000);
+
+  // disabled by default: nothing is stored //
+  TreeSetRecordCacheSize(0);
+  TreeResetRecordCacheStats();
+  TEST1(check_record(ctx, nid[0], 0));
+  get_stats();
+  TEST0(stats.entries);
+  TEST0(stats.hits);
+
+  // hits //
+  TreeSetRecordCacheSize(1 << 20);
+  TreeResetRecordCacheStats();
+  TEST1(check_record(ctx, nid[0], 0));
+  get_stats();
+  TEST1(stats.misses == 1);
+  TEST1(stats.entries == 1);
+  TEST1(check_record(ctx, nid[0], 0));
+  TEST1(check_record(ctx, nid[0], 0));
+  get_stats();
+  TEST1(stats.hits == 2);
+  TEST1(stats.misses == 1);
+
+  // a put invalidates the node and the next read sees the new data //
+  put_record(ctx, nid[0], 5000);
+  get_stats();
+  TEST1(stats.invalidations >= 1);
+  TEST0(stats.entries);
+  TEST1(check_record(ctx, nid[0], 5000));
+  TEST1(check_record(ctx, nid[0], 5000));
+  get_stats();
+  TEST1(stats.hits == 3);
+  TEST1(stats.misses == 2);
+
+  // eviction keeps the byte count under the limit //
+  TreeFlushRecordCache();
+  TreeResetRecordCacheStats();
+  TEST1(check_record(ctx, nid[1], 1000));
+  get_stats();
+  const int64_t entry_size = stats.bytes;
+  TEST1(entry_size > 0);
+  TreeSetRecordCacheSize(entry_size * 3);
+  for (i = 2; i < NUM_NODES; i++)
+    TEST1(check_record(ctx, nid[i], i * 1000));
+  get_stats();
+  TEST1(stats.entries == 3);
+  TEST1(stats.evictions == NUM_NODES - 4);
+  TEST1(stats.bytes <= entry_size * 3);
+  // the most recently read nodes are still cached, the oldest is not //
+  TreeResetRecordCacheStats();
+  TEST1(check_record(ctx, nid[NUM_NODES - 1], (NUM_NODES - 1) * 1000));
+  TEST1(check_record(ctx, nid[1], 1000));
+  get_stats();
+  TEST1(stats.hits == 1);
+  TEST1(stats.misses == 1);
+
+  // lowering the limit trims, flushing empties //
+  TreeSetRecordCacheSize(entry_size);
+  get_stats();
+  TEST1(stats.entries <= 1);
+  TreeFlushRecordCache();
+  get_stats();
+  TEST0(stats.entries);
+  TEST0(stats.bytes);
+
+  TreeSetRecordCacheSize(0);
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  TreeFreeDbid(ctx);
+
+  END_TESTING;
+  return 0;
+}
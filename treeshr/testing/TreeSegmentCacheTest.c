@@ -0,0 +1,216 @@
+/*
+Copyright (c) 2017, Massachusetts Institute of Technology All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// MDsplus //
+#include <mdsdescrip.h>
+#include <mdsshr.h>
+#include <treeshr.h>
+#include <usagedef.h>
+#include "../treeshr_xnci.h"
+
+// testing //
+#include "testing.h"
+
+#define ROWS 16
+
+/* a read through the cache must match a read of the datafile */
+static int check_segment(void *ctx, int nid, int idx, int rows)
+{
+  EMPTYXD(seg);
+  EMPTYXD(dim);
+  EMPTYXD(file_seg);
+  EMPTYXD(file_dim);
+  int status = _TreeGetSegment(ctx, nid, idx, &seg, &dim);
+  int ok = STATUS_OK;
+  if (ok)
+    ok = IS_OK(_TreeXNciGetSegment(ctx, nid, NULL, idx, &file_seg, &file_dim));
+  if (ok)
+    ok = MdsCompareXd((mdsdsc_t *)&seg, (mdsdsc_t *)&file_seg) &&
+         MdsCompareXd((mdsdsc_t *)&dim, (mdsdsc_t *)&file_dim);
+  if (ok)
+    ok = seg.pointer && seg.pointer->class == CLASS_A &&
+         ((mdsdsc_a_t *)seg.pointer)->arsize == rows * sizeof(int);
+  MdsFree1Dx(&seg, NULL);
+  MdsFree1Dx(&dim, NULL);
+  MdsFree1Dx(&file_seg, NULL);
+  MdsFree1Dx(&file_dim, NULL);
+  return ok;
+}
+
+static int shm_exists(int shot)
+{
+  char name[64];
+  sprintf(name, "/mdsplus_segcache_TREE_TEST_%d", shot);
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd == -1)
+    return 0;
+  close(fd);
+  return 1;
+}
+
+static void put_row(void *ctx, int nid, int value)
+{
+  int64_t t = value;
+  DESCRIPTOR_LONG(row_d, &value);
+  int status = _TreePutRow(ctx, nid, ROWS, &t, (mdsdsc_a_t *)&row_d);
+  TEST1(STATUS_OK);
+}
+
+int main(int argc __attribute__((unused)),
+         char *argv[] __attribute__((unused)))
+{
+  BEGIN_TESTING(Tree Segment Cache);
+
+  void *ctx = NULL;
+  const int shot = 1;
+  const char *tree_name = "tree_test";
+  int nid, num, status, i;
+  int init[ROWS] = {0}, rows[3];
+  int64_t times[3];
+  DESCRIPTOR_A(init_d, sizeof(int), DTYPE_L, init, sizeof(init));
+  DESCRIPTOR_A(rows_d, sizeof(int), DTYPE_L, rows, sizeof(rows));
+  MdsPutEnv("tree_test_path=.");
+  MdsPutEnv("TreeSegmentCacheDepth=4");
+  // room for one object of 16 nodes with 4 slots of 64k
+  MdsPutEnv("TreeSegmentCacheSlotSize=64k");
+  MdsPutEnv("TreeSegmentCacheNodes=16");
+  MdsPutEnv("TreeSegmentCacheMaxSize=6M");
+
+  // model tree with one signal, the pulse file retires any old cache //
+  status = _TreeOpenNew(&ctx, tree_name, -1);
+  TEST1(STATUS_OK);
+  status = _TreeAddNode(ctx, "SIG", &nid, TreeUSAGE_SIGNAL);
+  TEST1(STATUS_OK);
+  status = _TreeWriteTree(&ctx, tree_name, -1);
+  TEST1(STATUS_OK);
+  status = _TreeClose(&ctx, tree_name, -1);
+  TEST1(STATUS_OK);
+  status = _TreeOpen(&ctx, tree_name, -1, 1);
+  TEST1(STATUS_OK);
+  status = _TreeCreatePulseFile(ctx, shot, 0, NULL);
+  TEST1(STATUS_OK);
+  status = _TreeCreatePulseFile(ctx, shot + 1, 0, NULL);
+  TEST1(STATUS_OK);
+  status = _TreeClose(&ctx, tree_name, -1);
+  TEST1(STATUS_OK);
+
+  // a writer that dies leaves its object behind //
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    void *child = NULL;
+    int ok = IS_OK(_TreeOpen(&child, tree_name, shot + 1, 0)) &&
+             IS_OK(_TreeBeginTimestampedSegment(child, nid,
+                                                (mdsdsc_a_t *)&init_d, -1));
+    if (ok)
+    {
+      int64_t t = 0;
+      DESCRIPTOR_LONG(row_d, &i);
+      i = 0;
+      ok = IS_OK(_TreePutRow(child, nid, ROWS, &t, (mdsdsc_a_t *)&row_d));
+    }
+    _exit(ok ? 0 : 1);
+  }
+  int child_status;
+  TEST1(waitpid(pid, &child_status, 0) == pid);
+  TEST1(WIFEXITED(child_status) && WEXITSTATUS(child_status) == 0);
+  TEST1(shm_exists(shot + 1));
+
+  status = _TreeOpen(&ctx, tree_name, shot, 0);
+  TEST1(STATUS_OK);
+
+  // rows written through the cache //
+  status = _TreeBeginTimestampedSegment(ctx, nid, (mdsdsc_a_t *)&init_d, -1);
+  TEST1(STATUS_OK);
+  for (i = 0; i < 5; i++)
+    put_row(ctx, nid, i);
+  // the new object only fits without the one left behind
+  TEST1(shm_exists(shot));
+  TEST0(shm_exists(shot + 1));
+  TEST1(check_segment(ctx, nid, -1, 5));
+  TEST1(check_segment(ctx, nid, 0, 5));
+  TEST1(check_segment(ctx, nid, 0, 5));
+
+  // a full segment rolls over into a new one //
+  for (; i < ROWS + 4; i++)
+    put_row(ctx, nid, i);
+  status = _TreeGetNumSegments(ctx, nid, &num);
+  TEST1(STATUS_OK && num == 2);
+  TEST1(check_segment(ctx, nid, 0, ROWS));
+  TEST1(check_segment(ctx, nid, 1, 4));
+  TEST1(check_segment(ctx, nid, -1, 4));
+
+  // rows appended by a writer that bypasses the cache are not hidden //
+  for (i = 0; i < 3; i++)
+  {
+    rows[i] = 100 + i;
+    times[i] = 100 + i;
+  }
+  status = _TreeXNciPutTimestampedSegment(ctx, nid, NULL, times,
+                                          (mdsdsc_a_t *)&rows_d);
+  TEST1(STATUS_OK);
+  TEST1(check_segment(ctx, nid, -1, 7));
+  TEST1(check_segment(ctx, nid, 1, 7));
+
+  // nor is a segment made behind its back //
+  status = _TreeXNciMakeTimestampedSegment(ctx, nid, NULL, times,
+                                           (mdsdsc_a_t *)&rows_d, -1, 3);
+  TEST1(STATUS_OK);
+  TEST1(check_segment(ctx, nid, -1, 3));
+  TEST1(check_segment(ctx, nid, 2, 3));
+  TEST1(check_segment(ctx, nid, 1, 7));
+
+  // a record replaces the segments //
+  status = _TreePutRecord(ctx, nid, (mdsdsc_t *)&init_d, 0);
+  TEST1(STATUS_OK);
+  status = _TreeGetNumSegments(ctx, nid, &num);
+  TEST1(STATUS_OK && num == 0);
+  EMPTYXD(seg);
+  status = _TreeGetSegment(ctx, nid, 0, &seg, NULL);
+  TEST0(STATUS_OK);
+  MdsFree1Dx(&seg, NULL);
+
+  // the last close unlinks the object //
+  status = _TreeClose(&ctx, tree_name, shot);
+  TEST1(STATUS_OK);
+  TEST0(shm_exists(shot));
+  status = _TreeOpen(&ctx, tree_name, -1, 1);
+  TEST1(STATUS_OK);
+  status = _TreeDeletePulseFile(ctx, shot, 1);
+  TEST1(STATUS_OK);
+  status = _TreeDeletePulseFile(ctx, shot + 1, 1);
+  TEST1(STATUS_OK);
+  status = _TreeClose(&ctx, tree_name, -1);
+  TEST1(STATUS_OK);
+  TreeFreeDbid(ctx);
+
+  END_TESTING;
+  return 0;
+}
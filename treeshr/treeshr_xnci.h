@@ -66,6 +66,9 @@ extern "C"
                                                const char *xnci, int *numsegs,
                                                mdsdsc_xd_t *start_list,
                                                mdsdsc_xd_t *end_list);
+  extern EXPORT int _TreeXNciGetSegmentRows(void *dbid, int nid,
+                                            const char *xnci, int *numsegs,
+                                            int **rows);
   extern EXPORT int _TreeXNciGetSegmentScale(void *dbid, int nid,
                                              const char *xnci,
                                              mdsdsc_xd_t *value);
@@ -580,6 +580,7 @@ typedef struct tree_info
   char *filespec;                    /* Pointer to full file spec of tree file           */
   char dvi[16];                      /* Tree file disk info                              */
   unsigned short tree_info_w_fid[3]; /* Tree file file id */
+  int64_t file_id[3];                /* Inode, size and mtime of the tree file when mapped */
   unsigned flush : 1;                /* Flush I/O's buffers                              */
   unsigned rundown : 1;              /* Doing rundown                                    */
   unsigned mapped : 1;               /* Tree is mapped into memory                       */
@@ -590,6 +591,9 @@ typedef struct tree_info
   NCI_FILE *nci_file;                /* Pointer to nci file block (if open)              */
   DATA_FILE *data_file;              /* Pointer to a datafile access block               */
   pthread_rwlock_t lock;
+  int lazy;                          /* Subtree not mapped yet, see tree_lazy_load       */
+  NODE lazy_top;                     /* Top node standing in until the tree is mapped    */
+  void *segcache;                    /* Segment cache object in use, see TreeSegmentCache.c */
 } TREE_INFO;
 
 #define RDLOCKINFO(info) \
@@ -633,15 +637,23 @@ typedef struct pino_database
   unsigned setup_info : 1;    /* Flag indicating setup info is being added */
   unsigned remote : 1;        /* Flag indicating tree is on remote system */
   unsigned alternate_compression : 1;
-  unsigned : 25;
+  unsigned lazy : 1;          /* Flag indicating subtrees are opened lazily */
+  unsigned : 24;
   int stack_size;
   unsigned fill;
   timecontext_t timecontext;
   int delete_list_vm;
   unsigned char *delete_list;
   void *dispatch_table; /* pointer to dispatch table generated by dispatch/build */
+  struct tree_index *index; /* name and tag index, see TreeIndex.c */
 } PINO_DATABASE;
 
+extern int tree_lazy_load(PINO_DATABASE *dblist, TREE_INFO *info);
+static inline int tree_lazy(TREE_INFO *info)
+{
+  return __atomic_load_n(&info->lazy, __ATOMIC_ACQUIRE);
+}
+
 static inline NODE *nid_to_node(PINO_DATABASE *dbid, NID *nid)
 {
   TREE_INFO *info;
@@ -784,11 +796,14 @@ static inline int node_to_nid(PINO_DATABASE *dbid, NODE *node, NID *nid_out)
   for (info = dbid->tree_info, nid.tree = 0; info != NULL;
        info = info->next_info, nid.tree++)
   {
-    if ((node >= info->node) && (node <= (info->node + info->header->nodes)))
+    if ((node == &info->lazy_top) ||
+        ((node >= info->node) && (node <= (info->node + info->header->nodes))))
       break;
   }
   if (info)
-    nid.node = (unsigned int)((node - info->node) & 0xFFFFFF);
+    nid.node = (node == &info->lazy_top)
+                   ? 0
+                   : (unsigned int)((node - info->node) & 0xFFFFFF);
   else
     nid.tree = 0;
   if (nid_out)
@@ -811,6 +826,8 @@ static inline int nid_to_tree_idx(PINO_DATABASE *pino, NID *nid,
   TREE_INFO *info = pino->tree_info;
   for (i = 0; info && i < nid->tree; i++)
     info = info->next_info;
+  if (info && tree_lazy(info))
+    tree_lazy_load(pino, info);
   *info_out = info ? (info->header->nodes >= (int)nid->node ? info : 0) : NULL;
   return *info_out ? nid->node : 0;
 }
@@ -873,7 +890,18 @@ extern int GetDefaultNidRemote(PINO_DATABASE *dblist, int *nid);
 #endif
 extern int64_t RfaToSeek(uint8_t *rfa);
 void SeekToRfa(int64_t seek, uint8_t *rfa);
-extern void TreeCallHookFun(char *hookType, char *hookName, ...);
+/* Hooks of enabled types have at least one consumer (TreeHooks env or
+ * TreeRegisterHook); the mask starts all set until the configuration is read.
+ */
+extern uint32_t _TreeHookMask;
+extern void TreeCallHooks(TreeshrHookType type, char const *tree, int shot,
+                          int nid, struct descriptor *data);
+#define TREE_HOOKS(type, tree, shot, nid, data)   \
+  do                                              \
+  {                                               \
+    if (_TreeHookMask & (1u << (type)))           \
+      TreeCallHooks(type, tree, shot, nid, data); \
+  } while (0)
 extern int TreeMakeNidsLocal(struct descriptor *dsc_ptr, int nid);
 extern int TreeCloseFiles(TREE_INFO *info, int nci, int data);
 extern int TreeCopyExtended(PINO_DATABASE *dbid1, PINO_DATABASE *dbid2, int nid,
@@ -941,6 +969,107 @@ extern int tree_put_dsc(PINO_DATABASE *dbid, TREE_INFO *info, int nid,
                         struct descriptor *dsc, int64_t *offset, int *length,
                         int compress);
 
+extern int tree_cache_get(TREE_INFO *info, int nidx, int64_t offset,
+                          int64_t time_inserted, struct descriptor_xd *dsc);
+extern void tree_cache_put(TREE_INFO *info, int nidx, int64_t offset,
+                           int64_t time_inserted, struct descriptor_xd *dsc);
+extern void tree_cache_invalidate(TREE_INFO *info, int nidx);
+extern void tree_async_close_owner(void *owner);
+
+/* shared memory segment cache, see TreeSegmentCache.c */
+#define SEGCACHE_DIM_NONE 0
+#define SEGCACHE_DIM_TIMESTAMPS 1
+#define SEGCACHE_DIM_DSC 2
+typedef struct
+{
+  void *header;
+  void *node;
+  uint32_t writers;
+  uint64_t version;
+} segcache_fill_t;
+typedef struct
+{
+  void *header;
+  void *node;
+} segcache_write_t;
+extern int tree_segment_head(void *dbid, int nid, int *last, int *next_row);
+extern int tree_segcache_enabled();
+extern int tree_segcache_get(PINO_DATABASE *dblist, int nid, int idx,
+                             struct descriptor_xd *segment,
+                             struct descriptor_xd *dim, segcache_fill_t *fill);
+extern void tree_segcache_fill(segcache_fill_t *fill, int idx, int rows,
+                               int last, int next_row, int kind,
+                               struct descriptor_xd *segment,
+                               struct descriptor_xd *dim);
+extern void tree_segcache_begin(PINO_DATABASE *dblist, int nid,
+                                segcache_write_t *w);
+extern void tree_segcache_end_make(segcache_write_t *w, int status,
+                                   PINO_DATABASE *dblist, int nid,
+                                   struct descriptor *dimension,
+                                   int64_t *timestamps, int timestamped,
+                                   struct descriptor_a *initialValue,
+                                   int rows_filled);
+extern void tree_segcache_end_put(segcache_write_t *w, int status,
+                                  int start_idx, int64_t *timestamps,
+                                  struct descriptor_a *data);
+extern void tree_segcache_end_put_row(segcache_write_t *w, int status,
+                                      PINO_DATABASE *dblist, int nid,
+                                      int bufsize, int64_t *timestamp,
+                                      struct descriptor_a *data);
+extern void tree_segcache_end_invalidate(segcache_write_t *w);
+extern void tree_segcache_close(TREE_INFO *info);
+extern void tree_segcache_purge(char const *tree, int shot);
+
+/* node name and tag index, see TreeIndex.c */
+typedef struct
+{
+  NODE *node;
+  int parent;      /* entry of the parent, -1 for the top node */
+  int kids;        /* first entry of the members, followed by the children */
+  int members;     /* number of members */
+  int children;    /* number of children */
+  int next_name;   /* next entry with the same name */
+  int depth;       /* distance from the top node */
+  int is_member;   /* is a member of its parent */
+  char name[sizeof(NODE_NAME) + 1];
+} TREE_INDEX_ENTRY;
+typedef struct
+{
+  TREE_INFO *info;
+  NODE *node;
+  char name[sizeof(TAG_NAME) + 1];
+} TREE_INDEX_TAG;
+typedef struct tree_index
+{
+  TREE_INFO *tree_info; /* tree_info list the index was built from */
+  int count;
+  TREE_INDEX_ENTRY *entry; /* breadth first order */
+  int mask;
+  int *nodes; /* NODE * -> entry */
+  int *names; /* name -> first entry of that name */
+  int *edges; /* (parent, name) -> entry */
+  int ntags;
+  int tag_mask;
+  TREE_INDEX_TAG *tag;
+  int *tags;                  /* (tree, tag) -> tag */
+  int stale;                  /* rebuild on next use, see tree_index_retire */
+  struct tree_index *retired; /* replaced indices, freed with this one */
+} TREE_INDEX;
+extern TREE_INDEX *tree_index_get(PINO_DATABASE *dblist);
+extern void tree_index_free(PINO_DATABASE *dblist);
+extern void tree_index_retire(PINO_DATABASE *dblist);
+extern int tree_index_entry(const TREE_INDEX *index, const NODE *node);
+extern int tree_index_child(const TREE_INDEX *index, int parent,
+                            const char *name);
+extern int tree_index_named(const TREE_INDEX *index, const char *name);
+extern NODE *tree_index_tag(const TREE_INDEX *index, const TREE_INFO *info,
+                            const char *name);
+extern NODE *tree_lazy_node(PINO_DATABASE *dblist, NODE *node);
+extern void tree_lazy_load_below(PINO_DATABASE *dblist, NODE *node);
+extern uint64_t tree_perf_now();
+extern void tree_perf_record(int op, uint64_t start, PINO_DATABASE *dblist,
+                             TREE_INFO *info, int nid);
+
 extern int MDS_IO_ID(int fd);
 extern int MDS_IO_FD(int fd);
 #ifdef _WIN32
@@ -17,6 +17,13 @@ typedef struct host
 
 void destroy_host(Host *host);
 
+/* time contexts set up by TreeBeginTimeContext, innermost first */
+typedef struct thread_timecontext
+{
+  timecontext_t tc;
+  struct thread_timecontext *prev;
+} thread_timecontext_t;
+
 #define TREETHREADSTATIC_VAR TreeThreadStatic_p
 #define TREETHREADSTATIC_TYPE TreeThreadStatic_t
 #define TREETHREADSTATIC_ARG TREETHREADSTATIC_TYPE *TREETHREADSTATIC_VAR
@@ -31,6 +38,7 @@ typedef struct
   int private_ctx;
   int nid_ref;
   int path_ref;
+  thread_timecontext_t *timecontext;
 } TREETHREADSTATIC_TYPE;
 #define TREE_DBID TREETHREADSTATIC_VAR->dbid
 #define TREE_HOSTLIST TREETHREADSTATIC_VAR->hostlist
@@ -39,9 +47,11 @@ typedef struct
 #define TREE_NIDREF TREETHREADSTATIC_VAR->nid_ref
 #define TREE_PATHREF TREETHREADSTATIC_VAR->path_ref
 #define TREE_TEMPNCI TREETHREADSTATIC_VAR->temp_nci
+#define TREE_TIMECONTEXT TREETHREADSTATIC_VAR->timecontext
 
 extern DEFINE_GETTHREADSTATIC(TREETHREADSTATIC_TYPE, TreeGetThreadStatic);
 
 extern void **TreeCtx();
+extern void free_thread_timecontext(thread_timecontext_t *ttc);
 extern EXPORT int TreeUsePrivateCtx(int onoff);
 #endif // ifndef _TREETHREADSTATIC_H
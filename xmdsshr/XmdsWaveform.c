@@ -135,6 +135,7 @@ Widget XmdsCreateWaveform( parent, name, args, argcount )
 #define waveformStepPlot(widget) ((widget)->waveform.step_plot)
 #define waveformDisabled(widget) ((widget)->waveform.disabled)
 #define waveformClosed(widget) ((widget)->waveform.closed)
+#define waveformEnvelope(widget) ((widget)->waveform.envelope)
 
 /*------------------------------------------------------------------------------
 
@@ -147,6 +148,9 @@ Widget XmdsCreateWaveform( parent, name, args, argcount )
 #include <X11/Xatom.h>
 #include <xmdsshr.h>
 #include <Xmds/XmdsWaveformP.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /*------------------------------------------------------------------------------
 
@@ -206,6 +210,9 @@ static void Point();
 static void Align();
 static void FreePixVals(XmdsWaveformWidget w);
 static void GetPixVals(XmdsWaveformWidget w, Dimension width, Dimension height);
+static void FreeEnvelope(XmdsWaveformWidget w);
+static Boolean UseEnvelope(XmdsWaveformWidget w);
+static void GetEnvelope(XmdsWaveformWidget w);
 static void Plot(XmdsWaveformWidget w, Boolean free_mem);
 static void ConvertToPix(int num, float *minval, float *maxval, float *value,
                          unsigned short pixspan, int *pixval,
@@ -496,6 +503,7 @@ static void Initialize(XmdsWaveformWidget req,
   yOffset(w) = 0;
   xPixValue(w) = 0;
   yPixValue(w) = 0;
+  memset(&waveformEnvelope(w), 0, sizeof(waveformEnvelope(w)));
   xCrosshair(w) = 0.0;
   yCrosshair(w) = 0.0;
   waveformReverse(w) = 0;
@@ -622,6 +630,7 @@ static void Destroy(XmdsWaveformWidget w)
   if (waveformPixmap(w))
     XFreePixmap(XtDisplay(w), waveformPixmap(w));
   FreePixVals(w);
+  FreeEnvelope(w);
 
 #define destroyVal(field)                                                   \
   if (field##ValStruct(w))                                                  \
@@ -1027,6 +1036,7 @@ static Boolean SetValues(XmdsWaveformWidget old,
 
   waveformPanning(new) = 0;
   FreePixVals(new);
+  FreeEnvelope(new);
   if (waveformFontStruct(old) != waveformFontStruct(req))
   {
     XGCValues values;
@@ -1108,6 +1118,183 @@ static void GetPixVals(XmdsWaveformWidget w, Dimension width,
   yOffset(w) = 0;
 }
 
+/*------------------------------------------------------------------------------
+        Line plots of traces with many more samples than pixel columns are
+        drawn from an envelope: each run of consecutive samples that fall
+        in the same column is reduced to its first, lowest, highest and
+        last point. The lines within a column only join its points
+        vertically, so the reduced trace sets exactly the same pixels and
+        costs are in proportion to the widget width. Missing, off scale
+        and pen up samples are kept as they are. The envelope is kept
+        across redraws until the data, limits, size or pan offset change.
+------------------------------------------------------------------------------*/
+
+static void FreeEnvelope(XmdsWaveformWidget w)
+{
+  XmdsWaveformEnvelope *env = &waveformEnvelope(w);
+  XtFree((char *)env->x);
+  XtFree((char *)env->y);
+  XtFree((char *)env->pen_down);
+  memset(env, 0, sizeof(*env));
+}
+
+static Boolean UseEnvelope(XmdsWaveformWidget w)
+{
+  XmdsWaveformEnvelope *env = &waveformEnvelope(w);
+  if (waveformPrint || waveformPanning(w) > 0 ||
+      waveformShowMode(w) != XmdsSHOW_MODE_LINE ||
+      (waveformShowSelections(w) && waveformSelectionsValue(w)) ||
+      waveformCount(w) < 4 * (int)XtWidth(w))
+    return False;
+  if (env->x && (env->xmin != *xMin(w) || env->xmax != *xMax(w) ||
+                 env->ymin != *yMin(w) || env->ymax != *yMax(w) ||
+                 env->width != XtWidth(w) || env->height != XtHeight(w) ||
+                 env->xoffset != xOffset(w) || env->yoffset != yOffset(w)))
+    FreeEnvelope(w);
+  return True;
+}
+
+/* index of the first sample after start in another pixel column */
+static int ColumnEnd(int *xp, int start, int count)
+{
+  int x = xp[start];
+  int i = start + 1;
+#ifdef __SSE2__
+  __m128i column = _mm_set1_epi32(x);
+  for (; i + 4 <= count; i += 4)
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(
+            _mm_loadu_si128((__m128i *)(xp + i)), column)) != 0xFFFF)
+      break;
+#endif
+  while (i < count && xp[i] == x)
+    i++;
+  return i;
+}
+
+static void ColumnRange(int *yp, int num, int *lo, int *hi)
+{
+  int i = 0;
+  int ymin = yp[0];
+  int ymax = yp[0];
+#ifdef __SSE2__
+  if (num >= 8)
+  {
+    __m128i vmin = _mm_set1_epi32(ymin);
+    __m128i vmax = vmin;
+    int mins[4];
+    int maxs[4];
+    for (; i + 4 <= num; i += 4)
+    {
+      __m128i y = _mm_loadu_si128((__m128i *)(yp + i));
+      __m128i lt = _mm_cmplt_epi32(y, vmin);
+      __m128i gt = _mm_cmpgt_epi32(y, vmax);
+      vmin = _mm_or_si128(_mm_and_si128(lt, y), _mm_andnot_si128(lt, vmin));
+      vmax = _mm_or_si128(_mm_and_si128(gt, y), _mm_andnot_si128(gt, vmax));
+    }
+    _mm_storeu_si128((__m128i *)mins, vmin);
+    _mm_storeu_si128((__m128i *)maxs, vmax);
+    for (int j = 0; j < 4; j++)
+    {
+      ymin = min(ymin, mins[j]);
+      ymax = max(ymax, maxs[j]);
+    }
+  }
+#endif
+  for (; i < num; i++)
+  {
+    ymin = min(ymin, yp[i]);
+    ymax = max(ymax, yp[i]);
+  }
+  *lo = ymin;
+  *hi = ymax;
+}
+
+static void GetEnvelope(XmdsWaveformWidget w)
+{
+  XmdsWaveformEnvelope *env = &waveformEnvelope(w);
+  int count = waveformCount(w);
+  int *xp = xPixValue(w);
+  int *yp = yPixValue(w);
+  Boolean *pd = waveformPenDownValue(w);
+  int xoff = xOffset(w);
+  int yoff = yOffset(w);
+  int n = 0;
+  int i;
+  int j;
+  FreeEnvelope(w);
+  env->x = (int *)XtMalloc(count * sizeof(int));
+  env->y = (int *)XtMalloc(count * sizeof(int));
+  if (pd)
+    env->pen_down = (Boolean *)XtMalloc(count * sizeof(Boolean));
+#define AddPoint(xval, yval, penDown)                                          \
+  if (!n || xval != env->x[n - 1] || yval != env->y[n - 1] ||                  \
+      (pd && !env->pen_down[n - 1]))                                           \
+  {                                                                            \
+    env->x[n] = xval;                                                          \
+    env->y[n] = yval;                                                          \
+    if (pd)                                                                    \
+      env->pen_down[n] = penDown;                                              \
+    n++;                                                                       \
+  }
+  for (i = 0; i < count; i = j)
+  {
+    int x = xp[i];
+    int lo;
+    int hi;
+    j = i + 1;
+    if (x != missing && x > -32768 - xoff && x < 32767 - xoff)
+    {
+      j = ColumnEnd(xp, i, count);
+      if (pd)
+      {
+        int k;
+        for (k = i + 1; k < j && pd[k]; k++)
+          ;
+        j = k;
+      }
+    }
+    if (j - i > 4)
+    {
+      ColumnRange(yp + i, j - i, &lo, &hi);
+      if (lo > -32768 - yoff && hi < 32767 - yoff)
+      {
+        env->x[n] = x;
+        env->y[n] = yp[i];
+        if (pd)
+          env->pen_down[n] = pd[i];
+        n++;
+        AddPoint(x, lo, True);
+        AddPoint(x, hi, True);
+        AddPoint(x, yp[j - 1], True);
+        continue;
+      }
+    }
+    for (; i < j; i++)
+    {
+      env->x[n] = xp[i];
+      env->y[n] = yp[i];
+      if (pd)
+        env->pen_down[n] = pd[i];
+      n++;
+    }
+  }
+#undef AddPoint
+  env->count = n;
+  env->x = (int *)XtRealloc((char *)env->x, n * sizeof(int));
+  env->y = (int *)XtRealloc((char *)env->y, n * sizeof(int));
+  if (pd)
+    env->pen_down =
+        (Boolean *)XtRealloc((char *)env->pen_down, n * sizeof(Boolean));
+  env->xmin = *xMin(w);
+  env->xmax = *xMax(w);
+  env->ymin = *yMin(w);
+  env->ymax = *yMax(w);
+  env->width = XtWidth(w);
+  env->height = XtHeight(w);
+  env->xoffset = xoff;
+  env->yoffset = yoff;
+}
+
 #define LoadPoint(idx, penDown)                                                \
   {                                                                            \
     XPoint this_point;                                                         \
@@ -1220,15 +1407,23 @@ static void Plot(XmdsWaveformWidget w, Boolean free_mem)
   }
   if (waveformCount(w))
   {
-    if (xPixValue(w) == 0 || yPixValue(w) == 0)
+    Boolean envelope = UseEnvelope(w);
+    if (envelope && !waveformEnvelope(w).x)
+    {
+      if (xPixValue(w) == 0 || yPixValue(w) == 0)
+        GetPixVals(w, XtWidth(w), XtHeight(w));
+      GetEnvelope(w);
+    }
+    else if (!envelope && (xPixValue(w) == 0 || yPixValue(w) == 0))
       GetPixVals(w, XtWidth(w), XtHeight(w));
     {
       int i;
-      int count = waveformCount(w);
-      Boolean *pd = waveformPenDownValue(w);
-      int *xp = xPixValue(w);
+      int count = envelope ? waveformEnvelope(w).count : waveformCount(w);
+      Boolean *pd =
+          envelope ? waveformEnvelope(w).pen_down : waveformPenDownValue(w);
+      int *xp = envelope ? waveformEnvelope(w).x : xPixValue(w);
       int xoff = xOffset(w);
-      int *yp = yPixValue(w);
+      int *yp = envelope ? waveformEnvelope(w).y : yPixValue(w);
       int yoff = yOffset(w);
       Boolean *selections = waveformSelectionsValue(w);
       Boolean step = waveformStepPlot(w);
@@ -2106,6 +2301,7 @@ static void Update(Widget w_in,
   int old_count = waveformCount(w);
   waveformPanning(w) = 0;
   FreePixVals(w);
+  FreeEnvelope(w);
   if (xValStruct(w))
   {
     if (xValStruct(w)->destroy)
@@ -2156,6 +2352,7 @@ static void SetWave(Widget w_in,
   int old_count = waveformCount(w);
   waveformPanning(w) = 0;
   FreePixVals(w);
+  FreeEnvelope(w);
   waveformCount(w) = count;
 #define UpdateField(field, type)                                            \
   if (old_count != count)                                                   \
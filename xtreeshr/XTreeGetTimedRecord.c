@@ -119,56 +119,110 @@ static int checkResampledVersion(int nid, mdsdsc_t *deltaD)
   return outNid;
 }
 
-EXPORT int XTreeGetTimedRecord(int inNid, mdsdsc_t *inStartD, mdsdsc_t *inEndD,
-                               mdsdsc_t *inMinDeltaD, mdsdsc_xd_t *outSignal)
+// Find the segments overlapping [start, end]. *startIdx is set to
+// *numSegments if there is none.
+static int findSegments(int nid, mdsdsc_t *startD, mdsdsc_t *endD,
+                        int *numSegments, int *startIdx, int *endIdx)
 {
-  int status, nid;
-  int actNumSegments, currSegIdx, nonEmptySegIdx, numSegments, currIdx,
-      numDimensions;
-  int i, nameLen, startIdx, endIdx;
-  char resampleFunName[MAX_FUN_NAMELEN], squishFunName[MAX_FUN_NAMELEN];
-  char resampleMode[MAX_FUN_NAMELEN];
+  int status, currSegIdx;
   EMPTYXD(startTimesXd);
   EMPTYXD(endTimesXd);
-  double *startTimes, *endTimes, start, end;
+  EMPTYXD(xd);
+  struct descriptor_a *startTimesApd;
+  struct descriptor_a *endTimesApd;
+  double *startTimes = NULL, *endTimes = NULL, start = 0, end = 0;
 
-  
-  //Start, End, Delta MUST be copied becuse they may become invalid in case TreeSetTimeContext is internally called (e.g. in DefaultResample)
-  EMPTYXD(startXd);
-  EMPTYXD(endXd);
-  EMPTYXD(minDeltaXd);
-  mdsdsc_t *startD, *endD, *minDeltaD;
-  if (inStartD)
-  {
-    MdsCopyDxXd(inStartD, &startXd);
-    startD = startXd.pointer;
-  }
-  else
-    startD = NULL;
-  if (inEndD)
+  // Get segment limits. If not evaluated to 64 bit int, make the required
+  // conversion.
+  // New management based on TreeGetSegmentLimits()
+  status = TreeGetSegmentTimesXd(nid, numSegments, &startTimesXd, &endTimesXd);
+  if (STATUS_NOT_OK)
+    return status;
+  // Convert read times into 64 bit representation
+  status = 0; // Internal error
+  if (startTimesXd.pointer == 0 || endTimesXd.pointer == 0)
+    goto cleanup;
+  startTimesApd = (struct descriptor_a *)startTimesXd.pointer;
+  endTimesApd = (struct descriptor_a *)endTimesXd.pointer;
+  if ((int)(startTimesApd->arsize / startTimesApd->length) != *numSegments)
+    goto cleanup;
+  if ((int)(endTimesApd->arsize / endTimesApd->length) != *numSegments)
+    goto cleanup;
+
+  status = TdiData(*(mdsdsc_t **)startTimesApd->pointer, &xd MDS_END_ARG);
+  MdsFree1Dx(&xd, 0);
+  // Evaluate start, end to double
+  if (STATUS_OK && startD)
+    status = XTreeConvertToDouble(startD, &start);
+  if (STATUS_OK && endD)
+    status = XTreeConvertToDouble(endD, &end);
+  if (STATUS_NOT_OK)
+    goto cleanup;
+
+  startTimes = (double *)malloc(*numSegments * sizeof(double));
+  endTimes = (double *)malloc(*numSegments * sizeof(double));
+  for (currSegIdx = 0; currSegIdx < *numSegments; currSegIdx++)
   {
-    MdsCopyDxXd(inEndD, &endXd);
-    endD = endXd.pointer;
+    status = XTreeConvertToDouble(
+        ((mdsdsc_t **)(startTimesApd->pointer))[currSegIdx],
+        &startTimes[currSegIdx]);
+    if (STATUS_OK)
+      status = XTreeConvertToDouble(
+          ((mdsdsc_t **)(endTimesApd->pointer))[currSegIdx],
+          &endTimes[currSegIdx]);
+    if (STATUS_NOT_OK)
+      goto cleanup;
   }
+
+  if (!startD) // If no start time specified, take all initial segments
+    *startIdx = 0;
+  else // find first overlapping segment
+    for (*startIdx = 0;
+         *startIdx < *numSegments && endTimes[*startIdx] < start;
+         (*startIdx)++)
+      ;
+  if (!endD)
+    *endIdx = *numSegments - 1;
   else
-    endD = NULL;
-  if (inMinDeltaD)
   {
-    MdsCopyDxXd(inMinDeltaD, &minDeltaXd);
-    minDeltaD = minDeltaXd.pointer;
+    for (currSegIdx = *startIdx; currSegIdx < *numSegments; currSegIdx++)
+    {
+      if (endTimes[currSegIdx] >= end)
+      { // Last overlapping segment
+        if (startTimes[currSegIdx] > end && currSegIdx > *startIdx)
+          currSegIdx--;
+        break;
+      }
+    }
+    *endIdx = currSegIdx == *numSegments
+                  ? currSegIdx - 1
+                  : currSegIdx; // No segment (section) after end
   }
-  else
-    minDeltaD = NULL;
-  
-  
-  
+
+cleanup:
+  free(startTimes);
+  free(endTimes);
+  MdsFree1Dx(&startTimesXd, 0);
+  MdsFree1Dx(&endTimesXd, 0);
+  return status;
+}
+
+// Read segments startIdx to endIdx, resample each one unless no time window
+// is given and squish them into a single signal
+static int getSegments(int inNid, int nid, int startIdx, int endIdx,
+                       mdsdsc_t *startD, mdsdsc_t *endD, mdsdsc_t *minDeltaD,
+                       mdsdsc_xd_t *outSignal)
+{
+  int status;
+  int actNumSegments, currSegIdx, nonEmptySegIdx, currIdx, numDimensions;
+  int i, nameLen;
+  char resampleFunName[MAX_FUN_NAMELEN], squishFunName[MAX_FUN_NAMELEN];
+  char resampleMode[MAX_FUN_NAMELEN];
   mdsdsc_t resampleFunNameD = {0, DTYPE_T, CLASS_S, resampleFunName};
   mdsdsc_t squishFunNameD = {0, DTYPE_T, CLASS_S, squishFunName};
   DESCRIPTOR_R(resampleFunD, DTYPE_FUNCTION, 6);
   DESCRIPTOR_R(squishFunD, DTYPE_FUNCTION, 6);
 
-  struct descriptor_a *startTimesApd;
-  struct descriptor_a *endTimesApd;
   struct descriptor_a *currApd;
   EMPTYXD(xd);
   EMPTYXD(emptyXd);
@@ -180,10 +234,6 @@ EXPORT int XTreeGetTimedRecord(int inNid, mdsdsc_t *inStartD, mdsdsc_t *inEndD,
   DESCRIPTOR_APD(signalsApd, DTYPE_SIGNAL, 0, 0);
   mds_signal_t **signals;
 
-  // Check for possible resampled versions
-  nid = checkResampledVersion(inNid, minDeltaD);
-
-  timedAccessFlag = 1;
   // Get names for (possible) user defined  resample and squish funs
   status = TreeGetXNci(nid, "ResampleFun", &xd);
   if (STATUS_OK && xd.pointer)
@@ -224,91 +274,7 @@ EXPORT int XTreeGetTimedRecord(int inNid, mdsdsc_t *inStartD, mdsdsc_t *inEndD,
   else
     resampleMode[0] = 0;
 
-  // Get segment limits. If not evaluated to 64 bit int, make the required
-  // conversion.
-  // New management based on TreeGetSegmentLimits()
-  status = TreeGetSegmentTimesXd(nid, &numSegments, &startTimesXd, &endTimesXd);
-  if (STATUS_NOT_OK)
-    return status;
-  // Convert read times into 64 bit representation
-  if (startTimesXd.pointer == 0 || endTimesXd.pointer == 0)
-    return 0; // Internal error
-  startTimesApd = (struct descriptor_a *)startTimesXd.pointer;
-  endTimesApd = (struct descriptor_a *)endTimesXd.pointer;
-
-  status = TdiData(*(mdsdsc_t **)startTimesApd->pointer, &xd MDS_END_ARG);
-  if (STATUS_NOT_OK)
-    return status;
-  MdsFree1Dx(&xd, 0);
-  // Evaluate start, end to int64
-  if (startD)
-  {
-    status = XTreeConvertToDouble(startD, &start);
-    if (STATUS_NOT_OK)
-      return status;
-  }
-  if (endD)
-  {
-    status = XTreeConvertToDouble(endD, &end);
-    if (STATUS_NOT_OK)
-      return status;
-  }
-
-  if ((int)(startTimesApd->arsize / startTimesApd->length) != numSegments)
-    return 0; // Internal error
-  if ((int)(endTimesApd->arsize / endTimesApd->length) != numSegments)
-    return 0; // Internal error
-  startTimes = (double *)malloc(numSegments * sizeof(double));
-  endTimes = (double *)malloc(numSegments * sizeof(double));
-  for (currSegIdx = 0; currSegIdx < numSegments; currSegIdx++)
-  {
-    status = XTreeConvertToDouble(
-        ((mdsdsc_t **)(startTimesApd->pointer))[currSegIdx],
-        &startTimes[currSegIdx]);
-    if (STATUS_NOT_OK)
-      return status;
-    status =
-        XTreeConvertToDouble(((mdsdsc_t **)(endTimesApd->pointer))[currSegIdx],
-                             &endTimes[currSegIdx]);
-    if (STATUS_NOT_OK)
-      return status;
-  }
-  MdsFree1Dx(&startTimesXd, 0);
-  MdsFree1Dx(&endTimesXd, 0);
-
-  if (!startD) // If no start time specified, take all initial segments
-    startIdx = 0;
-  else // find first overlapping segment
-    for (startIdx = 0; startIdx < numSegments && endTimes[startIdx] < start;
-         startIdx++)
-      ;
-  if (startIdx == numSegments)
-  {
-    MdsCopyDxXd((mdsdsc_t *)&emptyXd, outSignal); // return an empty XD
-    return 1;
-  }
-  if (!endD)
-    endIdx = numSegments - 1;
-  else
-  {
-    for (currSegIdx = startIdx; currSegIdx < numSegments; currSegIdx++)
-    {
-      if (endTimes[currSegIdx] >= end)
-      { // Last overlapping segment
-        if (startTimes[currSegIdx] > end && currSegIdx > startIdx)
-          currSegIdx--;
-        break;
-      }
-    }
-    endIdx = currSegIdx == numSegments
-                 ? currSegIdx - 1
-                 : currSegIdx; // No segment (section) after end
-  }
   actNumSegments = endIdx - startIdx + 1;
-
-  free(startTimes);
-  free(endTimes);
-
   signals = (mds_signal_t **)malloc(actNumSegments * sizeof(mds_signal_t *));
   signalsApd.pointer = (mdsdsc_t **)signals;
   signalsApd.arsize = actNumSegments * sizeof(mds_signal_t *);
@@ -486,6 +452,55 @@ EXPORT int XTreeGetTimedRecord(int inNid, mdsdsc_t *inStartD, mdsdsc_t *inEndD,
       MdsFree1Dx(&emptyXd, NULL);
     }
   }
+  return status;
+}
+
+EXPORT int XTreeGetTimedRecord(int inNid, mdsdsc_t *inStartD, mdsdsc_t *inEndD,
+                               mdsdsc_t *inMinDeltaD, mdsdsc_xd_t *outSignal)
+{
+  int status, nid, numSegments, startIdx = 0, endIdx = 0;
+  EMPTYXD(emptyXd);
+
+  //Start, End, Delta MUST be copied becuse they may become invalid in case TreeSetTimeContext is internally called (e.g. in DefaultResample)
+  EMPTYXD(startXd);
+  EMPTYXD(endXd);
+  EMPTYXD(minDeltaXd);
+  mdsdsc_t *startD, *endD, *minDeltaD;
+  if (inStartD)
+  {
+    MdsCopyDxXd(inStartD, &startXd);
+    startD = startXd.pointer;
+  }
+  else
+    startD = NULL;
+  if (inEndD)
+  {
+    MdsCopyDxXd(inEndD, &endXd);
+    endD = endXd.pointer;
+  }
+  else
+    endD = NULL;
+  if (inMinDeltaD)
+  {
+    MdsCopyDxXd(inMinDeltaD, &minDeltaXd);
+    minDeltaD = minDeltaXd.pointer;
+  }
+  else
+    minDeltaD = NULL;
+
+  // Check for possible resampled versions
+  nid = checkResampledVersion(inNid, minDeltaD);
+
+  timedAccessFlag = 1;
+  status = findSegments(nid, startD, endD, &numSegments, &startIdx, &endIdx);
+  if (STATUS_OK)
+  {
+    if (startIdx == numSegments)
+      MdsCopyDxXd((mdsdsc_t *)&emptyXd, outSignal); // return an empty XD
+    else
+      status = getSegments(inNid, nid, startIdx, endIdx, startD, endD,
+                           minDeltaD, outSignal);
+  }
   MdsFree1Dx(&startXd, NULL);
   MdsFree1Dx(&endXd, NULL);
   MdsFree1Dx(&minDeltaXd, NULL);
@@ -493,6 +508,39 @@ EXPORT int XTreeGetTimedRecord(int inNid, mdsdsc_t *inStartD, mdsdsc_t *inEndD,
   return status;
 }
 
+// Return the segments overlapping [start, end] and one more segment on each
+// side, not resampled. The result is the part of the full record that a
+// subscript by a time (window) within [start, end] can select.
+EXPORT int XTreeGetTimedSegments(int nid, mdsdsc_t *startD, mdsdsc_t *endD,
+                                 mdsdsc_xd_t *outSignal)
+{
+  int status, numSegments, startIdx = 0, endIdx = 0;
+
+  status = findSegments(nid, startD, endD, &numSegments, &startIdx, &endIdx);
+  if (STATUS_NOT_OK)
+    return status;
+  if (numSegments < 1)
+    return 0; // Internal error
+  if (startIdx >= numSegments)
+    startIdx = numSegments - 1;
+  if (endIdx < startIdx)
+    endIdx = startIdx;
+  if (startIdx > 0)
+    startIdx--;
+  if (endIdx < numSegments - 1)
+    endIdx++;
+  timedAccessFlag = 1;
+  return getSegments(nid, nid, startIdx, endIdx, NULL, NULL, NULL, outSignal);
+}
+
+// Return segments startIdx to endIdx, not resampled
+EXPORT int XTreeGetSegmentRange(int nid, int startIdx, int endIdx,
+                                mdsdsc_xd_t *outSignal)
+{
+  timedAccessFlag = 1;
+  return getSegments(nid, nid, startIdx, endIdx, NULL, NULL, NULL, outSignal);
+}
+
 EXPORT int _XTreeGetTimedRecord(void *dbid, int nid, mdsdsc_t *startD,
                                 mdsdsc_t *endD, mdsdsc_t *minDeltaD,
                                 mdsdsc_xd_t *outSignal)
@@ -503,3 +551,23 @@ EXPORT int _XTreeGetTimedRecord(void *dbid, int nid, mdsdsc_t *startD,
   CTX_POP(&dbid);
   return status;
 }
+
+EXPORT int _XTreeGetTimedSegments(void *dbid, int nid, mdsdsc_t *startD,
+                                  mdsdsc_t *endD, mdsdsc_xd_t *outSignal)
+{
+  int status;
+  CTX_PUSH(&dbid);
+  status = XTreeGetTimedSegments(nid, startD, endD, outSignal);
+  CTX_POP(&dbid);
+  return status;
+}
+
+EXPORT int _XTreeGetSegmentRange(void *dbid, int nid, int startIdx, int endIdx,
+                                 mdsdsc_xd_t *outSignal)
+{
+  int status;
+  CTX_PUSH(&dbid);
+  status = XTreeGetSegmentRange(nid, startIdx, endIdx, outSignal);
+  CTX_POP(&dbid);
+  return status;
+}